@@ -0,0 +1,143 @@
+/*
+ Dmscanlib is a software library and standalone application that scans
+ and decodes libdmtx compatible test-tubes. It is currently designed
+ to decode 12x8 pallets that use 2D data-matrix laser etched test-tubes.
+ Copyright (C) 2010 Canadian Biosample Repository
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DecodeJob.h"
+#include "DmScanLib.h"
+#include "decoder/WellDecoder.h"
+
+#define GLOG_NO_ABBREVIATED_SEVERITIES
+#include <glog/logging.h>
+#include <OpenThreads/ScopedLock>
+#include <OpenThreads/Thread>
+
+#include <stdexcept>
+
+namespace dmscanlib {
+
+class DecodeJob::Runner: public ::OpenThreads::Thread {
+public:
+    Runner(DecodeJob & _job) :
+            job(_job)
+    {
+    }
+
+    virtual ~Runner() {
+    }
+
+    virtual void run() {
+        job.run();
+    }
+
+private:
+    DecodeJob & job;
+};
+
+DecodeJob::DecodeJob(DmScanLib & _dmScanLib,
+        const std::string & _filename,
+        const DecodeOptions & _decodeOptions,
+        std::vector<std::unique_ptr<const WellRectangle> > & _wellRects,
+        DecodeListener * _callback) :
+        dmScanLib(_dmScanLib),
+        filename(_filename),
+        decodeOptions(_decodeOptions),
+        wellRects(_wellRects),
+        callback(_callback),
+        cancelled(false),
+        finished(false),
+        result(SC_FAIL),
+        runner(new Runner(*this))
+{
+    runner->start();
+}
+
+DecodeJob::~DecodeJob() {
+    cancel();
+    wait();
+    runner->join();
+}
+
+void DecodeJob::run() {
+    int decodeResult;
+
+    dmScanLib.setListener(this);
+    try {
+        decodeResult = dmScanLib.decodeImageWells(filename.c_str(), decodeOptions, wellRects);
+    } catch (std::exception & e) {
+        // nothing can catch it on this thread
+        LOG(WARNING) << "DecodeJob: " << e.what();
+        decodeResult = SC_FAIL;
+    }
+    dmScanLib.setListener(NULL);
+
+    VLOG(3) << "DecodeJob: filename/" << filename << " result/" << decodeResult;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+    result = decodeResult;
+    finished = true;
+    finishedCondition.broadcast();
+}
+
+void DecodeJob::cancel() {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+    cancelled = true;
+}
+
+bool DecodeJob::isCancelled() const {
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+        if (cancelled) {
+            return true;
+        }
+    }
+    return (callback != NULL) && callback->isCancelled();
+}
+
+bool DecodeJob::isDone() const {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+    return finished;
+}
+
+int DecodeJob::wait() {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+    while (!finished) {
+        finishedCondition.wait(&mutex);
+    }
+    return result;
+}
+
+unsigned DecodeJob::poll(std::vector<WellResult> & results) {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+    unsigned count = pending.size();
+    results.insert(results.end(), pending.begin(), pending.end());
+    pending.clear();
+    return count;
+}
+
+void DecodeJob::wellDecoded(const WellDecoder & wellDecoder) {
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+        pending.push_back(WellResult(wellDecoder.getLabel(), wellDecoder.getMessage()));
+    }
+    if (callback != NULL) {
+        callback->wellDecoded(wellDecoder);
+    }
+}
+
+} /* namespace */
@@ -0,0 +1,116 @@
+#ifndef __INC_DECODE_JOB_H
+#define __INC_DECODE_JOB_H
+
+/*
+ Dmscanlib is a software library and standalone application that scans
+ and decodes libdmtx compatible test-tubes. It is currently designed
+ to decode 12x8 pallets that use 2D data-matrix laser etched test-tubes.
+ Copyright (C) 2010 Canadian Biosample Repository
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "decoder/DecodeListener.h"
+#include "decoder/WellRectangle.h"
+
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Condition>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dmscanlib {
+
+class DmScanLib;
+class DecodeOptions;
+
+/*
+ * Decodes an image on its own thread. The constructor returns as soon as the
+ * thread is started, and each well's result can then be collected with poll()
+ * or handed to a callback as soon as that well is decoded.
+ *
+ * The DmScanLib, the options and the well rectangles must outlive the job,
+ * and the DmScanLib must not be used by anyone else until wait() returns. Its
+ * decoded wells hold the final result: a well reported early can still be
+ * dropped if the plate has duplicate messages.
+ */
+class DecodeJob: public DecodeListener {
+public:
+    // the well's label and its message
+    typedef std::pair<std::string, std::string> WellResult;
+
+    /*
+     * The callback, when given, is called from the decoding threads as well
+     * as queuing the result for poll(), and is also asked whether to cancel.
+     */
+    DecodeJob(DmScanLib & dmScanLib,
+            const std::string & filename,
+            const DecodeOptions & decodeOptions,
+            std::vector<std::unique_ptr<const WellRectangle> > & wellRects,
+            DecodeListener * callback = NULL);
+
+    // cancels the job if it is still running and waits for it
+    virtual ~DecodeJob();
+
+    /*
+     * The wells not yet started are skipped. The ones in progress finish, and
+     * wait() then returns SC_DECODE_CANCELLED.
+     */
+    void cancel();
+
+    virtual bool isCancelled() const;
+
+    bool isDone() const;
+
+    // blocks until the decode has finished and returns its result code
+    int wait();
+
+    /*
+     * Appends the wells decoded since the last call to results and returns
+     * how many were added. Never blocks on the decode.
+     */
+    unsigned poll(std::vector<WellResult> & results);
+
+    virtual void wellDecoded(const WellDecoder & wellDecoder);
+
+private:
+    class Runner;
+
+    void run();
+
+    DmScanLib & dmScanLib;
+    const std::string filename;
+    const DecodeOptions & decodeOptions;
+    std::vector<std::unique_ptr<const WellRectangle> > & wellRects;
+    DecodeListener * callback;
+
+    std::vector<WellResult> pending;
+    bool cancelled;
+    bool finished;
+    int result;
+    mutable OpenThreads::Mutex mutex;
+    OpenThreads::Condition finishedCondition;
+
+    // started last, once everything it uses is constructed
+    std::unique_ptr<Runner> runner;
+
+    DecodeJob(const DecodeJob &);
+    DecodeJob & operator=(const DecodeJob &);
+};
+
+} /* namespace */
+
+#endif /* __INC_DECODE_JOB_H */
@@ -30,14 +30,21 @@
 #include "DmScanLib.h"
 #include "imgscanner/ImgScanner.h"
 #include "decoder/Decoder.h"
+#include "decoder/BandDecoder.h"
 #include "decoder/DecodeOptions.h"
 #include "decoder/WellDecoder.h"
+#include "decoder/PlateLayout.h"
+#include "decoder/ThreadMgr.h"
+#include "decoder/DecodeListener.h"
 #include "Image.h"
 
 #include <stdio.h>
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <OpenThreads/Thread>
 
 #define GLOG_NO_ABBREVIATED_SEVERITIES
 #include <glog/logging.h>
@@ -52,13 +59,84 @@ const std::string DmScanLib::LIBRARY_NAME("dmscanlib");
 
 bool DmScanLib::loggingInitialized = false;
 
+bool DmScanLib::metricsEnabled = false;
+
+bool DmScanLib::locateTubes = false;
+
+bool DmScanLib::refitGrid = false;
+
+unsigned DmScanLib::rescanDpi = 0;
+
+std::unique_ptr<DecodeTuner> DmScanLib::tuner;
+
+std::unique_ptr<DecodeCache> DmScanLib::decodeCache;
+
+namespace {
+
+// the layouts registered by registerLayout(), shared by all instances
+OpenThreads::Mutex layoutsMutex;
+std::map<int, std::shared_ptr<const PlateLayout> > layouts;
+int nextLayoutId = 1;
+
+std::shared_ptr<const PlateLayout> getLayout(int layoutId) {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(layoutsMutex);
+    std::map<int, std::shared_ptr<const PlateLayout> >::const_iterator it =
+            layouts.find(layoutId);
+    if (it == layouts.end()) {
+        return std::shared_ptr<const PlateLayout>();
+    }
+    return it->second;
+}
+
+/*
+ * Creates the decoder of one plate of a flatbed scan on its own thread, since
+ * creating it filters the plate's part of the image.
+ */
+class PlateDecoderBuilder: public ::OpenThreads::Thread {
+public:
+    PlateDecoderBuilder(const Image & _plateImage, const DecodeOptions & _decodeOptions,
+            std::shared_ptr<const PlateLayout> _layout) :
+            plateImage(_plateImage),
+            decodeOptions(_decodeOptions),
+            layout(_layout)
+    {
+    }
+
+    virtual ~PlateDecoderBuilder() {
+    }
+
+    virtual void run() {
+        try {
+            decoder = std::unique_ptr<Decoder>(new Decoder(plateImage, decodeOptions, layout));
+        } catch (const std::invalid_argument & e) {
+            LOG(WARNING) << "PlateDecoderBuilder: " << e.what();
+        }
+    }
+
+    // NULL when the plate's wells do not fit in its region
+    std::unique_ptr<Decoder> decoder;
+
+private:
+    const Image plateImage;
+    const DecodeOptions & decodeOptions;
+    std::shared_ptr<const PlateLayout> layout;
+};
+
+} /* namespace */
+
 DmScanLib::DmScanLib() :
-        imgScanner(std::move(ImgScanner::create()))
+        imgScanner(std::move(ImgScanner::create())),
+        threadMgr(NULL),
+        listener(NULL),
+        decodedFromCache(false)
 {
 }
 
 DmScanLib::DmScanLib(unsigned loggingLevel, bool logToFile) :
-        imgScanner(std::move(ImgScanner::create()))
+        imgScanner(std::move(ImgScanner::create())),
+        threadMgr(NULL),
+        listener(NULL),
+        decodedFromCache(false)
 {
     configLogging(loggingLevel, logToFile);
 }
@@ -160,22 +238,188 @@ int DmScanLib::scanAndDecode(
             << " contrast/" << contrast
             << " " << region << " " << decodeOptions;
 
-    HANDLE h;
-    int result;
+    std::shared_ptr<const PlateLayout> layout(new PlateLayout(wellRects));
+    const DecodeOptions & options = selectDecodeOptions(decodeOptions);
+
+    BandDecoder bandDecoder(options, layout);
+    bandDecoder.setCollectMetrics(metricsEnabled);
+    bandDecoder.setLocateTubes(locateTubes);
+    bandDecoder.setRefitGrid(refitGrid);
+    bandDecoder.setThreadMgr(threadMgr);
+    bandDecoder.setListener(listener);
+
+    cv::Mat scanned;
+    const int scanResult = imgScanner->acquireImageBands(
+            dpi, brightness, contrast, region, scanned, bandDecoder);
+
+    // the metrics cover the time from the end of the scan, which is all the
+    // decode adds to it
+    util::DmStopwatch stopwatch;
+    int result = bandDecoder.finish(scanResult == SC_SUCCESS);
+    if (scanResult != SC_SUCCESS) {
+        VLOG(1) << "could not acquire image";
+        return scanResult;
+    }
+
+    decoder = bandDecoder.releaseDecoder();
+    if (decoder.get() == NULL) {
+        return result;
+    }
+    decoder->setThreadMgr(threadMgr);
+    VLOG(3) << "scanAndDecode: preprocess seconds during scan/"
+            << bandDecoder.getPreprocessSeconds();
+
+    const ScanSettings scan = { dpi, brightness, contrast, region };
+    Image image(scanned);
+    image.write("scanned.png");
+    result = finishDecode(image, decodeOptions, "decode.png", result, 0, stopwatch, &scan);
+
+    VLOG(1) << "scanAndDecode returned: " << result;
+    return result;
+}
+
+int DmScanLib::scanAndDecodePlates(
+        const unsigned dpi,
+        const int brightness,
+        const int contrast,
+        const std::vector<cv::Rect_<float> > & regions,
+        const std::vector<int> & layoutIds,
+        const DecodeOptions & decodeOptions) {
+
+    VLOG(3) << "scanAndDecodePlates: dpi/" << dpi
+            << " brightness/" << brightness
+            << " contrast/" << contrast
+            << " numPlates/" << regions.size()
+            << " " << decodeOptions;
+
+    plateDecoders.clear();
+    plateResults.clear();
 
-    h = imgScanner->acquireImage(dpi, brightness, contrast, region);
+    if (regions.empty() || (regions.size() != layoutIds.size())) {
+        return SC_INVALID_NOTHING_TO_DECODE;
+    }
+
+    std::vector<std::shared_ptr<const PlateLayout> > plateLayouts(layoutIds.size());
+    for (unsigned i = 0, n = layoutIds.size(); i < n; ++i) {
+        plateLayouts[i] = getLayout(layoutIds[i]);
+        if (plateLayouts[i].get() == NULL) {
+            VLOG(1) << "scanAndDecodePlates: layout not registered: " << layoutIds[i];
+            return SC_INVALID_NOTHING_TO_DECODE;
+        }
+    }
+
+    HANDLE h = imgScanner->acquireFlatbed(dpi, brightness, contrast);
     if (h == NULL) {
         VLOG(1) << "could not acquire image";
         return imgScanner->getErrorCode();
     }
 
-    Image image(h);
-    image.write("scanned.png");
-    result = decodeCommon(image, decodeOptions, "decode.png", wellRects);
+    {
+        Image flatbed(h);
+        flatbed.write("scanned.png");
+        decodePlates(flatbed, dpi, regions, plateLayouts, decodeOptions);
+    }
 
     imgScanner->freeImage(h);
-    VLOG(1) << "decodeCommon returned: " << result;
-    return result;
+    return SC_SUCCESS;
+}
+
+/*
+ * A plate whose region is off the flatbed, or whose wells do not fit in its
+ * region, gets SC_INVALID_NOTHING_TO_DECODE. The tuner's options are used
+ * for the first pass when it is enabled, but the tuner does not learn from
+ * these decodes.
+ */
+void DmScanLib::decodePlates(
+        const Image & flatbed,
+        const unsigned dpi,
+        const std::vector<cv::Rect_<float> > & regions,
+        const std::vector<std::shared_ptr<const PlateLayout> > & plateLayouts,
+        const DecodeOptions & decodeOptions) {
+    const unsigned numPlates = regions.size();
+    const cv::Size size = flatbed.size();
+    const cv::Rect flatbedRect(0, 0, size.width, size.height);
+    const DecodeOptions & options = selectDecodeOptions(decodeOptions);
+
+    plateDecoders.resize(numPlates);
+    plateResults.assign(numPlates, SC_INVALID_NOTHING_TO_DECODE);
+
+    std::vector<std::unique_ptr<PlateDecoderBuilder> > builders(numPlates);
+    for (unsigned i = 0; i < numPlates; ++i) {
+        cv::Rect rect(
+                cvRound(regions[i].x * dpi),
+                cvRound(regions[i].y * dpi),
+                cvRound(regions[i].width * dpi),
+                cvRound(regions[i].height * dpi));
+        rect &= flatbedRect;
+        if (rect.area() == 0) {
+            VLOG(1) << "decodePlates: plate " << i << " is off the flatbed";
+            continue;
+        }
+
+        Image plateImage(flatbed.getOriginalImage()(rect));
+        builders[i] = std::unique_ptr<PlateDecoderBuilder>(
+                new PlateDecoderBuilder(plateImage, options, plateLayouts[i]));
+        builders[i]->start();
+    }
+
+    decoder::ThreadMgr localThreadMgr;
+    decoder::ThreadMgr & plateThreadMgr = (threadMgr != NULL) ? *threadMgr : localThreadMgr;
+
+    std::vector<WellDecoder *> wells;
+    for (unsigned i = 0; i < numPlates; ++i) {
+        if (builders[i].get() == NULL) {
+            continue;
+        }
+        builders[i]->join();
+        plateDecoders[i] = std::move(builders[i]->decoder);
+        if (plateDecoders[i].get() != NULL) {
+            plateDecoders[i]->setCollectMetrics(metricsEnabled);
+            plateDecoders[i]->setLocateTubes(locateTubes);
+            plateDecoders[i]->setRefitGrid(refitGrid);
+            plateDecoders[i]->setThreadMgr(&plateThreadMgr);
+            plateDecoders[i]->setListener(listener);
+            plateDecoders[i]->addWellsTo(wells);
+        }
+    }
+
+    VLOG(3) << "decodePlates: numWells/" << wells.size();
+    plateThreadMgr.decodeWells(wells, listener);
+
+    for (unsigned i = 0; i < numPlates; ++i) {
+        Decoder * plateDecoder = plateDecoders[i].get();
+        if (plateDecoder == NULL) {
+            continue;
+        }
+
+        int result = plateDecoder->decodeLaterStages(plateDecoder->collectDecodedWells());
+        if ((result == SC_SUCCESS) && (tunedOptions.get() != NULL)) {
+            result = plateDecoder->decodeFailedWells(decodeOptions);
+        }
+        if ((result == SC_SUCCESS) && (plateDecoder->getDecodedWellCount() == 0)) {
+            result = SC_INVALID_NOTHING_DECODED;
+        }
+        plateDecoder->setThreadMgr(threadMgr);
+        plateResults[i] = result;
+
+        VLOG(3) << "decodePlates: plate/" << i << " result/" << result
+                << " decoded/" << plateDecoder->getDecodedWellCount();
+    }
+}
+
+int DmScanLib::getPlateResult(unsigned plate) const {
+    if (plate >= plateResults.size()) {
+        throw std::out_of_range("invalid plate");
+    }
+    return plateResults[plate];
+}
+
+const std::map<std::string, const WellDecoder *> & DmScanLib::getDecodedWells(
+        unsigned plate) const {
+    if ((plate >= plateDecoders.size()) || (plateDecoders[plate].get() == NULL)) {
+        throw std::out_of_range("invalid plate");
+    }
+    return plateDecoders[plate]->getDecodedWells();
 }
 
 int DmScanLib::decodeImageWells(
@@ -195,13 +439,178 @@ int DmScanLib::decodeImageWells(
     return decodeCommon(image, decodeOptions, "decode.png", wellRects);
 }
 
+int DmScanLib::decodeImageLayout(
+        const char * filename,
+        const DecodeOptions & decodeOptions,
+        int layoutId) {
+
+    VLOG(1) << "decodeImageLayout: filename/" << filename
+            << " layout/" << layoutId
+            << " " << decodeOptions;
+
+    std::shared_ptr<const PlateLayout> layout = getLayout(layoutId);
+    if (layout.get() == NULL) {
+        VLOG(1) << "decodeImageLayout: layout not registered: " << layoutId;
+        return SC_INVALID_NOTHING_TO_DECODE;
+    }
+
+    Image image(filename);
+    if (!image.isValid()) {
+        return SC_INVALID_IMAGE;
+    }
+
+    return decodeCommon(image, decodeOptions, "decode.png", layout);
+}
+
+int DmScanLib::registerLayout(
+        const std::vector<std::unique_ptr<const WellRectangle> > & wellRects) {
+    std::shared_ptr<const PlateLayout> layout(new PlateLayout(wellRects));
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(layoutsMutex);
+    const int layoutId = nextLayoutId++;
+    layouts[layoutId] = layout;
+    VLOG(1) << "registerLayout: layout/" << layoutId << " numWellRects/" << wellRects.size();
+    return layoutId;
+}
+
+/*
+ * A decode already using the layout keeps its own reference to it.
+ */
+bool DmScanLib::unregisterLayout(int layoutId) {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(layoutsMutex);
+    VLOG(1) << "unregisterLayout: layout/" << layoutId;
+    return layouts.erase(layoutId) > 0;
+}
+
 int DmScanLib::decodeCommon(const Image & image,
         const DecodeOptions & decodeOptions,
         const std::string &decodedDibFilename,
         std::vector<std::unique_ptr<const WellRectangle> > & wellRects) {
+    return decodeCommon(image, decodeOptions, decodedDibFilename,
+            std::shared_ptr<const PlateLayout>(new PlateLayout(wellRects)));
+}
+
+int DmScanLib::decodeCommon(const Image & image,
+        const DecodeOptions & decodeOptions,
+        const std::string &decodedDibFilename,
+        std::shared_ptr<const PlateLayout> layout) {
+
+    util::DmStopwatch stopwatch;
+    decodedFromCache = false;
+
+    DecodeCache * cache = decodeCache.get();
+    DecodeCache::Key cacheKey;
+    if (cache != NULL) {
+        cacheKey = DecodeCache::getKey(image.getOriginalImage(), *layout, decodeOptions,
+                locateTubes, refitGrid);
+        if (decodeFromCache(image, decodeOptions, decodedDibFilename, layout, cacheKey,
+                stopwatch)) {
+            return SC_SUCCESS;
+        }
+    }
 
-    decoder = std::unique_ptr<Decoder>(new Decoder(image, decodeOptions, wellRects));
+    const DecodeOptions & options = selectDecodeOptions(decodeOptions);
+
+    decoder = std::unique_ptr<Decoder>(new Decoder(image, options, layout));
+    decoder->setCollectMetrics(metricsEnabled);
+    decoder->setLocateTubes(locateTubes);
+    decoder->setRefitGrid(refitGrid);
+    decoder->setThreadMgr(threadMgr);
+    decoder->setListener(listener);
+
+    const double preprocessTime = stopwatch.getElapsedSeconds();
     int result = decoder->decodeWellRects();
+    result = finishDecode(image, decodeOptions, decodedDibFilename, result,
+            preprocessTime, stopwatch);
+
+    if ((cache != NULL) && (result == SC_SUCCESS)) {
+        cache->store(cacheKey, *decoder);
+    }
+    return result;
+}
+
+/*
+ * None of the wells are decoded on a hit, so the decoder is given a blank
+ * image of the right size instead of the filtered one. The metrics only have
+ * the total time.
+ */
+bool DmScanLib::decodeFromCache(
+        const Image & image,
+        const DecodeOptions & decodeOptions,
+        const std::string & decodedDibFilename,
+        std::shared_ptr<const PlateLayout> layout,
+        const DecodeCache::Key & key,
+        const util::DmStopwatch & stopwatch) {
+    std::unique_ptr<Decoder> cachedDecoder(new Decoder(
+            Image(cv::Mat(image.size(), CV_8UC1)), decodeOptions, layout, true));
+    if (!decodeCache->restore(key, *cachedDecoder)) {
+        return false;
+    }
+
+    VLOG(1) << "decodeCommon: result from decode cache";
+    decoder = std::move(cachedDecoder);
+    decodedFromCache = true;
+    tunedOptions.reset();
+    writeDecodedImage(image, decodedDibFilename);
+
+    if (metricsEnabled) {
+        const util::DmNanos total = stopwatch.getElapsedNanos();
+        metrics.clear();
+        wellMetrics.clear();
+        metrics.setTime(DecodeMetrics::TOTAL, util::nanosToSeconds(total));
+        decodeLatency.record(total);
+    }
+    return true;
+}
+
+/*
+ * The tuner, when there is one, picks the options for the first pass.
+ */
+const DecodeOptions & DmScanLib::selectDecodeOptions(const DecodeOptions & decodeOptions) {
+    tunedOptions.reset();
+    if (tuner.get() != NULL) {
+        tunedOptions = tuner->getOptions(decodeOptions);
+    }
+    return (tunedOptions.get() != NULL) ? *tunedOptions : decodeOptions;
+}
+
+/*
+ * Takes over once the decoder has been through every well with the options
+ * from selectDecodeOptions(), with result being what that returned.
+ */
+int DmScanLib::finishDecode(
+        const Image & image,
+        const DecodeOptions & decodeOptions,
+        const std::string & decodedDibFilename,
+        int result,
+        double preprocessTime,
+        const util::DmStopwatch & stopwatch,
+        const ScanSettings * scan) {
+    DecodeTuner * decodeTuner = tuner.get();
+    unsigned firstPassDecoded = decoder->getDecodedWellCount();
+
+    if ((result == SC_SUCCESS) && (tunedOptions.get() != NULL)) {
+        // fall back to the caller's options for the wells that were missed
+        result = decoder->decodeFailedWells(decodeOptions);
+        VLOG(3) << "decodeCommon: tuned options decoded " << firstPassDecoded
+                << " of " << decoder->getDecodedWellCount() << " wells";
+    }
+    double wellsEndTime = stopwatch.getElapsedSeconds();
+
+    if ((result == SC_SUCCESS) && (decodeTuner != NULL)) {
+        decodeTuner->observe(decoder->getWellDecoders(), decodeOptions,
+                tunedOptions.get(), firstPassDecoded, wellsEndTime - preprocessTime);
+    }
+
+    // the tuner only learns from the plate as scanned at the caller's DPI
+    if ((result == SC_SUCCESS) && (scan != NULL) && (rescanDpi > scan->dpi)) {
+        result = rescanFailedWells(*scan, decodeOptions);
+        wellsEndTime = stopwatch.getElapsedSeconds();
+    }
+
+    if (metricsEnabled) {
+        updateMetrics(preprocessTime, wellsEndTime - preprocessTime);
+    }
 
     if (result != SC_SUCCESS) {
         return result;
@@ -215,9 +624,170 @@ int DmScanLib::decodeCommon(const Image & image,
 
     writeDecodedImage(image, decodedDibFilename);
 
+    if (metricsEnabled) {
+        const util::DmNanos total = stopwatch.getElapsedNanos();
+        const double totalTime = util::nanosToSeconds(total);
+        metrics.setTime(DecodeMetrics::ANNOTATE, totalTime - wellsEndTime);
+        metrics.setTime(DecodeMetrics::TOTAL, totalTime);
+        decodeLatency.record(total);
+        VLOG(1) << "decodeCommon: metrics: " << metrics;
+        VLOG(1) << "decodeCommon: well latency: " << wellLatency;
+    }
+
     return SC_SUCCESS;
 }
 
+/*
+ * The smallest region of the plate holding all the wells that were missed is
+ * scanned at the rescan DPI, and only those wells are decoded in it. A rescan
+ * that cannot be acquired or decoded leaves the decode as it was. The
+ * listener hears of the wells the rescan adds once they are merged.
+ */
+int DmScanLib::rescanFailedWells(const ScanSettings & scan, const DecodeOptions & decodeOptions) {
+    std::vector<WellDecoder *> failedWells;
+    cv::Rect failedBounds;
+    std::vector<std::unique_ptr<WellDecoder> > & wellDecoders = decoder->getWellDecoders();
+    for (unsigned i = 0, n = wellDecoders.size(); i < n; ++i) {
+        if (wellDecoders[i]->getMessage().empty()) {
+            const cv::Rect & rect = wellDecoders[i]->getWellRegion().getRectangle();
+            failedBounds = failedWells.empty() ? rect : (failedBounds | rect);
+            failedWells.push_back(wellDecoders[i].get());
+        }
+    }
+
+    if (failedWells.empty()) {
+        return SC_SUCCESS;
+    }
+
+    const float dpi = static_cast<float>(scan.dpi);
+    const cv::Rect_<float> region = cv::Rect_<float>(
+            scan.region.x + failedBounds.x / dpi,
+            scan.region.y + failedBounds.y / dpi,
+            failedBounds.width / dpi,
+            failedBounds.height / dpi) & scan.region;
+
+    VLOG(3) << "rescanFailedWells: dpi/" << rescanDpi << " numWells/" << failedWells.size()
+            << " " << region;
+
+    imgScanner->repeatLastPlate();
+    HANDLE h = imgScanner->acquireImage(rescanDpi, scan.brightness, scan.contrast, region);
+    if (h == NULL) {
+        VLOG(1) << "rescanFailedWells: could not acquire image";
+        return SC_SUCCESS;
+    }
+
+    int result;
+    {
+        Image image(h);
+        if (VLOG_IS_ON(2)) {
+            image.write("rescanned.png");
+        }
+
+        // the failed wells, moved to the rescan's origin and scaled to its DPI
+        const float scale = rescanDpi / dpi;
+        const cv::Point2f origin((region.x - scan.region.x) * dpi,
+                (region.y - scan.region.y) * dpi);
+        const cv::Size size = image.size();
+        std::vector<std::unique_ptr<const WellRectangle> > wellRects;
+        for (unsigned i = 0, n = failedWells.size(); i < n; ++i) {
+            const WellRectangle & wellRect = failedWells[i]->getWellRegion();
+            const std::vector<cv::Point2f> & corners = wellRect.getCorners();
+            cv::Point2f rescanCorners[4];
+            for (unsigned c = 0; c < 4; ++c) {
+                const cv::Point2f corner = (corners[c] - origin) * scale;
+                rescanCorners[c] = cv::Point2f(
+                        std::min(std::max(corner.x, 0.0f), size.width - 1.0f),
+                        std::min(std::max(corner.y, 0.0f), size.height - 1.0f));
+            }
+            wellRects.push_back(std::unique_ptr<const WellRectangle>(
+                    new WellRectangle(wellRect.getLabel().c_str(), rescanCorners)));
+        }
+
+        Decoder rescanDecoder(image, decodeOptions, wellRects);
+        rescanDecoder.setCollectMetrics(metricsEnabled);
+        rescanDecoder.setLocateTubes(locateTubes);
+        rescanDecoder.setThreadMgr(threadMgr);
+        result = rescanDecoder.decodeWellRects();
+        if (result == SC_SUCCESS) {
+            result = decoder->mergeRescan(rescanDecoder, origin, 1.0f / scale);
+        } else {
+            VLOG(1) << "rescanFailedWells: could not decode the rescan, result/" << result;
+            result = SC_SUCCESS;
+        }
+    }
+    imgScanner->freeImage(h);
+
+    if (listener != NULL) {
+        for (unsigned i = 0, n = failedWells.size(); i < n; ++i) {
+            if (!failedWells[i]->getMessage().empty()) {
+                listener->wellDecoded(*failedWells[i]);
+            }
+        }
+    }
+
+    VLOG(3) << "rescanFailedWells: result/" << result;
+    return result;
+}
+
+/*
+ * Sums the metrics collected by each well into the plate's metrics. The
+ * plate's WELLS time is the wall clock time taken to decode all the wells.
+ */
+void DmScanLib::updateMetrics(double preprocessTime, double wellsTime) {
+    metrics.clear();
+    wellMetrics.clear();
+
+    std::vector<std::unique_ptr<WellDecoder> > & wellDecoders = decoder->getWellDecoders();
+    for (unsigned i = 0, n = wellDecoders.size(); i < n; ++i) {
+        const WellDecoder & wellDecoder = *wellDecoders[i];
+        metrics.add(wellDecoder.getMetrics());
+        wellMetrics[wellDecoder.getLabel()] = wellDecoder.getMetrics();
+        wellLatency.record(static_cast<util::DmNanos>(
+                wellDecoder.getMetrics().getTime(DecodeMetrics::WELLS) * 1e9));
+    }
+
+    metrics.setTime(DecodeMetrics::PREPROCESS, preprocessTime);
+    metrics.setTime(DecodeMetrics::WELLS, wellsTime);
+    metrics.setTime(DecodeMetrics::TOTAL, preprocessTime + wellsTime);
+}
+
+void DmScanLib::clearLatency() {
+    wellLatency.clear();
+    decodeLatency.clear();
+}
+
+void DmScanLib::setAutoTune(const std::string & stateFilename, double targetRate) {
+    if (stateFilename.empty()) {
+        tuner.reset();
+        return;
+    }
+    tuner = std::unique_ptr<DecodeTuner>(new DecodeTuner(stateFilename, targetRate));
+}
+
+void DmScanLib::setDecodeCache(unsigned maxEntries, const std::string & directory) {
+    if (maxEntries == 0) {
+        decodeCache.reset();
+        return;
+    }
+    decodeCache = std::unique_ptr<DecodeCache>(new DecodeCache(maxEntries, directory));
+}
+
+void DmScanLib::setMetricsEnabled(bool enabled) {
+    metricsEnabled = enabled;
+}
+
+void DmScanLib::setLocateTubes(bool enabled) {
+    locateTubes = enabled;
+}
+
+void DmScanLib::setRefitGrid(bool enabled) {
+    refitGrid = enabled;
+}
+
+void DmScanLib::setRescanDpi(unsigned dpi) {
+    rescanDpi = dpi;
+}
+
 void DmScanLib::writeDecodedImage(
         const Image & image,
         const std::string & decodedDibFilename) {
@@ -237,7 +807,15 @@ void DmScanLib::writeDecodedImage(
     Image decodedImage(image);
 
     for (unsigned i = 0, n = wellDecoders.size(); i < n; ++i) {
-        decodedImage.drawRectangle(wellDecoders[i]->getWellRectangle(), colorBlue);
+        const WellRectangle & wellRect = wellDecoders[i]->getWellRegion();
+        if (!wellRect.isQuad()) {
+            decodedImage.drawRectangle(wellRect.getRectangle(), colorBlue);
+            continue;
+        }
+        const std::vector<cv::Point2f> & corners = wellRect.getCorners();
+        for (unsigned c = 0; c < 4; ++c) {
+            decodedImage.drawLine(corners[c], corners[(c + 1) % 4], colorBlue);
+        }
     }
 
     for (std::map<std::string, const WellDecoder *>::const_iterator ii = decodedWells.begin();
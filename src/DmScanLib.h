@@ -22,7 +22,11 @@
  */
 
 #include "decoder/WellRectangle.h"
+#include "decoder/DecodeMetrics.h"
+#include "decoder/DecodeTuner.h"
+#include "decoder/DecodeCache.h"
 #include "utils/DmTime.h"
+#include "utils/DmLatencyHistogram.h"
 
 #include <string>
 #include <memory>
@@ -42,6 +46,7 @@ const int SC_INVALID_NOTHING_DECODED = -4;
 const int SC_INVALID_IMAGE = -5;
 const int SC_INVALID_NOTHING_TO_DECODE = -6;
 const int SC_INCORRECT_DPI_SCANNED = -7;
+const int SC_DECODE_CANCELLED = -8;
 
 const unsigned CAP_IS_WIA = 0x01;
 const unsigned CAP_DPI_300 = 0x02;
@@ -54,6 +59,12 @@ class Decoder;
 class ImgScanner;
 class WellDecoder;
 class DecodeOptions;
+class DecodeListener;
+class PlateLayout;
+
+namespace decoder {
+class ThreadMgr;
+}
 
 enum Orientation { LANDSCAPE, PORTRAIT, ORIENTATION_MAX };
 
@@ -102,17 +113,203 @@ public:
             const DecodeOptions & decodeOptions,
             std::vector<std::unique_ptr<const WellRectangle> > & wellRects);
 
+    /**
+     * Scans the whole flatbed once and decodes every plate on it. Plate i is
+     * in regions[i], in inches from the top left corner of the flatbed, and
+     * has the wells of the registered layout layoutIds[i], given relative to
+     * the plate's region at the DPI of the scan.
+     *
+     * The plates are filtered in parallel and all their wells are decoded
+     * together by one thread pool. Returns the result of the scan; each
+     * plate's result and wells then come from getPlateResult() and
+     * getDecodedWells(plate).
+     */
+    int scanAndDecodePlates(
+            const unsigned dpi,
+            const int brightness,
+            const int contrast,
+            const std::vector<cv::Rect_<float> > & regions,
+            const std::vector<int> & layoutIds,
+            const DecodeOptions & decodeOptions);
+
     int decodeImageWells(
             const char * filename,
             const DecodeOptions & decodeOptions,
             std::vector<std::unique_ptr<const WellRectangle> > & wellRects);
 
+    /**
+     * Decodes the wells of a layout registered with registerLayout(). Returns
+     * SC_INVALID_NOTHING_TO_DECODE when there is no layout with that ID.
+     */
+    int decodeImageLayout(
+            const char * filename,
+            const DecodeOptions & decodeOptions,
+            int layoutId);
+
+    /**
+     * Keeps a copy of the wells, with the masks and bounds the decoder needs
+     * for them, for all instances to decode by the returned ID. Worth doing
+     * for a plate layout that is decoded many times.
+     */
+    static int registerLayout(
+            const std::vector<std::unique_ptr<const WellRectangle> > & wellRects);
+
+    // returns false when there is no layout with that ID
+    static bool unregisterLayout(int layoutId);
+
     static void configLogging(unsigned level, bool useFile = true);
 
+    /**
+     * The wells are decoded by the given thread pool instead of threads
+     * started for each decode. The pool must outlive this object.
+     */
+    void setThreadMgr(decoder::ThreadMgr * mgr) {
+        threadMgr = mgr;
+    }
+
+    /**
+     * The listener is told about each well as soon as it is decoded, and can
+     * cancel the decode, by the decodes that follow. It must outlive them.
+     */
+    void setListener(DecodeListener * wellListener) {
+        listener = wellListener;
+    }
+
     const unsigned getDecodedWellCount();
 
     const std::map<std::string, const WellDecoder *> & getDecodedWells() const;
 
+    // the number of plates in the last scanAndDecodePlates()
+    unsigned getPlateCount() const {
+        return static_cast<unsigned>(plateResults.size());
+    }
+
+    // the result of decoding one plate, with the same codes as scanAndDecode()
+    int getPlateResult(unsigned plate) const;
+
+    // only valid when the plate's result is SC_SUCCESS
+    const std::map<std::string, const WellDecoder *> & getDecodedWells(unsigned plate) const;
+
+    /**
+     * Metrics are collected for the decodes that follow, by all instances.
+     * When disabled, which is the default, nothing is counted or timed.
+     */
+    static void setMetricsEnabled(bool enabled);
+
+    static bool getMetricsEnabled() {
+        return metricsEnabled;
+    }
+
+    /**
+     * Metrics for the whole plate from the last decode.
+     */
+    const DecodeMetrics & getMetrics() const {
+        return metrics;
+    }
+
+    /**
+     * Metrics for each well from the last decode, including the wells that
+     * could not be decoded. The key is the well's label.
+     */
+    const std::map<std::string, DecodeMetrics> & getWellMetrics() const {
+        return wellMetrics;
+    }
+
+    /**
+     * Time taken to decode each well, over all the decodes made by this
+     * instance while metrics were enabled.
+     */
+    const util::DmLatencyHistogram & getWellLatency() const {
+        return wellLatency;
+    }
+
+    /**
+     * Time taken by each successful decode made by this instance while
+     * metrics were enabled, from preprocessing until the image is annotated.
+     */
+    const util::DmLatencyHistogram & getDecodeLatency() const {
+        return decodeLatency;
+    }
+
+    void clearLatency();
+
+    /**
+     * When enabled, the decodes that follow, by all instances, first locate
+     * the tube bottom in each well and only search that disc for the
+     * barcode. A well that does not decode is searched whole when it is
+     * retried at the next shrink. Disabled by default.
+     */
+    static void setLocateTubes(bool enabled);
+
+    static bool getLocateTubes() {
+        return locateTubes;
+    }
+
+    /**
+     * When enabled, the decodes that follow, by all instances, fit the
+     * plate's grid to the barcodes decoded and retry each well still
+     * missing in a small region around where the fitted grid puts its
+     * barcode. Helps when the rack is slightly off the wells given.
+     * Disabled by default.
+     */
+    static void setRefitGrid(bool enabled);
+
+    static bool getRefitGrid() {
+        return refitGrid;
+    }
+
+    /**
+     * When set above the DPI of a scanAndDecode(), the decodes that follow,
+     * by all instances, scan the part of the plate holding the wells that
+     * were missed again at this DPI and decode just those wells, so that
+     * the plate can be scanned at a fast, low DPI. Empty wells are missed
+     * too, so a plate that is not full is always scanned twice. 0, the
+     * default, disables it.
+     */
+    static void setRescanDpi(unsigned dpi);
+
+    static unsigned getRescanDpi() {
+        return rescanDpi;
+    }
+
+    /**
+     * Tunes the decode options of the following decodes, by all instances,
+     * from the plates decoded so far. The options passed to the decode
+     * methods become the conservative options used for wells the tuned
+     * options miss. The tuner's state is kept in stateFilename so that it
+     * survives restarts. An empty filename disables tuning, which is the
+     * default. Must not be called while a decode is in progress.
+     */
+    static void setAutoTune(const std::string & stateFilename,
+            double targetRate = DecodeTuner::DEFAULT_TARGET_RATE);
+
+    static bool getAutoTune() {
+        return tuner.get() != NULL;
+    }
+
+    /**
+     * Keeps the results of the image decodes that follow, by all instances,
+     * so that decoding the same image again with the same wells and options
+     * returns straight away. At most maxEntries results are kept. With a
+     * directory they are also written there, one file each, and survive
+     * restarts. A maxEntries of 0 disables the cache, which is the default.
+     * Must not be called while a decode is in progress.
+     */
+    static void setDecodeCache(unsigned maxEntries, const std::string & directory = "");
+
+    static DecodeCache * getDecodeCache() {
+        return decodeCache.get();
+    }
+
+    // true when the result of the last decode came from the decode cache
+    bool getDecodedFromCache() const {
+        return decodedFromCache;
+    }
+
+    // the options the tuner chose for the last decode, NULL when it had none
+    const DecodeOptions * getTunedOptions() const {
+        return tunedOptions.get();
+    }
 
     static Orientation getOrientationFromString(std::string & orientationStr);
 
@@ -132,22 +329,100 @@ public:
     static PalletSize getPalletSizeFromString(std::string & palletSizeStr);
 
 protected:
+    // where an image was scanned, so that part of it can be scanned again
+    struct ScanSettings {
+        unsigned dpi;
+        int brightness;
+        int contrast;
+        cv::Rect_<float> region;
+    };
+
     int decodeCommon(
             const Image & image,
             const DecodeOptions & decodeOptions,
             const std::string &decodedDibFilename,
             std::vector<std::unique_ptr<const WellRectangle> > & wellRects);
 
+    int decodeCommon(
+            const Image & image,
+            const DecodeOptions & decodeOptions,
+            const std::string &decodedDibFilename,
+            std::shared_ptr<const PlateLayout> layout);
+
+    const DecodeOptions & selectDecodeOptions(const DecodeOptions & decodeOptions);
+
+    bool decodeFromCache(
+            const Image & image,
+            const DecodeOptions & decodeOptions,
+            const std::string & decodedDibFilename,
+            std::shared_ptr<const PlateLayout> layout,
+            const DecodeCache::Key & key,
+            const util::DmStopwatch & stopwatch);
+
+    void decodePlates(
+            const Image & flatbed,
+            const unsigned dpi,
+            const std::vector<cv::Rect_<float> > & regions,
+            const std::vector<std::shared_ptr<const PlateLayout> > & plateLayouts,
+            const DecodeOptions & decodeOptions);
+
+    int finishDecode(
+            const Image & image,
+            const DecodeOptions & decodeOptions,
+            const std::string & decodedDibFilename,
+            int result,
+            double preprocessTime,
+            const util::DmStopwatch & stopwatch,
+            const ScanSettings * scan = NULL);
+
+    int rescanFailedWells(const ScanSettings & scan, const DecodeOptions & decodeOptions);
+
     void writeDecodedImage(const Image & image, const std::string & decodedDibFilename);
 
+    void updateMetrics(double preprocessTime, double wellsTime);
+
     static const std::string LIBRARY_NAME;
 
     std::unique_ptr<ImgScanner> imgScanner;
 
     std::unique_ptr<Decoder> decoder;
 
+    // one per plate of the last scanAndDecodePlates(), NULL when it had no wells
+    std::vector<std::unique_ptr<Decoder> > plateDecoders;
+
+    std::vector<int> plateResults;
+
+    decoder::ThreadMgr * threadMgr;
+
+    DecodeListener * listener;
+
     static bool loggingInitialized;
 
+    static bool metricsEnabled;
+
+    static bool locateTubes;
+
+    static bool refitGrid;
+
+    static unsigned rescanDpi;
+
+    static std::unique_ptr<DecodeTuner> tuner;
+
+    static std::unique_ptr<DecodeCache> decodeCache;
+
+    bool decodedFromCache;
+
+    // the options the last decode used, when chosen by the tuner
+    std::unique_ptr<DecodeOptions> tunedOptions;
+
+    DecodeMetrics metrics;
+
+    std::map<std::string, DecodeMetrics> wellMetrics;
+
+    util::DmLatencyHistogram wellLatency;
+
+    util::DmLatencyHistogram decodeLatency;
+
 };
 
 std::ostream & operator<<(std::ostream &os, Orientation m);
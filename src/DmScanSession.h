@@ -0,0 +1,87 @@
+#ifndef __INC_DMSCAN_SESSION_H
+#define __INC_DMSCAN_SESSION_H
+
+/*
+ Dmscanlib is a software library and standalone application that scans
+ and decodes libdmtx compatible test-tubes. It is currently designed
+ to decode 12x8 pallets that use 2D data-matrix laser etched test-tubes.
+ Copyright (C) 2010 Canadian Biosample Repository
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DmScanLib.h"
+#include "decoder/ThreadMgr.h"
+
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+
+namespace dmscanlib {
+
+/*
+ * State kept between decodes for a caller that decodes many plates: the
+ * decoding threads and their libdmtx contexts, the scanner, and the metrics
+ * and latency histograms of the session's DmScanLib.
+ *
+ * A session can be shared by several threads. Each one gets the DmScanLib
+ * through an Access, which lets only one thread use it at a time. Callers that
+ * want to decode plates concurrently should open one session each.
+ */
+class DmScanSession {
+public:
+    // numThreads of 0 uses the default number of decoding threads
+    DmScanSession(unsigned loggingLevel, unsigned numThreads = 0);
+    virtual ~DmScanSession();
+
+    /*
+     * Holds the session's lock for as long as it exists. The results of a
+     * decode made through it stay valid until it is destroyed.
+     */
+    class Access {
+    public:
+        Access(DmScanSession & _session) :
+                session(_session),
+                lock(_session.mutex)
+        {
+            ++session.useCount;
+        }
+
+        DmScanLib & getScanLib() {
+            return session.dmScanLib;
+        }
+
+    private:
+        DmScanSession & session;
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock;
+    };
+
+    // number of times the session has been used
+    unsigned getUseCount() const {
+        return useCount;
+    }
+
+private:
+    // declared before dmScanLib so that the threads outlive its decoder
+    decoder::ThreadMgr threadMgr;
+    DmScanLib dmScanLib;
+    unsigned useCount;
+    OpenThreads::Mutex mutex;
+
+    DmScanSession(const DmScanSession &);
+    DmScanSession & operator=(const DmScanSession &);
+};
+
+} /* namespace */
+
+#endif /* __INC_DMSCAN_SESSION_H */
@@ -14,6 +14,13 @@
 
 namespace dmscanlib {
 
+namespace {
+
+// standard deviation of the blur used by applyFilters()
+const double FILTER_SIGMA = 15;
+
+} /* namespace */
+
 Image::Image(const std::string & _filename) : filename(_filename) {
 	image = cv::imread(filename.c_str());
 
@@ -101,7 +108,12 @@ Image::Image(HANDLE handle) : filename("") {
 
     valid = true;
 #else
-    valid = false;
+    // the scanner simulator's handles refer to a cv::Mat, whose pixels are shared
+    const cv::Mat * mat = static_cast<const cv::Mat *>(handle);
+    valid = (mat != NULL) && (mat->data != NULL);
+    if (valid) {
+        image = *mat;
+    }
 #endif
 }
 
@@ -113,12 +125,17 @@ void Image::grayscale(Image & that) const {
     cv::cvtColor(image, that.image, CV_BGR2GRAY);
 }
 
+void Image::share(Image & that) const {
+    that.image = image;
+    that.valid = valid;
+}
+
 // from: https://github.com/radeonwu/DMTag/blob/master/dm_localization/src/dm_localize.cpp
 void Image::applyFilters(Image & that) const {
     cv::Mat blurredImage;
     cv::Mat enhancedImage;
 
-    double sigma = 15, threshold = 5, amount = 1;
+    double sigma = FILTER_SIGMA, threshold = 5, amount = 1;
 
     cv::GaussianBlur(image, blurredImage, cv::Size(0, 0), sigma);
     cv::Mat lowContrastMask = abs(image - blurredImage) < threshold;
@@ -126,6 +143,11 @@ void Image::applyFilters(Image & that) const {
     image.copyTo(that.image, lowContrastMask);
 }
 
+// the radius of the kernel OpenCV builds for the blur of an 8 bit image
+int Image::getFilterApron() {
+    return (cvRound(FILTER_SIGMA * 3 * 2 + 1) | 1) / 2;
+}
+
 
 /**
  * Converts an OpenCV image to a DmtxImage.
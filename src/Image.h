@@ -32,6 +32,9 @@ public:
     Image(const std::string & filename);
     Image(HANDLE handle);
     Image(const Image & that);
+
+    // the image refers to the matrix's pixels, they are not copied
+    explicit Image(const cv::Mat & mat);
     virtual ~Image();
 
     const bool isValid() const {
@@ -52,8 +55,18 @@ public:
 
     void grayscale(Image & that) const;
 
+    // makes that refer to this image's pixels, they are not copied
+    void share(Image & that) const;
+
     void applyFilters(Image & that) const;
 
+    /*
+     * The number of rows above and below a pixel that applyFilters() reads.
+     * A band of rows filtered on its own comes out the same as in the whole
+     * image, except within this many rows of a cut.
+     */
+    static int getFilterApron();
+
     DmtxImage * dmtxImage() const;
 
     std::unique_ptr<const Image> crop(unsigned x, unsigned y, unsigned width, unsigned height) const;
@@ -66,8 +79,6 @@ public:
 
 
 private:
-    Image(const cv::Mat & mat);
-
     cv::Mat image;
     bool valid;
     const std::string filename;
@@ -0,0 +1,200 @@
+/*
+ * BandDecoder.cpp
+ *
+ * Decodes an image while it is being scanned.
+ */
+
+#include "decoder/BandDecoder.h"
+#include "decoder/Decoder.h"
+#include "decoder/DecodeOptions.h"
+#include "utils/DmTime.h"
+#include "DmScanLib.h"
+#include "Image.h"
+
+#define GLOG_NO_ABBREVIATED_SEVERITIES
+#include <glog/logging.h>
+#include <OpenThreads/ScopedLock>
+#include <OpenThreads/Thread>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace dmscanlib {
+
+class BandDecoder::Worker: public ::OpenThreads::Thread {
+public:
+    Worker(BandDecoder & _bandDecoder) :
+            bandDecoder(_bandDecoder)
+    {
+    }
+
+    virtual ~Worker() {
+    }
+
+    virtual void run() {
+        bandDecoder.run();
+    }
+
+private:
+    BandDecoder & bandDecoder;
+};
+
+BandDecoder::BandDecoder(const DecodeOptions & _decodeOptions,
+        std::shared_ptr<const PlateLayout> _layout) :
+        decodeOptions(_decodeOptions),
+        layout(_layout),
+        collectMetrics(false),
+        locateTubes(false),
+        refitGrid(false),
+        threadMgr(NULL),
+        listener(NULL),
+        rowsAcquired(0),
+        rowsTaken(0),
+        scanOver(false),
+        scanFailed(false),
+        result(SC_FAIL),
+        preprocessSeconds(0)
+{
+    CHECK_NOTNULL(layout.get());
+}
+
+BandDecoder::~BandDecoder() {
+    if (worker.get() != NULL) {
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+            if (!scanOver) {
+                scanOver = true;
+                scanFailed = true;
+            }
+            rowsAvailable.signal();
+        }
+        worker->join();
+    }
+}
+
+/*
+ * Called on the scanner's thread. The scanner keeps writing into the image,
+ * so only its header is kept here.
+ */
+void BandDecoder::imageStarted(const cv::Mat & image) {
+    VLOG(3) << "imageStarted: size/" << image.size();
+
+    scan = image;
+    filtered.create(image.size(), CV_8UC1);
+    worker = std::unique_ptr<Worker>(new Worker(*this));
+    worker->start();
+}
+
+void BandDecoder::bandAcquired(int rows) {
+    VLOG(5) << "bandAcquired: rows/" << rows;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+    rowsAcquired = rows;
+    rowsAvailable.signal();
+}
+
+int BandDecoder::finish(bool acquired) {
+    VLOG(3) << "finish: acquired/" << acquired;
+
+    if (worker.get() == NULL) {
+        return SC_FAIL;
+    }
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+        scanOver = true;
+        scanFailed = !acquired;
+        rowsAvailable.signal();
+    }
+    worker->join();
+
+    if (!error.empty()) {
+        throw std::invalid_argument(error);
+    }
+    return acquired ? result : SC_FAIL;
+}
+
+std::unique_ptr<Decoder> BandDecoder::releaseDecoder() {
+    return std::move(decoder);
+}
+
+bool BandDecoder::waitForRows(int & available, bool & complete) {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+    while (!scanOver && (rowsAcquired == rowsTaken)) {
+        rowsAvailable.wait(&mutex);
+    }
+
+    if (scanFailed || (rowsAcquired == rowsTaken)) {
+        return false;
+    }
+
+    rowsTaken = rowsAcquired;
+    available = rowsAcquired;
+    complete = (rowsAcquired >= scan.rows);
+    return true;
+}
+
+/*
+ * Runs on the worker thread, where nothing can catch an exception. A well
+ * outside the image is thrown again by finish(), any other exception makes
+ * the decode fail.
+ */
+void BandDecoder::run() {
+    try {
+        decodeBands();
+    } catch (const std::invalid_argument & e) {
+        error = e.what();
+    } catch (const std::exception & e) {
+        LOG(WARNING) << "BandDecoder: " << e.what();
+        result = SC_FAIL;
+    }
+}
+
+/*
+ * Every band is filtered as far down as its apron allows, and then the wells
+ * above the filtered rows are decoded while the scanner carries on.
+ */
+void BandDecoder::decodeBands() {
+    decoder = std::unique_ptr<Decoder>(
+            new Decoder(Image(filtered), decodeOptions, layout, true));
+
+    decoder->setCollectMetrics(collectMetrics);
+    decoder->setLocateTubes(locateTubes);
+    decoder->setRefitGrid(refitGrid);
+    decoder->setThreadMgr((threadMgr != NULL) ? threadMgr : &localThreadMgr);
+    decoder->setListener(listener);
+
+    const int apron = Image::getFilterApron();
+    int rowsFiltered = 0;
+    int available;
+    bool complete;
+
+    while (waitForRows(available, complete)) {
+        const int end = complete ? scan.rows : std::max(rowsFiltered, available - apron);
+        if (end == rowsFiltered) {
+            continue;
+        }
+
+        util::DmStopwatch stopwatch;
+        Decoder::preprocessRows(scan, rowsFiltered, end, available, filtered);
+        preprocessSeconds += stopwatch.getElapsedSeconds();
+        rowsFiltered = end;
+
+        if (!complete) {
+            decoder->decodeWellsAbove(rowsFiltered);
+        }
+    }
+
+    if (rowsFiltered < scan.rows) {
+        VLOG(1) << "BandDecoder: scan ended after " << rowsFiltered << " of "
+                << scan.rows << " rows";
+        result = SC_INVALID_IMAGE;
+        return;
+    }
+
+    result = decoder->decodeRemainingWells();
+    VLOG(3) << "BandDecoder: preprocessSeconds/" << preprocessSeconds
+            << " result/" << result;
+}
+
+} /* namespace */
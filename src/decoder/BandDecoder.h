@@ -0,0 +1,134 @@
+#ifndef BANDDECODER_H_
+#define BANDDECODER_H_
+
+/*
+ * BandDecoder.h
+ *
+ * Decodes an image while it is being scanned.
+ */
+
+#include "imgscanner/BandListener.h"
+#include "decoder/PlateLayout.h"
+#include "decoder/ThreadMgr.h"
+
+#include <OpenThreads/Condition>
+#include <OpenThreads/Mutex>
+#include <opencv/cv.h>
+
+#include <memory>
+#include <string>
+
+namespace dmscanlib {
+
+class Decoder;
+class DecodeOptions;
+class DecodeListener;
+
+/*
+ * Given to ImgScanner::acquireImageBands() as the listener. The bands are
+ * filtered and the wells decoded on a thread of its own, so the scanner is
+ * never kept waiting.
+ *
+ * The filters read Image::getFilterApron() rows on either side of a pixel,
+ * so the rows of a band are filtered once the apron below them has arrived,
+ * and a row of wells is decoded as soon as all of its rows are filtered. By
+ * the end of the scan only the bottom rows of wells are left to decode.
+ *
+ * The options, the listener and the thread manager must outlive the
+ * decoder.
+ */
+class BandDecoder: public BandListener {
+public:
+    BandDecoder(const DecodeOptions & decodeOptions,
+            std::shared_ptr<const PlateLayout> layout);
+
+    // waits for the decoding thread when finish() was not called
+    virtual ~BandDecoder();
+
+    // the same settings as those of Decoder, applied when it is created
+    void setCollectMetrics(bool collect) {
+        collectMetrics = collect;
+    }
+
+    void setLocateTubes(bool locate) {
+        locateTubes = locate;
+    }
+
+    void setRefitGrid(bool refit) {
+        refitGrid = refit;
+    }
+
+    // when not set, the bands are decoded with a thread pool of their own
+    void setThreadMgr(decoder::ThreadMgr * mgr) {
+        threadMgr = mgr;
+    }
+
+    void setListener(DecodeListener * wellListener) {
+        listener = wellListener;
+    }
+
+    virtual void imageStarted(const cv::Mat & image);
+
+    virtual void bandAcquired(int rows);
+
+    /*
+     * Called once the acquisition has returned. When it succeeded, waits for
+     * the remaining wells to be decoded and returns the result of the
+     * decode. Otherwise the decode is abandoned and SC_FAIL is returned.
+     *
+     * Throws std::invalid_argument when a well lies outside the image, like
+     * Decoder does. Any other exception on the decoding thread is logged
+     * and SC_FAIL returned.
+     */
+    int finish(bool acquired);
+
+    // the decoder, with the decoded wells, once finish() has returned
+    std::unique_ptr<Decoder> releaseDecoder();
+
+    // time spent filtering the bands, most of it while the scan was running
+    double getPreprocessSeconds() const {
+        return preprocessSeconds;
+    }
+
+private:
+    class Worker;
+
+    void run();
+    void decodeBands();
+
+    // returns false once the scan is over and every row has been taken
+    bool waitForRows(int & available, bool & complete);
+
+    const DecodeOptions & decodeOptions;
+    std::shared_ptr<const PlateLayout> layout;
+    bool collectMetrics;
+    bool locateTubes;
+    bool refitGrid;
+    decoder::ThreadMgr * threadMgr;
+    DecodeListener * listener;
+
+    // used when no thread manager is set
+    decoder::ThreadMgr localThreadMgr;
+
+    // written by the scanner
+    cv::Mat scan;
+    cv::Mat filtered;
+
+    std::unique_ptr<Decoder> decoder;
+    std::unique_ptr<Worker> worker;
+
+    OpenThreads::Mutex mutex;
+    OpenThreads::Condition rowsAvailable;
+    int rowsAcquired;
+    int rowsTaken;
+    bool scanOver;
+    bool scanFailed;
+
+    int result;
+    std::string error;
+    double preprocessSeconds;
+};
+
+} /* namespace */
+
+#endif /* BANDDECODER_H_ */
@@ -0,0 +1,424 @@
+/*
+ * DecodeCache.cpp
+ *
+ * Keeps the results of decoding images so that decoding the same image again
+ * does not repeat the work.
+ */
+
+#define _CRT_SECURE_NO_DEPRECATE
+
+#include "DecodeCache.h"
+#include "Decoder.h"
+#include "DecodeOptions.h"
+#include "PlateLayout.h"
+#include "WellDecoder.h"
+#include "DmScanLib.h"
+
+#include <OpenThreads/ScopedLock>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#define GLOG_NO_ABBREVIATED_SEVERITIES
+#include <glog/logging.h>
+
+#ifdef WIN32
+#   define NOMINMAX
+#   include <windows.h>
+#   undef ERROR
+#else
+#   include <dirent.h>
+#   include <sys/stat.h>
+#endif
+
+namespace dmscanlib {
+
+namespace {
+
+const unsigned long long HASH_OFFSET = 14695981039346656037ULL;
+const unsigned long long HASH_PRIME = 1099511628211ULL;
+
+/*
+ * FNV-1a, taking a 64 bit word at a time. The shift brings the high bits of
+ * each word down so that they reach every bit of the hash.
+ */
+void hashWord(unsigned long long & hash, unsigned long long word) {
+    hash = (hash ^ word) * HASH_PRIME;
+    hash ^= hash >> 32;
+}
+
+void hashBytes(unsigned long long & hash, const unsigned char * data, size_t size) {
+    const size_t words = size / sizeof(unsigned long long);
+    for (size_t i = 0; i < words; ++i) {
+        unsigned long long word;
+        memcpy(&word, data + i * sizeof(word), sizeof(word));
+        hashWord(hash, word);
+    }
+    for (size_t i = words * sizeof(unsigned long long); i < size; ++i) {
+        hashWord(hash, data[i]);
+    }
+}
+
+void hashDouble(unsigned long long & hash, double value) {
+    hashBytes(hash, reinterpret_cast<const unsigned char *>(&value), sizeof(value));
+}
+
+void hashString(unsigned long long & hash, const std::string & str) {
+    hashWord(hash, str.size());
+    hashBytes(hash, reinterpret_cast<const unsigned char *>(str.data()), str.size());
+}
+
+/*
+ * The names of the entry files in the directory, each with the time it was
+ * last written.
+ */
+void listEntryFiles(const std::string & directory,
+        std::vector<std::pair<long long, std::string> > & files) {
+#ifdef WIN32
+    WIN32_FIND_DATAA findData;
+    HANDLE hFind = FindFirstFileA((directory + "\\*.dmc").c_str(), &findData);
+    if (hFind == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    do {
+        ULARGE_INTEGER written;
+        written.LowPart = findData.ftLastWriteTime.dwLowDateTime;
+        written.HighPart = findData.ftLastWriteTime.dwHighDateTime;
+        files.push_back(std::make_pair(static_cast<long long>(written.QuadPart),
+                std::string(findData.cFileName)));
+    } while (FindNextFileA(hFind, &findData));
+    FindClose(hFind);
+#else
+    DIR * dp = opendir(directory.c_str());
+    if (dp == NULL) {
+        return;
+    }
+
+    dirent * dirp;
+    while ((dirp = readdir(dp)) != NULL) {
+        const std::string name(dirp->d_name);
+        struct stat status;
+        if ((stat((directory + "/" + name).c_str(), &status) == 0) && S_ISREG(status.st_mode)) {
+            files.push_back(std::make_pair(static_cast<long long>(status.st_mtime), name));
+        }
+    }
+    closedir(dp);
+#endif
+}
+
+} /* namespace */
+
+bool DecodeCache::Key::operator<(const Key & that) const {
+    if (image != that.image) {
+        return image < that.image;
+    }
+    if (layout != that.layout) {
+        return layout < that.layout;
+    }
+    return options < that.options;
+}
+
+DecodeCache::DecodeCache(unsigned _maxEntries, const std::string & _directory) :
+        maxEntries(_maxEntries),
+        directory(_directory),
+        hits(0),
+        misses(0)
+{
+    VLOG(1) << "DecodeCache: maxEntries/" << maxEntries << " directory/" << directory;
+    if (!directory.empty()) {
+        indexDirectory();
+    }
+}
+
+DecodeCache::~DecodeCache() {
+}
+
+DecodeCache::Key DecodeCache::getKey(const cv::Mat & image, const PlateLayout & layout,
+        const DecodeOptions & decodeOptions, bool locateTubes, bool refitGrid) {
+    Key key;
+
+    key.image = HASH_OFFSET;
+    hashWord(key.image, image.rows);
+    hashWord(key.image, image.cols);
+    hashWord(key.image, image.type());
+    const size_t rowBytes = image.cols * image.elemSize();
+    for (int y = 0; y < image.rows; ++y) {
+        hashBytes(key.image, image.ptr<unsigned char>(y), rowBytes);
+    }
+
+    key.layout = HASH_OFFSET;
+    hashWord(key.layout, layout.getWellCount());
+    for (unsigned i = 0, n = layout.getWellCount(); i < n; ++i) {
+        const WellRectangle & wellRect = layout.getWell(i);
+        const cv::Rect & rect = wellRect.getRectangle();
+        hashString(key.layout, wellRect.getLabel());
+        hashWord(key.layout, rect.x);
+        hashWord(key.layout, rect.y);
+        hashWord(key.layout, rect.width);
+        hashWord(key.layout, rect.height);
+        hashWord(key.layout, wellRect.isQuad());
+        if (wellRect.isQuad()) {
+            const std::vector<cv::Point2f> & corners = wellRect.getCorners();
+            for (unsigned c = 0; c < corners.size(); ++c) {
+                hashDouble(key.layout, corners[c].x);
+                hashDouble(key.layout, corners[c].y);
+            }
+        }
+    }
+
+    key.options = HASH_OFFSET;
+    hashWord(key.options, decodeOptions.getStageCount());
+    for (unsigned i = 0, n = decodeOptions.getStageCount(); i < n; ++i) {
+        const DecodeOptions & stage = decodeOptions.getStage(i);
+        hashDouble(key.options, stage.minEdgeFactor);
+        hashDouble(key.options, stage.maxEdgeFactor);
+        hashDouble(key.options, stage.scanGapFactor);
+        hashWord(key.options, stage.squareDev);
+        hashWord(key.options, stage.edgeThresh);
+        hashWord(key.options, stage.corrections);
+        hashWord(key.options, stage.shrink);
+    }
+    hashWord(key.options, locateTubes);
+    hashWord(key.options, refitGrid);
+
+    return key;
+}
+
+void DecodeCache::store(const Key & key, Decoder & decoder) {
+    std::shared_ptr<Entry> entry(new Entry());
+
+    std::vector<std::unique_ptr<WellDecoder> > & wellDecoders = decoder.getWellDecoders();
+    for (unsigned i = 0, n = wellDecoders.size(); i < n; ++i) {
+        const WellDecoder & wellDecoder = *wellDecoders[i];
+        if (wellDecoder.getMessage().empty()) {
+            continue;
+        }
+        Well well;
+        well.index = wellDecoder.getWellIndex();
+        well.scale = wellDecoder.getDecodedScale();
+        well.quad = wellDecoder.getDecodedQuad();
+        well.message = wellDecoder.getMessage();
+        entry->push_back(well);
+    }
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+    insert(key, entry);
+    if (!directory.empty() && !save(key, *entry)) {
+        LOG(WARNING) << "DecodeCache: could not save " << getFilename(key);
+    }
+}
+
+bool DecodeCache::restore(const Key & key, Decoder & decoder) {
+    std::shared_ptr<const Entry> entry;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+        entry = find(key);
+        if (entry.get() == NULL) {
+            ++misses;
+            return false;
+        }
+        ++hits;
+    }
+
+    std::vector<WellDecoder *> wells;
+    decoder.addWellsTo(wells);
+    for (unsigned i = 0, n = entry->size(); i < n; ++i) {
+        if ((*entry)[i].index >= wells.size()) {
+            LOG(WARNING) << "DecodeCache: entry does not match the layout: " << getFilename(key);
+            return false;
+        }
+    }
+
+    for (unsigned i = 0, n = entry->size(); i < n; ++i) {
+        const Well & well = (*entry)[i];
+        WellDecoder & wellDecoder = *wells[well.index];
+        wellDecoder.setMessage(well.message.data(), static_cast<int>(well.message.size()));
+        wellDecoder.setDecodedScale(well.scale);
+
+        if (well.quad.size() == 4) {
+            const cv::Point tl = wellDecoder.getWellRectangle().tl();
+            cv::Point2f quad[4];
+            for (unsigned c = 0; c < 4; ++c) {
+                quad[c] = well.quad[c] - tl;
+            }
+            wellDecoder.setDecodeQuad(quad);
+        }
+    }
+    return decoder.collectDecodedWells() == SC_SUCCESS;
+}
+
+void DecodeCache::clear() {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+    if (directory.empty()) {
+        entries.clear();
+        index.clear();
+        return;
+    }
+
+    // the files stay indexed, and are loaded again when they are looked up
+    for (EntryList::iterator it = entries.begin(); it != entries.end(); ++it) {
+        it->second.reset();
+    }
+}
+
+/*
+ * The files left in the directory by earlier processes are indexed without
+ * being loaded, the most recently written first, so that they are dropped
+ * like any other entry and the directory never holds more than maxEntries
+ * of them. The oldest of any files beyond that are removed here.
+ */
+void DecodeCache::indexDirectory() {
+    std::vector<std::pair<long long, std::string> > files;
+    listEntryFiles(directory, files);
+    std::sort(files.begin(), files.end());
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+    for (unsigned i = 0, n = files.size(); i < n; ++i) {
+        const std::string & name = files[i].second;
+        Key key;
+        char suffix[8];
+        if ((name.size() == 52)
+                && (sscanf(name.c_str(), "%16llx%16llx%16llx%7s",
+                        &key.image, &key.layout, &key.options, suffix) == 4)
+                && (strcmp(suffix, ".dmc") == 0)) {
+            insert(key, std::shared_ptr<const Entry>());
+        }
+    }
+    VLOG(1) << "DecodeCache: indexed " << entries.size() << " entries in " << directory;
+}
+
+/*
+ * Called with the mutex held. An entry found on disk is brought into memory.
+ */
+std::shared_ptr<const DecodeCache::Entry> DecodeCache::find(const Key & key) {
+    std::map<Key, EntryList::iterator>::iterator it = index.find(key);
+    if ((it != index.end()) && (it->second->second.get() != NULL)) {
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->second;
+    }
+
+    if (directory.empty()) {
+        return std::shared_ptr<const Entry>();
+    }
+
+    std::shared_ptr<const Entry> entry = load(key);
+    if (entry.get() != NULL) {
+        insert(key, entry);
+    } else if (it != index.end()) {
+        // an indexed file that can no longer be read
+        remove(getFilename(key).c_str());
+        entries.erase(it->second);
+        index.erase(it);
+    }
+    return entry;
+}
+
+/*
+ * Called with the mutex held.
+ */
+void DecodeCache::insert(const Key & key, std::shared_ptr<const Entry> entry) {
+    std::map<Key, EntryList::iterator>::iterator it = index.find(key);
+    if (it != index.end()) {
+        entries.erase(it->second);
+        index.erase(it);
+    }
+
+    entries.push_front(std::make_pair(key, entry));
+    index[key] = entries.begin();
+
+    while (entries.size() > maxEntries) {
+        const Key & oldest = entries.back().first;
+        if (!directory.empty()) {
+            remove(getFilename(oldest).c_str());
+        }
+        index.erase(oldest);
+        entries.pop_back();
+    }
+}
+
+std::string DecodeCache::getFilename(const Key & key) const {
+    char name[64];
+    snprintf(name, sizeof(name), "%016llx%016llx%016llx.dmc",
+            key.image, key.layout, key.options);
+    return directory + "/" + name;
+}
+
+/*
+ * The file has a header line, then one line per decoded well with its index,
+ * scale, the points of its quad and the length of its message followed by
+ * the message itself.
+ */
+std::shared_ptr<const DecodeCache::Entry> DecodeCache::load(const Key & key) const {
+    std::ifstream file(getFilename(key).c_str(), std::ios::binary);
+    if (!file.is_open()) {
+        return std::shared_ptr<const Entry>();
+    }
+
+    std::string header;
+    unsigned numWells = 0;
+    std::getline(file, header);
+    file >> numWells;
+
+    std::shared_ptr<Entry> entry(new Entry(numWells));
+    for (unsigned i = 0; (i < numWells) && file.good(); ++i) {
+        Well & well = (*entry)[i];
+        unsigned numPoints = 0;
+        file >> well.index >> well.scale >> numPoints;
+        well.quad.resize(std::min(numPoints, 4u));
+        for (unsigned p = 0; p < well.quad.size(); ++p) {
+            file >> well.quad[p].x >> well.quad[p].y;
+        }
+
+        size_t length = 0;
+        file >> length;
+        file.get();
+        well.message.resize(length);
+        if (length > 0) {
+            file.read(&well.message[0], length);
+        }
+    }
+
+    if (file.fail()) {
+        LOG(WARNING) << "DecodeCache: ignoring invalid entry " << getFilename(key);
+        return std::shared_ptr<const Entry>();
+    }
+    VLOG(3) << "DecodeCache: loaded " << getFilename(key);
+    return entry;
+}
+
+/*
+ * Written to a temporary file first so that a crash never leaves a partial
+ * entry behind.
+ */
+bool DecodeCache::save(const Key & key, const Entry & entry) const {
+    const std::string filename = getFilename(key);
+    const std::string tmpFilename = filename + ".tmp";
+    {
+        std::ofstream file(tmpFilename.c_str(), std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        file << "# dmscanlib decode cache entry\n" << entry.size() << "\n";
+        for (unsigned i = 0, n = entry.size(); i < n; ++i) {
+            const Well & well = entry[i];
+            file << well.index << " " << well.scale << " " << well.quad.size();
+            for (unsigned p = 0; p < well.quad.size(); ++p) {
+                file << " " << well.quad[p].x << " " << well.quad[p].y;
+            }
+            file << " " << well.message.size() << " " << well.message << "\n";
+        }
+        if (!file.good()) {
+            return false;
+        }
+    }
+
+#ifdef _VISUALC_
+    // rename() does not replace an existing file on Windows
+    remove(filename.c_str());
+#endif
+    return rename(tmpFilename.c_str(), filename.c_str()) == 0;
+}
+
+} /* namespace */
@@ -0,0 +1,115 @@
+#ifndef DECODECACHE_H_
+#define DECODECACHE_H_
+
+/*
+ * DecodeCache.h
+ *
+ * Keeps the results of decoding images so that decoding the same image again
+ * does not repeat the work.
+ */
+
+#include <opencv/cv.h>
+#include <OpenThreads/Mutex>
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dmscanlib {
+
+class Decoder;
+class DecodeOptions;
+class PlateLayout;
+
+/*
+ * An entry is found by a hash of the image's pixels, one of its wells and
+ * one of the decode options, so a change to any of them is a miss and never
+ * returns a stale result. Only successful decodes are stored.
+ *
+ * At most maxEntries are kept, the least recently used being dropped first.
+ * With a directory, each entry is also written to a file of its own there,
+ * and the files already there are indexed when the cache is created and only
+ * loaded when they are looked up, so that the cache survives restarts. The
+ * file of a dropped entry is removed, which keeps the directory to
+ * maxEntries files. All the methods can be called from any thread.
+ */
+class DecodeCache {
+public:
+    struct Key {
+        unsigned long long image;
+        unsigned long long layout;
+        unsigned long long options;
+
+        bool operator<(const Key & that) const;
+    };
+
+    DecodeCache(unsigned maxEntries, const std::string & directory = "");
+    virtual ~DecodeCache();
+
+    /*
+     * The image is hashed in 64 bit words, which takes a few milliseconds for
+     * a plate at 600 DPI. Locating tubes and refitting the grid change what
+     * is decoded, so they are part of the options.
+     */
+    static Key getKey(const cv::Mat & image, const PlateLayout & layout,
+            const DecodeOptions & decodeOptions, bool locateTubes, bool refitGrid);
+
+    // keeps the decoded wells of a decoder whose decode was successful
+    void store(const Key & key, Decoder & decoder);
+
+    /*
+     * Fills in the wells of a decoder, created for the same layout but not
+     * yet used, from the entry for the key. Returns false on a miss, in
+     * which case the decoder is left alone.
+     */
+    bool restore(const Key & key, Decoder & decoder);
+
+    // drops the entries held in memory, the files in the directory are kept
+    void clear();
+
+    unsigned long getHits() const {
+        return hits;
+    }
+
+    unsigned long getMisses() const {
+        return misses;
+    }
+
+private:
+    struct Well {
+        unsigned index;
+        int scale;
+        std::vector<cv::Point> quad;
+        std::string message;
+    };
+
+    typedef std::vector<Well> Entry;
+
+    typedef std::list<std::pair<Key, std::shared_ptr<const Entry> > > EntryList;
+
+    void indexDirectory();
+    std::shared_ptr<const Entry> find(const Key & key);
+    void insert(const Key & key, std::shared_ptr<const Entry> entry);
+
+    std::string getFilename(const Key & key) const;
+    std::shared_ptr<const Entry> load(const Key & key) const;
+    bool save(const Key & key, const Entry & entry) const;
+
+    const unsigned maxEntries;
+    const std::string directory;
+
+    // most recently used first, an entry not yet loaded from its file is NULL
+    EntryList entries;
+    std::map<Key, EntryList::iterator> index;
+
+    unsigned long hits;
+    unsigned long misses;
+
+    OpenThreads::Mutex mutex;
+};
+
+} /* namespace */
+
+#endif /* DECODECACHE_H_ */
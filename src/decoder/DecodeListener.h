@@ -0,0 +1,42 @@
+#ifndef DECODELISTENER_H_
+#define DECODELISTENER_H_
+
+/*
+ * DecodeListener.h
+ *
+ * Lets a caller see each well as soon as it is decoded, and stop a decode
+ * before all the wells have been tried.
+ */
+
+namespace dmscanlib {
+
+class WellDecoder;
+
+class DecodeListener {
+public:
+    virtual ~DecodeListener() {
+    }
+
+    /*
+     * Called once for every well that yields a message, from the thread that
+     * decoded it, so implementations must be thread safe. With auto tuning, a
+     * well missed by the tuned options is reported when the retry finds it.
+     *
+     * The plate is only checked for duplicate messages once all its wells are
+     * done, so a well reported here can still make the decode fail.
+     */
+    virtual void wellDecoded(const WellDecoder & wellDecoder) = 0;
+
+    /*
+     * Checked before each well is decoded. Once it returns true the wells
+     * not yet started are skipped, and the decode returns
+     * SC_DECODE_CANCELLED.
+     */
+    virtual bool isCancelled() const {
+        return false;
+    }
+};
+
+} /* namespace */
+
+#endif /* DECODELISTENER_H_ */
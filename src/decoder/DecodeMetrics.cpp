@@ -0,0 +1,102 @@
+/*
+ * DecodeMetrics.cpp
+ *
+ * Counters and phase times collected while decoding a plate or a single well.
+ */
+
+#include "DecodeMetrics.h"
+
+namespace dmscanlib {
+
+const char * DecodeMetrics::COUNTER_NAMES[COUNTER_MAX] = {
+        "probes",
+        "candidates",
+        "rejectOrientation",
+        "rejectCalibEdge",
+        "rejectSize",
+        "regions",
+        "decodeAttempts",
+        "decodeFailures",
+        "correctedWords",
+        "shrinkRetries",
+        "wellPixels",
+        "searchPixels",
+        "cascadeRetries",
+        "speculativeAttempts",
+        "refitRetries",
+        "rescannedWells"
+};
+
+const char * DecodeMetrics::PHASE_NAMES[PHASE_MAX] = {
+        "preprocess",
+        "regionFind",
+        "decode",
+        "retry",
+        "wells",
+        "annotate",
+        "total",
+        "locate"
+};
+
+DecodeMetrics::DecodeMetrics() {
+    clear();
+}
+
+DecodeMetrics::~DecodeMetrics() {
+}
+
+void DecodeMetrics::clear() {
+    for (unsigned i = 0; i < COUNTER_MAX; ++i) {
+        counters[i] = 0;
+    }
+    for (unsigned i = 0; i < PHASE_MAX; ++i) {
+        times[i] = 0;
+    }
+}
+
+void DecodeMetrics::add(const DecodeMetrics & that) {
+    for (unsigned i = 0; i < COUNTER_MAX; ++i) {
+        counters[i] += that.counters[i];
+    }
+    for (unsigned i = 0; i < PHASE_MAX; ++i) {
+        times[i] += that.times[i];
+    }
+}
+
+/*
+ * Adds the counters collected by libdmtx.
+ */
+void DecodeMetrics::add(const DmtxDecodeStats & stats) {
+    counters[PROBES] += stats.probes;
+    counters[CANDIDATES] += stats.candidates;
+    counters[REJECT_ORIENTATION] += stats.rejectOrientation;
+    counters[REJECT_CALIB_EDGE] += stats.rejectCalibEdge;
+    counters[REJECT_SIZE] += stats.rejectSize;
+    counters[REGIONS] += stats.regions;
+    counters[DECODE_ATTEMPTS] += stats.decodeAttempts;
+    counters[DECODE_FAILURES] += stats.decodeFailures;
+    counters[CORRECTED_WORDS] += stats.correctedWords;
+}
+
+const char * DecodeMetrics::getCounterName(Counter counter) {
+    return COUNTER_NAMES[counter];
+}
+
+const char * DecodeMetrics::getPhaseName(Phase phase) {
+    return PHASE_NAMES[phase];
+}
+
+std::ostream & operator<<(std::ostream &os, const DecodeMetrics & m) {
+    for (unsigned i = 0; i < DecodeMetrics::COUNTER_MAX; ++i) {
+        DecodeMetrics::Counter counter = static_cast<DecodeMetrics::Counter>(i);
+        os << DecodeMetrics::getCounterName(counter) << "/" << m.getCount(counter) << " ";
+    }
+    for (unsigned i = 0; i < DecodeMetrics::PHASE_MAX; ++i) {
+        DecodeMetrics::Phase phase = static_cast<DecodeMetrics::Phase>(i);
+        os << ((i == 0) ? "" : " ")
+                << DecodeMetrics::getPhaseName(phase) << "/" << m.getTime(phase);
+    }
+    return os;
+}
+
+} /* namespace */
@@ -0,0 +1,112 @@
+#ifndef DECODEMETRICS_H_
+#define DECODEMETRICS_H_
+
+/*
+ * DecodeMetrics.h
+ *
+ * Counters and phase times collected while decoding a plate or a single well.
+ */
+
+#include <dmtx.h>
+#include <ostream>
+
+namespace dmscanlib {
+
+/*
+ * Only filled in when metrics are enabled with DmScanLib::setMetricsEnabled().
+ *
+ * For a well, the times are those spent on that well. For a plate, the
+ * counters and the REGION_FIND, DECODE, RETRY and LOCATE times are the sums over all
+ * its wells, which are decoded in parallel, while PREPROCESS, WELLS, ANNOTATE
+ * and TOTAL are wall clock times.
+ */
+class DecodeMetrics {
+public:
+    enum Counter {
+        PROBES,
+        CANDIDATES,
+        REJECT_ORIENTATION,
+        REJECT_CALIB_EDGE,
+        REJECT_SIZE,
+        REGIONS,
+        DECODE_ATTEMPTS,
+        DECODE_FAILURES,
+        CORRECTED_WORDS,
+        SHRINK_RETRIES,
+        WELL_PIXELS,
+        SEARCH_PIXELS,
+        CASCADE_RETRIES,
+        SPECULATIVE_ATTEMPTS,
+        REFIT_RETRIES,
+        RESCANNED_WELLS,
+        COUNTER_MAX
+    };
+
+    enum Phase {
+        PREPROCESS,
+        REGION_FIND,
+        DECODE,
+        RETRY,
+        WELLS,
+        ANNOTATE,
+        TOTAL,
+        LOCATE,
+        PHASE_MAX
+    };
+
+    DecodeMetrics();
+    virtual ~DecodeMetrics();
+
+    void clear();
+
+    void add(const DecodeMetrics & that);
+
+    void add(const DmtxDecodeStats & stats);
+
+    void addCount(Counter counter, long count) {
+        counters[counter] += count;
+    }
+
+    void addTime(Phase phase, double seconds) {
+        times[phase] += seconds;
+    }
+
+    void setTime(Phase phase, double seconds) {
+        times[phase] = seconds;
+    }
+
+    long getCount(Counter counter) const {
+        return counters[counter];
+    }
+
+    double getTime(Phase phase) const {
+        return times[phase];
+    }
+
+    // the counters indexed by Counter, used to copy them to Java
+    const long * getCounts() const {
+        return counters;
+    }
+
+    // the times in seconds indexed by Phase, used to copy them to Java
+    const double * getTimes() const {
+        return times;
+    }
+
+    static const char * getCounterName(Counter counter);
+
+    static const char * getPhaseName(Phase phase);
+
+private:
+    static const char * COUNTER_NAMES[COUNTER_MAX];
+    static const char * PHASE_NAMES[PHASE_MAX];
+
+    long counters[COUNTER_MAX];
+    double times[PHASE_MAX];
+};
+
+std::ostream & operator<<(std::ostream & os, const DecodeMetrics & m);
+
+} /* namespace */
+
+#endif /* DECODEMETRICS_H_ */
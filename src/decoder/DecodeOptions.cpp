@@ -7,7 +7,7 @@
 
 #include "DecodeOptions.h"
 #include <stddef.h>
-#include <jni.h>
+#include <stdexcept>
 
 namespace dmscanlib {
 
@@ -31,56 +31,23 @@ DecodeOptions::DecodeOptions(
 DecodeOptions::~DecodeOptions() {
 }
 
-std::unique_ptr<DecodeOptions> DecodeOptions::getDecodeOptionsViaJni(
-        JNIEnv *env, jobject decodeOptionsObj) {
-    jclass decodeOptionsJavaClass = env->GetObjectClass(decodeOptionsObj);
-
-    // run the following command to obtain method signatures from a class.
-    // javap -s -p edu.ualberta.med.scannerconfig.dmscanlib.ScanRegion
-    jmethodID getMethod = env->GetMethodID(decodeOptionsJavaClass, "getMinEdgeFactor", "()D");
-    if (env->ExceptionOccurred()) {
-        return NULL;
-    }
-    double minEdgeFactor = env->CallDoubleMethod(decodeOptionsObj, getMethod, NULL);
-
-    getMethod = env->GetMethodID(decodeOptionsJavaClass, "getMaxEdgeFactor", "()D");
-    if (env->ExceptionOccurred()) {
-        return NULL;
-    }
-    double maxEdgeFactor = env->CallDoubleMethod(decodeOptionsObj, getMethod, NULL);
-
-    getMethod = env->GetMethodID(decodeOptionsJavaClass, "getScanGapFactor", "()D");
-    if (env->ExceptionOccurred()) {
-        return NULL;
-    }
-    double scanGapFactor = env->CallDoubleMethod(decodeOptionsObj, getMethod, NULL);
-
-    getMethod = env->GetMethodID(decodeOptionsJavaClass, "getSquareDev", "()J");
-    if (env->ExceptionOccurred()) {
-        return NULL;
-    }
-    long squareDev = static_cast<long>(env->CallLongMethod(decodeOptionsObj, getMethod, NULL));
-
-    getMethod = env->GetMethodID(decodeOptionsJavaClass, "getEdgeThresh", "()J");
-    if (env->ExceptionOccurred()) {
-        return NULL;
-    }
-    long edgeThresh = static_cast<long>(env->CallLongMethod(decodeOptionsObj, getMethod, NULL));
-
-    getMethod = env->GetMethodID(decodeOptionsJavaClass, "getCorrections", "()J");
-    if (env->ExceptionOccurred()) {
-        return NULL;
-    }
-    long corrections = static_cast<long>(env->CallLongMethod(decodeOptionsObj, getMethod, NULL));
+void DecodeOptions::addStage(const DecodeOptions & stage) {
+    std::shared_ptr<DecodeOptions> copy(new DecodeOptions(
+            stage.minEdgeFactor,
+            stage.maxEdgeFactor,
+            stage.scanGapFactor,
+            stage.squareDev,
+            stage.edgeThresh,
+            stage.corrections,
+            stage.shrink));
+    stages.push_back(copy);
+}
 
-    getMethod = env->GetMethodID(decodeOptionsJavaClass, "getShrink", "()J");
-    if (env->ExceptionOccurred()) {
-        return NULL;
+const DecodeOptions & DecodeOptions::getStage(unsigned stage) const {
+    if (stage > stages.size()) {
+        throw std::out_of_range("invalid decode options stage");
     }
-    long shrink = static_cast<long>(env->CallLongMethod(decodeOptionsObj, getMethod, NULL));
-
-    return std::unique_ptr<DecodeOptions>(new DecodeOptions(
-            minEdgeFactor, maxEdgeFactor, scanGapFactor, squareDev, edgeThresh, corrections, shrink));
+    return (stage < stages.size()) ? *stages[stage] : *this;
 }
 
 std::ostream & operator<<(std::ostream &os, const DecodeOptions & m) {
@@ -91,6 +58,9 @@ std::ostream & operator<<(std::ostream &os, const DecodeOptions & m) {
             << " edgeThresh/" << m.edgeThresh
             << " corrections/" << m.corrections
             << " shrink/" << m.shrink;
+    if (!m.stages.empty()) {
+        os << " stages/" << m.getStageCount();
+    }
     return os;
 }
 
@@ -8,9 +8,9 @@
  *      Author: nelson
  */
 
-#include <jni.h>
 #include <ostream>
 #include <memory>
+#include <vector>
 
 namespace dmscanlib {
 
@@ -28,9 +28,24 @@ public:
             const long shrink);
     virtual ~DecodeOptions();
 
-    static std::unique_ptr<DecodeOptions> getDecodeOptionsViaJni(
-            JNIEnv *env,
-            jobject decodeOptionsObj);
+    /*
+     * Adds a copy of stage, without its own stages, to the cascade of
+     * options tried before these ones. The stages are tried in the order
+     * they are added, so they should go from the fastest and narrowest to
+     * the most thorough. Every well is decoded with the first stage, and
+     * the wells a stage misses are decoded together with the next one.
+     * These options are the last stage, and the only one that retries a
+     * well at shrink + 1.
+     */
+    void addStage(const DecodeOptions & stage);
+
+    // the number of stages in the cascade, including these options
+    unsigned getStageCount() const {
+        return static_cast<unsigned>(stages.size()) + 1;
+    }
+
+    // the last stage is these options
+    const DecodeOptions & getStage(unsigned stage) const;
 
     const double minEdgeFactor;
     const double maxEdgeFactor;
@@ -41,6 +56,8 @@ public:
     const long shrink;
 
 private:
+    std::vector<std::shared_ptr<const DecodeOptions> > stages;
+
     friend class Decoder;
     friend std::ostream & operator<<(std::ostream & os, const DecodeOptions & m);
 };
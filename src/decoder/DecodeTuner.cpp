@@ -0,0 +1,262 @@
+/*
+ * DecodeTuner.cpp
+ *
+ * Learns cheaper decode options for a station from the plates it decodes.
+ */
+
+#include "DecodeTuner.h"
+#include "DecodeOptions.h"
+#include "WellDecoder.h"
+
+#include <OpenThreads/ScopedLock>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <glog/logging.h>
+
+namespace dmscanlib {
+
+const double DecodeTuner::DEFAULT_TARGET_RATE = 0.995;
+
+// number of decoded symbols seen before the options are tuned
+const long DecodeTuner::MIN_SAMPLES = 96;
+
+// fraction added on each side of the observed edge lengths
+const double DecodeTuner::EDGE_MARGIN = 0.15;
+
+const double DecodeTuner::SCAN_GAP_STEP = 0.02;
+
+// the scan gap is kept below this fraction of the smallest edge seen
+const double DecodeTuner::SCAN_GAP_EDGE_LIMIT = 0.5;
+
+const double DecodeTuner::RETRY_SHRINK_FRACTION = 0.5;
+
+// weight of the latest plate in the running averages
+const double DecodeTuner::SMOOTHING = 0.2;
+
+DecodeTuner::DecodeTuner(const std::string & _filename, double _targetRate) :
+        filename(_filename),
+        targetRate(_targetRate)
+{
+    reset();
+    if (!filename.empty() && load()) {
+        VLOG(1) << "DecodeTuner: loaded " << filename << ": " << *this;
+    }
+}
+
+DecodeTuner::~DecodeTuner() {
+}
+
+void DecodeTuner::reset() {
+    plates = 0;
+    samples = 0;
+    edgeMin = 0;
+    edgeMax = 0;
+    scanGap = 0;
+    shrinkOffset = 0;
+    retryFraction = 0;
+    rate = 1;
+    plateTime = 0;
+}
+
+std::unique_ptr<DecodeOptions> DecodeTuner::getOptions(const DecodeOptions & conservative) {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+
+    if (samples < MIN_SAMPLES) {
+        return std::unique_ptr<DecodeOptions>();
+    }
+
+    double minEdgeFactor = std::max(conservative.minEdgeFactor, edgeMin * (1 - EDGE_MARGIN));
+    double maxEdgeFactor = std::min(conservative.maxEdgeFactor, edgeMax * (1 + EDGE_MARGIN));
+    if (minEdgeFactor >= maxEdgeFactor) {
+        // the symbols seen do not fit the caller's range
+        return std::unique_ptr<DecodeOptions>();
+    }
+
+    double scanGapFactor = std::max(conservative.scanGapFactor,
+            std::min(scanGap, edgeMin * SCAN_GAP_EDGE_LIMIT));
+
+    return std::unique_ptr<DecodeOptions>(new DecodeOptions(
+            minEdgeFactor,
+            maxEdgeFactor,
+            scanGapFactor,
+            conservative.squareDev,
+            conservative.edgeThresh,
+            conservative.corrections,
+            conservative.shrink + shrinkOffset));
+}
+
+void DecodeTuner::observe(
+        const std::vector<std::unique_ptr<WellDecoder> > & wellDecoders,
+        const DecodeOptions & conservative,
+        const DecodeOptions * tuned,
+        unsigned firstPassDecoded,
+        double seconds) {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+
+    unsigned decoded = 0;
+    unsigned retried = 0;
+    const long baseShrink = (tuned != NULL) ? tuned->shrink : conservative.shrink;
+
+    for (unsigned i = 0, n = wellDecoders.size(); i < n; ++i) {
+        const WellDecoder & wellDecoder = *wellDecoders[i];
+        const std::vector<cv::Point> & quad = wellDecoder.getDecodedQuad();
+        if (wellDecoder.getMessage().empty() || (quad.size() != 4)) {
+            continue;
+        }
+
+        const cv::Rect rect = wellDecoder.getWellRectangle();
+        const double mindim = std::min(rect.width, rect.height);
+        if (mindim <= 0) {
+            continue;
+        }
+
+        for (unsigned j = 0; j < 4; ++j) {
+            const cv::Point & a = quad[j];
+            const cv::Point & b = quad[(j + 1) % 4];
+            double edge = std::sqrt(static_cast<double>(
+                    (b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y))) / mindim;
+            if (samples == 0 && j == 0) {
+                edgeMin = edgeMax = edge;
+            } else {
+                edgeMin = std::min(edgeMin, edge);
+                edgeMax = std::max(edgeMax, edge);
+            }
+        }
+        ++samples;
+        ++decoded;
+        if (wellDecoder.getDecodedScale() > baseShrink) {
+            ++retried;
+        }
+    }
+
+    ++plates;
+    plateTime = (plates == 1) ? seconds : plateTime + SMOOTHING * (seconds - plateTime);
+
+    if (decoded > 0) {
+        double plateRetry = static_cast<double>(retried) / decoded;
+        retryFraction += SMOOTHING * (plateRetry - retryFraction);
+    }
+
+    if ((tuned != NULL) && (decoded > 0)) {
+        double plateRate = static_cast<double>(firstPassDecoded) / decoded;
+        rate += SMOOTHING * (plateRate - rate);
+
+        if (plateRate >= targetRate) {
+            scanGap = std::min(std::max(scanGap, tuned->scanGapFactor) + SCAN_GAP_STEP,
+                    edgeMin * SCAN_GAP_EDGE_LIMIT);
+            if ((shrinkOffset == 0) && (retryFraction > RETRY_SHRINK_FRACTION)) {
+                shrinkOffset = 1;
+                retryFraction = 0;
+            }
+        } else {
+            scanGap = std::max(conservative.scanGapFactor,
+                    tuned->scanGapFactor - 2 * SCAN_GAP_STEP);
+            shrinkOffset = 0;
+        }
+    }
+
+    VLOG(2) << "DecodeTuner: " << *this;
+
+    if (!filename.empty() && !save()) {
+        LOG(WARNING) << "DecodeTuner: could not save state to " << filename;
+    }
+}
+
+/*
+ * The file has one "name value" pair per line. Unknown names are ignored so
+ * that the format can grow.
+ */
+bool DecodeTuner::load() {
+    std::ifstream file(filename.c_str());
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || (line[0] == '#')) {
+            continue;
+        }
+
+        std::istringstream ss(line);
+        std::string name;
+        ss >> name;
+
+        if (name == "plates") {
+            ss >> plates;
+        } else if (name == "samples") {
+            ss >> samples;
+        } else if (name == "edgeMin") {
+            ss >> edgeMin;
+        } else if (name == "edgeMax") {
+            ss >> edgeMax;
+        } else if (name == "scanGap") {
+            ss >> scanGap;
+        } else if (name == "shrinkOffset") {
+            ss >> shrinkOffset;
+        } else if (name == "retryFraction") {
+            ss >> retryFraction;
+        } else if (name == "rate") {
+            ss >> rate;
+        } else if (name == "plateTime") {
+            ss >> plateTime;
+        }
+
+        if (ss.fail()) {
+            LOG(WARNING) << "DecodeTuner: ignoring invalid state file " << filename;
+            reset();
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Written to a temporary file first so that a crash never leaves a partial
+ * state file behind.
+ */
+bool DecodeTuner::save() const {
+    const std::string tmpFilename = filename + ".tmp";
+    {
+        std::ofstream file(tmpFilename.c_str());
+        if (!file.is_open()) {
+            return false;
+        }
+        file.precision(6);
+        file << "# dmscanlib decode tuner state\n"
+                << "plates " << plates << "\n"
+                << "samples " << samples << "\n"
+                << "edgeMin " << edgeMin << "\n"
+                << "edgeMax " << edgeMax << "\n"
+                << "scanGap " << scanGap << "\n"
+                << "shrinkOffset " << shrinkOffset << "\n"
+                << "retryFraction " << retryFraction << "\n"
+                << "rate " << rate << "\n"
+                << "plateTime " << plateTime << "\n";
+        if (!file.good()) {
+            return false;
+        }
+    }
+
+#ifdef _VISUALC_
+    // rename() does not replace an existing file on Windows
+    remove(filename.c_str());
+#endif
+    return rename(tmpFilename.c_str(), filename.c_str()) == 0;
+}
+
+std::ostream & operator<<(std::ostream & os, const DecodeTuner & m) {
+    os << "plates/" << m.plates
+            << " samples/" << m.samples
+            << " edges/" << m.edgeMin << "-" << m.edgeMax
+            << " scanGap/" << m.scanGap
+            << " shrinkOffset/" << m.shrinkOffset
+            << " rate/" << m.rate
+            << " plateTime/" << m.plateTime;
+    return os;
+}
+
+} /* namespace */
@@ -0,0 +1,103 @@
+#ifndef DECODETUNER_H_
+#define DECODETUNER_H_
+
+/*
+ * DecodeTuner.h
+ *
+ * Learns cheaper decode options for a station from the plates it decodes.
+ */
+
+#include <OpenThreads/Mutex>
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace dmscanlib {
+
+class DecodeOptions;
+class WellDecoder;
+
+/*
+ * The options passed by the caller are treated as the conservative options.
+ * Once enough symbols have been seen, the edge range is narrowed to the edge
+ * lengths that were actually decoded, plus a margin, and the scan gap is
+ * raised one step after every plate whose decode rate stays at or above the
+ * target. A plate that falls below the target steps the scan gap back. The
+ * decode rate of a plate is the fraction of its decoded wells that the tuned
+ * options found on their own; the others were found when the failed wells
+ * were decoded again with the conservative options.
+ *
+ * The shrink is also raised by one when most wells only decode on the retry
+ * at shrink + 1, so that the first pass is not wasted.
+ *
+ * The state is saved to a small text file after every plate and read back
+ * when the tuner is created. All the methods can be called from any thread.
+ */
+class DecodeTuner {
+public:
+    static const double DEFAULT_TARGET_RATE;
+
+    DecodeTuner(const std::string & filename, double targetRate = DEFAULT_TARGET_RATE);
+    virtual ~DecodeTuner();
+
+    /*
+     * Returns the options to decode with, derived from and never wider than
+     * the conservative options. Returns NULL while the tuner has not seen
+     * enough symbols, in which case the conservative options should be used.
+     */
+    std::unique_ptr<DecodeOptions> getOptions(const DecodeOptions & conservative);
+
+    /*
+     * Called after a plate has been decoded. tuned is the result of
+     * getOptions() for the plate, and firstPassDecoded the number of wells
+     * decoded with it before falling back to the conservative options.
+     */
+    void observe(
+            const std::vector<std::unique_ptr<WellDecoder> > & wellDecoders,
+            const DecodeOptions & conservative,
+            const DecodeOptions * tuned,
+            unsigned firstPassDecoded,
+            double seconds);
+
+    void reset();
+
+    const std::string & getFilename() const {
+        return filename;
+    }
+
+private:
+    static const long MIN_SAMPLES;
+    static const double EDGE_MARGIN;
+    static const double SCAN_GAP_STEP;
+    static const double SCAN_GAP_EDGE_LIMIT;
+    static const double RETRY_SHRINK_FRACTION;
+    static const double SMOOTHING;
+
+    bool load();
+    bool save() const;
+
+    const std::string filename;
+    const double targetRate;
+
+    long plates;
+    long samples;
+    double edgeMin;
+    double edgeMax;
+    double scanGap;
+    long shrinkOffset;
+    double retryFraction;
+    double rate;
+    double plateTime;
+
+    OpenThreads::Mutex mutex;
+
+    friend std::ostream & operator<<(std::ostream & os, const DecodeTuner & m);
+};
+
+std::ostream & operator<<(std::ostream & os, const DecodeTuner & m);
+
+} /* namespace */
+
+#endif /* DECODETUNER_H_ */
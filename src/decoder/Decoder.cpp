@@ -26,6 +26,11 @@
 #include "decoder/WellDecoder.h"
 #include "decoder/ThreadMgr.h"
 #include "decoder/DmtxDecodeHelper.h"
+#include "decoder/DecodeMetrics.h"
+#include "decoder/DecodeListener.h"
+#include "decoder/TubeLocator.h"
+#include "decoder/GridFit.h"
+#include "utils/DmTime.h"
 #include "Image.h"
 #include "DmScanLib.h"
 
@@ -36,7 +41,12 @@
 #include <math.h>
 #include <stdlib.h>
 #include <sstream>
+#include <algorithm>
+#include <set>
 #include <opencv/cv.h>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <OpenThreads/Thread>
 
 #if defined(USE_NVWA)
 #   include "debug_new.h"
@@ -46,88 +56,583 @@ namespace dmscanlib {
 
 using namespace decoder;
 
+const unsigned Decoder::MIN_PARTITION_HEIGHT = 64;
+
+// side of the square searched for a refitted well, in symbol sides
+const double Decoder::REFIT_REGION_FACTOR = 2.0;
+
+namespace {
+
+/*
+ * Adds the time until stop() is called to a phase of the metrics. Does
+ * nothing, not even read the clock, when metrics are not being collected.
+ */
+class PhaseTimer {
+public:
+    PhaseTimer(DecodeMetrics * _metrics, DecodeMetrics::Phase _phase) :
+            metrics(_metrics),
+            phase(_phase),
+            start((metrics != NULL) ? util::getMonotonicNanos() : 0)
+    {
+    }
+
+    void stop() {
+        if (metrics != NULL) {
+            metrics->addTime(phase,
+                    util::nanosToSeconds(util::getMonotonicNanos() - start));
+        }
+    }
+
+private:
+    DecodeMetrics * metrics;
+    const DecodeMetrics::Phase phase;
+    const util::DmNanos start;
+};
+
+} /* namespace */
+
+/*
+ * Searches one horizontal strip of a well image for a 2D barcode. All the
+ * workers for a well share the same image and cancel flag. The first worker
+ * to decode a message stores it in the well decoder and sets the flag, which
+ * stops the region search in the other workers.
+ *
+ * Only the scan locations are limited to the strip, the edges of a region are
+ * still followed into the neighbouring strips.
+ */
+class Decoder::PartitionWorker: public ::OpenThreads::Thread {
+public:
+    PartitionWorker(
+            const Decoder & _decoder,
+            WellDecoder & _wellDecoder,
+            DmtxImage * _dmtxImage,
+            int _scale,
+            const cv::Rect & _strip,
+            CancelFlag & _cancel,
+            OpenThreads::Mutex & _mutex) :
+            decoder(_decoder),
+            wellDecoder(_wellDecoder),
+            dmtxImage(_dmtxImage),
+            scale(_scale),
+            strip(_strip),
+            cancel(_cancel),
+            mutex(_mutex),
+            stats()
+    {
+    }
+
+    virtual ~PartitionWorker() {
+    }
+
+    /*
+     * This method runs in its own thread.
+     */
+    virtual void run() {
+        DecodeMetrics * metrics = decoder.collectMetrics ? &workerMetrics : NULL;
+        decoder.resetDmtxDecode(dmtxDecode, dmtxImage, wellDecoder, scale,
+                (metrics != NULL) ? &stats : NULL);
+
+        const int props[] = {
+                DmtxPropXmin, strip.x,
+                DmtxPropXmax, strip.x + strip.width - 1,
+                DmtxPropYmin, strip.y,
+                DmtxPropYmax, strip.y + strip.height - 1
+        };
+
+        dmtxDecode.setProperties(props, sizeof(props) / (2 * sizeof(props[0])));
+        dmtxDecode.setCancelFlag(&cancel);
+
+        DmtxDecode * dec = dmtxDecode.getDecode();
+        DmtxRegion * reg;
+        while (1) {
+            PhaseTimer findTimer(metrics, DecodeMetrics::REGION_FIND);
+            reg = dmtxRegionFindNext(dec, NULL);
+            findTimer.stop();
+
+            if (reg == NULL) {
+                break;
+            }
+
+            PhaseTimer decodeTimer(metrics, DecodeMetrics::DECODE);
+            DmtxMessage *msg = dmtxDecodeMatrixRegion(dec, reg,
+                    decoder.decodeOptions->corrections);
+            decodeTimer.stop();
+
+            if (msg != NULL) {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+                if (!cancel.isSet()) {
+                    decoder.getDecodeInfo(dec, reg, msg, wellDecoder);
+                    cancel.set();
+                    VLOG(5) << "PartitionWorker: decoded in strip " << strip;
+                }
+                dmtxMessageDestroy(&msg);
+            }
+            dmtxRegionDestroy(&reg);
+        }
+
+        if (metrics != NULL) {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+            workerMetrics.add(stats);
+            wellDecoder.getMetrics().add(workerMetrics);
+        }
+    }
+
+private:
+    const Decoder & decoder;
+    WellDecoder & wellDecoder;
+    DmtxImage * dmtxImage;
+    const int scale;
+    const cv::Rect strip;
+    CancelFlag & cancel;
+    OpenThreads::Mutex & mutex;
+    DmtxDecodeHelper dmtxDecode;
+    DmtxDecodeStats stats;
+    DecodeMetrics workerMetrics;
+};
+
 Decoder::Decoder(
         const Image & image,
         const DecodeOptions & _decodeOptions,
-        std::vector<std::unique_ptr<const WellRectangle> > & _wellRects) :
-        decodeOptions(_decodeOptions),
-        wellRects(_wellRects),
-        decodeSuccessful(false)
+        std::vector<std::unique_ptr<const WellRectangle> > & wellRects,
+        bool preprocessed) :
+        cascade(&_decodeOptions),
+        decodeOptions(&_decodeOptions.getStage(0)),
+        shrinkRetry(_decodeOptions.getStageCount() == 1),
+        layout(new PlateLayout(wellRects)),
+        decodeSuccessful(false),
+        collectMetrics(false),
+        locateTubes(false),
+        refitGrid(false),
+        multiThreaded(true),
+        threadMgr(NULL),
+        listener(NULL)
 {
-    Image tmpImage;
-    image.grayscale(tmpImage);
-    tmpImage.applyFilters(grayscaleImage);
-    if (VLOG_IS_ON(2)) {
-        grayscaleImage.write("filtered.png");
+    init(image, preprocessed);
+}
+
+Decoder::Decoder(
+        const Image & image,
+        const DecodeOptions & _decodeOptions,
+        std::shared_ptr<const PlateLayout> _layout,
+        bool preprocessed) :
+        cascade(&_decodeOptions),
+        decodeOptions(&_decodeOptions.getStage(0)),
+        shrinkRetry(_decodeOptions.getStageCount() == 1),
+        layout(_layout),
+        decodeSuccessful(false),
+        collectMetrics(false),
+        locateTubes(false),
+        refitGrid(false),
+        multiThreaded(true),
+        threadMgr(NULL),
+        listener(NULL)
+{
+    CHECK_NOTNULL(layout.get());
+    init(image, preprocessed);
+}
+
+void Decoder::init(const Image & image, bool preprocessed) {
+    if (preprocessed) {
+        if (image.getOriginalImage().type() != CV_8UC1) {
+            throw std::invalid_argument("preprocessed image is not grayscale");
+        }
+        image.share(grayscaleImage);
+    } else {
+        preprocess(image, grayscaleImage);
+        if (VLOG_IS_ON(2)) {
+            grayscaleImage.write("filtered.png");
+        }
     }
 
     cv::Size size = grayscaleImage.size();
     cv::Rect imageRect(0, 0, size.width, size.height);
-    float width = static_cast<float>(size.width);
-    float height = static_cast<float>(size.height);
-
-    VLOG(5) << "Decoder: image size: " << width << ", " << height;
-
-    for (unsigned i = 0, n = wellRects.size(); i < n; ++i) {
-        // ensure well rectangles are within the image's region
-        const WellRectangle & wellRect = *wellRects[i];
 
-        const cv::Rect & rect = wellRect.getRectangle();
+    VLOG(5) << "Decoder: image size: " << size.width << ", " << size.height;
 
-        VLOG(5) << "Decoder: well: " << rect;
+    // ensure well rectangles are within the image's region
+    const cv::Rect & bounds = layout->getBounds();
+    if (!imageRect.contains(bounds.tl()) || !imageRect.contains(bounds.br())) {
+        for (unsigned i = 0, n = layout->getWellCount(); i < n; ++i) {
+            const WellRectangle & wellRect = layout->getWell(i);
+            const cv::Rect & rect = wellRect.getRectangle();
 
-        if (!imageRect.contains(rect.tl()) || !imageRect.contains(rect.br())) {
-            throw std::invalid_argument("well rectangle exceeds image dimensions: "
-                    + wellRect.getLabel());
+            if (!imageRect.contains(rect.tl()) || !imageRect.contains(rect.br())) {
+                throw std::invalid_argument("well rectangle exceeds image dimensions: "
+                        + wellRect.getLabel());
+            }
         }
     }
 
-    wellDecoders.resize(wellRects.size());
+    wellDecoders.resize(layout->getWellCount());
 }
 
 Decoder::~Decoder() {
 }
 
+void Decoder::preprocess(const Image & image, Image & result) {
+    Image tmpImage;
+    image.grayscale(tmpImage);
+    tmpImage.applyFilters(result);
+}
+
+/*
+ * The band is filtered with an apron of rows on each side, where there are
+ * any, so that the rows kept match those of the whole image filtered at once.
+ */
+void Decoder::preprocessRows(const cv::Mat & image, int begin, int end,
+        int available, cv::Mat & result) {
+    const int apron = Image::getFilterApron();
+    const int first = std::max(0, begin - apron);
+    const int last = std::min(available, end + apron);
+
+    if ((end > available) || ((last < end + apron) && (available < image.rows))) {
+        throw std::logic_error("rows to preprocess are not available");
+    }
+
+    Image band(image.rowRange(first, last));
+    Image filtered;
+    preprocess(band, filtered);
+
+    cv::Mat dst = result.rowRange(begin, end);
+    filtered.getOriginalImage().rowRange(begin - first, end - first).copyTo(dst);
+}
+
 int Decoder::decodeWellRects() {
-    VLOG(3) << "decodeWellRects: numWellRects/" << wellRects.size();
+    VLOG(3) << "decodeWellRects: numWellRects/" << layout->getWellCount();
 
-    for (unsigned i = 0, n = wellRects.size(); i < n; ++i) {
-        const WellRectangle & wellRect = *wellRects[i];
+    createWellDecoders();
+    const int result = multiThreaded ? decodeMultiThreaded() : decodeSingleThreaded();
+    return decodeLaterStages(result);
+}
+
+void Decoder::createWellDecoders() {
+    for (unsigned i = 0, n = layout->getWellCount(); i < n; ++i) {
+        const WellRectangle & wellRect = layout->getWell(i);
 
         VLOG(5) << "well rect: " << wellRect;
 
-        const cv::Rect & rect = wellRect.getRectangle();
+        wellDecoders[i] = std::unique_ptr<WellDecoder>(new WellDecoder(*this, wellRect, i));
+    }
+}
+
+void Decoder::decodeWellsAbove(int row) {
+    if (wellsStarted.empty()) {
+        createWellDecoders();
+        wellsStarted.resize(wellDecoders.size(), false);
+    }
+
+    std::vector<WellDecoder *> wells;
+    for (unsigned i = 0, n = wellDecoders.size(); i < n; ++i) {
+        const cv::Rect & rect = layout->getWell(i).getRectangle();
+        if (!wellsStarted[i] && (rect.y + rect.height <= row)) {
+            wellsStarted[i] = true;
+            wells.push_back(wellDecoders[i].get());
+        }
+    }
 
-        std::unique_ptr<WellRectangle> convertedWellRect(
-                new WellRectangle(
-                        wellRect.getLabel().c_str(),
-                        rect.x,
-                        rect.y,
-                        rect.width,
-                        rect.height
-                ));
+    VLOG(3) << "decodeWellsAbove: row/" << row << " numWells/" << wells.size();
 
-        wellDecoders[i] = std::unique_ptr<WellDecoder>(
-                new WellDecoder(*this, std::move(convertedWellRect)));
+    if (!wells.empty()) {
+        decodeWells(wells);
+    }
+}
+
+int Decoder::decodeRemainingWells() {
+    decodeWellsAbove(grayscaleImage.size().height);
+    return decodeLaterStages(collectDecodedWells());
+}
+
+void Decoder::addWellsTo(std::vector<WellDecoder *> & wells) {
+    createWellDecoders();
+    for (unsigned i = 0, n = wellDecoders.size(); i < n; ++i) {
+        wells.push_back(wellDecoders[i].get());
     }
-    return decodeMultiThreaded();
-    //return decodeSingleThreaded();
 }
 
 int Decoder::decodeSingleThreaded() {
+    std::vector<WellDecoder *> wells(wellDecoders.size());
     for (unsigned i = 0, n = wellDecoders.size(); i < n; ++i) {
-        wellDecoders[i]->run();
-        if (!wellDecoders[i]->getMessage().empty()) {
-            decodedWells[wellDecoders[i]->getMessage()] = wellDecoders[i].get();
-        }
+        wells[i] = wellDecoders[i].get();
     }
-    return SC_SUCCESS;
+    decodeOnThisThread(wells);
+    return collectDecodedWells();
 }
 
 int Decoder::decodeMultiThreaded() {
-    decoder::ThreadMgr threadMgr;
-    threadMgr.decodeWells(wellDecoders);
+    if (threadMgr != NULL) {
+        threadMgr->decodeWells(wellDecoders, listener);
+    } else {
+        decoder::ThreadMgr localThreadMgr;
+        localThreadMgr.decodeWells(wellDecoders, listener);
+    }
+    return collectDecodedWells();
+}
+
+void Decoder::decodeWells(const std::vector<WellDecoder *> & wells) {
+    if (multiThreaded && (threadMgr != NULL)) {
+        threadMgr->decodeWells(wells, listener);
+    } else if (multiThreaded) {
+        decoder::ThreadMgr localThreadMgr;
+        localThreadMgr.decodeWells(wells, listener);
+    } else {
+        decodeOnThisThread(wells);
+    }
+}
+
+void Decoder::decodeOnThisThread(const std::vector<WellDecoder *> & wells) {
+    DmtxDecodeHelper dmtxDecode;
+    for (unsigned i = 0, n = wells.size(); i < n; ++i) {
+        if ((listener != NULL) && listener->isCancelled()) {
+            return;
+        }
+        wells[i]->resetAttempts();
+        wells[i]->decode(dmtxDecode);
+        if ((listener != NULL) && !wells[i]->getMessage().empty()) {
+            listener->wellDecoded(*wells[i]);
+        }
+    }
+}
+
+/*
+ * Decodes the wells that have no message again, using the given options
+ * instead of the ones the decoder was created with. Used to fall back to
+ * conservative options when faster ones miss a well. The wells go through
+ * every stage of the options' cascade.
+ */
+int Decoder::decodeFailedWells(const DecodeOptions & options) {
+    return decodeStages(options, 0);
+}
+
+int Decoder::decodeLaterStages(int result) {
+    if ((result == SC_SUCCESS) && (cascade->getStageCount() > 1)) {
+        result = decodeStages(*cascade, 1);
+    }
+    if ((result == SC_SUCCESS) && refitGrid) {
+        result = decodeRefitWells();
+    }
+    return result;
+}
+
+/*
+ * The wells missed by one stage are queued and decoded together with the
+ * next stage, so that each stage is a single pass over the thread pool.
+ */
+int Decoder::decodeStages(const DecodeOptions & options, unsigned firstStage) {
+    int result = SC_SUCCESS;
+    const unsigned numStages = options.getStageCount();
+
+    for (unsigned stage = firstStage; stage < numStages; ++stage) {
+        std::vector<WellDecoder *> failedWells;
+        for (unsigned i = 0, n = wellDecoders.size(); i < n; ++i) {
+            if (wellDecoders[i]->getMessage().empty()) {
+                failedWells.push_back(wellDecoders[i].get());
+                if (collectMetrics && (stage > 0)) {
+                    wellDecoders[i]->getMetrics().addCount(DecodeMetrics::CASCADE_RETRIES, 1);
+                }
+            }
+        }
+
+        VLOG(3) << "decodeStages: stage/" << stage << " numWells/" << failedWells.size();
+
+        if (failedWells.empty()) {
+            break;
+        }
+
+        decodeOptions = &options.getStage(stage);
+        shrinkRetry = (stage + 1 == numStages);
+        decodeWells(failedWells);
+
+        decodedWells.clear();
+        decodeSuccessful = false;
+        result = collectDecodedWells();
+        if (result != SC_SUCCESS) {
+            break;
+        }
+    }
+    return result;
+}
+
+/*
+ * The grid is fitted from the centres of the wells and of the symbols decoded
+ * in them. Each well still missing is then searched in a square, a few
+ * symbols wide, centred where the fit puts its symbol, with the last stage of
+ * the options and no retry at shrink + 1. Wells whose square would be no
+ * smaller than the well are searched in a square of the well's size. The
+ * retry is not started once the decode is cancelled, nor cancelled part way
+ * through, and the wells search their own region again afterwards. A symbol
+ * already decoded, in another well or by an earlier square, is dropped.
+ */
+int Decoder::decodeRefitWells() {
+    if ((listener != NULL) && listener->isCancelled()) {
+        return SC_DECODE_CANCELLED;
+    }
+
+    GridFit gridFit;
+    std::vector<float> symbolSides;
+    std::vector<WellDecoder *> failedWells;
 
+    for (unsigned i = 0, n = wellDecoders.size(); i < n; ++i) {
+        WellDecoder & wellDecoder = *wellDecoders[i];
+        if (wellDecoder.getMessage().empty()) {
+            failedWells.push_back(&wellDecoder);
+            continue;
+        }
+
+        const std::vector<cv::Point> & quad = wellDecoder.getDecodedQuad();
+        if (quad.size() != 4) {
+            continue;
+        }
+        cv::Point2f symbolCentre(0, 0);
+        float symbolSide = 0;
+        for (unsigned c = 0; c < 4; ++c) {
+            const cv::Point side = quad[(c + 1) % 4] - quad[c];
+            symbolCentre += cv::Point2f(static_cast<float>(quad[c].x),
+                    static_cast<float>(quad[c].y)) * 0.25f;
+            symbolSide = std::max(symbolSide, static_cast<float>(sqrt(
+                    static_cast<double>(side.dot(side)))));
+        }
+        gridFit.addWell(getCentre(layout->getWell(i)), symbolCentre);
+        symbolSides.push_back(symbolSide);
+    }
+
+    if (failedWells.empty() || !gridFit.fit()) {
+        VLOG(3) << "decodeRefitWells: no refit, failed wells/" << failedWells.size();
+        return SC_SUCCESS;
+    }
+
+    std::nth_element(symbolSides.begin(), symbolSides.begin() + symbolSides.size() / 2,
+            symbolSides.end());
+    const double symbolSide = symbolSides[symbolSides.size() / 2];
+    const double regionSide = REFIT_REGION_FACTOR * symbolSide + 2 * gridFit.getResidual();
+
+    const cv::Size imageSize = grayscaleImage.size();
+    const cv::Rect imageRect(0, 0, imageSize.width, imageSize.height);
+
+    std::vector<WellDecoder *> refitWells;
+    for (unsigned i = 0, n = failedWells.size(); i < n; ++i) {
+        WellDecoder & wellDecoder = *failedWells[i];
+        const cv::Rect & wellRect = wellDecoder.getWellRegion().getRectangle();
+        const int side = static_cast<int>(std::min(regionSide,
+                static_cast<double>(std::max(wellRect.width, wellRect.height))));
+        const cv::Point2f centre = gridFit.map(getCentre(wellDecoder.getWellRegion()));
+
+        const cv::Rect region = cv::Rect(static_cast<int>(centre.x - side / 2.0f),
+                static_cast<int>(centre.y - side / 2.0f), side, side) & imageRect;
+        if ((region.width < side / 2) || (region.height < side / 2)) {
+            continue;
+        }
+
+        wellDecoder.setRefitRegion(region);
+        refitWells.push_back(&wellDecoder);
+        if (collectMetrics) {
+            wellDecoder.getMetrics().addCount(DecodeMetrics::REFIT_RETRIES, 1);
+        }
+    }
+
+    VLOG(3) << "decodeRefitWells: numWells/" << refitWells.size() << " regionSide/" << regionSide;
+
+    if (refitWells.empty()) {
+        return SC_SUCCESS;
+    }
+
+    // the listener only hears of the wells left once duplicates are dropped
+    DecodeListener * wellListener = listener;
+    listener = NULL;
+    decodeOptions = cascade;
+    shrinkRetry = false;
+    decodeWells(refitWells);
+    listener = wellListener;
+
+    // a square reaching into a neighbouring well, or overlapping another
+    // well's square, can find a symbol that is already taken
+    std::set<std::string> refitMessages;
+    for (unsigned i = 0, n = refitWells.size(); i < n; ++i) {
+        WellDecoder & wellDecoder = *refitWells[i];
+        if (wellDecoder.getMessage().empty()) {
+            continue;
+        }
+        if ((decodedWells.find(wellDecoder.getMessage()) != decodedWells.end())
+                || !refitMessages.insert(wellDecoder.getMessage()).second) {
+            VLOG(3) << "decodeRefitWells: " << wellDecoder.getLabel()
+                    << " found a neighbour's symbol";
+            wellDecoder.clearDecode();
+        } else if (listener != NULL) {
+            listener->wellDecoded(wellDecoder);
+        }
+    }
+
+    // later decodes, such as the fallback from tuned options, search the wells
+    for (unsigned i = 0, n = refitWells.size(); i < n; ++i) {
+        refitWells[i]->clearRefitRegion();
+    }
+
+    decodedWells.clear();
+    decodeSuccessful = false;
+    return collectDecodedWells();
+}
+
+/*
+ * Only wells still missing here are filled in, and a message that is already
+ * decoded in another well is dropped rather than failing the plate. The
+ * rescan's metrics are added to the wells they were collected for.
+ */
+int Decoder::mergeRescan(const Decoder & rescan, const cv::Point2f & origin, float scale) {
+    std::map<std::string, WellDecoder *> wellsByLabel;
+    for (unsigned i = 0, n = wellDecoders.size(); i < n; ++i) {
+        wellsByLabel[wellDecoders[i]->getLabel()] = wellDecoders[i].get();
+    }
+
+    for (unsigned i = 0, n = rescan.wellDecoders.size(); i < n; ++i) {
+        const WellDecoder & rescanWell = *rescan.wellDecoders[i];
+        std::map<std::string, WellDecoder *>::iterator it = wellsByLabel.find(
+                rescanWell.getLabel());
+        if (it == wellsByLabel.end()) {
+            continue;
+        }
+        WellDecoder & wellDecoder = *it->second;
+        if (collectMetrics) {
+            wellDecoder.getMetrics().add(rescanWell.getMetrics());
+            wellDecoder.getMetrics().addCount(DecodeMetrics::RESCANNED_WELLS, 1);
+        }
+
+        const std::string & message = rescanWell.getMessage();
+        const std::vector<cv::Point> & quad = rescanWell.getDecodedQuad();
+        if (message.empty() || (quad.size() != 4) || !wellDecoder.getMessage().empty()) {
+            continue;
+        }
+        if (decodedWells.find(message) != decodedWells.end()) {
+            VLOG(3) << "mergeRescan: " << rescanWell.getLabel()
+                    << " found a neighbour's symbol";
+            continue;
+        }
+
+        // the quad is kept relative to the region the well decoder searches
+        const cv::Point tl = wellDecoder.getSearchRegion().getRectangle().tl();
+        cv::Point2f points[4];
+        for (unsigned c = 0; c < 4; ++c) {
+            points[c] = origin + cv::Point2f(quad[c].x * scale, quad[c].y * scale)
+                    - cv::Point2f(static_cast<float>(tl.x), static_cast<float>(tl.y));
+        }
+        wellDecoder.setDecodeResult(message.data(), static_cast<int>(message.size()),
+                points, rescanWell.getDecodedScale());
+        decodedWells[message] = &wellDecoder;
+    }
+
+    decodedWells.clear();
+    decodeSuccessful = false;
+    return collectDecodedWells();
+}
+
+cv::Point2f Decoder::getCentre(const WellRectangle & wellRect) {
+    const std::vector<cv::Point2f> & corners = wellRect.getCorners();
+    cv::Point2f centre(0, 0);
+    for (unsigned c = 0, n = corners.size(); c < n; ++c) {
+        centre += corners[c] * (1.0f / n);
+    }
+    return centre;
+}
+
+int Decoder::collectDecodedWells() {
     for (unsigned i = 0, n = wellDecoders.size(); i < n; ++i) {
         WellDecoder & wellDecoder = *wellDecoders[i];
         VLOG(5) << wellDecoder;
@@ -141,6 +646,11 @@ int Decoder::decodeMultiThreaded() {
         }
     }
     decodeSuccessful = true;
+
+    if ((listener != NULL) && listener->isCancelled()) {
+        // the wells decoded before the cancel are still available
+        return SC_DECODE_CANCELLED;
+    }
     return SC_SUCCESS;
 }
 
@@ -159,56 +669,288 @@ const std::map<std::string, const WellDecoder *> & Decoder::getDecodedWells() co
 }
 
 /*
- * Called by multiple threads.
+ * Called by multiple threads. The decode context is owned by the calling
+ * thread. The metrics are collected apart and added to the well's at the end,
+ * since another attempt of the same well may be running.
  */
-void Decoder::decodeWellRect(const Image & wellRectImage, WellDecoder & wellDecoder) const {
+void Decoder::decodeAttempt(
+        const Image & wellRectImage,
+        WellDecoder & wellDecoder,
+        unsigned attempt,
+        bool speculative,
+        DmtxDecodeHelper & dmtxDecode) const {
     DmtxImage * dmtxImage = wellRectImage.dmtxImage();
     CHECK_NOTNULL(dmtxImage);
 
-    std::unique_ptr<DmtxDecodeHelper> dec =
-            createDmtxDecode(dmtxImage, wellDecoder, decodeOptions.shrink);
-    decodeWellRect(wellDecoder, dec->getDecode());
-    VLOG(5) << "decodeWellRect: " << wellDecoder;
+    DecodeMetrics attemptMetrics;
+    DecodeMetrics * metrics = collectMetrics ? &attemptMetrics : NULL;
+    DmtxDecodeStats stats = DmtxDecodeStats();
+    DmtxDecodeStats * statsPtr = (metrics != NULL) ? &stats : NULL;
+    PhaseTimer wellTimer(metrics, DecodeMetrics::WELLS);
 
-    if (wellDecoder.getMessage().empty()) {
-        dec = std::move(createDmtxDecode(
-                dmtxImage, wellDecoder, decodeOptions.shrink + 1));
-        decodeWellRect(wellDecoder, dec->getDecode());
-        VLOG(5) << "decodeWellRect: second attempt " << wellDecoder;
+    if (attempt == 0) {
+        if (locateTubes) {
+            PhaseTimer locateTimer(metrics, DecodeMetrics::LOCATE);
+            wellDecoder.setTubeDisc(TubeLocator::locate(wellRectImage));
+        }
+
+        const long searchPixels = resetDmtxDecode(
+                dmtxDecode, dmtxImage, wellDecoder, decodeOptions->shrink, statsPtr, true);
+        dmtxDecode.setCancelFlag(wellDecoder.getCancelFlag());
+        decodeWellRect(wellDecoder, dmtxDecode.getDecode(), metrics);
+        VLOG(5) << "decodeAttempt: " << wellDecoder;
+
+        if (metrics != NULL) {
+            metrics->addCount(DecodeMetrics::WELL_PIXELS, wellDecoder.getWellRectangle().area());
+            metrics->addCount(DecodeMetrics::SEARCH_PIXELS, searchPixels);
+        }
+    } else {
+        // the retry searches the whole well, in case the tube was misplaced
+        PhaseTimer retryTimer(metrics, DecodeMetrics::RETRY);
+        resetDmtxDecode(dmtxDecode, dmtxImage, wellDecoder, decodeOptions->shrink + 1, statsPtr);
+        dmtxDecode.setCancelFlag(wellDecoder.getCancelFlag());
+        decodeWellRect(wellDecoder, dmtxDecode.getDecode(), metrics);
+        retryTimer.stop();
+        VLOG(5) << "decodeAttempt: second attempt " << wellDecoder;
+
+        if (metrics != NULL) {
+            metrics->addCount(DecodeMetrics::SHRINK_RETRIES, 1);
+        }
     }
     dmtxImageDestroy(&dmtxImage);
+
+    wellTimer.stop();
+    if (metrics != NULL) {
+        metrics->add(stats);
+        if (speculative) {
+            metrics->addCount(DecodeMetrics::SPECULATIVE_ATTEMPTS, 1);
+        }
+        wellDecoder.addMetrics(attemptMetrics);
+    }
 }
 
-std::unique_ptr<DmtxDecodeHelper> Decoder::createDmtxDecode(
+/*
+ * Decodes a single well using several threads. The image is split into
+ * horizontal strips no shorter than MIN_PARTITION_HEIGHT pixels and each
+ * strip is searched by its own worker, with its own decode context.
+ */
+void Decoder::decodeWellRectPartitioned(
+        const Image & wellRectImage,
+        WellDecoder & wellDecoder,
+        unsigned numPartitions) const {
+    DmtxImage * dmtxImage = wellRectImage.dmtxImage();
+    CHECK_NOTNULL(dmtxImage);
+
+    cv::Size size = wellRectImage.size();
+    unsigned maxPartitions = std::max(
+            1u, static_cast<unsigned>(size.height) / MIN_PARTITION_HEIGHT);
+    numPartitions = std::max(1u, std::min(numPartitions, maxPartitions));
+
+    OpenThreads::Mutex mutex;
+    DecodeMetrics * metrics = collectMetrics ? &wellDecoder.getMetrics() : NULL;
+    PhaseTimer wellTimer(metrics, DecodeMetrics::WELLS);
+
+    const int lastScale = decodeOptions->shrink + (shrinkRetry ? 1 : 0);
+    for (int scale = decodeOptions->shrink; scale <= lastScale; ++scale) {
+        if ((scale > decodeOptions->shrink) && (metrics != NULL)) {
+            metrics->addCount(DecodeMetrics::SHRINK_RETRIES, 1);
+        }
+
+        CancelFlag cancel;
+        std::vector<std::unique_ptr<PartitionWorker> > workers(numPartitions);
+
+        for (unsigned i = 0; i < numPartitions; ++i) {
+            int yBeg = size.height * i / numPartitions;
+            int yEnd = size.height * (i + 1) / numPartitions;
+            cv::Rect strip(0, yBeg, size.width, yEnd - yBeg);
+
+            workers[i] = std::unique_ptr<PartitionWorker>(new PartitionWorker(
+                    *this, wellDecoder, dmtxImage, scale, strip, cancel, mutex));
+            workers[i]->start();
+        }
+
+        for (unsigned i = 0; i < numPartitions; ++i) {
+            workers[i]->join();
+        }
+
+        VLOG(5) << "decodeWellRectPartitioned: scale/" << scale << " partitions/"
+                << numPartitions << " " << wellDecoder;
+
+        if (!wellDecoder.getMessage().empty()) {
+            break;
+        }
+    }
+    dmtxImageDestroy(&dmtxImage);
+    wellTimer.stop();
+}
+
+/*
+ * Retargets the decode context at the well's image and assigns all the decode
+ * properties in one call, so that the scan grid is only built once. Returns
+ * the number of pixels, in the well image, left to search.
+ *
+ * When restrictToTube is set and the well's tube bottom was located, the
+ * search is limited to that disc.
+ */
+long Decoder::resetDmtxDecode(
+        DmtxDecodeHelper & dmtxDecode,
         DmtxImage * dmtxImage,
         WellDecoder & wellDecoder,
-        int scale) const {
-    std::unique_ptr<DmtxDecodeHelper> dec(new DmtxDecodeHelper(dmtxImage, scale));
+        int scale,
+        DmtxDecodeStats * stats,
+        bool restrictToTube) const {
+    dmtxDecode.reset(dmtxImage, scale);
+
+    const WellRectangle & wellRect = wellDecoder.getSearchRegion();
+
+    // the edge lengths are relative to the well, not to its bounding box
+    unsigned mindim = static_cast<unsigned>(wellDecoder.getWellRegion().getMinSide());
+
+    const int props[] = {
+            DmtxPropEdgeMin, static_cast<int>(decodeOptions->minEdgeFactor * mindim),
+            DmtxPropEdgeMax, static_cast<int>(decodeOptions->maxEdgeFactor * mindim),
+            DmtxPropScanGap, static_cast<int>(decodeOptions->scanGapFactor * mindim),
+            DmtxPropSymbolSize, DmtxSymbolSquareAuto,
+            DmtxPropSquareDevn, static_cast<int>(decodeOptions->squareDev),
+            DmtxPropEdgeThresh, static_cast<int>(decodeOptions->edgeThresh)
+    };
 
-    cv::Rect bbox = wellDecoder.getWellRectangle();
+    dmtxDecode.setProperties(props, sizeof(props) / (2 * sizeof(props[0])));
+    dmtxDecode.setStats(stats);
 
-    unsigned mindim = std::min(bbox.width, bbox.height);
+    // only read when restricted, the first attempt may be writing it otherwise
+    const cv::Vec3f & disc = wellDecoder.getTubeDisc();
+    const bool useDisc = restrictToTube && (disc[2] > 0);
 
-    dec->setProperty(DmtxPropEdgeMin, static_cast<int>(decodeOptions.minEdgeFactor * mindim));
-    dec->setProperty(DmtxPropEdgeMax, static_cast<int>(decodeOptions.maxEdgeFactor * mindim));
-    dec->setProperty(DmtxPropScanGap, static_cast<int>(decodeOptions.scanGapFactor * mindim));
+    if (!wellRect.isQuad() && !useDisc) {
+        return wellRect.getRectangle().area();
+    }
 
-    dec->setProperty(DmtxPropSymbolSize, DmtxSymbolSquareAuto);
-    dec->setProperty(DmtxPropSquareDevn, decodeOptions.squareDev);
-    dec->setProperty(DmtxPropEdgeThresh, decodeOptions.edgeThresh);
+    if (!useDisc) {
+        const unsigned well = wellDecoder.getWellIndex();
+        const std::vector<PlateLayout::Span> * spans = layout->getQuadSpans(well, scale);
+        if (spans != NULL) {
+            maskSpans(dmtxDecode, *spans);
+            return layout->getQuadPixels(well, scale);
+        }
+    }
+    return maskOutsideWell(dmtxDecode, wellRect, useDisc ? &disc : NULL, scale);
+}
 
-    return dec;
+/*
+ * Marks the pixels of each row outside the layout's precomputed span for the
+ * row as visited. Does the same as maskOutsideWell() without a disc.
+ */
+void Decoder::maskSpans(
+        DmtxDecodeHelper & dmtxDecode,
+        const std::vector<PlateLayout::Span> & spans) const {
+    DmtxDecode * dec = dmtxDecode.getDecode();
+    const int width = dmtxDecodeGetProp(dec, DmtxPropWidth);
+    const int height = dmtxDecodeGetProp(dec, DmtxPropHeight);
+    CHECK_EQ(static_cast<int>(spans.size()), height);
+
+    for (int y = 0; y < height; ++y) {
+        const PlateLayout::Span & span = spans[y];
+        if (span.first >= span.second) {
+            dmtxDecode.setVisited(y, 0, width);
+            continue;
+        }
+        dmtxDecode.setVisited(y, 0, span.first);
+        dmtxDecode.setVisited(y, span.second, width);
+    }
 }
 
-void Decoder::decodeWellRect(WellDecoder & wellDecoder, DmtxDecode *dec) const {
+/*
+ * Marks the pixels of the well's bounding box that are outside its corners,
+ * or outside the tube's disc when one is given, as visited so that libdmtx
+ * does not probe them or follow edges into them. With a disc, the scan grid
+ * is also limited to the disc's bounding box.
+ *
+ * Each scaled row of the decode context is intersected with the quad and
+ * the disc. libdmtx counts rows from the bottom of the image, and scaled row
+ * y samples its unscaled row y * scale.
+ */
+long Decoder::maskOutsideWell(
+        DmtxDecodeHelper & dmtxDecode,
+        const WellRectangle & wellRect,
+        const cv::Vec3f * disc,
+        int scale) {
+    DmtxDecode * dec = dmtxDecode.getDecode();
+    const int width = dmtxDecodeGetProp(dec, DmtxPropWidth);
+    const int height = dmtxDecodeGetProp(dec, DmtxPropHeight);
+    const int imageHeight = dmtxImageGetProp(dec->image, DmtxPropHeight);
+
+    long searchPixels = 0;
+    int xBeg = width, xEnd = 0, yBeg = height, yEnd = 0;
+
+    for (int y = 0; y < height; ++y) {
+        const float imageY = static_cast<float>(imageHeight - 1 - y * scale);
+        float xmin, xmax;
+
+        if (!wellRect.getRowSpan(imageY, xmin, xmax)) {
+            dmtxDecode.setVisited(y, 0, width);
+            continue;
+        }
+
+        if (disc != NULL) {
+            const float dy = imageY - (*disc)[1];
+            const float radius = (*disc)[2];
+            if (fabs(dy) > radius) {
+                xmax = -1;
+            } else {
+                const float halfChord = sqrt(radius * radius - dy * dy);
+                xmin = std::max(xmin, (*disc)[0] - halfChord);
+                xmax = std::min(xmax, (*disc)[0] + halfChord);
+            }
+        }
+
+        const PlateLayout::Span span = PlateLayout::toScaledSpan(xmin, xmax, width, scale);
+        const int spanBeg = span.first;
+        const int spanEnd = span.second;
+
+        if (spanBeg >= spanEnd) {
+            dmtxDecode.setVisited(y, 0, width);
+            continue;
+        }
+        dmtxDecode.setVisited(y, 0, spanBeg);
+        dmtxDecode.setVisited(y, spanEnd, width);
+
+        searchPixels += spanEnd - spanBeg;
+        xBeg = std::min(xBeg, spanBeg);
+        xEnd = std::max(xEnd, spanEnd);
+        yBeg = std::min(yBeg, y);
+        yEnd = std::max(yEnd, y + 1);
+    }
+
+    if ((disc != NULL) && (xBeg < xEnd) && (yBeg < yEnd)) {
+        // the bounds are given in unscaled pixels
+        const int props[] = {
+                DmtxPropXmin, xBeg * scale,
+                DmtxPropXmax, (xEnd - 1) * scale,
+                DmtxPropYmin, yBeg * scale,
+                DmtxPropYmax, (yEnd - 1) * scale
+        };
+        dmtxDecode.setProperties(props, sizeof(props) / (2 * sizeof(props[0])));
+    }
+    return searchPixels * scale * scale;
+}
+
+void Decoder::decodeWellRect(WellDecoder & wellDecoder, DmtxDecode *dec,
+        DecodeMetrics * metrics) const {
     DmtxRegion * reg;
     while (1) {
+        PhaseTimer findTimer(metrics, DecodeMetrics::REGION_FIND);
         reg = dmtxRegionFindNext(dec, NULL);
+        findTimer.stop();
+
         if (reg == NULL) {
             break;
         }
 
-        DmtxMessage *msg = dmtxDecodeMatrixRegion(dec, reg, decodeOptions.corrections);
+        PhaseTimer decodeTimer(metrics, DecodeMetrics::DECODE);
+        DmtxMessage *msg = dmtxDecodeMatrixRegion(dec, reg, decodeOptions->corrections);
+        decodeTimer.stop();
+
         if (msg != NULL) {
             getDecodeInfo(dec, reg, msg, wellDecoder);
 
@@ -237,8 +979,6 @@ void Decoder::getDecodeInfo(
 
     DmtxVector2 p00, p10, p11, p01;
 
-    wellDecoder.setMessage((char *) msg->output, msg->outputIdx);
-
     int height = dmtxDecodeGetProp(dec, DmtxPropHeight);
     p00.X = p00.Y = p10.Y = p01.X = 0.0;
     p10.X = p01.Y = p11.X = p11.Y = 1.0;
@@ -259,7 +999,8 @@ void Decoder::getDecodeInfo(
             cv::Point2f(static_cast<float>(p01.X), static_cast<float>(p01.Y)) * dec->scale
     };
 
-    wellDecoder.setDecodeQuad(points);
+    // the first attempt to decode the well keeps its message
+    wellDecoder.setDecodeResult((char *) msg->output, msg->outputIdx, points, dec->scale);
 }
 
 void Decoder::showStats(DmtxDecode * dec, DmtxRegion * reg, DmtxMessage * msg) {
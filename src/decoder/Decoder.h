@@ -23,6 +23,7 @@
 
 #include "Image.h"
 #include "WellRectangle.h"
+#include "PlateLayout.h"
 
 #include <dmtx.h>
 #include <string>
@@ -38,19 +39,148 @@
 namespace dmscanlib {
 
 class DecodeOptions;
+class DecodeMetrics;
+class DecodeListener;
 class WellDecoder;
 
 namespace decoder {
 class DmtxDecodeHelper;
+class ThreadMgr;
 }
 
 class Decoder {
 public:
+    /*
+     * When preprocessed is true the image must already have been passed
+     * through preprocess(), and it is used without being copied. This lets
+     * the same image be decoded many times without filtering it again.
+     */
     Decoder(const Image & image, const DecodeOptions & decodeOptions,
-            std::vector<std::unique_ptr<const WellRectangle> > & wellRects);
+            std::vector<std::unique_ptr<const WellRectangle> > & wellRects,
+            bool preprocessed = false);
+
+    // decodes the wells of a layout that can be shared with other decoders
+    Decoder(const Image & image, const DecodeOptions & decodeOptions,
+            std::shared_ptr<const PlateLayout> layout,
+            bool preprocessed = false);
     virtual ~Decoder();
     int decodeWellRects();
-    void decodeWellRect(const Image & wellRectImage, WellDecoder & wellDecoder) const;
+
+    int decodeFailedWells(const DecodeOptions & options);
+
+    /*
+     * When the options have a cascade, the wells are first decoded with its
+     * first stage only. Given what that pass returned, decodes the wells it
+     * missed with the later stages, and then around where the plate's
+     * refitted grid puts them when that is enabled. decodeWellRects() and
+     * decodeRemainingWells() call it themselves.
+     */
+    int decodeLaterStages(int result);
+
+    /*
+     * For an image that is filled in while it is being decoded: decodes the
+     * wells not yet started that lie entirely above the given row. Once the
+     * whole image is ready, decodeRemainingWells() decodes the rest and
+     * checks the plate.
+     */
+    void decodeWellsAbove(int row);
+
+    int decodeRemainingWells();
+
+    /*
+     * For a caller that decodes the wells of several plates together:
+     * appends this plate's wells to wells, to be decoded by the caller.
+     * Once they are done collectDecodedWells() checks the plate.
+     */
+    void addWellsTo(std::vector<WellDecoder *> & wells);
+
+    int collectDecodedWells();
+
+    /*
+     * Takes the wells decoded by a decoder of part of the same plate, such as
+     * a rescan at a higher DPI, into this one's wells with the same labels,
+     * and checks the plate again. A point p of the rescan's image is at
+     * origin + p * scale in this one.
+     */
+    int mergeRescan(const Decoder & rescan, const cv::Point2f & origin, float scale);
+
+    // converts the image to grayscale and applies the decoding filters
+    static void preprocess(const Image & image, Image & result);
+
+    /*
+     * Does what preprocess() does for rows begin to end - 1 of a colour
+     * image, writing them into the same rows of result, a grayscale image of
+     * the same size. Only the rows above available are read, so unless
+     * available is the image's height it must be at least the filter apron
+     * below end.
+     */
+    static void preprocessRows(const cv::Mat & image, int begin, int end,
+            int available, cv::Mat & result);
+
+    /*
+     * Marks the part of a decode context, reset for the well's image at
+     * scale, that is outside the well's corners, or outside disc unless it
+     * is NULL, as visited. Returns the number of unscaled pixels left to
+     * search.
+     */
+    static long maskOutsideWell(
+            decoder::DmtxDecodeHelper & dmtxDecode,
+            const WellRectangle & wellRect,
+            const cv::Vec3f * disc,
+            int scale);
+
+    // when cleared, the wells are decoded on the calling thread
+    void setMultiThreaded(bool multi) {
+        multiThreaded = multi;
+    }
+
+    // decodes with the given thread pool instead of starting new threads
+    void setThreadMgr(decoder::ThreadMgr * mgr) {
+        threadMgr = mgr;
+    }
+
+    // told about each well as it is decoded, and can cancel the decode
+    void setListener(DecodeListener * wellListener) {
+        listener = wellListener;
+    }
+
+    // when set, the search in each well is limited to its tube's bottom
+    void setLocateTubes(bool locate) {
+        locateTubes = locate;
+    }
+
+    /*
+     * When set, the plate's grid is fitted to the symbols decoded and each
+     * well still missing is decoded once more, searching only a square
+     * around where the fitted grid puts its symbol. Helps with racks that
+     * sit slightly off the wells given.
+     */
+    void setRefitGrid(bool refit) {
+        refitGrid = refit;
+    }
+
+    // when set, each well decoder collects DecodeMetrics
+    void setCollectMetrics(bool collect) {
+        collectMetrics = collect;
+    }
+
+    /*
+     * A well is decoded in attempts: the first one at the options' shrink,
+     * limited to the tube when tubes are located, and, when it fails on the
+     * last stage of the options, a second one over the whole well at
+     * shrink + 1. The attempts of a well can run on different threads at
+     * the same time, see WellDecoder.
+     */
+    unsigned getAttemptCount() const {
+        return shrinkRetry ? 2 : 1;
+    }
+
+    void decodeAttempt(const Image & wellRectImage, WellDecoder & wellDecoder,
+            unsigned attempt, bool speculative,
+            decoder::DmtxDecodeHelper & dmtxDecode) const;
+
+    void decodeWellRectPartitioned(const Image & wellRectImage,
+            WellDecoder & wellDecoder, unsigned numPartitions) const;
 
     const Image & getWorkingImage() const {
         return grayscaleImage;
@@ -69,24 +199,58 @@ public:
     static void writeDiagnosticImage(DmtxDecode *dec, const std::string & id);
 
 private:
+    class PartitionWorker;
+
+    static const unsigned MIN_PARTITION_HEIGHT;
+    static const double REFIT_REGION_FACTOR;
+
+    void init(const Image & image, bool preprocessed);
     void applyFilters();
-    void decodeWellRect(WellDecoder & wellDecoder, DmtxDecode *dec) const;
-    std::unique_ptr<decoder::DmtxDecodeHelper> createDmtxDecode(
+    void decodeWellRect(WellDecoder & wellDecoder, DmtxDecode *dec,
+            DecodeMetrics * metrics) const;
+    void maskSpans(
+            decoder::DmtxDecodeHelper & dmtxDecode,
+            const std::vector<PlateLayout::Span> & spans) const;
+    long resetDmtxDecode(
+            decoder::DmtxDecodeHelper & dmtxDecode,
             DmtxImage * dmtxImage,
             WellDecoder & wellDecoder,
-            int scale) const;
+            int scale,
+            DmtxDecodeStats * stats,
+            bool restrictToTube = false) const;
 
     void getDecodeInfo(DmtxDecode *dec, DmtxRegion *reg, DmtxMessage *msg,
             WellDecoder & wellDecoder) const;
 
+    void createWellDecoders();
     int decodeSingleThreaded();
     int decodeMultiThreaded();
+    void decodeWells(const std::vector<WellDecoder *> & wells);
+    int decodeStages(const DecodeOptions & options, unsigned firstStage);
+    int decodeRefitWells();
+    static cv::Point2f getCentre(const WellRectangle & wellRect);
+    void decodeOnThisThread(const std::vector<WellDecoder *> & wells);
 
     Image grayscaleImage;
-    const DecodeOptions & decodeOptions;
-    const std::vector<std::unique_ptr<const WellRectangle> > & wellRects;
+
+    // the options the decoder was created with, and the stage being decoded
+    const DecodeOptions * cascade;
+    const DecodeOptions * decodeOptions;
+
+    // only the last stage of a cascade retries a well at shrink + 1
+    bool shrinkRetry;
+    std::shared_ptr<const PlateLayout> layout;
     std::vector<std::unique_ptr<WellDecoder> > wellDecoders;
+
+    // the wells decodeWellsAbove() has started on, empty until it is called
+    std::vector<bool> wellsStarted;
     bool decodeSuccessful;
+    bool collectMetrics;
+    bool locateTubes;
+    bool refitGrid;
+    bool multiThreaded;
+    decoder::ThreadMgr * threadMgr;
+    DecodeListener * listener;
     std::map<std::string, const WellDecoder *> decodedWells;
 };
 
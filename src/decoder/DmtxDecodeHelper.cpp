@@ -13,6 +13,11 @@ namespace dmscanlib {
 
 namespace decoder {
 
+DmtxDecodeHelper::DmtxDecodeHelper() :
+        dec(NULL)
+{
+}
+
 DmtxDecodeHelper::DmtxDecodeHelper(DmtxImage * dmtxImage, int scale) :
         dec(dmtxDecodeCreate(dmtxImage, scale))
 {
@@ -20,7 +25,24 @@ DmtxDecodeHelper::DmtxDecodeHelper(DmtxImage * dmtxImage, int scale) :
 }
 
 DmtxDecodeHelper::~DmtxDecodeHelper() {
-    dmtxDecodeDestroy(&dec);
+    if (dec != NULL) {
+        dmtxDecodeDestroy(&dec);
+    }
+}
+
+/*
+ * The decode context is only created on first use. After that it is
+ * retargeted at the new image, and its cache is only reallocated if the image
+ * is larger than any seen before.
+ */
+void DmtxDecodeHelper::reset(DmtxImage * dmtxImage, int scale) {
+    CHECK_NOTNULL(dmtxImage);
+    if (dec == NULL) {
+        dec = dmtxDecodeCreate(dmtxImage, scale);
+        CHECK_NOTNULL(dec);
+        return;
+    }
+    CHECK(dmtxDecodeReset(dec, dmtxImage, scale) == DmtxPass);
 }
 
 unsigned DmtxDecodeHelper::setProperty(int prop, int value) {
@@ -28,6 +50,33 @@ unsigned DmtxDecodeHelper::setProperty(int prop, int value) {
     return dmtxDecodeSetProp(dec, prop, value);
 }
 
+unsigned DmtxDecodeHelper::setProperties(const int * props, int count) {
+    CHECK_NOTNULL(dec);
+    return dmtxDecodeSetProps(dec, props, count);
+}
+
+unsigned DmtxDecodeHelper::setCancelFlag(const CancelFlag * cancel) {
+    CHECK_NOTNULL(dec);
+    if (cancel == NULL) {
+        return dmtxDecodeSetCancel(dec, NULL, NULL);
+    }
+    return dmtxDecodeSetCancel(dec, &CancelFlag::isSet,
+            const_cast<CancelFlag *>(cancel));
+}
+
+unsigned DmtxDecodeHelper::setStats(DmtxDecodeStats * stats) {
+    CHECK_NOTNULL(dec);
+    return dmtxDecodeSetStats(dec, stats);
+}
+
+unsigned DmtxDecodeHelper::setVisited(int y, int xBeg, int xEnd) {
+    CHECK_NOTNULL(dec);
+    if (xBeg >= xEnd) {
+        return DmtxPass;
+    }
+    return dmtxDecodeSetVisited(dec, y, xBeg, xEnd);
+}
+
 } /* namespace decoder */
 
 } /* namespace dmscanlib */
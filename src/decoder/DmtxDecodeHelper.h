@@ -9,18 +9,73 @@
  */
 
 #include <dmtx.h>
+#include <atomic>
 
 namespace dmscanlib {
 
 namespace decoder {
 
+/*
+ * Set by one thread to stop the region searches of the decode contexts it
+ * was given to, see DmtxDecodeHelper::setCancelFlag().
+ */
+class CancelFlag {
+public:
+    CancelFlag() :
+            flag(0)
+    {
+    }
+
+    void set() {
+        flag.store(1);
+    }
+
+    void clear() {
+        flag.store(0);
+    }
+
+    bool isSet() const {
+        return flag.load() != 0;
+    }
+
+    // the libdmtx cancel callback, context is the flag
+    static int isSet(void * context) {
+        return static_cast<const CancelFlag *>(context)->isSet() ? 1 : 0;
+    }
+
+private:
+    CancelFlag(const CancelFlag &);
+    CancelFlag & operator=(const CancelFlag &);
+
+    std::atomic<int> flag;
+};
+
+/*
+ * Owns a libdmtx decode context. The context can be retargeted at a new image
+ * with reset(), which reuses the cache memory allocated for previous images.
+ */
 class DmtxDecodeHelper {
 public:
+    DmtxDecodeHelper();
     DmtxDecodeHelper(DmtxImage * dmtxImage, int scale);
     virtual ~DmtxDecodeHelper();
 
+    void reset(DmtxImage * dmtxImage, int scale);
+
     unsigned setProperty(int prop, int value);
 
+    // props holds count (property, value) pairs
+    unsigned setProperties(const int * props, int count);
+
+    // region search stops once cancel is set, NULL to never stop it
+    unsigned setCancelFlag(const CancelFlag * cancel);
+
+    // libdmtx adds to these counters, NULL to stop collecting them
+    unsigned setStats(DmtxDecodeStats * stats);
+
+    // pixels [xBeg, xEnd) of scaled row y are skipped by the region search
+    unsigned setVisited(int y, int xBeg, int xEnd);
+
     DmtxDecode * getDecode() {
         return dec;
     }
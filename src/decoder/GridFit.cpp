@@ -0,0 +1,130 @@
+/*
+ * GridFit.cpp
+ *
+ * Works out where the wells of a plate really are from the symbols decoded
+ * in some of them.
+ */
+
+#include "GridFit.h"
+
+#define GLOG_NO_ABBREVIATED_SEVERITIES
+#include <glog/logging.h>
+
+#include <math.h>
+
+namespace dmscanlib {
+
+namespace decoder {
+
+const unsigned GridFit::MIN_WELLS = 3;
+
+const double GridFit::OUTLIER_FACTOR = 2.5;
+
+GridFit::GridFit() :
+        a(1),
+        b(0),
+        residual(0)
+{
+}
+
+GridFit::~GridFit() {
+}
+
+void GridFit::addWell(const cv::Point2f & nominal, const cv::Point2f & decoded) {
+    nominals.push_back(nominal);
+    decodeds.push_back(decoded);
+}
+
+bool GridFit::fit() {
+    const unsigned numWells = nominals.size();
+    std::vector<bool> used(numWells, true);
+    if ((numWells < MIN_WELLS) || !fitWells(used)) {
+        return false;
+    }
+
+    unsigned numUsed = 0;
+    const double maxDistance = OUTLIER_FACTOR * residual;
+    for (unsigned i = 0; i < numWells; ++i) {
+        const cv::Point2f error = map(nominals[i]) - decodeds[i];
+        used[i] = (sqrt(error.dot(error)) <= maxDistance);
+        if (used[i]) {
+            ++numUsed;
+        }
+    }
+
+    if ((numUsed < numWells) && (numUsed >= MIN_WELLS)) {
+        VLOG(3) << "GridFit: dropped " << numWells - numUsed << " of " << numWells << " wells";
+        if (!fitWells(used)) {
+            return false;
+        }
+    }
+
+    VLOG(3) << "GridFit: scale/" << getScale() << " rotation/" << getRotation()
+            << " offset/" << (decodedCentroid - nominalCentroid) << " residual/" << residual;
+    return true;
+}
+
+/*
+ * With both sets of points centred on their centroids, the least squares
+ * rotation and scale have a closed form.
+ */
+bool GridFit::fitWells(const std::vector<bool> & used) {
+    unsigned count = 0;
+    cv::Point2f nominalSum(0, 0), decodedSum(0, 0);
+    for (unsigned i = 0, n = nominals.size(); i < n; ++i) {
+        if (used[i]) {
+            nominalSum += nominals[i];
+            decodedSum += decodeds[i];
+            ++count;
+        }
+    }
+    nominalCentroid = nominalSum * (1.0f / count);
+    decodedCentroid = decodedSum * (1.0f / count);
+
+    double norm = 0, dot = 0, cross = 0;
+    for (unsigned i = 0, n = nominals.size(); i < n; ++i) {
+        if (!used[i]) {
+            continue;
+        }
+        const cv::Point2f d = nominals[i] - nominalCentroid;
+        const cv::Point2f e = decodeds[i] - decodedCentroid;
+        norm += d.x * d.x + d.y * d.y;
+        dot += d.x * e.x + d.y * e.y;
+        cross += d.x * e.y - d.y * e.x;
+    }
+
+    if (norm < 1) {
+        return false;
+    }
+    a = dot / norm;
+    b = cross / norm;
+
+    double squares = 0;
+    for (unsigned i = 0, n = nominals.size(); i < n; ++i) {
+        if (used[i]) {
+            const cv::Point2f error = map(nominals[i]) - decodeds[i];
+            squares += error.dot(error);
+        }
+    }
+    residual = sqrt(squares / count);
+    return true;
+}
+
+cv::Point2f GridFit::map(const cv::Point2f & nominal) const {
+    const cv::Point2f d = nominal - nominalCentroid;
+    return decodedCentroid + cv::Point2f(
+            static_cast<float>(a * d.x - b * d.y),
+            static_cast<float>(b * d.x + a * d.y));
+}
+
+double GridFit::getScale() const {
+    return sqrt(a * a + b * b);
+}
+
+double GridFit::getRotation() const {
+    return atan2(b, a);
+}
+
+} /* namespace */
+
+} /* namespace */
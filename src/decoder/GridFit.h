@@ -0,0 +1,75 @@
+#ifndef GRIDFIT_H_
+#define GRIDFIT_H_
+
+/*
+ * GridFit.h
+ *
+ * Works out where the wells of a plate really are from the symbols decoded
+ * in some of them.
+ */
+
+#include <opencv/cv.h>
+
+#include <vector>
+
+namespace dmscanlib {
+
+namespace decoder {
+
+/*
+ * Fits the transform that takes the centre of each well, as given to the
+ * decoder, to the centre of the symbol decoded in it: an offset, a rotation
+ * and a single scale for the pitch, found by least squares. Symbols are not
+ * always in the middle of their tube, so a well whose symbol is more than
+ * OUTLIER_FACTOR times the RMS error away from the fit is dropped once and
+ * the fit done again.
+ */
+class GridFit {
+public:
+    GridFit();
+    virtual ~GridFit();
+
+    void addWell(const cv::Point2f & nominal, const cv::Point2f & decoded);
+
+    /*
+     * Returns false when there are fewer than MIN_WELLS wells, or when they
+     * are all at the same place, in which case map() must not be used.
+     */
+    bool fit();
+
+    // where the fitted grid puts the symbol of a well centred at nominal
+    cv::Point2f map(const cv::Point2f & nominal) const;
+
+    // the RMS distance between the decoded centres and the fitted ones
+    double getResidual() const {
+        return residual;
+    }
+
+    double getScale() const;
+
+    // in radians, clockwise in image coordinates
+    double getRotation() const;
+
+    static const unsigned MIN_WELLS;
+
+private:
+    static const double OUTLIER_FACTOR;
+
+    bool fitWells(const std::vector<bool> & used);
+
+    std::vector<cv::Point2f> nominals;
+    std::vector<cv::Point2f> decodeds;
+
+    // decoded = decodedCentroid + [a -b; b a] * (nominal - nominalCentroid)
+    cv::Point2f nominalCentroid;
+    cv::Point2f decodedCentroid;
+    double a;
+    double b;
+    double residual;
+};
+
+} /* namespace */
+
+} /* namespace */
+
+#endif /* GRIDFIT_H_ */
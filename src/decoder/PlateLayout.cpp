@@ -0,0 +1,103 @@
+/*
+ * PlateLayout.cpp
+ *
+ * The wells of a plate and their precomputed decode data.
+ */
+
+#include "PlateLayout.h"
+
+#define GLOG_NO_ABBREVIATED_SEVERITIES
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <math.h>
+
+namespace dmscanlib {
+
+/*
+ * Covers a shrink of up to 2, raised by one by the tuner, and its retry at
+ * shrink + 1. Larger scales are masked row by row at decode time.
+ */
+const int PlateLayout::MAX_MASK_SCALE = 4;
+
+PlateLayout::PlateLayout(
+        const std::vector<std::unique_ptr<const WellRectangle> > & wellRects) :
+        wells(wellRects.size()),
+        quadMasks(wellRects.size())
+{
+    for (unsigned i = 0, n = wellRects.size(); i < n; ++i) {
+        wells[i] = std::unique_ptr<const WellRectangle>(new WellRectangle(*wellRects[i]));
+
+        const cv::Rect & rect = wells[i]->getRectangle();
+        bounds = (i == 0) ? rect : (bounds | rect);
+
+        if (wells[i]->isQuad()) {
+            buildMasks(i);
+        }
+    }
+    VLOG(3) << "PlateLayout: wells/" << wells.size() << " bounds/" << bounds;
+}
+
+PlateLayout::~PlateLayout() {
+}
+
+/*
+ * The rows are sampled the way libdmtx samples a shrunken image: row y of the
+ * decode image is row y * scale counted from the bottom of the well image.
+ * When the shrunken height was rounded down, this is not the same as counting
+ * shrunken rows from the top.
+ */
+void PlateLayout::buildMasks(unsigned well) {
+    const WellRectangle & wellRect = *wells[well];
+    const cv::Rect & rect = wellRect.getRectangle();
+    std::vector<QuadMask> & masks = quadMasks[well];
+    masks.resize(MAX_MASK_SCALE);
+
+    for (int scale = 1; scale <= MAX_MASK_SCALE; ++scale) {
+        const int width = rect.width / scale;
+        const int height = rect.height / scale;
+        QuadMask & mask = masks[scale - 1];
+        mask.spans.resize(height);
+        mask.pixels = 0;
+
+        for (int y = 0; y < height; ++y) {
+            float xmin, xmax;
+            Span & span = mask.spans[y];
+            if (wellRect.getRowSpan(static_cast<float>(rect.height - 1 - y * scale), xmin, xmax)) {
+                span = toScaledSpan(xmin, xmax, width, scale);
+            } else {
+                span = Span(0, 0);
+            }
+            mask.pixels += std::max(0, span.second - span.first);
+        }
+        mask.pixels *= scale * scale;
+    }
+}
+
+const std::vector<PlateLayout::Span> * PlateLayout::getQuadSpans(
+        unsigned well, int scale) const {
+    const std::vector<QuadMask> & masks = quadMasks[well];
+    if ((scale < 1) || (scale > static_cast<int>(masks.size()))) {
+        return NULL;
+    }
+    return &masks[scale - 1].spans;
+}
+
+long PlateLayout::getQuadPixels(unsigned well, int scale) const {
+    const std::vector<QuadMask> & masks = quadMasks[well];
+    if ((scale < 1) || (scale > static_cast<int>(masks.size()))) {
+        return 0;
+    }
+    return masks[scale - 1].pixels;
+}
+
+PlateLayout::Span PlateLayout::toScaledSpan(float xmin, float xmax, int width, int scale) {
+    if (xmin > xmax) {
+        return Span(0, 0);
+    }
+    return Span(
+            std::max(0, static_cast<int>(ceil(xmin / scale))),
+            std::min(width, static_cast<int>(floor(xmax / scale)) + 1));
+}
+
+} /* namespace */
@@ -0,0 +1,86 @@
+#ifndef PLATELAYOUT_H_
+#define PLATELAYOUT_H_
+
+/*
+ * PlateLayout.h
+ *
+ * The wells of a plate, with the data the decoder needs for each of them
+ * worked out once so that it can be reused by every decode of the plate.
+ */
+
+#include "WellRectangle.h"
+
+#include <opencv/cv.h>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace dmscanlib {
+
+class PlateLayout {
+public:
+    // the columns [first, second) of one row of a well's decode image
+    typedef std::pair<int, int> Span;
+
+    /*
+     * The wells are copied, and the masks of the quad wells are built for
+     * the scales from 1 to MAX_MASK_SCALE.
+     */
+    PlateLayout(const std::vector<std::unique_ptr<const WellRectangle> > & wellRects);
+
+    virtual ~PlateLayout();
+
+    unsigned getWellCount() const {
+        return wells.size();
+    }
+
+    const WellRectangle & getWell(unsigned i) const {
+        return *wells[i];
+    }
+
+    // the smallest rectangle holding every well
+    const cv::Rect & getBounds() const {
+        return bounds;
+    }
+
+    /*
+     * The part of each row of the well's decode image, at the given libdmtx
+     * scale, that lies inside the well. Rows are in libdmtx order, counted
+     * from the bottom. Returns NULL when the well is not a quad or the scale
+     * was not precomputed.
+     */
+    const std::vector<Span> * getQuadSpans(unsigned well, int scale) const;
+
+    // number of pixels, at full scale, inside the spans of getQuadSpans()
+    long getQuadPixels(unsigned well, int scale) const;
+
+    /*
+     * The columns of a decode image row, width pixels wide at the given
+     * scale, that are between xmin and xmax in unscaled well coordinates.
+     */
+    static Span toScaledSpan(float xmin, float xmax, int width, int scale);
+
+    static const int MAX_MASK_SCALE;
+
+private:
+    struct QuadMask {
+        std::vector<Span> spans;
+        long pixels;
+    };
+
+    void buildMasks(unsigned well);
+
+    std::vector<std::unique_ptr<const WellRectangle> > wells;
+
+    // indexed by well, then by scale - 1; empty for wells that are not quads
+    std::vector<std::vector<QuadMask> > quadMasks;
+
+    cv::Rect bounds;
+
+    PlateLayout(const PlateLayout &);
+    PlateLayout & operator=(const PlateLayout &);
+};
+
+} /* namespace */
+
+#endif /* PLATELAYOUT_H_ */
@@ -23,11 +23,15 @@
 #include "ThreadMgr.h"
 #include "DmScanLib.h"
 #include "WellDecoder.h"
+#include "DecodeListener.h"
+#include "DmtxDecodeHelper.h"
 
 #include <algorithm>
 #include <vector>
 #include <memory>
 #include <glog/logging.h>
+#include <OpenThreads/ScopedLock>
+#include <OpenThreads/Thread>
 
 #ifdef WIN32
 #   define NOMINMAX
@@ -41,44 +45,196 @@ namespace decoder {
 
 const unsigned ThreadMgr::THREAD_NUM = 8;
 
-ThreadMgr::ThreadMgr() {
+class ThreadMgr::DecodeWorker: public ::OpenThreads::Thread {
+public:
+    DecodeWorker(ThreadMgr & _threadMgr) :
+            threadMgr(_threadMgr)
+    {
+    }
+
+    virtual ~DecodeWorker() {
+    }
+
+    /*
+     * This method runs in its own thread, until the manager shuts down.
+     */
+    virtual void run() {
+        WellDecoder * wellDecoder;
+        DecodeListener * listener;
+        bool speculative;
+        while ((wellDecoder = threadMgr.getNextWell(listener, speculative)) != NULL) {
+            const bool finished = decodeWell(*wellDecoder, listener, speculative);
+            threadMgr.wellDone(wellDecoder, finished);
+        }
+    }
+
+private:
+    /*
+     * Returns true when this thread finished the well. Only that thread tells
+     * the listener about it.
+     */
+    bool decodeWell(WellDecoder & wellDecoder, DecodeListener * listener, bool speculative) {
+        bool finished;
+        if ((listener != NULL) && listener->isCancelled()) {
+            finished = wellDecoder.abandonAttempts();
+        } else if (speculative) {
+            finished = wellDecoder.decodeSpeculative(dmtxDecode);
+        } else {
+            finished = wellDecoder.decode(dmtxDecode);
+        }
+        if (finished && (listener != NULL) && !wellDecoder.getMessage().empty()) {
+            listener->wellDecoded(wellDecoder);
+        }
+        return finished;
+    }
+
+    ThreadMgr & threadMgr;
+    DmtxDecodeHelper dmtxDecode;
+};
+
+ThreadMgr::ThreadMgr(unsigned _numThreads) :
+        numThreads((_numThreads > 0) ? _numThreads : THREAD_NUM),
+        listener(NULL),
+        nextWell(0),
+        wellsDone(0),
+        wellsHeld(0),
+        shutdown(false),
+        speculate(true)
+{
 }
 
 ThreadMgr::~ThreadMgr() {
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+        shutdown = true;
+        wellsAvailable.broadcast();
+    }
+
+    for (unsigned i = 0, n = workers.size(); i < n; ++i) {
+        workers[i]->join();
+    }
+}
+
+void ThreadMgr::decodeWells(std::vector<std::unique_ptr<WellDecoder> > & wellDecoders,
+        DecodeListener * wellListener) {
+    std::vector<WellDecoder *> wells(wellDecoders.size());
+    for (unsigned i = 0, n = wellDecoders.size(); i < n; ++i) {
+        wells[i] = wellDecoders[i].get();
+    }
+    decodeWells(wells, wellListener);
 }
 
-void ThreadMgr::decodeWells(std::vector<std::unique_ptr<WellDecoder> > & wellDecoders) {
-    numThreads = wellDecoders.size();
-    allThreads.resize(numThreads);
+void ThreadMgr::decodeWells(const std::vector<WellDecoder *> & wellDecoders,
+        DecodeListener * wellListener) {
+    unsigned numWells = wellDecoders.size();
 
-    for (unsigned i = 0; i < numThreads; ++i) {
-        allThreads[i] = wellDecoders[i].get();
+    if (numWells == 0) {
+        return;
     }
 
-    threadHandler();
-}
+    if (numWells == 1) {
+        // well level parallelism does not help here, split the well instead
+        if ((wellListener != NULL) && wellListener->isCancelled()) {
+            return;
+        }
+        wellDecoders[0]->decodePartitioned(numThreads);
+        if ((wellListener != NULL) && !wellDecoders[0]->getMessage().empty()) {
+            wellListener->wellDecoded(*wellDecoders[0]);
+        }
+        return;
+    }
 
-void ThreadMgr::threadHandler() {
-    unsigned first = 0;
-    unsigned last = std::min(numThreads, THREAD_NUM);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> decodeLock(decodeMutex);
 
-    do {
-        threadProcessRange(first, last);
-        VLOG(5) << "Threads for cells finished: " << first << "/" << last - 1;
+    // workers are only started when a batch needs them and then kept
+    startWorkers(std::min(numWells, numThreads));
 
-        first = last;
-        last = std::min(last + THREAD_NUM, numThreads);
-    } while (first < numThreads);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+    allWells = wellDecoders;
+    listener = wellListener;
+    nextWell = 0;
+    wellsDone = 0;
+    wellsAvailable.broadcast();
+
+    while ((wellsDone < numWells) || (wellsHeld > 0)) {
+        wellsFinished.wait(&mutex);
+    }
+    allWells.clear();
+    running.clear();
+    listener = NULL;
+    nextWell = 0;
+
+    VLOG(5) << "decodeWells: " << numWells << " wells decoded by " << workers.size()
+            << " threads";
 }
 
-//first is inclusive , last is exclusive
-void ThreadMgr::threadProcessRange(unsigned first, unsigned last) {
-    for (unsigned int i = first; i < last; i++) {
-        allThreads[i]->start();
+void ThreadMgr::startWorkers(unsigned count) {
+    while (workers.size() < count) {
+        workers.push_back(std::unique_ptr<DecodeWorker>(new DecodeWorker(*this)));
+        workers.back()->start();
     }
+}
 
-    for (unsigned int j = first; j < last; j++) {
-        allThreads[j]->join();
+/*
+ * Blocks until a well is available. Returns NULL when the manager is shutting
+ * down. A well is speculative when another worker is already decoding it.
+ */
+WellDecoder * ThreadMgr::getNextWell(DecodeListener *& wellListener, bool & speculative) {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+    WellDecoder * wellDecoder = NULL;
+    while (!shutdown && (wellDecoder == NULL)) {
+        if (nextWell < allWells.size()) {
+            wellDecoder = allWells[nextWell++];
+            wellDecoder->resetAttempts();
+            running.push_back(wellDecoder);
+            speculative = false;
+        } else if ((wellDecoder = getSpeculativeWell()) != NULL) {
+            speculative = true;
+        } else {
+            wellsAvailable.wait(&mutex);
+        }
+    }
+    if (shutdown) {
+        return NULL;
+    }
+    ++wellsHeld;
+    wellListener = listener;
+    return wellDecoder;
+}
+
+/*
+ * Called with the mutex held. The wells started first have been running the
+ * longest, so they are the ones most likely to hold up the batch. Attempts
+ * are never added to a well once started, so a worker that finds none can
+ * wait for the next batch.
+ */
+WellDecoder * ThreadMgr::getSpeculativeWell() {
+    if (!speculate || ((listener != NULL) && listener->isCancelled())) {
+        return NULL;
+    }
+    for (unsigned i = 0, n = running.size(); i < n; ++i) {
+        if (running[i]->hasAttemptsLeft()) {
+            return running[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Called once the worker no longer uses a well it was given, with finished
+ * set when it was the one to finish the well. The batch is over once every
+ * well is finished and no worker still holds one, since the wells can go
+ * away as soon as decodeWells() returns.
+ */
+void ThreadMgr::wellDone(WellDecoder * wellDecoder, bool finished) {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+    --wellsHeld;
+    if (finished) {
+        running.erase(std::find(running.begin(), running.end(), wellDecoder));
+        ++wellsDone;
+    }
+    if ((wellsDone == allWells.size()) && (wellsHeld == 0)) {
+        wellsFinished.signal();
     }
 }
 
@@ -25,6 +25,8 @@
 #include <string>
 #include <memory>
 #include <vector>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Condition>
 
 #ifdef _VISUALC_
 #   include <functional>
@@ -33,24 +35,83 @@
 namespace dmscanlib {
 
 class WellDecoder;
+class DecodeListener;
 
 namespace decoder {
 
+/*
+ * Decodes the wells using a pool of worker threads. Each worker owns a
+ * libdmtx decode context that it reuses for every well it takes from the
+ * queue.
+ *
+ * The workers are started by the first call to decodeWells() and wait for
+ * more wells until the manager is destroyed, so a manager that is kept
+ * between decodes does not pay for starting threads again. Calls to
+ * decodeWells() from different threads are run one after the other.
+ *
+ * Once every well of a batch has been started, a worker that would otherwise
+ * wait starts the next attempt of a well still being decoded, see
+ * WellDecoder, instead. The hard wells that hold up the end of a batch then
+ * have their retry running beside their first attempt, and whichever decodes
+ * the well first stops the other. This only uses workers that have nothing
+ * else to do.
+ */
 class ThreadMgr {
 public:
-    ThreadMgr();
+    // numThreads of 0 uses the default number of threads
+    ThreadMgr(unsigned numThreads = 0);
     ~ThreadMgr();
 
-    void decodeWells(std::vector<std::unique_ptr<dmscanlib::WellDecoder> > & wellDecoders);
+    /*
+     * When a listener is given it is told about each well as soon as the
+     * well is decoded, and can cancel the wells not yet started.
+     */
+    void decodeWells(std::vector<std::unique_ptr<dmscanlib::WellDecoder> > & wellDecoders,
+            DecodeListener * listener = NULL);
+
+    void decodeWells(const std::vector<dmscanlib::WellDecoder *> & wellDecoders,
+            DecodeListener * listener = NULL);
+
+    unsigned getNumThreads() const {
+        return numThreads;
+    }
+
+    // on by default, must not be called while a decode is in progress
+    void setSpeculative(bool enable) {
+        speculate = enable;
+    }
 
 private:
+    class DecodeWorker;
+
     static const unsigned THREAD_NUM;
 
-    void threadHandler();
-    void threadProcessRange(unsigned int first, unsigned int last);
+    void startWorkers(unsigned count);
+
+    dmscanlib::WellDecoder * getNextWell(DecodeListener *& wellListener, bool & speculative);
+
+    dmscanlib::WellDecoder * getSpeculativeWell();
+
+    void wellDone(dmscanlib::WellDecoder * wellDecoder, bool finished);
+
+    const unsigned numThreads;
+    std::vector<std::unique_ptr<DecodeWorker> > workers;
+    std::vector<dmscanlib::WellDecoder *> allWells;
+
+    // the wells started and not yet done, oldest first
+    std::vector<dmscanlib::WellDecoder *> running;
+    DecodeListener * listener;
+    unsigned nextWell;
+    unsigned wellsDone;
+    unsigned wellsHeld;
+    bool shutdown;
+    bool speculate;
+    OpenThreads::Mutex mutex;
+    OpenThreads::Condition wellsAvailable;
+    OpenThreads::Condition wellsFinished;
 
-    std::vector<dmscanlib::WellDecoder *> allThreads;
-    unsigned numThreads;
+    // held for the whole of decodeWells()
+    OpenThreads::Mutex decodeMutex;
 };
 
 } /* namespace */
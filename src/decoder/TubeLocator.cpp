@@ -0,0 +1,75 @@
+/*
+ * TubeLocator.cpp
+ *
+ * Finds the bottom of the tube inside a well.
+ */
+
+#include "TubeLocator.h"
+#include "Image.h"
+
+#define GLOG_NO_ABBREVIATED_SEVERITIES
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace dmscanlib {
+
+namespace decoder {
+
+const int TubeLocator::WORK_SIZE = 64;
+
+const double TubeLocator::MIN_RADIUS_FACTOR = 0.5;
+
+const double TubeLocator::MAX_RADIUS_FACTOR = 1.1;
+
+// the centre may be this fraction of half the well away from its middle
+const double TubeLocator::CENTER_FACTOR = 0.35;
+
+const double TubeLocator::RADIUS_MARGIN = 1.15;
+
+cv::Vec3f TubeLocator::locate(const Image & wellImage) {
+    const cv::Mat image = wellImage.getOriginalImage();
+    const cv::Vec3f notFound(0, 0, 0);
+
+    if ((image.cols < 8) || (image.rows < 8) || (image.type() != CV_8UC1)) {
+        return notFound;
+    }
+
+    const double factor = std::min(1.0,
+            static_cast<double>(WORK_SIZE) / std::max(image.cols, image.rows));
+
+    cv::Mat small;
+    cv::resize(image, small, cv::Size(), factor, factor, cv::INTER_AREA);
+    cv::GaussianBlur(small, small, cv::Size(5, 5), 1.5);
+
+    const double halfSide = std::min(small.cols, small.rows) / 2.0;
+    const int minRadius = static_cast<int>(MIN_RADIUS_FACTOR * halfSide);
+    const int maxRadius = static_cast<int>(MAX_RADIUS_FACTOR * halfSide + 0.5);
+
+    std::vector<cv::Vec3f> circles;
+    cv::HoughCircles(small, circles, CV_HOUGH_GRADIENT, 1, halfSide, 100, 15,
+            minRadius, maxRadius);
+
+    // the circles are ordered by decreasing strength
+    const cv::Point2f middle(small.cols / 2.0f, small.rows / 2.0f);
+    const double maxOffset = CENTER_FACTOR * halfSide;
+    for (unsigned i = 0, n = circles.size(); i < n; ++i) {
+        const cv::Point2f offset = cv::Point2f(circles[i][0], circles[i][1]) - middle;
+        if (offset.dot(offset) > maxOffset * maxOffset) {
+            continue;
+        }
+
+        const float scale = static_cast<float>(1.0 / factor);
+        cv::Vec3f disc(circles[i][0] * scale, circles[i][1] * scale,
+                static_cast<float>(circles[i][2] * scale * RADIUS_MARGIN));
+        VLOG(5) << "locate: disc " << disc[0] << ", " << disc[1] << " radius " << disc[2]
+                << " in " << image.cols << "x" << image.rows;
+        return disc;
+    }
+    return notFound;
+}
+
+} /* namespace */
+
+} /* namespace */
@@ -0,0 +1,52 @@
+#ifndef TUBELOCATOR_H_
+#define TUBELOCATOR_H_
+
+/*
+ * TubeLocator.h
+ *
+ * Finds the bottom of the tube inside a well so that only the disc holding
+ * the etched symbol has to be searched.
+ */
+
+#include <opencv/cv.h>
+
+namespace dmscanlib {
+
+class Image;
+
+namespace decoder {
+
+/*
+ * The well's image is shrunk so that its longer side is WORK_SIZE pixels and
+ * a Hough circle transform picks the strongest circle whose radius is between
+ * MIN_RADIUS_FACTOR and MAX_RADIUS_FACTOR of half the well's shorter side and
+ * whose centre is in the middle part of the well. At that size the search
+ * costs a small fraction of a libdmtx scan of the full well.
+ *
+ * The disc returned is grown by RADIUS_MARGIN so that a slightly off fit
+ * still covers the symbol.
+ */
+class TubeLocator {
+public:
+    /*
+     * Returns the disc as (x, y, radius) in the well image's coordinates, or
+     * a radius of 0 when no tube bottom is found, in which case the whole
+     * well should be searched.
+     */
+    static cv::Vec3f locate(const Image & wellImage);
+
+private:
+    static const int WORK_SIZE;
+    static const double MIN_RADIUS_FACTOR;
+    static const double MAX_RADIUS_FACTOR;
+    static const double CENTER_FACTOR;
+    static const double RADIUS_MARGIN;
+
+    TubeLocator();
+};
+
+} /* namespace */
+
+} /* namespace */
+
+#endif /* TUBELOCATOR_H_ */
@@ -12,6 +12,7 @@
 #include "Decoder.h"
 
 #include <sstream>
+#include <OpenThreads/ScopedLock>
 
 #define GLOG_NO_ABBREVIATED_SEVERITIES
 #include <glog/logging.h>
@@ -25,34 +26,138 @@ namespace dmscanlib {
 
 WellDecoder::WellDecoder(
         const Decoder & _decoder,
-        std::unique_ptr<const WellRectangle> _wellRectangle) :
+        const WellRectangle & _wellRectangle,
+        unsigned _wellIndex) :
         decoder(_decoder),
-        wellRectangle(std::move(_wellRectangle)),
-        rectangle(wellRectangle->getRectangle()),
-        decodedQuad()
+        wellRectangle(_wellRectangle),
+        wellIndex(_wellIndex),
+        rectangle(wellRectangle.getRectangle()),
+        decodedQuad(),
+        decodedScale(0),
+        tubeDisc(0, 0, 0),
+        attemptsStarted(0),
+        attemptsRunning(0),
+        abandoned(false),
+        finished(false),
+        cancel()
 {
     decodedQuad.reserve(4);
     VLOG(9) << "constructor: bounding box: " << rectangle
-            << ", rect: " << wellRectangle->getRectangle();
+            << ", rect: " << wellRectangle.getRectangle();
 }
 
 WellDecoder::~WellDecoder() {
 }
 
 /*
- * This method runs in its own thread.
+ * Called from the decoding threads. The decode context belongs to the calling
+ * thread and is reused for each well it decodes.
  */
-void WellDecoder::run() {
-    wellImage = decoder.getWorkingImage().crop(
+bool WellDecoder::decode(decoder::DmtxDecodeHelper & dmtxDecode) {
+    unsigned attempt;
+    bool done = false;
+    while (!done && claimAttempt(attempt)) {
+        done = runAttempt(attempt, false, dmtxDecode);
+    }
+    return done;
+}
+
+bool WellDecoder::decodeSpeculative(decoder::DmtxDecodeHelper & dmtxDecode) {
+    unsigned attempt;
+    if (!claimAttempt(attempt)) {
+        return false;
+    }
+    VLOG(5) << "decodeSpeculative: " << wellRectangle.getLabel() << " attempt/" << attempt;
+    return runAttempt(attempt, true, dmtxDecode);
+}
+
+void WellDecoder::resetAttempts() {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+    attemptsStarted = 0;
+    attemptsRunning = 0;
+    abandoned = false;
+    finished = false;
+    cancel.clear();
+}
+
+bool WellDecoder::hasAttemptsLeft() {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+    return !finished && !abandoned && message.empty()
+            && (attemptsStarted < decoder.getAttemptCount());
+}
+
+bool WellDecoder::abandonAttempts() {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+    abandoned = true;
+    return checkFinished();
+}
+
+bool WellDecoder::claimAttempt(unsigned & attempt) {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+    if (finished || abandoned || !message.empty()
+            || (attemptsStarted >= decoder.getAttemptCount())) {
+        return false;
+    }
+    attempt = attemptsStarted++;
+    ++attemptsRunning;
+    return true;
+}
+
+/*
+ * Each attempt crops an image of its own, since the attempts of a well can run
+ * at the same time.
+ */
+bool WellDecoder::runAttempt(unsigned attempt, bool speculative,
+        decoder::DmtxDecodeHelper & dmtxDecode) {
+    std::unique_ptr<const Image> attemptImage = decoder.getWorkingImage().crop(
+            rectangle.x,
+            rectangle.y,
+            rectangle.width,
+            rectangle.height);
+    decoder.decodeAttempt(*attemptImage, *this, attempt, speculative, dmtxDecode);
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+    --attemptsRunning;
+    return checkFinished();
+}
+
+/*
+ * Called with the mutex held. The well is finished once none of its attempts
+ * are running and no more will be started, and only the first call to see
+ * this returns true.
+ */
+bool WellDecoder::checkFinished() {
+    if (finished || (attemptsRunning > 0)) {
+        return false;
+    }
+    if (message.empty() && !abandoned && (attemptsStarted < decoder.getAttemptCount())) {
+        return false;
+    }
+    finished = true;
+    if (!message.empty()) {
+        VLOG(3) << "decode: " << *this;
+    } else {
+        VLOG(3) << "decode: " << wellRectangle.getLabel() << " - could not be decoded";
+    }
+    return true;
+}
+
+/*
+ * Used when there is only a single well. The well is decoded by several
+ * threads, each one searching a different part of the image.
+ */
+void WellDecoder::decodePartitioned(unsigned numPartitions) {
+    std::unique_ptr<const Image> wellImage = decoder.getWorkingImage().crop(
             rectangle.x,
             rectangle.y,
             rectangle.width,
             rectangle.height);
-    decoder.decodeWellRect(*wellImage, *this);
+    decoder.decodeWellRectPartitioned(*wellImage, *this, numPartitions);
     if (!message.empty()) {
-        VLOG(3) << "run: " << *this;
+        VLOG(3) << "decodePartitioned: " << *this;
     } else {
-        VLOG(3) << "run: " << wellRectangle->getLabel() << " - could not be decoded";
+        VLOG(3) << "decodePartitioned: " << wellRectangle.getLabel()
+                << " - could not be decoded";
     }
 }
 
@@ -60,12 +165,49 @@ void WellDecoder::setMessage(const char * message, int messageLength) {
     this->message.assign(message, messageLength);
 }
 
+void WellDecoder::clearDecode() {
+    message.clear();
+    decodedQuad.clear();
+    decodedScale = 0;
+}
+
+bool WellDecoder::setDecodeResult(const char * message, int messageLength,
+        const cv::Point2f (&points)[4], int scale) {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+    if (!this->message.empty()) {
+        return false;
+    }
+    setMessage(message, messageLength);
+    setDecodeQuad(points);
+    setDecodedScale(scale);
+    cancel.set();
+    return true;
+}
+
+void WellDecoder::addMetrics(const DecodeMetrics & attemptMetrics) {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+    metrics.add(attemptMetrics);
+}
+
+
+void WellDecoder::setRefitRegion(const cv::Rect & region) {
+    refitRegion = std::unique_ptr<const WellRectangle>(new WellRectangle(
+            wellRectangle.getLabel().c_str(), region.x, region.y, region.width, region.height));
+    rectangle = region;
+    VLOG(5) << "setRefitRegion: " << wellRectangle.getLabel() << " " << region;
+}
+
+// a disc located while the refit region was set is in its coordinates
+void WellDecoder::clearRefitRegion() {
+    refitRegion.reset();
+    rectangle = wellRectangle.getRectangle();
+    tubeDisc = cv::Vec3f(0, 0, 0);
+}
 
 const cv::Rect WellDecoder::getWellRectangle() const {	
-    CHECK_NOTNULL(wellRectangle.get());
-	VLOG(9) << "getWellRectangle: bbox: " << wellRectangle->getRectangle();
+	VLOG(9) << "getWellRectangle: bbox: " << wellRectangle.getRectangle();
 
-	return wellRectangle->getRectangle();
+	return wellRectangle.getRectangle();
 }
 
 // the quadrilateral passed in is in coordinates of the cropped image,
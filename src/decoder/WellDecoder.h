@@ -2,15 +2,15 @@
 #define __INC_PALLET_CELL_H
 
 #include "WellRectangle.h"
+#include "DecodeMetrics.h"
+#include "DmtxDecodeHelper.h"
 
 #include <dmtx.h>
 #include <opencv/cv.h>
+#include <OpenThreads/Mutex>
 #include <string>
 #include <ostream>
 #include <memory>
-#include <OpenThreads/Mutex>
-#include <OpenThreads/ScopedLock>
-#include <OpenThreads/Thread>
 
 namespace dmscanlib {
 
@@ -19,20 +19,45 @@ class Image;
 class RgbQuad;
 class PalletGrid;
 
-class WellDecoder: public ::OpenThreads::Thread {
+class WellDecoder {
 public:
+    // the well is the one at wellIndex in the decoder's layout
     WellDecoder(
             const Decoder & decoder,
-            std::unique_ptr<const WellRectangle> _wellRectangle);
+            const WellRectangle & _wellRectangle,
+            unsigned _wellIndex);
 
     virtual ~WellDecoder();
 
-    virtual void run();
+    /*
+     * A well is decoded in attempts, see Decoder::getAttemptCount(), and an
+     * idle thread can start the next attempt of a well while another thread
+     * is still running the one before. The first attempt to decode the
+     * message stops the others.
+     *
+     * Runs the attempts no other thread has started, one after the other,
+     * until the well is decoded. Returns true when this call finished the
+     * well, in which case the caller reports it as done. resetAttempts()
+     * must have been called since the well was last decoded.
+     */
+    bool decode(decoder::DmtxDecodeHelper & dmtxDecode);
+
+    // starts the next attempt of a well being decoded by another thread
+    bool decodeSpeculative(decoder::DmtxDecodeHelper & dmtxDecode);
+
+    void resetAttempts();
+
+    bool hasAttemptsLeft();
+
+    // no more attempts are started, returns true when the well is finished
+    bool abandonAttempts();
+
+    void decodePartitioned(unsigned numPartitions);
 
     bool isFinished();
 
     const std::string & getLabel() const {
-        return wellRectangle->getLabel();
+        return wellRectangle.getLabel();
     }
 
     const std::string & getMessage() const {
@@ -41,25 +66,111 @@ public:
 
     void setMessage(const char * message, int messageLength);
 
+    // forgets the message, its quad and scale
+    void clearDecode();
+
     const cv::Rect getWellRectangle() const;
 
+    // the tube bottom as (x, y, radius) in the well's image, radius 0 if unknown
+    const cv::Vec3f & getTubeDisc() const {
+        return tubeDisc;
+    }
+
+    void setTubeDisc(const cv::Vec3f & disc) {
+        tubeDisc = disc;
+    }
+
+    // the well as given to the decoder, including its corners
+    const WellRectangle & getWellRegion() const {
+        return wellRectangle;
+    }
+
+    /*
+     * Searches the given part of the image instead of the well, from the
+     * next decode on. Used to retry a well where the plate's fitted grid
+     * puts it, until clearRefitRegion(). The edge lengths stay relative to
+     * the well.
+     */
+    void setRefitRegion(const cv::Rect & region);
+
+    // the decodes that follow search the well again, without its tube disc
+    void clearRefitRegion();
+
+    // the part of the image searched, the well unless a refit region is set
+    const WellRectangle & getSearchRegion() const {
+        return (refitRegion.get() != NULL) ? *refitRegion : wellRectangle;
+    }
+
+    unsigned getWellIndex() const {
+        return wellIndex;
+    }
+
     const std::vector<cv::Point> & getDecodedQuad() const {
         return decodedQuad;
     }
 
     void setDecodeQuad(const cv::Point2f (&points)[4]);
 
+    /*
+     * Called by an attempt that decoded a message. Returns false, leaving the
+     * well alone, when another attempt got there first. Otherwise the
+     * message is kept and the other attempts are cancelled.
+     */
+    bool setDecodeResult(const char * message, int messageLength,
+            const cv::Point2f (&points)[4], int scale);
+
+    // region searches of the well's attempts stop once it is set
+    const decoder::CancelFlag * getCancelFlag() const {
+        return &cancel;
+    }
+
+    // the libdmtx scale (shrink) the message was decoded at, 0 if not decoded
+    int getDecodedScale() const {
+        return decodedScale;
+    }
+
+    void setDecodedScale(int scale) {
+        decodedScale = scale;
+    }
+
     const bool getDecodeValid() {
         return message.empty();
     }
 
+    DecodeMetrics & getMetrics() {
+        return metrics;
+    }
+
+    const DecodeMetrics & getMetrics() const {
+        return metrics;
+    }
+
+    // for attempts that may run at the same time as others
+    void addMetrics(const DecodeMetrics & attemptMetrics);
+
 private:
+    bool claimAttempt(unsigned & attempt);
+    bool runAttempt(unsigned attempt, bool speculative, decoder::DmtxDecodeHelper & dmtxDecode);
+    bool checkFinished();
+
     const Decoder & decoder;
-    std::unique_ptr<const WellRectangle> wellRectangle;
-    std::unique_ptr<const Image> wellImage;
+    const WellRectangle & wellRectangle;
+    const unsigned wellIndex;
     cv::Rect rectangle;
+    std::unique_ptr<const WellRectangle> refitRegion;
     std::vector<cv::Point> decodedQuad;
     std::string message;
+    int decodedScale;
+    cv::Vec3f tubeDisc;
+    DecodeMetrics metrics;
+
+    // the attempts of the current decode, guarded by the mutex
+    unsigned attemptsStarted;
+    unsigned attemptsRunning;
+    bool abandoned;
+    bool finished;
+    decoder::CancelFlag cancel;
+    OpenThreads::Mutex mutex;
 
     friend std::ostream & operator<<(std::ostream & os, const WellDecoder & m);
 };
@@ -10,17 +10,106 @@
 #include "WellRectangle.h"
 
 #include <glog/logging.h>
+#include <algorithm>
+#include <limits>
+#include <math.h>
 #include <stdexcept>
 
 namespace dmscanlib {
 
+const double WellRectangle::QUAD_FILL_MIN = 0.98;
+
 WellRectangle::WellRectangle(const char * _label, unsigned x, unsigned y, unsigned width, unsigned height) :
-        label(_label), rect(x, y, width, height)
+        label(_label), rect(x, y, width, height), corners(4), quad(false)
 {
+    corners[0] = cv::Point2f(static_cast<float>(x), static_cast<float>(y));
+    corners[1] = cv::Point2f(static_cast<float>(x + width), static_cast<float>(y));
+    corners[2] = cv::Point2f(static_cast<float>(x + width), static_cast<float>(y + height));
+    corners[3] = cv::Point2f(static_cast<float>(x), static_cast<float>(y + height));
+}
+
+WellRectangle::WellRectangle(const char * _label, const cv::Point2f (&_corners)[4]) :
+        label(_label), rect(boundingBox(_corners)), corners(_corners, _corners + 4), quad(false)
+{
+    const double area = cv::contourArea(corners);
+    quad = (area < QUAD_FILL_MIN * rect.area());
+}
+
+/*
+ * The smallest rectangle, with whole pixel coordinates, that contains all the
+ * corners. Corners left of or above the image are clipped to it.
+ */
+cv::Rect WellRectangle::boundingBox(const cv::Point2f (&corners)[4]) {
+    float xmin = corners[0].x, xmax = corners[0].x;
+    float ymin = corners[0].y, ymax = corners[0].y;
+    for (unsigned i = 1; i < 4; ++i) {
+        xmin = std::min(xmin, corners[i].x);
+        xmax = std::max(xmax, corners[i].x);
+        ymin = std::min(ymin, corners[i].y);
+        ymax = std::max(ymax, corners[i].y);
+    }
+
+    const int x = std::max(0, static_cast<int>(floor(xmin)));
+    const int y = std::max(0, static_cast<int>(floor(ymin)));
+    return cv::Rect(x, y,
+            std::max(0, static_cast<int>(ceil(xmax)) - x),
+            std::max(0, static_cast<int>(ceil(ymax)) - y));
+}
+
+float WellRectangle::getMinSide() const {
+    float minSide = static_cast<float>(std::min(rect.width, rect.height));
+    if (quad) {
+        for (unsigned i = 0; i < 4; ++i) {
+            const cv::Point2f side = corners[(i + 1) % 4] - corners[i];
+            minSide = std::min(minSide, static_cast<float>(sqrt(side.dot(side))));
+        }
+    }
+    return minSide;
+}
+
+/*
+ * A convex quad gives the exact span; for any other quad the span runs from
+ * the leftmost to the rightmost crossing, which can only make it too wide.
+ */
+bool WellRectangle::getRowSpan(float y, float & xmin, float & xmax) const {
+    xmin = 0;
+    xmax = static_cast<float>(rect.width);
+    if (!quad) {
+        return (y >= 0) && (y <= rect.height);
+    }
+
+    const cv::Point2f tl(static_cast<float>(rect.x), static_cast<float>(rect.y));
+    const float imageY = y + tl.y;
+    float quadMin = std::numeric_limits<float>::max();
+    float quadMax = -std::numeric_limits<float>::max();
+
+    for (unsigned i = 0; i < 4; ++i) {
+        const cv::Point2f & p = corners[i];
+        const cv::Point2f & q = corners[(i + 1) % 4];
+        if ((imageY < std::min(p.y, q.y)) || (imageY > std::max(p.y, q.y))) {
+            continue;
+        }
+        float x = p.x;
+        if (p.y != q.y) {
+            x += (imageY - p.y) * (q.x - p.x) / (q.y - p.y);
+        } else {
+            quadMin = std::min(quadMin, q.x);
+            quadMax = std::max(quadMax, q.x);
+        }
+        quadMin = std::min(quadMin, x);
+        quadMax = std::max(quadMax, x);
+    }
+    xmin = std::max(xmin, quadMin - tl.x);
+    xmax = std::min(xmax, quadMax - tl.x);
+    return xmin <= xmax;
 }
 
 std::ostream & operator<<(std::ostream &os, const WellRectangle & m) {
     os << m.label << " - " << m.rect;
+    if (m.quad) {
+        os << " quad " << m.corners[0] << " " << m.corners[1] << " " << m.corners[2]
+                << " " << m.corners[3];
+    }
     return os;
 }
 
@@ -10,6 +10,7 @@
 
 #include <ostream>
 #include <string>
+#include <vector>
 #include <opencv/cv.h>
 
 namespace dmscanlib {
@@ -18,6 +19,14 @@ class WellRectangle {
 public:
     WellRectangle(const char * label, unsigned x, unsigned y, unsigned width, unsigned height);
 
+    /*
+     * A well given by its four corners, in order around the well, as happens
+     * when the rack is rotated or skewed in the image. The rectangle is the
+     * corners' bounding box, and the decoder does not search the part of it
+     * that lies outside the corners.
+     */
+    WellRectangle(const char * label, const cv::Point2f (&corners)[4]);
+
     virtual ~WellRectangle() {
     }
 
@@ -29,10 +38,36 @@ public:
         return rect;
     }
 
+    // the four corners in image coordinates, the rectangle's when not a quad
+    const std::vector<cv::Point2f> & getCorners() const {
+        return corners;
+    }
+
+    // false when the corners fill their bounding box
+    bool isQuad() const {
+        return quad;
+    }
+
+    // length of the well's shortest side
+    float getMinSide() const;
+
+    /*
+     * The part of row y that is inside the corners, with y and the span
+     * measured from the rectangle's top left corner. Returns false when the
+     * row misses the well. When not a quad the span is the whole row.
+     */
+    bool getRowSpan(float y, float & xmin, float & xmax) const;
 
 private:
+    static cv::Rect boundingBox(const cv::Point2f (&corners)[4]);
+
+    // a quad covering at least this much of its bounding box is not masked
+    static const double QUAD_FILL_MIN;
+
     const std::string label;
     const cv::Rect rect;
+    std::vector<cv::Point2f> corners;
+    bool quad;
 
     friend std::ostream & operator<<(std::ostream & os, const WellRectangle & m);
 };
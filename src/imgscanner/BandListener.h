@@ -0,0 +1,39 @@
+#ifndef BANDLISTENER_H_
+#define BANDLISTENER_H_
+
+/*
+ * BandListener.h
+ *
+ * Lets a caller use the top of a scanned image while the rest of it is still
+ * being scanned.
+ */
+
+#include <opencv/cv.h>
+
+namespace dmscanlib {
+
+class BandListener {
+public:
+    virtual ~BandListener() {
+    }
+
+    /*
+     * Called once the size of the image is known, before any of it has been
+     * scanned. The bands are written into this image, which stays valid until
+     * the acquisition returns.
+     */
+    virtual void imageStarted(const cv::Mat & image) = 0;
+
+    /*
+     * Called, from the thread doing the acquisition, each time more of the
+     * image has been scanned. Rows 0 to rows - 1 are final and are not
+     * written again. The last call has rows equal to the image's height.
+     * Implementations should return quickly, since the scanner waits for
+     * them.
+     */
+    virtual void bandAcquired(int rows) = 0;
+};
+
+} /* namespace */
+
+#endif /* BANDLISTENER_H_ */
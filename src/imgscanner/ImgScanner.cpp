@@ -3,6 +3,8 @@
 #include "imgscanner/ImgScanner.h"
 #include "imgscanner/ImgScannerTwain.h"
 #include "imgscanner/ImgScannerSimulator.h"
+#include "DmScanLib.h"
+#include "Image.h"
 
 #include <memory>
 
@@ -24,4 +26,30 @@ std::unique_ptr<ImgScanner> ImgScanner::create() {
 #endif
 }
 
+int ImgScanner::acquireImageBands(
+        const unsigned dpi,
+        const int brightness,
+        const int contrast,
+        const cv::Rect_<float> & bbox,
+        cv::Mat & image,
+        BandListener & listener) {
+    HANDLE h = acquireImage(dpi, brightness, contrast, bbox);
+    if (h == NULL) {
+        return getErrorCode();
+    }
+
+    {
+        Image scanned(h);
+        scanned.getOriginalImage().copyTo(image);
+    }
+    freeImage(h);
+
+    listener.imageStarted(image);
+    listener.bandAcquired(image.rows);
+    return SC_SUCCESS;
+}
+
+void ImgScanner::repeatLastPlate() {
+}
+
 } /* namespace */
@@ -20,6 +20,8 @@
  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "imgscanner/BandListener.h"
+
 #include <memory>
 #include <opencv/cv.h>
 
@@ -59,6 +61,29 @@ public:
             const int brightness,
             const int contrast) = 0;
 
+    /**
+     * Scans the region into image, band by band, telling the listener as
+     * each band arrives so that it can start on the image before the scan
+     * is over. Returns an SC_* code.
+     *
+     * The default waits for acquireImage() and delivers the whole image as a
+     * single band.
+     */
+    virtual int acquireImageBands(
+            const unsigned dpi,
+            const int brightness,
+            const int contrast,
+            const cv::Rect_<float> & bbox,
+            cv::Mat & image,
+            BandListener & listener);
+
+    /**
+     * Tells the scanner that the next scan is of the plate scanned last, as
+     * when part of it is scanned again at a higher DPI. A real scanner has
+     * nothing to do, the plate is still on it.
+     */
+    virtual void repeatLastPlate();
+
     virtual void freeImage(HANDLE handle) = 0;
 
     virtual int getErrorCode() = 0;
@@ -18,18 +18,24 @@
  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 /**
- * Implements the ImgScanner.
- *
- * This class performs all interfacing with the TWAIN driver to acquire images
- * from the scanner.
- *
- * Some portions of the implementation borrowed from EZTWAIN.
+ * Implements the ImgScanner without a scanner, by serving images from files
+ * or by generating them.
  */
 
 #include "ImgScannerSimulator.h"
+#include "DmScanLib.h"
+#include "Image.h"
 
+#define GLOG_NO_ABBREVIATED_SEVERITIES
 #include <glog/logging.h>
 #include <math.h>
+#include <dirent.h>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <OpenThreads/Thread>
 
 #if defined(USE_NVWA)
 #   include "debug_new.h"
@@ -39,20 +45,187 @@ namespace dmscanlib {
 
 namespace imgscanner {
 
-ImgScannerSimulator::ImgScannerSimulator() {
+namespace {
+
+// the pixel value of the synthetic flatbed's empty lid
+const unsigned char SYNTHETIC_BACKGROUND = 235;
+
+const char * IMAGE_EXTENSIONS[] = { ".bmp", ".png", ".jpg", ".jpeg", ".tif", ".tiff" };
+
+// shared by all the simulators
+OpenThreads::Mutex optionsMutex;
+SimulatorOptions simulatorOptions;
+std::vector<std::string> sourceFilenames;
+unsigned nextSource = 0;
+bool repeatSource = false;
+
+bool isImageFilename(const std::string & filename) {
+    std::string lower(filename);
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    for (unsigned i = 0, n = sizeof(IMAGE_EXTENSIONS) / sizeof(IMAGE_EXTENSIONS[0]); i < n; ++i) {
+        const std::string ext(IMAGE_EXTENSIONS[i]);
+        if ((lower.size() > ext.size())
+                && (lower.compare(lower.size() - ext.size(), ext.size(), ext) == 0)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * A source that is not a directory is taken to be a single image file.
+ */
+void listSourceImages(const std::string & source, std::vector<std::string> & filenames) {
+    DIR * dp = opendir(source.c_str());
+    if (dp == NULL) {
+        filenames.push_back(source);
+        return;
+    }
+
+    dirent * dirp;
+    while ((dirp = readdir(dp)) != NULL) {
+        if ((dirp->d_type != DT_DIR) && isImageFilename(dirp->d_name)) {
+            filenames.push_back(std::string(source).append("/").append(dirp->d_name));
+        }
+    }
+    closedir(dp);
+    std::sort(filenames.begin(), filenames.end());
+}
+
+void sleepUntil(util::DmNanos start, double seconds) {
+    const util::DmNanos end = start + static_cast<util::DmNanos>(seconds * 1e9);
+    const util::DmNanos now = util::getMonotonicNanos();
+    if (now < end) {
+        OpenThreads::Thread::microSleep(static_cast<unsigned>((end - now) / 1000));
+    }
+}
+
+} /* namespace */
+
+SimulatorOptions::SimulatorOptions() :
+        source(),
+        synthetic(false),
+        sourceDpi(600),
+        flatbedWidth(8.5f),
+        flatbedHeight(11.7f),
+        startSeconds(0),
+        bandRows(64),
+        bandSeconds(0)
+{
+}
+
+std::ostream & operator<<(std::ostream & os, const SimulatorOptions & m) {
+    os << "source/\"" << m.source << "\""
+            << " synthetic/" << m.synthetic
+            << " sourceDpi/" << m.sourceDpi
+            << " flatbed/" << m.flatbedWidth << "x" << m.flatbedHeight
+            << " startSeconds/" << m.startSeconds
+            << " bandRows/" << m.bandRows
+            << " bandSeconds/" << m.bandSeconds;
+    return os;
+}
+
+ImgScannerSimulator::ImgScannerSimulator() :
+        errorCode(SC_SUCCESS)
+{
 }
 
 ImgScannerSimulator::~ImgScannerSimulator() {
 }
 
+void ImgScannerSimulator::setOptions(const SimulatorOptions & options) {
+    VLOG(2) << "setOptions: " << options;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(optionsMutex);
+    simulatorOptions = options;
+    sourceFilenames.clear();
+    nextSource = 0;
+    repeatSource = false;
+    if (!options.source.empty()) {
+        listSourceImages(options.source, sourceFilenames);
+    }
+}
+
+SimulatorOptions ImgScannerSimulator::getOptions() {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(optionsMutex);
+    return simulatorOptions;
+}
+
+bool ImgScannerSimulator::isAvailable(const SimulatorOptions & options) {
+    return !options.source.empty() || options.synthetic;
+}
+
+/*
+ * Each call serves the next image of the source, or the last one again after
+ * repeatLastPlate().
+ */
+bool ImgScannerSimulator::nextSourceImage(const SimulatorOptions & options, cv::Mat & image) {
+    if (options.source.empty()) {
+        image = cv::Mat(
+                static_cast<int>(options.flatbedHeight * options.sourceDpi),
+                static_cast<int>(options.flatbedWidth * options.sourceDpi),
+                CV_8UC3,
+                cv::Scalar::all(SYNTHETIC_BACKGROUND));
+        return true;
+    }
+
+    std::string filename;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(optionsMutex);
+        if (sourceFilenames.empty()) {
+            return false;
+        }
+        const unsigned numSources = sourceFilenames.size();
+        if (repeatSource) {
+            nextSource = (nextSource + numSources - 1) % numSources;
+            repeatSource = false;
+        }
+        filename = sourceFilenames[nextSource];
+        nextSource = (nextSource + 1) % numSources;
+    }
+
+    VLOG(3) << "nextSourceImage: " << filename;
+    Image sourceImage(filename);
+    if (!sourceImage.isValid()) {
+        return false;
+    }
+    image = sourceImage.getOriginalImage();
+    return true;
+}
+
+/*
+ * Contrast scales the pixel values about the middle grey, from flat at -1000
+ * to twice the spread at 1000. Brightness shifts them by up to half the
+ * range.
+ */
+void ImgScannerSimulator::adjust(const cv::Mat & src, cv::Mat & dst,
+        int brightness, int contrast) {
+    if ((brightness == 0) && (contrast == 0)) {
+        src.copyTo(dst);
+        return;
+    }
+    const double alpha = std::max(0.0, 1.0 + contrast / 1000.0);
+    const double beta = 128.0 * (1.0 - alpha) + brightness * 127.0 / 1000.0;
+    src.convertTo(dst, -1, alpha, beta);
+}
+
+void ImgScannerSimulator::repeatLastPlate() {
+    VLOG(2) << "repeatLastPlate";
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(optionsMutex);
+    repeatSource = true;
+}
+
 bool ImgScannerSimulator::selectSourceAsDefault() {
     VLOG(2) << "selectSourceAsDefault";
-    return false;
+    return isAvailable(getOptions());
 }
 
 int ImgScannerSimulator::getScannerCapability() {
     VLOG(2) << "getScannerCapability";
-    return 0;
+    if (!isAvailable(getOptions())) {
+        return 0;
+    }
+    return CAP_IS_SCANNER | CAP_DPI_300 | CAP_DPI_400 | CAP_DPI_600;
 }
 
 HANDLE ImgScannerSimulator::acquireImage(
@@ -60,17 +233,147 @@ HANDLE ImgScannerSimulator::acquireImage(
         const int brightness,
         const int contrast,
         const cv::Rect_<float> & bbox) {
-    VLOG(2) << "acquireImage";
-    return NULL;
+    VLOG(2) << "acquireImage: dpi/" << dpi
+            << " brightness/" << brightness
+            << " contrast/" << contrast
+            << " " << bbox;
+    return acquire(dpi, brightness, contrast, &bbox);
 }
 
 HANDLE ImgScannerSimulator::acquireFlatbed(unsigned dpi, int brightness, int contrast) {
-    VLOG(2) << "acquireFlatbed";
-    return NULL;
+    VLOG(2) << "acquireFlatbed: dpi/" << dpi
+            << " brightness/" << brightness
+            << " contrast/" << contrast;
+    return acquire(dpi, brightness, contrast, NULL);
+}
+
+int ImgScannerSimulator::acquireImageBands(
+        const unsigned dpi,
+        const int brightness,
+        const int contrast,
+        const cv::Rect_<float> & bbox,
+        cv::Mat & image,
+        BandListener & listener) {
+    VLOG(2) << "acquireImageBands: dpi/" << dpi
+            << " brightness/" << brightness
+            << " contrast/" << contrast
+            << " " << bbox;
+
+    const util::DmNanos start = util::getMonotonicNanos();
+    const SimulatorOptions options = getOptions();
+
+    cv::Mat scan;
+    errorCode = prepareScan(options, dpi, &bbox, scan);
+    if (errorCode != SC_SUCCESS) {
+        return errorCode;
+    }
+
+    image.create(scan.size(), scan.type());
+    listener.imageStarted(image);
+    deliverBands(options, scan, brightness, contrast, start, image, &listener);
+    return errorCode;
+}
+
+HANDLE ImgScannerSimulator::acquire(
+        const unsigned dpi,
+        const int brightness,
+        const int contrast,
+        const cv::Rect_<float> * bbox) {
+    const util::DmNanos start = util::getMonotonicNanos();
+    const SimulatorOptions options = getOptions();
+
+    cv::Mat scan;
+    errorCode = prepareScan(options, dpi, bbox, scan);
+    if (errorCode != SC_SUCCESS) {
+        return NULL;
+    }
+
+    std::unique_ptr<cv::Mat> result(new cv::Mat(scan.size(), scan.type()));
+    deliverBands(options, scan, brightness, contrast, start, *result, NULL);
+    return result.release();
+}
+
+/*
+ * Accepts the same DPIs as the scanners the library supports. A region that
+ * runs past the edge of the source image is clipped to it.
+ */
+int ImgScannerSimulator::prepareScan(
+        const SimulatorOptions & options,
+        const unsigned dpi,
+        const cv::Rect_<float> * bbox,
+        cv::Mat & scan) {
+    if (!isAvailable(options)) {
+        return SC_TWAIN_UNAVAIL;
+    }
+
+    if ((dpi != 300) && (dpi != 400) && (dpi != 600)) {
+        return SC_INVALID_DPI;
+    }
+
+    cv::Mat source;
+    if (!nextSourceImage(options, source)) {
+        return SC_INVALID_IMAGE;
+    }
+
+    cv::Rect region(0, 0, source.cols, source.rows);
+    if (bbox != NULL) {
+        const float sourceDpi = static_cast<float>(options.sourceDpi);
+        region &= cv::Rect(
+                cvRound(bbox->x * sourceDpi),
+                cvRound(bbox->y * sourceDpi),
+                cvRound(bbox->width * sourceDpi),
+                cvRound(bbox->height * sourceDpi));
+        if (region.area() == 0) {
+            throw std::invalid_argument("bounding box exceeds image dimensions");
+        }
+    }
+
+    if (dpi == options.sourceDpi) {
+        scan = source(region);
+    } else {
+        const double scale = static_cast<double>(dpi) / options.sourceDpi;
+        cv::resize(source(region), scan, cv::Size(), scale, scale,
+                (scale < 1) ? CV_INTER_AREA : CV_INTER_LINEAR);
+    }
+    return SC_SUCCESS;
+}
+
+/*
+ * Fills the result one band at a time. Each band is held back until the time
+ * the options say it would have been scanned, so the image is only ready
+ * once the whole scan time has passed.
+ */
+void ImgScannerSimulator::deliverBands(
+        const SimulatorOptions & options,
+        const cv::Mat & scan,
+        int brightness,
+        int contrast,
+        util::DmNanos start,
+        cv::Mat & result,
+        BandListener * listener) {
+    const int bandRows = (options.bandRows > 0)
+            ? std::min(static_cast<int>(options.bandRows), scan.rows) : scan.rows;
+    const int numBands = (scan.rows + bandRows - 1) / bandRows;
+
+    for (int band = 0; band < numBands; ++band) {
+        const int y = band * bandRows;
+        const int rows = std::min(bandRows, scan.rows - y);
+        cv::Mat dst = result.rowRange(y, y + rows);
+        adjust(scan.rowRange(y, y + rows), dst, brightness, contrast);
+
+        sleepUntil(start, options.startSeconds + (band + 1) * options.bandSeconds);
+        if (listener != NULL) {
+            listener->bandAcquired(y + rows);
+        }
+    }
+
+    VLOG(3) << "deliverBands: size/" << scan.size() << " bands/" << numBands
+            << " seconds/" << util::nanosToSeconds(util::getMonotonicNanos() - start);
 }
 
 void ImgScannerSimulator::freeImage(HANDLE handle) {
     VLOG(2) << "freeImage";
+    delete static_cast<cv::Mat *>(handle);
 }
 
 } /* namespace */
@@ -23,19 +23,73 @@
 
 #include "imgscanner/ImgScanner.h"
 
+#include "utils/DmTime.h"
+
+#include <ostream>
+#include <string>
+
 namespace dmscanlib {
 
 namespace imgscanner {
 
 /**
- * This class interfaces with the TWAIN driver to acquire images from the
- * scanner.
+ * Where the simulated scanner gets its images from and how long it takes to
+ * scan them. The defaults leave the scanner unavailable.
+ */
+struct SimulatorOptions {
+    SimulatorOptions();
+
+    // an image file, or a directory whose images are served one per scan in
+    // file name order, starting again at the first one after the last
+    std::string source;
+
+    // when there is no source, scans are of an empty flatbed
+    bool synthetic;
+
+    // resolution the source images were scanned at
+    unsigned sourceDpi;
+
+    // size of the synthetic flatbed, in inches
+    float flatbedWidth;
+    float flatbedHeight;
+
+    // time from the start of a scan until its first band is delivered
+    double startSeconds;
+
+    // the image is delivered in bands of this many rows, at the scan's DPI
+    unsigned bandRows;
+
+    // time taken to scan each band
+    double bandSeconds;
+};
+
+std::ostream & operator<<(std::ostream & os, const SimulatorOptions & m);
+
+/**
+ * Stands in for a TWAIN scanner where there is none, so that scanning and
+ * decoding can be run and timed on any platform.
+ *
+ * The scanned region is cut from the source image and resized from the
+ * source's DPI to the requested one. Each scan takes the next image of a
+ * directory, unless repeatLastPlate() was called. Brightness and contrast, in TWAIN's
+ * -1000 to 1000 range, are applied as a linear change to the pixel values.
+ * The image is delivered band by band and a scan takes as long as the
+ * options say, no matter how quickly the image is prepared. With
+ * acquireImageBands() each band is passed on as soon as its time is up.
+ *
+ * On platforms other than Windows the HANDLE returned refers to a cv::Mat,
+ * which is what Image expects there.
  */
 class ImgScannerSimulator: public ImgScanner {
 public:
     ImgScannerSimulator();
     virtual ~ImgScannerSimulator();
 
+    // used by all the scanners created afterwards
+    static void setOptions(const SimulatorOptions & options);
+
+    static SimulatorOptions getOptions();
+
     bool selectSourceAsDefault();
 
     int getScannerCapability();
@@ -51,13 +105,51 @@ public:
             const int brightness,
             const int contrast);
 
+    // delivers the bands to the listener as their scan time passes
+    int acquireImageBands(
+            const unsigned dpi,
+            const int brightness,
+            const int contrast,
+            const cv::Rect_<float> & bbox,
+            cv::Mat & image,
+            BandListener & listener);
+
+    // the next scan serves the same source image as the last one
+    void repeatLastPlate();
+
     void freeImage(HANDLE handle);
 
     int getErrorCode() {
-        return 0;
+        return errorCode;
     }
 
 private:
+    static bool isAvailable(const SimulatorOptions & options);
+
+    static bool nextSourceImage(const SimulatorOptions & options, cv::Mat & image);
+
+    static void adjust(const cv::Mat & src, cv::Mat & dst, int brightness, int contrast);
+
+    // bbox is in inches, NULL for the whole flatbed
+    HANDLE acquire(
+            const unsigned dpi,
+            const int brightness,
+            const int contrast,
+            const cv::Rect_<float> * bbox);
+
+    // the region of the next source image at the given DPI, before adjustment
+    int prepareScan(
+            const SimulatorOptions & options,
+            const unsigned dpi,
+            const cv::Rect_<float> * bbox,
+            cv::Mat & scan);
+
+    // listener may be NULL
+    void deliverBands(const SimulatorOptions & options, const cv::Mat & scan,
+            int brightness, int contrast, util::DmNanos start, cv::Mat & result,
+            BandListener * listener);
+
+    int errorCode;
 };
 
 } /* namespace */
@@ -32,6 +32,9 @@
 #include "ImgScannerTwain.h"
 
 #include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
 
 #define GLOG_NO_ABBREVIATED_SEVERITIES
 #include <glog/logging.h>
@@ -207,7 +210,6 @@ HANDLE ImgScannerTwain::acquireImage(
    TW_UINT16 rc;
    TW_UINT32 handle = 0;
    TW_IDENTITY srcID;
-   TW_FIX32 value;
    HWND hwnd;
 
    CHECK_EQ(sizeof(TW_FIX32), sizeof(long));
@@ -217,68 +219,12 @@ HANDLE ImgScannerTwain::acquireImage(
       return NULL;
    }
 
-   int scannerCapability = getScannerCapabilityInternal(srcID);
-
-   if (!(scannerCapability & CAP_IS_SCANNER)) {
-	  scannerSourceDeinit(hwnd, srcID);
-      errorCode = SC_FAIL;
-      return NULL;
-   }
-
-   if (!(((scannerCapability & CAP_DPI_300) && dpi == 300)
-         || ((scannerCapability & CAP_DPI_400) && dpi == 400)
-         || ((scannerCapability & CAP_DPI_600) && dpi == 600))) {
-	  scannerSourceDeinit(hwnd, srcID);
-      errorCode = SC_INVALID_DPI;
+   errorCode = configureSource(srcID, dpi, brightness, contrast, bbox, TWSX_NATIVE);
+   if (errorCode != SC_SUCCESS) {
+      scannerSourceDeinit(hwnd, srcID);
       return NULL;
    }
 
-   double physicalWidth = getPhysicalDimensions(srcID, ICAP_PHYSICALWIDTH);
-   double physicalHeight = getPhysicalDimensions(srcID, ICAP_PHYSICALHEIGHT);
-
-   cv::Rect_<float> flatbedRect(0, 0, 
-	   static_cast<float>(physicalWidth),
-	   static_cast<float>(physicalHeight));
-
-   if (!flatbedRect.contains(bbox.tl()) && !flatbedRect.contains(bbox.br()))  {
-		   throw std::invalid_argument("bounding box exeeds image dimensions");
-   }
-
-   errorCode = SC_SUCCESS;
-
-   value.Whole = dpi;
-   value.Frac = 0;
-   setCapOneValue(&srcID, ICAP_XRESOLUTION, TWTY_FIX32,
-                  *(unsigned long*) &value);
-   setCapOneValue(&srcID, ICAP_YRESOLUTION, TWTY_FIX32,
-                  *(unsigned long*) &value);
-
-   setCapOneValue(&srcID, ICAP_PIXELTYPE, TWTY_UINT16, TWPT_RGB);
-   //SetCapOneValue(&srcID, ICAP_BITDEPTH, TWTY_UINT16, 8);
-
-   value.Whole = brightness;
-   setCapOneValue(&srcID, ICAP_BRIGHTNESS, TWTY_FIX32,
-                  *(unsigned long*) &value);
-
-   value.Whole = contrast;
-   setCapOneValue(&srcID, ICAP_CONTRAST, TWTY_FIX32, *(unsigned long*) &value);
-
-   VLOG(3) << "acquireImage: source/\"" << srcID.ProductName << "\""
-           << " brightness/" << brightness
-           << " constrast/" << contrast
-           << " " << bbox;
-
-   setCapOneValue(&srcID, ICAP_UNITS, TWTY_UINT16, TWUN_INCHES);
-   TW_IMAGELAYOUT layout;
-   setFloatToIntPair(bbox.x, layout.Frame.Left.Whole, layout.Frame.Left.Frac);
-   setFloatToIntPair(bbox.y, layout.Frame.Top.Whole, layout.Frame.Top.Frac);
-   setFloatToIntPair(bbox.x + bbox.width, layout.Frame.Right.Whole, layout.Frame.Right.Frac);
-   setFloatToIntPair(bbox.y + bbox.height, layout.Frame.Bottom.Whole, layout.Frame.Bottom.Frac);
-   layout.DocumentNumber = 1;
-   layout.PageNumber = 1;
-   layout.FrameNumber = 1;
-   rc = invokeTwain(&srcID, DG_IMAGE, DAT_IMAGELAYOUT, MSG_SET, &layout);
-
    //Prepare to enable the default data source
    TW_USERINTERFACE ui;
    ui.ShowUI = FALSE;
@@ -398,6 +344,238 @@ HANDLE ImgScannerTwain::acquireImage(
    return (HANDLE) handle;
 }
 
+/*
+ * Uses a buffered memory transfer, so that the strips of the image can be
+ * handed to the listener as the scanner sends them. A source that cannot say
+ * how long the image will be before it is scanned is not supported.
+ */
+int ImgScannerTwain::acquireImageBands(
+        const unsigned dpi,
+        const int brightness,
+        const int contrast,
+        const cv::Rect_<float> & bbox,
+        cv::Mat & image,
+        BandListener & listener) {
+
+   TW_UINT16 rc;
+   TW_IDENTITY srcID;
+   HWND hwnd;
+
+   if (!scannerSourceInit(hwnd, srcID)) {
+      errorCode = SC_FAIL;
+      return errorCode;
+   }
+
+   errorCode = configureSource(srcID, dpi, brightness, contrast, bbox, TWSX_MEMORY);
+   if (errorCode != SC_SUCCESS) {
+      scannerSourceDeinit(hwnd, srcID);
+      return errorCode;
+   }
+
+   TW_USERINTERFACE ui;
+   ui.ShowUI = FALSE;
+   ui.ModalUI = FALSE;
+   ui.hParent = hwnd;
+
+   rc = invokeTwain(&srcID, DG_CONTROL, DAT_USERINTERFACE, MSG_ENABLEDS, &ui);
+   VLOG(3) << "DG_CONTROL / DAT_USERINTERFACE / MSG_ENABLEDS";
+
+   if (rc == TWRC_FAILURE) {
+      errorCode = SC_FAIL;
+      scannerSourceDeinit(hwnd, srcID);
+      VLOG(3) << "TWRC_FAILURE";
+      return errorCode;
+   }
+
+   MSG msg;
+   TW_EVENT event;
+   TW_PENDINGXFERS pxfers;
+
+   errorCode = SC_FAIL;
+
+   while (GetMessage((LPMSG) &msg, 0, 0, 0)) {
+      event.pEvent = (TW_MEMREF) &msg;
+      event.TWMessage = MSG_NULL;
+
+      rc = invokeTwain(&srcID, DG_CONTROL, DAT_EVENT, MSG_PROCESSEVENT,
+                       &event);
+      if (rc == TWRC_NOTDSEVENT) {
+         TranslateMessage((LPMSG) &msg);
+         DispatchMessage((LPMSG) &msg);
+         continue;
+      }
+
+      if (event.TWMessage == MSG_CLOSEDSREQ) {
+         invokeTwain(&srcID, DG_CONTROL, DAT_USERINTERFACE, MSG_DISABLEDS, &ui);
+         VLOG(3) << "got MSG_CLOSEDSREQ: sending DG_CONTROL / DAT_USERINTERFACE / MSG_DISABLEDS";
+         break;
+      }
+
+      if (event.TWMessage != MSG_XFERREADY) {
+         continue;
+      }
+
+      TW_IMAGEINFO ii;
+      rc = invokeTwain(&srcID, DG_IMAGE, DAT_IMAGEINFO, MSG_GET, &ii);
+      VLOG(3) << "DG_IMAGE / DAT_IMAGEINFO / MSG_GET";
+
+      TW_SETUPMEMXFER setup;
+      if ((rc != TWRC_SUCCESS)
+          || (ii.Compression != TWCP_NONE)
+          || ((ii.BitsPerPixel != 8) && (ii.BitsPerPixel != 24))
+          || (ii.ImageWidth <= 0) || (ii.ImageLength <= 0)
+          || (invokeTwain(&srcID, DG_CONTROL, DAT_SETUPMEMXFER, MSG_GET,
+                          &setup) != TWRC_SUCCESS)) {
+         invokeTwain(&srcID, DG_CONTROL, DAT_PENDINGXFERS, MSG_RESET, &pxfers);
+         LOG(WARNING) << "Unable to set up a memory transfer";
+         errorCode = SC_INVALID_IMAGE;
+         break;
+      }
+
+      VLOG(3) << "acquireImageBands:"
+              << " imageWidth/" << ii.ImageWidth
+              << " imageLength/" << ii.ImageLength
+              << " bits per pixel/" << ii.BitsPerPixel
+              << " buffer/" << setup.Preferred;
+
+      image.create(ii.ImageLength, ii.ImageWidth,
+                   (ii.BitsPerPixel == 24) ? CV_8UC3 : CV_8UC1);
+      listener.imageStarted(image);
+
+      std::vector<unsigned char> buffer(setup.Preferred);
+      int rowsDone = 0;
+
+      do {
+         TW_IMAGEMEMXFER xfer;
+         memset(&xfer, 0, sizeof(xfer));
+         xfer.Memory.Flags = TWMF_APPOWNS | TWMF_POINTER;
+         xfer.Memory.Length = static_cast<TW_UINT32>(buffer.size());
+         xfer.Memory.TheMem = &buffer[0];
+
+         rc = invokeTwain(&srcID, DG_IMAGE, DAT_IMAGEMEMXFER, MSG_GET, &xfer);
+         if ((rc != TWRC_SUCCESS) && (rc != TWRC_XFERDONE)) {
+            break;
+         }
+
+         // TWAIN sends the colour samples in RGB order
+         for (TW_UINT32 row = 0; row < xfer.Rows; ++row) {
+            cv::Mat src(1, xfer.Columns, image.type(), &buffer[row * xfer.BytesPerRow]);
+            cv::Mat dst = image(cv::Rect(xfer.XOffset, xfer.YOffset + row, xfer.Columns, 1));
+            if (image.channels() == 3) {
+               cv::cvtColor(src, dst, CV_RGB2BGR);
+            } else {
+               src.copyTo(dst);
+            }
+         }
+
+         // strips that arrive out of order are only reported at the end
+         if ((static_cast<int>(xfer.YOffset) == rowsDone) && (xfer.Rows > 0)) {
+            rowsDone += xfer.Rows;
+            listener.bandAcquired(std::min(rowsDone, image.rows));
+         }
+      } while (rc == TWRC_SUCCESS);
+
+      if (rc != TWRC_XFERDONE) {
+         invokeTwain(&srcID, DG_CONTROL, DAT_PENDINGXFERS, MSG_RESET, &pxfers);
+         VLOG(3) << "DG_CONTROL / DAT_PENDINGXFERS / MSG_RESET";
+         LOG(WARNING) << "User aborted transfer or failure";
+         errorCode = SC_INVALID_IMAGE;
+         break;
+      }
+
+      if (rowsDone < image.rows) {
+         listener.bandAcquired(image.rows);
+      }
+      errorCode = SC_SUCCESS;
+
+      rc = invokeTwain(&srcID, DG_CONTROL, DAT_PENDINGXFERS, MSG_ENDXFER, &pxfers);
+      VLOG(3) << "DG_CONTROL / DAT_PENDINGXFERS / MSG_ENDXFER";
+
+      if ((rc == TWRC_SUCCESS) && (pxfers.Count != 0)) {
+         invokeTwain(&srcID, DG_CONTROL, DAT_PENDINGXFERS, MSG_RESET, &pxfers);
+         VLOG(3) << "DG_CONTROL / DAT_PENDINGXFERS / MSG_RESET";
+      }
+      invokeTwain(&srcID, DG_CONTROL, DAT_USERINTERFACE, MSG_DISABLEDS, &ui);
+      VLOG(3) << "DG_CONTROL / DAT_USERINTERFACE / MSG_DISABLEDS";
+      break;
+   }
+
+   scannerSourceDeinit(hwnd, srcID);
+   return errorCode;
+}
+
+/*
+ * Checks that the source can scan at the DPI and sets it up to scan the
+ * region, with the given transfer mechanism. Returns an SC_* code.
+ */
+int ImgScannerTwain::configureSource(
+        TW_IDENTITY & srcID,
+        const unsigned dpi,
+        const int brightness,
+        const int contrast,
+        const cv::Rect_<float> & bbox,
+        TW_UINT16 xferMech) {
+   TW_FIX32 value;
+
+   int scannerCapability = getScannerCapabilityInternal(srcID);
+
+   if (!(scannerCapability & CAP_IS_SCANNER)) {
+      return SC_FAIL;
+   }
+
+   if (!(((scannerCapability & CAP_DPI_300) && dpi == 300)
+         || ((scannerCapability & CAP_DPI_400) && dpi == 400)
+         || ((scannerCapability & CAP_DPI_600) && dpi == 600))) {
+      return SC_INVALID_DPI;
+   }
+
+   double physicalWidth = getPhysicalDimensions(srcID, ICAP_PHYSICALWIDTH);
+   double physicalHeight = getPhysicalDimensions(srcID, ICAP_PHYSICALHEIGHT);
+
+   cv::Rect_<float> flatbedRect(0, 0, 
+	   static_cast<float>(physicalWidth),
+	   static_cast<float>(physicalHeight));
+
+   if (!flatbedRect.contains(bbox.tl()) && !flatbedRect.contains(bbox.br()))  {
+		   throw std::invalid_argument("bounding box exeeds image dimensions");
+   }
+
+   value.Whole = dpi;
+   value.Frac = 0;
+   setCapOneValue(&srcID, ICAP_XRESOLUTION, TWTY_FIX32,
+                  *(unsigned long*) &value);
+   setCapOneValue(&srcID, ICAP_YRESOLUTION, TWTY_FIX32,
+                  *(unsigned long*) &value);
+
+   setCapOneValue(&srcID, ICAP_PIXELTYPE, TWTY_UINT16, TWPT_RGB);
+   setCapOneValue(&srcID, ICAP_XFERMECH, TWTY_UINT16, xferMech);
+   //SetCapOneValue(&srcID, ICAP_BITDEPTH, TWTY_UINT16, 8);
+
+   value.Whole = brightness;
+   setCapOneValue(&srcID, ICAP_BRIGHTNESS, TWTY_FIX32,
+                  *(unsigned long*) &value);
+
+   value.Whole = contrast;
+   setCapOneValue(&srcID, ICAP_CONTRAST, TWTY_FIX32, *(unsigned long*) &value);
+
+   VLOG(3) << "acquireImage: source/\"" << srcID.ProductName << "\""
+           << " brightness/" << brightness
+           << " constrast/" << contrast
+           << " " << bbox;
+
+   setCapOneValue(&srcID, ICAP_UNITS, TWTY_UINT16, TWUN_INCHES);
+   TW_IMAGELAYOUT layout;
+   setFloatToIntPair(bbox.x, layout.Frame.Left.Whole, layout.Frame.Left.Frac);
+   setFloatToIntPair(bbox.y, layout.Frame.Top.Whole, layout.Frame.Top.Frac);
+   setFloatToIntPair(bbox.x + bbox.width, layout.Frame.Right.Whole, layout.Frame.Right.Frac);
+   setFloatToIntPair(bbox.y + bbox.height, layout.Frame.Bottom.Whole, layout.Frame.Bottom.Frac);
+   layout.DocumentNumber = 1;
+   layout.PageNumber = 1;
+   layout.FrameNumber = 1;
+   invokeTwain(&srcID, DG_IMAGE, DAT_IMAGELAYOUT, MSG_SET, &layout);
+   return SC_SUCCESS;
+}
+
 HANDLE ImgScannerTwain::acquireFlatbed(unsigned dpi, int brightness, int contrast) {
    TW_IDENTITY srcID;
    HWND hwnd;
@@ -65,6 +65,14 @@ namespace dmscanlib {
 				const int brightness,
 				const int contrast);
 
+			int acquireImageBands(
+				const unsigned dpi,
+				const int brightness,
+				const int contrast,
+				const cv::Rect_<float> & bbox,
+				cv::Mat & image,
+				BandListener & listener);
+
 			void freeImage(HANDLE handle);
 
 			int getErrorCode() { return errorCode; }
@@ -88,6 +96,10 @@ namespace dmscanlib {
 
 			void getCustomDsData(TW_IDENTITY * srcId);
 
+			int configureSource(TW_IDENTITY & srcID, const unsigned dpi,
+				const int brightness, const int contrast,
+				const cv::Rect_<float> & bbox, TW_UINT16 xferMech);
+
 			bool scannerSourceInit(HWND & hwnd, TW_IDENTITY & srcID);
 			void scannerSourceDeinit(HWND & hwnd, TW_IDENTITY & srcID);
 
@@ -27,6 +27,8 @@ extern "C" {
 #define edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_SC_INVALID_NOTHING_TO_DECODE -6L
 #undef edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_SC_INCORRECT_DPI_SCANNED
 #define edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_SC_INCORRECT_DPI_SCANNED -7L
+#undef edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_SC_DECODE_CANCELLED
+#define edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_SC_DECODE_CANCELLED -8L
 #undef edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_CAP_IS_WIA
 #define edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_CAP_IS_WIA 1L
 #undef edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_CAP_DPI_300
@@ -77,6 +79,22 @@ JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_
 JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_scanAndDecode
   (JNIEnv *, jobject, jlong, jlong, jint, jint, jdouble, jdouble, jdouble, jdouble, jobject, jobjectArray);
 
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    scanAndDecodePlates
+ * Signature: (JJII[D[ILedu/ualberta/med/scannerconfig/dmscanlib/DecodeOptions;)[Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeResult;
+ */
+JNIEXPORT jobjectArray JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_scanAndDecodePlates
+  (JNIEnv *, jobject, jlong, jlong, jint, jint, jdoubleArray, jintArray, jobject);
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    setScannerSimulator
+ * Signature: (Ljava/lang/String;ZJDJD)V
+ */
+JNIEXPORT void JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_setScannerSimulator
+  (JNIEnv *, jobject, jstring, jboolean, jlong, jdouble, jlong, jdouble);
+
 /*
  * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
  * Method:    decodeImage
@@ -85,6 +103,158 @@ JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_
 JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_decodeImage
   (JNIEnv *, jobject, jlong, jstring, jobject, jobjectArray);
 
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    decodeImageBulk
+ * Signature: (JLjava/lang/String;Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeOptions;[Ljava/lang/String;[D)Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeResult;
+ */
+JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_decodeImageBulk
+  (JNIEnv *, jobject, jlong, jstring, jobject, jobjectArray, jdoubleArray);
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    registerLayout
+ * Signature: ([Ljava/lang/String;[D)I
+ */
+JNIEXPORT jint JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_registerLayout
+  (JNIEnv *, jobject, jobjectArray, jdoubleArray);
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    unregisterLayout
+ * Signature: (I)V
+ */
+JNIEXPORT void JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_unregisterLayout
+  (JNIEnv *, jobject, jint);
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    decodeImageLayout
+ * Signature: (JLjava/lang/String;Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeOptions;I)Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeResult;
+ */
+JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_decodeImageLayout
+  (JNIEnv *, jobject, jlong, jstring, jobject, jint);
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    openSession
+ * Signature: (JJ)J
+ */
+JNIEXPORT jlong JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_openSession
+  (JNIEnv *, jobject, jlong, jlong);
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    closeSession
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_closeSession
+  (JNIEnv *, jobject, jlong);
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    sessionDecodeImage
+ * Signature: (JLjava/lang/String;Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeOptions;[Ledu/ualberta/med/scannerconfig/dmscanlib/Well;)Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeResult;
+ */
+JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_sessionDecodeImage
+  (JNIEnv *, jobject, jlong, jstring, jobject, jobjectArray);
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    sessionDecodeImageBulk
+ * Signature: (JLjava/lang/String;Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeOptions;[Ljava/lang/String;[D)Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeResult;
+ */
+JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_sessionDecodeImageBulk
+  (JNIEnv *, jobject, jlong, jstring, jobject, jobjectArray, jdoubleArray);
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    sessionDecodeImageLayout
+ * Signature: (JLjava/lang/String;Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeOptions;I)Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeResult;
+ */
+JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_sessionDecodeImageLayout
+  (JNIEnv *, jobject, jlong, jstring, jobject, jint);
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    startDecode
+ * Signature: (JLjava/lang/String;Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeOptions;[Ledu/ualberta/med/scannerconfig/dmscanlib/Well;)J
+ */
+JNIEXPORT jlong JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_startDecode
+  (JNIEnv *, jobject, jlong, jstring, jobject, jobjectArray);
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    pollDecode
+ * Signature: (J)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_pollDecode
+  (JNIEnv *, jobject, jlong);
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    cancelDecode
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_cancelDecode
+  (JNIEnv *, jobject, jlong);
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    finishDecode
+ * Signature: (J)Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeResult;
+ */
+JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_finishDecode
+  (JNIEnv *, jobject, jlong);
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    setMetricsEnabled
+ * Signature: (Z)V
+ */
+JNIEXPORT void JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_setMetricsEnabled
+  (JNIEnv *, jobject, jboolean);
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    setLocateTubes
+ * Signature: (Z)V
+ */
+JNIEXPORT void JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_setLocateTubes
+  (JNIEnv *, jobject, jboolean);
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    setRefitGrid
+ * Signature: (Z)V
+ */
+JNIEXPORT void JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_setRefitGrid
+  (JNIEnv *, jobject, jboolean);
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    setRescanDpi
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_setRescanDpi
+  (JNIEnv *, jobject, jlong);
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    setAutoTune
+ * Signature: (Ljava/lang/String;)V
+ */
+JNIEXPORT void JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_setAutoTune
+  (JNIEnv *, jobject, jstring);
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    setDecodeCache
+ * Signature: (JLjava/lang/String;)V
+ */
+JNIEXPORT void JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_setDecodeCache
+  (JNIEnv *, jobject, jlong, jstring);
+
 #ifdef __cplusplus
 }
 #endif
@@ -7,26 +7,132 @@
 #include "DmScanLibJni.h"
 #include "DmScanLibJniInternal.h"
 #include "DmScanLib.h"
+#include "DmScanSession.h"
+#include "DecodeJob.h"
 #include "decoder/DecodeOptions.h"
+#include "decoder/DecodeMetrics.h"
 #include "decoder/WellDecoder.h"
 
+#include <algorithm>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <vector>
 #include <glog/logging.h>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
 
 namespace dmscanlib {
 
 namespace jni {
 
-jobject createScanResultObject(JNIEnv * env, int resultCode, int value) {
-    jclass scanLibResultClass = env->FindClass(
+namespace {
+
+JniIds jniIds;
+
+bool jniIdsValid = false;
+
+jclass findClass(JNIEnv * env, const char * name) {
+    jclass localClass = env->FindClass(name);
+    if (localClass == NULL) {
+        return NULL;
+    }
+    jclass globalClass = static_cast<jclass>(env->NewGlobalRef(localClass));
+    env->DeleteLocalRef(localClass);
+    return globalClass;
+}
+
+// for methods that older versions of the Java classes do not have
+jmethodID getOptionalMethodID(JNIEnv * env, jclass clazz, const char * name,
+        const char * signature) {
+    jmethodID method = env->GetMethodID(clazz, name, signature);
+    if (method == NULL) {
+        env->ExceptionClear();
+        VLOG(1) << "JNI method not available: " << name << signature;
+    }
+    return method;
+}
+
+/*
+ * Run the following command to obtain method signatures from a class:
+ *
+ *   javap -s -p edu.ualberta.med.scannerconfig.dmscanlib.DecodeResult
+ *
+ * On failure the Java exception is left pending.
+ */
+bool resolveJniIds(JNIEnv * env, JniIds & ids) {
+    ids.stringClass = findClass(env, "java/lang/String");
+    ids.scanLibResultClass = findClass(env,
             "edu/ualberta/med/scannerconfig/dmscanlib/ScanLibResult");
+    ids.decodeResultClass = findClass(env,
+            "edu/ualberta/med/scannerconfig/dmscanlib/DecodeResult");
+    ids.decodeOptionsClass = findClass(env,
+            "edu/ualberta/med/scannerconfig/dmscanlib/DecodeOptions");
+    if ((ids.stringClass == NULL) || (ids.scanLibResultClass == NULL)
+            || (ids.decodeResultClass == NULL) || (ids.decodeOptionsClass == NULL)) {
+        return false;
+    }
 
-    // run the following command to obtain method signatures from a class.
-    // javap -s -p edu.ualberta.med.scannerconfig.dmscanlib.ScanLibResult
-    jmethodID cons = env->GetMethodID(scanLibResultClass, "<init>",
+    ids.scanLibResultInit = env->GetMethodID(ids.scanLibResultClass, "<init>",
             "(IILjava/lang/String;)V");
+    ids.decodeResultInit = env->GetMethodID(ids.decodeResultClass, "<init>",
+            "(IILjava/lang/String;)V");
+    ids.decodeResultAddWell = env->GetMethodID(ids.decodeResultClass, "addWell",
+            "(Ljava/lang/String;Ljava/lang/String;)V");
+    if ((ids.scanLibResultInit == NULL) || (ids.decodeResultInit == NULL)
+            || (ids.decodeResultAddWell == NULL)) {
+        return false;
+    }
+
+    const char * getters[DECODE_OPTION_MAX][2] = {
+            { "getMinEdgeFactor", "()D" },
+            { "getMaxEdgeFactor", "()D" },
+            { "getScanGapFactor", "()D" },
+            { "getSquareDev", "()J" },
+            { "getEdgeThresh", "()J" },
+            { "getCorrections", "()J" },
+            { "getShrink", "()J" }
+    };
+    for (unsigned i = 0; i < DECODE_OPTION_MAX; ++i) {
+        ids.decodeOptionsGetters[i] = env->GetMethodID(ids.decodeOptionsClass,
+                getters[i][0], getters[i][1]);
+        if (ids.decodeOptionsGetters[i] == NULL) {
+            return false;
+        }
+    }
+
+    ids.decodeResultSetWells = getOptionalMethodID(env, ids.decodeResultClass,
+            "setWells", "([Ljava/lang/String;[Ljava/lang/String;)V");
+    ids.decodeResultSetMetrics = getOptionalMethodID(env, ids.decodeResultClass,
+            "setMetrics", "([J[D)V");
+    ids.decodeResultAddWellMetrics = getOptionalMethodID(env, ids.decodeResultClass,
+            "addWellMetrics", "(Ljava/lang/String;[J[D)V");
+    ids.decodeResultSetWellMetrics = getOptionalMethodID(env, ids.decodeResultClass,
+            "setWellMetrics", "([Ljava/lang/String;[J[D)V");
+    ids.decodeOptionsGetCascade = getOptionalMethodID(env, ids.decodeOptionsClass,
+            "getCascade", "()[Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeOptions;");
+    return true;
+}
+
+} /* namespace */
+
+const JniIds * getJniIds(JNIEnv * env) {
+    if (!jniIdsValid) {
+        JniIds ids = JniIds();
+        if (!resolveJniIds(env, ids)) {
+            return NULL;
+        }
+        jniIds = ids;
+        jniIdsValid = true;
+    }
+    return &jniIds;
+}
+
+jobject createScanResultObject(JNIEnv * env, int resultCode, int value) {
+    const JniIds * ids = getJniIds(env);
+    if (ids == NULL) {
+        return NULL;
+    }
 
     std::string msg;
     getResultCodeMsg(resultCode, msg);
@@ -36,17 +142,14 @@ jobject createScanResultObject(JNIEnv * env, int resultCode, int value) {
     data[1].i = value;
     data[2].l = env->NewStringUTF(msg.c_str());
 
-    return env->NewObjectA(scanLibResultClass, cons, data);
+    return env->NewObjectA(ids->scanLibResultClass, ids->scanLibResultInit, data);
 }
 
 jobject createDecodeResultObject(JNIEnv * env, int resultCode) {
-    jclass resultClass = env->FindClass(
-            "edu/ualberta/med/scannerconfig/dmscanlib/DecodeResult");
-
-    // run the following command to obtain method signatures from a class.
-    // javap -s -p edu.ualberta.med.scannerconfig.dmscanlib.DecodeResult
-    jmethodID cons = env->GetMethodID(resultClass, "<init>",
-            "(IILjava/lang/String;)V");
+    const JniIds * ids = getJniIds(env);
+    if (ids == NULL) {
+        return NULL;
+    }
 
     std::string msg;
     getResultCodeMsg(resultCode, msg);
@@ -56,38 +159,256 @@ jobject createDecodeResultObject(JNIEnv * env, int resultCode) {
     data[1].i = 0;
     data[2].l = env->NewStringUTF(msg.c_str());
 
-    return env->NewObjectA(resultClass, cons, data);
+    return env->NewObjectA(ids->decodeResultClass, ids->decodeResultInit, data);
 }
 
+/*
+ * When DecodeResult has setWells() the labels and messages are passed as two
+ * parallel arrays in a single call, otherwise addWell() is called per well.
+ */
 jobject createDecodeResultObject(JNIEnv * env, int resultCode,
         const std::map<std::string, const dmscanlib::WellDecoder *> & wellDecoders) {
     jobject resultObj = createDecodeResultObject(env, resultCode);
+    if ((resultObj == NULL) || wellDecoders.empty()) {
+        return resultObj;
+    }
 
-    jclass resultClass = env->FindClass(
-            "edu/ualberta/med/scannerconfig/dmscanlib/DecodeResult");
+    const JniIds & ids = *getJniIds(env);
+    const jsize numWells = static_cast<jsize>(wellDecoders.size());
+    std::map<std::string, const dmscanlib::WellDecoder *>::const_iterator ii;
 
-    if (wellDecoders.size() > 0) {
-        jmethodID setCellMethod = env->GetMethodID(resultClass, "addWell",
-                "(Ljava/lang/String;Ljava/lang/String;)V");
+    if (ids.decodeResultSetWells != NULL) {
+        jobjectArray labels = env->NewObjectArray(numWells, ids.stringClass, NULL);
+        jobjectArray messages = env->NewObjectArray(numWells, ids.stringClass, NULL);
+        if ((labels == NULL) || (messages == NULL)) {
+            return NULL;
+        }
 
-        for (std::map<std::string, const dmscanlib::WellDecoder *>::const_iterator ii =
-                wellDecoders.begin();
-                ii != wellDecoders.end(); ++ii) {
+        jsize i = 0;
+        for (ii = wellDecoders.begin(); ii != wellDecoders.end(); ++ii, ++i) {
             const dmscanlib::WellDecoder & wellDecoder = *(ii->second);
-            jvalue data[3];
+            VLOG(5) << wellDecoder;
 
+            jstring label = env->NewStringUTF(wellDecoder.getLabel().c_str());
+            jstring message = env->NewStringUTF(wellDecoder.getMessage().c_str());
+            env->SetObjectArrayElement(labels, i, label);
+            env->SetObjectArrayElement(messages, i, message);
+            env->DeleteLocalRef(label);
+            env->DeleteLocalRef(message);
+        }
+
+        jvalue data[2];
+        data[0].l = labels;
+        data[1].l = messages;
+        env->CallVoidMethodA(resultObj, ids.decodeResultSetWells, data);
+    } else {
+        for (ii = wellDecoders.begin(); ii != wellDecoders.end(); ++ii) {
+            const dmscanlib::WellDecoder & wellDecoder = *(ii->second);
             VLOG(5) << wellDecoder;
 
+            jvalue data[2];
             data[0].l = env->NewStringUTF(wellDecoder.getLabel().c_str());
             data[1].l = env->NewStringUTF(wellDecoder.getMessage().c_str());
+            env->CallVoidMethodA(resultObj, ids.decodeResultAddWell, data);
+            env->DeleteLocalRef(data[0].l);
+            env->DeleteLocalRef(data[1].l);
+        }
+    }
+
+    VLOG(1) << "wells decoded: " << numWells;
+    return resultObj;
+}
 
-            env->CallObjectMethodA(resultObj, setCellMethod, data);
+void getMetricsArrays(JNIEnv * env, const DecodeMetrics & metrics, jvalue & countsValue,
+        jvalue & timesValue) {
+    jlong counts[DecodeMetrics::COUNTER_MAX];
+    for (unsigned i = 0; i < DecodeMetrics::COUNTER_MAX; ++i) {
+        counts[i] = metrics.getCounts()[i];
+    }
+
+    jlongArray countsArray = env->NewLongArray(DecodeMetrics::COUNTER_MAX);
+    env->SetLongArrayRegion(countsArray, 0, DecodeMetrics::COUNTER_MAX, counts);
+
+    jdoubleArray timesArray = env->NewDoubleArray(DecodeMetrics::PHASE_MAX);
+    env->SetDoubleArrayRegion(timesArray, 0, DecodeMetrics::PHASE_MAX, metrics.getTimes());
+
+    countsValue.l = countsArray;
+    timesValue.l = timesArray;
+}
+
+/*
+ * Passes the metrics of every well in one call to setWellMetrics(). The
+ * counters and times of well i start at i * COUNTER_MAX and i * PHASE_MAX.
+ */
+void setWellMetricsBulk(JNIEnv * env, jobject resultObj, const JniIds & ids,
+        const std::map<std::string, DecodeMetrics> & wellMetrics) {
+    const jsize numWells = static_cast<jsize>(wellMetrics.size());
+    jobjectArray labels = env->NewObjectArray(numWells, ids.stringClass, NULL);
+    if (labels == NULL) {
+        return;
+    }
+
+    std::vector<jlong> counts(numWells * DecodeMetrics::COUNTER_MAX);
+    std::vector<jdouble> times(numWells * DecodeMetrics::PHASE_MAX);
+
+    jsize i = 0;
+    for (std::map<std::string, DecodeMetrics>::const_iterator ii = wellMetrics.begin();
+            ii != wellMetrics.end(); ++ii, ++i) {
+        jstring label = env->NewStringUTF(ii->first.c_str());
+        env->SetObjectArrayElement(labels, i, label);
+        env->DeleteLocalRef(label);
+
+        for (unsigned j = 0; j < DecodeMetrics::COUNTER_MAX; ++j) {
+            counts[i * DecodeMetrics::COUNTER_MAX + j] = ii->second.getCounts()[j];
+        }
+        for (unsigned j = 0; j < DecodeMetrics::PHASE_MAX; ++j) {
+            times[i * DecodeMetrics::PHASE_MAX + j] = ii->second.getTimes()[j];
         }
+    }
 
-        VLOG(1) << "wells decoded: " << wellDecoders.size();
+    jlongArray countsArray = env->NewLongArray(counts.size());
+    jdoubleArray timesArray = env->NewDoubleArray(times.size());
+    if ((countsArray == NULL) || (timesArray == NULL)) {
+        return;
+    }
+    if (!counts.empty()) {
+        env->SetLongArrayRegion(countsArray, 0, counts.size(), &counts[0]);
+        env->SetDoubleArrayRegion(timesArray, 0, times.size(), &times[0]);
     }
 
-    return resultObj;
+    jvalue data[3];
+    data[0].l = labels;
+    data[1].l = countsArray;
+    data[2].l = timesArray;
+    env->CallVoidMethodA(resultObj, ids.decodeResultSetWellMetrics, data);
+}
+
+/*
+ * Copies the metrics from the last decode to the result object when metrics
+ * are enabled. The counters and the times (in seconds) are passed as arrays
+ * indexed by DecodeMetrics::Counter and DecodeMetrics::Phase.
+ */
+void setDecodeResultMetrics(JNIEnv * env, jobject resultObj, const DmScanLib & dmScanLib) {
+    if (!DmScanLib::getMetricsEnabled() || (resultObj == NULL)) {
+        return;
+    }
+
+    const JniIds * ids = getJniIds(env);
+    if (ids == NULL) {
+        return;
+    }
+
+    // older versions of DecodeResult do not take metrics
+    if ((ids->decodeResultSetMetrics == NULL)
+            || ((ids->decodeResultSetWellMetrics == NULL)
+                    && (ids->decodeResultAddWellMetrics == NULL))) {
+        VLOG(1) << "DecodeResult does not accept metrics";
+        return;
+    }
+
+    jvalue data[3];
+    getMetricsArrays(env, dmScanLib.getMetrics(), data[0], data[1]);
+    env->CallVoidMethodA(resultObj, ids->decodeResultSetMetrics, data);
+
+    const std::map<std::string, DecodeMetrics> & wellMetrics = dmScanLib.getWellMetrics();
+    if (ids->decodeResultSetWellMetrics != NULL) {
+        setWellMetricsBulk(env, resultObj, *ids, wellMetrics);
+        return;
+    }
+
+    for (std::map<std::string, DecodeMetrics>::const_iterator ii = wellMetrics.begin();
+            ii != wellMetrics.end(); ++ii) {
+        data[0].l = env->NewStringUTF(ii->first.c_str());
+        getMetricsArrays(env, ii->second, data[1], data[2]);
+        env->CallVoidMethodA(resultObj, ids->decodeResultAddWellMetrics, data);
+        env->DeleteLocalRef(data[0].l);
+        env->DeleteLocalRef(data[1].l);
+        env->DeleteLocalRef(data[2].l);
+    }
+}
+
+namespace {
+
+std::unique_ptr<DecodeOptions> getDecodeOptionValues(JNIEnv * env, const JniIds & ids,
+        jobject decodeOptionsObj) {
+    const jmethodID * getters = ids.decodeOptionsGetters;
+    double minEdgeFactor = env->CallDoubleMethod(decodeOptionsObj, getters[MIN_EDGE_FACTOR]);
+    double maxEdgeFactor = env->CallDoubleMethod(decodeOptionsObj, getters[MAX_EDGE_FACTOR]);
+    double scanGapFactor = env->CallDoubleMethod(decodeOptionsObj, getters[SCAN_GAP_FACTOR]);
+    long squareDev = static_cast<long>(
+            env->CallLongMethod(decodeOptionsObj, getters[SQUARE_DEV]));
+    long edgeThresh = static_cast<long>(
+            env->CallLongMethod(decodeOptionsObj, getters[EDGE_THRESH]));
+    long corrections = static_cast<long>(
+            env->CallLongMethod(decodeOptionsObj, getters[CORRECTIONS]));
+    long shrink = static_cast<long>(env->CallLongMethod(decodeOptionsObj, getters[SHRINK]));
+
+    if (env->ExceptionCheck()) {
+        return std::unique_ptr<DecodeOptions>();
+    }
+
+    return std::unique_ptr<DecodeOptions>(new DecodeOptions(
+            minEdgeFactor, maxEdgeFactor, scanGapFactor, squareDev, edgeThresh, corrections, shrink));
+}
+
+} /* namespace */
+
+/*
+ * When the Java options have getCascade(), the options it returns become the
+ * stages tried before these ones, fastest first.
+ */
+std::unique_ptr<DecodeOptions> getDecodeOptions(JNIEnv * env, jobject decodeOptionsObj) {
+    const JniIds * ids = getJniIds(env);
+    if (ids == NULL) {
+        return std::unique_ptr<DecodeOptions>();
+    }
+
+    std::unique_ptr<DecodeOptions> decodeOptions = getDecodeOptionValues(env, *ids,
+            decodeOptionsObj);
+    if ((decodeOptions.get() == NULL) || (ids->decodeOptionsGetCascade == NULL)) {
+        return decodeOptions;
+    }
+
+    jobjectArray stagesArr = static_cast<jobjectArray>(
+            env->CallObjectMethod(decodeOptionsObj, ids->decodeOptionsGetCascade));
+    if (env->ExceptionCheck()) {
+        return std::unique_ptr<DecodeOptions>();
+    }
+    if (stagesArr == NULL) {
+        return decodeOptions;
+    }
+
+    for (jsize i = 0, n = env->GetArrayLength(stagesArr); i < n; ++i) {
+        jobject stageObj = env->GetObjectArrayElement(stagesArr, i);
+        if (stageObj == NULL) {
+            continue;
+        }
+        std::unique_ptr<DecodeOptions> stage = getDecodeOptionValues(env, *ids, stageObj);
+        env->DeleteLocalRef(stageObj);
+        if (stage.get() == NULL) {
+            return std::unique_ptr<DecodeOptions>();
+        }
+        decodeOptions->addStage(*stage);
+    }
+    env->DeleteLocalRef(stagesArr);
+    return decodeOptions;
+}
+
+/*
+ * The four corners, given as x, y pairs, become the well's quad. Its bounding
+ * box is the rectangle cropped from the image.
+ */
+std::unique_ptr<const WellRectangle> createWellRectangle(const char * label,
+        const double (&corners)[8]) {
+    cv::Point2f points[4];
+    for (unsigned i = 0; i < 4; ++i) {
+        points[i] = cv::Point2f(static_cast<float>(corners[2 * i]),
+                static_cast<float>(corners[2 * i + 1]));
+    }
+
+    std::unique_ptr<const WellRectangle> wellRect(new WellRectangle(label, points));
+    VLOG(5) << *wellRect;
+    return wellRect;
 }
 
 int getWellRectangles(JNIEnv *env, jsize numWells, jobjectArray _wellRects,
@@ -134,45 +455,208 @@ int getWellRectangles(JNIEnv *env, jsize numWells, jobjectArray _wellRects,
         jobject labelJobj = env->CallObjectMethod(wellRectJavaObj, wellRectGetLabelMethodID);
         const char * label = env->GetStringUTFChars((jstring) labelJobj, NULL);
 
-        double x1 = env->CallDoubleMethod(wellRectJavaObj, wellRectGetCornerXMethodID, 0);
-        double y1 = env->CallDoubleMethod(wellRectJavaObj, wellRectGetCornerYMethodID, 0);
+        double corners[8];
+        for (unsigned corner = 0; corner < 4; ++corner) {
+            corners[2 * corner] = env->CallDoubleMethod(
+                    wellRectJavaObj, wellRectGetCornerXMethodID, corner);
+            corners[2 * corner + 1] = env->CallDoubleMethod(
+                    wellRectJavaObj, wellRectGetCornerYMethodID, corner);
+        }
 
-        double x2 = env->CallDoubleMethod(wellRectJavaObj, wellRectGetCornerXMethodID, 1);
-        double y2 = env->CallDoubleMethod(wellRectJavaObj, wellRectGetCornerYMethodID, 1);
+        wellRects.push_back(createWellRectangle(label, corners));
 
-        double x3 = env->CallDoubleMethod(wellRectJavaObj, wellRectGetCornerXMethodID, 2);
-        double y3 = env->CallDoubleMethod(wellRectJavaObj, wellRectGetCornerYMethodID, 2);
+        env->ReleaseStringUTFChars((jstring) labelJobj, label);
+        env->DeleteLocalRef(labelJobj);
+        env->DeleteLocalRef(wellRectJavaObj);
+    }
+    return 1;
+}
 
-        double x4 = env->CallDoubleMethod(wellRectJavaObj, wellRectGetCornerXMethodID, 3);
-        double y4 = env->CallDoubleMethod(wellRectJavaObj, wellRectGetCornerYMethodID, 3);
+/*
+ * Bulk version of the above. corners holds 8 values per well, the x and y
+ * coordinates of its four corners, and is copied out of Java in one call.
+ * Returns the same codes as the above.
+ */
+int getWellRectangles(JNIEnv *env, jobjectArray labels, jdoubleArray corners,
+        std::vector<std::unique_ptr<const WellRectangle> > & wellRects) {
+    const jsize numWells = env->GetArrayLength(labels);
 
-        double xmin = std::min(x1, std::min(x2, std::min(x3, x4)));
-        double ymin = std::min(y1, std::min(y2, std::min(y3, y4)));
+    VLOG(5) << "getWellRectangles: numWells/" << numWells;
 
-        double xmax = std::max(x1, std::max(x2, std::max(x3, x4)));
-        double ymax = std::max(y1, std::max(y2, std::max(y3, y4)));
+    if (env->GetArrayLength(corners) != 8 * numWells) {
+        return 2;
+    }
 
-        std::unique_ptr<const WellRectangle> wellRect(
-                new WellRectangle(label, 
-				static_cast<unsigned>(xmin), 
-				static_cast<unsigned>(ymin), 
-				static_cast<unsigned>(xmax - xmin), 
-				static_cast<unsigned>(ymax - ymin)));
+    std::vector<jdouble> allCorners(8 * numWells);
+    if (numWells > 0) {
+        env->GetDoubleArrayRegion(corners, 0, allCorners.size(), &allCorners[0]);
+        if (env->ExceptionCheck()) {
+            return 0;
+        }
+    }
 
-        VLOG(5) << *wellRect;
+    wellRects.reserve(numWells);
+    for (jsize i = 0; i < numWells; ++i) {
+        jstring labelJobj = static_cast<jstring>(env->GetObjectArrayElement(labels, i));
+        if (labelJobj == NULL) {
+            return 2;
+        }
 
-        wellRects.push_back(std::move(wellRect));
+        double wellCorners[8];
+        std::copy(allCorners.begin() + 8 * i, allCorners.begin() + 8 * (i + 1), wellCorners);
 
-        env->ReleaseStringUTFChars((jstring) labelJobj, label);
-        env->DeleteLocalRef(wellRectJavaObj);
+        const char * label = env->GetStringUTFChars(labelJobj, NULL);
+        wellRects.push_back(createWellRectangle(label, wellCorners));
+        env->ReleaseStringUTFChars(labelJobj, label);
+        env->DeleteLocalRef(labelJobj);
     }
     return 1;
 }
 
+/*
+ * Decodes the image once the wells have been converted by one of the
+ * getWellRectangles() functions, whose return code is passed in
+ * getWellsResult.
+ */
+jobject decodeImageWells(JNIEnv * env, int getWellsResult, jstring _filename,
+        const DecodeOptions & decodeOptions,
+        std::vector<std::unique_ptr<const WellRectangle> > & wellRects,
+        DmScanLib & dmScanLib) {
+    if (getWellsResult == 0) {
+        // got an exception when converting from JNI
+        return NULL;
+    } else if ((getWellsResult != 1) || (wellRects.size() == 0)) {
+        // invalid rects or zero rects passed from java
+        return createDecodeResultObject(env, SC_INVALID_NOTHING_TO_DECODE);
+    }
+
+    const char *filename = env->GetStringUTFChars(_filename, 0);
+    int result = dmScanLib.decodeImageWells(filename, decodeOptions, wellRects);
+    env->ReleaseStringUTFChars(_filename, filename);
+
+    jobject resultObj;
+    if (result == SC_SUCCESS) {
+        resultObj = createDecodeResultObject(env, result, dmScanLib.getDecodedWells());
+    } else {
+        resultObj = createDecodeResultObject(env, result);
+    }
+    setDecodeResultMetrics(env, resultObj, dmScanLib);
+    return resultObj;
+}
+
+/*
+ * Decodes the image with the wells of a layout registered by registerLayout.
+ */
+jobject decodeImageLayout(JNIEnv * env, jstring _filename,
+        const DecodeOptions & decodeOptions, jint layoutId, DmScanLib & dmScanLib) {
+    const char *filename = env->GetStringUTFChars(_filename, 0);
+    int result = dmScanLib.decodeImageLayout(filename, decodeOptions, layoutId);
+    env->ReleaseStringUTFChars(_filename, filename);
+
+    jobject resultObj;
+    if (result == SC_SUCCESS) {
+        resultObj = createDecodeResultObject(env, result, dmScanLib.getDecodedWells());
+    } else {
+        resultObj = createDecodeResultObject(env, result);
+    }
+    setDecodeResultMetrics(env, resultObj, dmScanLib);
+    return resultObj;
+}
+
 } /* namespace */
 
 } /* namespace */
 
+namespace dmscanlib {
+
+namespace jni {
+
+namespace {
+
+// open sessions by handle, handles are never reused
+std::map<jlong, std::shared_ptr<DmScanSession> > sessions;
+
+jlong nextSessionHandle = 1;
+
+OpenThreads::Mutex sessionsMutex;
+
+/*
+ * The session stays alive while the caller holds the returned pointer, even
+ * if another thread closes it in the meantime.
+ */
+std::shared_ptr<DmScanSession> getSession(jlong handle) {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(sessionsMutex);
+    std::map<jlong, std::shared_ptr<DmScanSession> >::iterator ii = sessions.find(handle);
+    if (ii == sessions.end()) {
+        return std::shared_ptr<DmScanSession>();
+    }
+    return ii->second;
+}
+
+/*
+ * A decode started by startDecode(). Everything the job uses is owned here,
+ * and the job is declared last so that it is cancelled and waited for before
+ * the rest is destroyed.
+ */
+struct AsyncDecode {
+    AsyncDecode(unsigned loggingLevel) :
+            dmScanLib(loggingLevel, false),
+            result(SC_FAIL)
+    {
+    }
+
+    DmScanLib dmScanLib;
+    std::unique_ptr<DecodeOptions> decodeOptions;
+    std::vector<std::unique_ptr<const WellRectangle> > wellRects;
+
+    // used when the job could not be started
+    int result;
+
+    std::unique_ptr<DecodeJob> job;
+};
+
+// decodes that have not been finished, by handle
+std::map<jlong, std::shared_ptr<AsyncDecode> > asyncDecodes;
+
+jlong nextDecodeHandle = 1;
+
+OpenThreads::Mutex asyncDecodesMutex;
+
+std::shared_ptr<AsyncDecode> getAsyncDecode(jlong handle, bool remove = false) {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(asyncDecodesMutex);
+    std::map<jlong, std::shared_ptr<AsyncDecode> >::iterator ii = asyncDecodes.find(handle);
+    if (ii == asyncDecodes.end()) {
+        return std::shared_ptr<AsyncDecode>();
+    }
+    std::shared_ptr<AsyncDecode> asyncDecode = ii->second;
+    if (remove) {
+        asyncDecodes.erase(ii);
+    }
+    return asyncDecode;
+}
+
+} /* namespace */
+
+} /* namespace */
+
+} /* namespace */
+
+/*
+ * Resolves the class and method IDs used by the library once, when the JVM
+ * loads it, instead of on every call.
+ */
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM * vm, void * reserved) {
+    JNIEnv * env;
+    if (vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_4) != JNI_OK) {
+        return JNI_ERR;
+    }
+    if (dmscanlib::jni::getJniIds(env) == NULL) {
+        // tried again on the first call, where the exception reaches Java
+        env->ExceptionClear();
+    }
+    return JNI_VERSION_1_4;
+}
+
 /*
  * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
  * Method:    decodeImage
@@ -188,30 +672,542 @@ JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_
 
     dmscanlib::DmScanLib::configLogging(static_cast<unsigned>(_verbose), false);
     std::unique_ptr<dmscanlib::DecodeOptions> decodeOptions =
-            dmscanlib::DecodeOptions::getDecodeOptionsViaJni(env, _decodeOptions);
+            dmscanlib::jni::getDecodeOptions(env, _decodeOptions);
+    if (decodeOptions.get() == NULL) {
+        return NULL;
+    }
+
     std::vector<std::unique_ptr<const dmscanlib::WellRectangle> > wellRects;
 
     jsize numWells = env->GetArrayLength(_wellRects);
     int result = dmscanlib::jni::getWellRectangles(env, numWells, _wellRects, wellRects);
 
-    if (result == 0) {
-        // got an exception when converting from JNI
+    dmscanlib::DmScanLib dmScanLib(1);
+    return dmscanlib::jni::decodeImageWells(env, result, _filename, *decodeOptions, wellRects,
+            dmScanLib);
+}
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    decodeImageBulk
+ * Signature: (JLjava/lang/String;Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeOptions;[Ljava/lang/String;[D)Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeResult;
+ *
+ * Same as decodeImage but the wells are passed as an array of labels and an
+ * array with the 4 corners (x, y pairs) of each well.
+ */
+JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_decodeImageBulk(
+        JNIEnv * env, jobject obj, jlong _verbose, jstring _filename,
+        jobject _decodeOptions, jobjectArray _labels, jdoubleArray _corners) {
+
+    if ((_filename == 0) || (_decodeOptions == 0) || (_labels == 0) || (_corners == 0)) {
+        return dmscanlib::jni::createDecodeResultObject(env, dmscanlib::SC_FAIL);
+    }
+
+    dmscanlib::DmScanLib::configLogging(static_cast<unsigned>(_verbose), false);
+    std::unique_ptr<dmscanlib::DecodeOptions> decodeOptions =
+            dmscanlib::jni::getDecodeOptions(env, _decodeOptions);
+    if (decodeOptions.get() == NULL) {
         return NULL;
-    } else if ((result != 1) || (wellRects.size() == 0)) {
-        // invalid rects or zero rects passed from java
-        return dmscanlib::jni::createDecodeResultObject(env,
-                dmscanlib::SC_INVALID_NOTHING_TO_DECODE);
     }
 
+    std::vector<std::unique_ptr<const dmscanlib::WellRectangle> > wellRects;
+    int result = dmscanlib::jni::getWellRectangles(env, _labels, _corners, wellRects);
+
     dmscanlib::DmScanLib dmScanLib(1);
+    return dmscanlib::jni::decodeImageWells(env, result, _filename, *decodeOptions, wellRects,
+            dmScanLib);
+}
 
-    const char *filename = env->GetStringUTFChars(_filename, 0);
-    result = dmScanLib.decodeImageWells(filename, *decodeOptions, wellRects);
-    env->ReleaseStringUTFChars(_filename, filename);
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    registerLayout
+ * Signature: ([Ljava/lang/String;[D)I
+ *
+ * The wells are given as in decodeImageBulk. Returns the layout's ID for the
+ * layout decode methods, or 0 when the wells are not valid.
+ */
+JNIEXPORT jint JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_registerLayout(
+        JNIEnv * env, jobject obj, jobjectArray _labels, jdoubleArray _corners) {
+    if ((_labels == 0) || (_corners == 0)) {
+        return 0;
+    }
+
+    std::vector<std::unique_ptr<const dmscanlib::WellRectangle> > wellRects;
+    int result = dmscanlib::jni::getWellRectangles(env, _labels, _corners, wellRects);
+    if ((result != 1) || (wellRects.size() == 0)) {
+        return 0;
+    }
+    return dmscanlib::DmScanLib::registerLayout(wellRects);
+}
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    unregisterLayout
+ * Signature: (I)V
+ */
+JNIEXPORT void JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_unregisterLayout(
+        JNIEnv * env, jobject obj, jint layoutId) {
+    dmscanlib::DmScanLib::unregisterLayout(layoutId);
+}
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    decodeImageLayout
+ * Signature: (JLjava/lang/String;Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeOptions;I)Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeResult;
+ *
+ * Same as decodeImage but with the wells of a registered layout. An unknown
+ * layout gives SC_INVALID_NOTHING_TO_DECODE.
+ */
+JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_decodeImageLayout(
+        JNIEnv * env, jobject obj, jlong _verbose, jstring _filename,
+        jobject _decodeOptions, jint layoutId) {
+
+    if ((_filename == 0) || (_decodeOptions == 0)) {
+        return dmscanlib::jni::createDecodeResultObject(env, dmscanlib::SC_FAIL);
+    }
+
+    dmscanlib::DmScanLib::configLogging(static_cast<unsigned>(_verbose), false);
+    std::unique_ptr<dmscanlib::DecodeOptions> decodeOptions =
+            dmscanlib::jni::getDecodeOptions(env, _decodeOptions);
+    if (decodeOptions.get() == NULL) {
+        return NULL;
+    }
+
+    dmscanlib::DmScanLib dmScanLib(1);
+    return dmscanlib::jni::decodeImageLayout(env, _filename, *decodeOptions, layoutId,
+            dmScanLib);
+}
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    scanAndDecodePlates
+ * Signature: (JJII[D[ILedu/ualberta/med/scannerconfig/dmscanlib/DecodeOptions;)[Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeResult;
+ *
+ * Scans the flatbed once and decodes every plate on it. Plate i is given by
+ * regions[4*i] to regions[4*i+3], its x, y, width and height in inches, and
+ * by the registered layout layoutIds[i]. Returns one result per plate. When
+ * the scan fails, every plate's result holds the scan's error code.
+ */
+JNIEXPORT jobjectArray JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_scanAndDecodePlates(
+        JNIEnv * env, jobject obj, jlong _verbose, jlong _dpi, jint _brightness,
+        jint _contrast, jdoubleArray _regions, jintArray _layoutIds,
+        jobject _decodeOptions) {
+    using namespace dmscanlib::jni;
+
+    if ((_dpi == 0) || (_regions == 0) || (_layoutIds == 0) || (_decodeOptions == 0)) {
+        return NULL;
+    }
+
+    const jsize numPlates = env->GetArrayLength(_layoutIds);
+    if ((numPlates < edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_MIN_PLATE_NUM)
+            || (numPlates > edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_MAX_PLATE_NUM)
+            || (env->GetArrayLength(_regions) != 4 * numPlates)) {
+        return NULL;
+    }
+
+    dmscanlib::DmScanLib::configLogging(static_cast<unsigned>(_verbose), false);
+    std::unique_ptr<dmscanlib::DecodeOptions> decodeOptions =
+            getDecodeOptions(env, _decodeOptions);
+    if (decodeOptions.get() == NULL) {
+        return NULL;
+    }
+
+    const JniIds * ids = getJniIds(env);
+    if (ids == NULL) {
+        return NULL;
+    }
+
+    std::vector<jdouble> coords(4 * numPlates);
+    std::vector<jint> layoutIds(numPlates);
+    env->GetDoubleArrayRegion(_regions, 0, 4 * numPlates, &coords[0]);
+    env->GetIntArrayRegion(_layoutIds, 0, numPlates, &layoutIds[0]);
+    if (env->ExceptionCheck()) {
+        return NULL;
+    }
+
+    std::vector<cv::Rect_<float> > regions;
+    for (jsize i = 0; i < numPlates; ++i) {
+        regions.push_back(cv::Rect_<float>(
+                static_cast<float>(coords[4 * i]),
+                static_cast<float>(coords[4 * i + 1]),
+                static_cast<float>(coords[4 * i + 2]),
+                static_cast<float>(coords[4 * i + 3])));
+    }
+
+    dmscanlib::DmScanLib dmScanLib(0);
+    int result = dmScanLib.scanAndDecodePlates(static_cast<unsigned>(_dpi), _brightness,
+            _contrast, regions, std::vector<int>(layoutIds.begin(), layoutIds.end()),
+            *decodeOptions);
+
+    jobjectArray resultArr = env->NewObjectArray(numPlates, ids->decodeResultClass, NULL);
+    if (resultArr == NULL) {
+        return NULL;
+    }
+
+    for (jsize i = 0; i < numPlates; ++i) {
+        jobject resultObj;
+        if (result != dmscanlib::SC_SUCCESS) {
+            resultObj = createDecodeResultObject(env, result);
+        } else if (dmScanLib.getPlateResult(i) == dmscanlib::SC_SUCCESS) {
+            resultObj = createDecodeResultObject(env, dmscanlib::SC_SUCCESS,
+                    dmScanLib.getDecodedWells(i));
+        } else {
+            resultObj = createDecodeResultObject(env, dmScanLib.getPlateResult(i));
+        }
+        env->SetObjectArrayElement(resultArr, i, resultObj);
+        env->DeleteLocalRef(resultObj);
+    }
+    return resultArr;
+}
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    setMetricsEnabled
+ * Signature: (Z)V
+ */
+JNIEXPORT void JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_setMetricsEnabled(
+        JNIEnv * env, jobject obj, jboolean enabled) {
+    dmscanlib::DmScanLib::setMetricsEnabled(enabled == JNI_TRUE);
+}
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    setLocateTubes
+ * Signature: (Z)V
+ */
+JNIEXPORT void JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_setLocateTubes(
+        JNIEnv * env, jobject obj, jboolean enabled) {
+    dmscanlib::DmScanLib::setLocateTubes(enabled == JNI_TRUE);
+}
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    setRefitGrid
+ * Signature: (Z)V
+ */
+JNIEXPORT void JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_setRefitGrid(
+        JNIEnv * env, jobject obj, jboolean enabled) {
+    dmscanlib::DmScanLib::setRefitGrid(enabled == JNI_TRUE);
+}
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    setRescanDpi
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_setRescanDpi(
+        JNIEnv * env, jobject obj, jlong dpi) {
+    dmscanlib::DmScanLib::setRescanDpi((dpi > 0) ? static_cast<unsigned>(dpi) : 0);
+}
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    setAutoTune
+ * Signature: (Ljava/lang/String;)V
+ *
+ * A null or empty filename disables tuning.
+ */
+JNIEXPORT void JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_setAutoTune(
+        JNIEnv * env, jobject obj, jstring _stateFilename) {
+    std::string stateFilename;
+    if (_stateFilename != NULL) {
+        const char * filename = env->GetStringUTFChars(_stateFilename, 0);
+        stateFilename = filename;
+        env->ReleaseStringUTFChars(_stateFilename, filename);
+    }
+    dmscanlib::DmScanLib::setAutoTune(stateFilename);
+}
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    setDecodeCache
+ * Signature: (JLjava/lang/String;)V
+ *
+ * A maxEntries of 0 disables the cache. With a null or empty directory the
+ * results are only kept in memory.
+ */
+JNIEXPORT void JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_setDecodeCache(
+        JNIEnv * env, jobject obj, jlong maxEntries, jstring _directory) {
+    std::string directory;
+    if (_directory != NULL) {
+        const char * dir = env->GetStringUTFChars(_directory, 0);
+        directory = dir;
+        env->ReleaseStringUTFChars(_directory, dir);
+    }
+    dmscanlib::DmScanLib::setDecodeCache(
+            static_cast<unsigned>(std::max(maxEntries, static_cast<jlong>(0))), directory);
+}
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    openSession
+ * Signature: (JJ)J
+ *
+ * Returns a handle to pass to the session methods, 0 on failure. A numThreads
+ * of 0 uses the default number of decoding threads.
+ */
+JNIEXPORT jlong JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_openSession(
+        JNIEnv * env, jobject obj, jlong _verbose, jlong _numThreads) {
+    using namespace dmscanlib::jni;
+
+    std::shared_ptr<dmscanlib::DmScanSession> session(new dmscanlib::DmScanSession(
+            static_cast<unsigned>(_verbose),
+            static_cast<unsigned>(std::max(_numThreads, static_cast<jlong>(0)))));
 
-    if (result == dmscanlib::SC_SUCCESS) {
-        return dmscanlib::jni::createDecodeResultObject(env, result, dmScanLib.getDecodedWells());
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(sessionsMutex);
+    jlong handle = nextSessionHandle++;
+    sessions[handle] = session;
+    return handle;
+}
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    closeSession
+ * Signature: (J)V
+ *
+ * A decode in progress on another thread finishes before the session is
+ * destroyed.
+ */
+JNIEXPORT void JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_closeSession(
+        JNIEnv * env, jobject obj, jlong handle) {
+    using namespace dmscanlib::jni;
+
+    std::shared_ptr<dmscanlib::DmScanSession> session;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(sessionsMutex);
+        std::map<jlong, std::shared_ptr<dmscanlib::DmScanSession> >::iterator ii =
+                sessions.find(handle);
+        if (ii == sessions.end()) {
+            return;
+        }
+        session = ii->second;
+        sessions.erase(ii);
+    }
+    // the session's threads are joined here, outside the lock, unless a
+    // decode still holds a reference
+    session.reset();
+}
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    sessionDecodeImage
+ * Signature: (JLjava/lang/String;Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeOptions;[Ledu/ualberta/med/scannerconfig/dmscanlib/Well;)Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeResult;
+ */
+JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_sessionDecodeImage(
+        JNIEnv * env, jobject obj, jlong handle, jstring _filename,
+        jobject _decodeOptions, jobjectArray _wellRects) {
+    std::shared_ptr<dmscanlib::DmScanSession> session = dmscanlib::jni::getSession(handle);
+
+    if ((session.get() == NULL) || (_filename == 0) || (_decodeOptions == 0)
+            || (_wellRects == 0)) {
+        return dmscanlib::jni::createDecodeResultObject(env, dmscanlib::SC_FAIL);
+    }
+
+    std::unique_ptr<dmscanlib::DecodeOptions> decodeOptions =
+            dmscanlib::jni::getDecodeOptions(env, _decodeOptions);
+    if (decodeOptions.get() == NULL) {
+        return NULL;
+    }
+
+    std::vector<std::unique_ptr<const dmscanlib::WellRectangle> > wellRects;
+    jsize numWells = env->GetArrayLength(_wellRects);
+    int result = dmscanlib::jni::getWellRectangles(env, numWells, _wellRects, wellRects);
+
+    dmscanlib::DmScanSession::Access access(*session);
+    return dmscanlib::jni::decodeImageWells(env, result, _filename, *decodeOptions, wellRects,
+            access.getScanLib());
+}
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    sessionDecodeImageBulk
+ * Signature: (JLjava/lang/String;Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeOptions;[Ljava/lang/String;[D)Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeResult;
+ */
+JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_sessionDecodeImageBulk(
+        JNIEnv * env, jobject obj, jlong handle, jstring _filename,
+        jobject _decodeOptions, jobjectArray _labels, jdoubleArray _corners) {
+    std::shared_ptr<dmscanlib::DmScanSession> session = dmscanlib::jni::getSession(handle);
+
+    if ((session.get() == NULL) || (_filename == 0) || (_decodeOptions == 0)
+            || (_labels == 0) || (_corners == 0)) {
+        return dmscanlib::jni::createDecodeResultObject(env, dmscanlib::SC_FAIL);
+    }
+
+    std::unique_ptr<dmscanlib::DecodeOptions> decodeOptions =
+            dmscanlib::jni::getDecodeOptions(env, _decodeOptions);
+    if (decodeOptions.get() == NULL) {
+        return NULL;
     }
-    return dmscanlib::jni::createDecodeResultObject(env, result);
+
+    std::vector<std::unique_ptr<const dmscanlib::WellRectangle> > wellRects;
+    int result = dmscanlib::jni::getWellRectangles(env, _labels, _corners, wellRects);
+
+    dmscanlib::DmScanSession::Access access(*session);
+    return dmscanlib::jni::decodeImageWells(env, result, _filename, *decodeOptions, wellRects,
+            access.getScanLib());
 }
 
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    sessionDecodeImageLayout
+ * Signature: (JLjava/lang/String;Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeOptions;I)Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeResult;
+ */
+JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_sessionDecodeImageLayout(
+        JNIEnv * env, jobject obj, jlong handle, jstring _filename,
+        jobject _decodeOptions, jint layoutId) {
+    std::shared_ptr<dmscanlib::DmScanSession> session = dmscanlib::jni::getSession(handle);
+
+    if ((session.get() == NULL) || (_filename == 0) || (_decodeOptions == 0)) {
+        return dmscanlib::jni::createDecodeResultObject(env, dmscanlib::SC_FAIL);
+    }
+
+    std::unique_ptr<dmscanlib::DecodeOptions> decodeOptions =
+            dmscanlib::jni::getDecodeOptions(env, _decodeOptions);
+    if (decodeOptions.get() == NULL) {
+        return NULL;
+    }
+
+    dmscanlib::DmScanSession::Access access(*session);
+    return dmscanlib::jni::decodeImageLayout(env, _filename, *decodeOptions, layoutId,
+            access.getScanLib());
+}
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    startDecode
+ * Signature: (JLjava/lang/String;Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeOptions;[Ledu/ualberta/med/scannerconfig/dmscanlib/Well;)J
+ *
+ * Starts decoding the image on a background thread and returns a handle for
+ * pollDecode(), cancelDecode() and finishDecode(), or 0 if a Java exception
+ * was raised. Every handle returned must be passed to finishDecode().
+ */
+JNIEXPORT jlong JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_startDecode(
+        JNIEnv * env, jobject obj, jlong _verbose, jstring _filename,
+        jobject _decodeOptions, jobjectArray _wellRects) {
+    using namespace dmscanlib::jni;
+
+    std::shared_ptr<AsyncDecode> asyncDecode(new AsyncDecode(static_cast<unsigned>(_verbose)));
+
+    if ((_filename != 0) && (_decodeOptions != 0) && (_wellRects != 0)) {
+        asyncDecode->decodeOptions = getDecodeOptions(env, _decodeOptions);
+        if (asyncDecode->decodeOptions.get() == NULL) {
+            return 0;
+        }
+
+        jsize numWells = env->GetArrayLength(_wellRects);
+        int result = getWellRectangles(env, numWells, _wellRects, asyncDecode->wellRects);
+        if (result == 0) {
+            // got an exception when converting from JNI
+            return 0;
+        } else if ((result != 1) || asyncDecode->wellRects.empty()) {
+            asyncDecode->result = dmscanlib::SC_INVALID_NOTHING_TO_DECODE;
+        } else {
+            const char *filename = env->GetStringUTFChars(_filename, 0);
+            asyncDecode->job = std::unique_ptr<dmscanlib::DecodeJob>(new dmscanlib::DecodeJob(
+                    asyncDecode->dmScanLib, filename, *asyncDecode->decodeOptions,
+                    asyncDecode->wellRects));
+            env->ReleaseStringUTFChars(_filename, filename);
+        }
+    }
+
+    // invalid arguments still get a handle, finishDecode() reports the error
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(asyncDecodesMutex);
+    jlong handle = nextDecodeHandle++;
+    asyncDecodes[handle] = asyncDecode;
+    return handle;
+}
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    pollDecode
+ * Signature: (J)[Ljava/lang/String;
+ *
+ * Returns the wells decoded since the last call as label and message pairs,
+ * {label0, message0, label1, message1, ...}, without waiting. The array is
+ * empty when no new well has been decoded, and null for an unknown handle.
+ */
+JNIEXPORT jobjectArray JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_pollDecode(
+        JNIEnv * env, jobject obj, jlong handle) {
+    using namespace dmscanlib::jni;
+
+    std::shared_ptr<AsyncDecode> asyncDecode = getAsyncDecode(handle);
+    if (asyncDecode.get() == NULL) {
+        return NULL;
+    }
+
+    std::vector<dmscanlib::DecodeJob::WellResult> results;
+    if (asyncDecode->job.get() != NULL) {
+        asyncDecode->job->poll(results);
+    }
+
+    const JniIds * ids = getJniIds(env);
+    if (ids == NULL) {
+        return NULL;
+    }
+
+    const jsize numResults = static_cast<jsize>(results.size());
+    jobjectArray resultArr = env->NewObjectArray(2 * numResults, ids->stringClass, NULL);
+    if (resultArr == NULL) {
+        return NULL;
+    }
+
+    for (jsize i = 0; i < numResults; ++i) {
+        jstring label = env->NewStringUTF(results[i].first.c_str());
+        jstring message = env->NewStringUTF(results[i].second.c_str());
+        env->SetObjectArrayElement(resultArr, 2 * i, label);
+        env->SetObjectArrayElement(resultArr, 2 * i + 1, message);
+        env->DeleteLocalRef(label);
+        env->DeleteLocalRef(message);
+    }
+    return resultArr;
+}
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    cancelDecode
+ * Signature: (J)V
+ *
+ * Returns straight away. The wells already decoded stay available.
+ */
+JNIEXPORT void JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_cancelDecode(
+        JNIEnv * env, jobject obj, jlong handle) {
+    std::shared_ptr<dmscanlib::jni::AsyncDecode> asyncDecode =
+            dmscanlib::jni::getAsyncDecode(handle);
+    if ((asyncDecode.get() != NULL) && (asyncDecode->job.get() != NULL)) {
+        asyncDecode->job->cancel();
+    }
+}
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    finishDecode
+ * Signature: (J)Ledu/ualberta/med/scannerconfig/dmscanlib/DecodeResult;
+ *
+ * Waits for the decode to end, returns the same result as decodeImage() and
+ * releases the handle. A cancelled decode returns SC_DECODE_CANCELLED along
+ * with the wells decoded before the cancel.
+ */
+JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_finishDecode(
+        JNIEnv * env, jobject obj, jlong handle) {
+    using namespace dmscanlib::jni;
+
+    std::shared_ptr<AsyncDecode> asyncDecode = getAsyncDecode(handle, true);
+    if (asyncDecode.get() == NULL) {
+        return createDecodeResultObject(env, dmscanlib::SC_FAIL);
+    }
+    if (asyncDecode->job.get() == NULL) {
+        return createDecodeResultObject(env, asyncDecode->result);
+    }
+
+    int result = asyncDecode->job->wait();
+    dmscanlib::DmScanLib & dmScanLib = asyncDecode->dmScanLib;
+
+    jobject resultObj;
+    if ((result == dmscanlib::SC_SUCCESS) || (result == dmscanlib::SC_DECODE_CANCELLED)) {
+        resultObj = createDecodeResultObject(env, result, dmScanLib.getDecodedWells());
+    } else {
+        resultObj = createDecodeResultObject(env, result);
+    }
+    setDecodeResultMetrics(env, resultObj, dmScanLib);
+    return resultObj;
+}
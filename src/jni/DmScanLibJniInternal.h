@@ -20,10 +20,48 @@
 
 namespace dmscanlib {
 
+class DmScanLib;
 class WellDecoder;
+class DecodeOptions;
 
 namespace jni {
 
+// indexes of the DecodeOptions getters in JniIds
+enum DecodeOptionGetter {
+    MIN_EDGE_FACTOR,
+    MAX_EDGE_FACTOR,
+    SCAN_GAP_FACTOR,
+    SQUARE_DEV,
+    EDGE_THRESH,
+    CORRECTIONS,
+    SHRINK,
+    DECODE_OPTION_MAX
+};
+
+/*
+ * Class and method IDs resolved once, by JNI_OnLoad(). The classes are global
+ * references. Methods that older versions of the Java classes do not have
+ * are NULL.
+ */
+struct JniIds {
+    jclass stringClass;
+    jclass scanLibResultClass;
+    jclass decodeResultClass;
+    jclass decodeOptionsClass;
+    jmethodID scanLibResultInit;
+    jmethodID decodeResultInit;
+    jmethodID decodeResultAddWell;
+    jmethodID decodeResultSetWells;
+    jmethodID decodeResultSetMetrics;
+    jmethodID decodeResultAddWellMetrics;
+    jmethodID decodeResultSetWellMetrics;
+    jmethodID decodeOptionsGetters[DECODE_OPTION_MAX];
+    jmethodID decodeOptionsGetCascade;
+};
+
+// returns NULL, with a Java exception pending, if a class or method is missing
+const JniIds * getJniIds(JNIEnv * env);
+
 void getResultCodeMsg(int resultCode, std::string & message);
 
 jobject createScanResultObject(JNIEnv * env, int resultCode, int value);
@@ -33,11 +71,23 @@ jobject createDecodeResultObject(JNIEnv * env, int resultCode);
 jobject createDecodeResultObject(JNIEnv * env, int resultCode,
         const std::map<std::string, const WellDecoder *> & wellDecoders);
 
+void setDecodeResultMetrics(JNIEnv * env, jobject resultObj, const DmScanLib & dmScanLib);
+
 std::unique_ptr<const cv::Rect> getBoundingBox(JNIEnv *env, jobject bboxJavaObj);
 
+std::unique_ptr<DecodeOptions> getDecodeOptions(JNIEnv * env, jobject decodeOptionsObj);
+
 int getWellRectangles(JNIEnv *env, jsize numWells, jobjectArray _wellRects,
         std::vector<std::unique_ptr<const WellRectangle> > & wellRects);
 
+int getWellRectangles(JNIEnv *env, jobjectArray labels, jdoubleArray corners,
+        std::vector<std::unique_ptr<const WellRectangle> > & wellRects);
+
+jobject decodeImageWells(JNIEnv * env, int getWellsResult, jstring filename,
+        const DecodeOptions & decodeOptions,
+        std::vector<std::unique_ptr<const WellRectangle> > & wellRects,
+        DmScanLib & dmScanLib);
+
 } /* namespace */
 
 } /* namespace */
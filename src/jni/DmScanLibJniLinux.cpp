@@ -5,7 +5,10 @@
 #include "DmScanLibJni.h"
 #include "DmScanLibJniInternal.h"
 #include "DmScanLib.h"
+#include "decoder/DecodeOptions.h"
+#include "imgscanner/ImgScannerSimulator.h"
 
+#include <algorithm>
 #include <iostream>
 
 namespace dmscanlib {
@@ -33,6 +36,9 @@ void getResultCodeMsg(int resultCode, std::string & message) {
     case SC_INVALID_NOTHING_TO_DECODE:
         message = "No wells to decode.";
         break;
+    case SC_DECODE_CANCELLED:
+        message = "Decode cancelled.";
+        break;
     case SC_FAIL:
         default:
         message = "undefined error";
@@ -48,11 +54,15 @@ void getResultCodeMsg(int resultCode, std::string & message) {
  * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
  * Method:    slSelectSourceAsDefault
  * Signature: ()Ledu/ualberta/med/scannerconfig/dmscanlib/ScanLibResult;
+ *
+ * Scanning goes through the scanner simulator, see setScannerSimulator.
  */
 JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_selectSourceAsDefault(
         JNIEnv * env,
         jobject obj) {
-    return dmscanlib::jni::createScanResultObject(env, dmscanlib::SC_FAIL, dmscanlib::SC_FAIL);
+    dmscanlib::DmScanLib dmScanLib;
+    int result = dmScanLib.selectSourceAsDefault();
+    return dmscanlib::jni::createScanResultObject(env, result, result);
 }
 
 /*
@@ -62,7 +72,9 @@ JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_
  */
 JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_getScannerCapability(
         JNIEnv * env, jobject obj) {
-    return dmscanlib::jni::createScanResultObject(env, dmscanlib::SC_FAIL, dmscanlib::SC_FAIL);
+    dmscanlib::DmScanLib dmScanLib;
+    int result = dmScanLib.getScannerCapability();
+    return dmscanlib::jni::createScanResultObject(env, dmscanlib::SC_SUCCESS, result);
 }
 
 /*
@@ -82,7 +94,25 @@ JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_
         jdouble width,
         jdouble height,
         jstring _filename) {
-    return dmscanlib::jni::createScanResultObject(env, dmscanlib::SC_FAIL, dmscanlib::SC_FAIL);
+
+    if ((_dpi == 0) || (_filename == 0)) {
+        return dmscanlib::jni::createScanResultObject(env, dmscanlib::SC_FAIL, dmscanlib::SC_FAIL);
+    }
+
+    const char *filename = env->GetStringUTFChars(_filename, 0);
+
+    dmscanlib::DmScanLib dmScanLib(static_cast<unsigned>(_verbose), false);
+    int result = dmScanLib.scanImage(
+            static_cast<unsigned>(_dpi),
+            _brightness,
+            _contrast,
+            static_cast<float>(x),
+            static_cast<float>(y),
+            static_cast<float>(width),
+            static_cast<float>(height),
+            filename);
+    env->ReleaseStringUTFChars(_filename, filename);
+    return dmscanlib::jni::createScanResultObject(env, result, result);
 }
 
 /*
@@ -98,7 +128,18 @@ JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_
         jint _brightness,
         jint _contrast,
         jstring _filename) {
-    return dmscanlib::jni::createScanResultObject(env, dmscanlib::SC_FAIL, dmscanlib::SC_FAIL);
+
+    if ((_dpi == 0) || (_filename == 0)) {
+        return dmscanlib::jni::createScanResultObject(env, dmscanlib::SC_FAIL, dmscanlib::SC_FAIL);
+    }
+
+    const char *filename = env->GetStringUTFChars(_filename, 0);
+
+    dmscanlib::DmScanLib dmScanLib(static_cast<unsigned>(_verbose), false);
+    int result = dmScanLib.scanFlatbed(
+            static_cast<unsigned>(_dpi), _brightness, _contrast, filename);
+    env->ReleaseStringUTFChars(_filename, filename);
+    return dmscanlib::jni::createScanResultObject(env, result, result);
 }
 
 /*
@@ -119,5 +160,87 @@ JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_
         jdouble height,
         jobject _decodeOptions,
         jobjectArray _wellRects) {
-    return dmscanlib::jni::createScanResultObject(env, dmscanlib::SC_FAIL, dmscanlib::SC_FAIL);
+
+    if ((_dpi == 0) || (_decodeOptions == 0) || (_wellRects == 0)) {
+        return dmscanlib::jni::createDecodeResultObject(env, dmscanlib::SC_FAIL);
+    }
+
+    dmscanlib::DmScanLib::configLogging(static_cast<unsigned>(_verbose), false);
+
+    std::unique_ptr<dmscanlib::DecodeOptions> decodeOptions =
+            dmscanlib::jni::getDecodeOptions(env, _decodeOptions);
+    if (decodeOptions.get() == NULL) {
+        return NULL;
+    }
+
+    std::vector<std::unique_ptr<const dmscanlib::WellRectangle> > wellRects;
+    jsize numWells = env->GetArrayLength(_wellRects);
+    int result = dmscanlib::jni::getWellRectangles(env, numWells, _wellRects, wellRects);
+
+    if (result == 0) {
+        // got an exception when converting from JNI
+        return NULL;
+    } else if ((result != 1) || (wellRects.size() == 0)) {
+        // invalid rects or zero rects passed from java
+        return dmscanlib::jni::createDecodeResultObject(
+                env, dmscanlib::SC_INVALID_NOTHING_TO_DECODE);
+    }
+
+    dmscanlib::DmScanLib dmScanLib(0);
+    result = dmScanLib.scanAndDecode(
+            static_cast<unsigned>(_dpi),
+            _brightness,
+            _contrast,
+            static_cast<float>(x),
+            static_cast<float>(y),
+            static_cast<float>(width),
+            static_cast<float>(height),
+            *decodeOptions,
+            wellRects);
+
+    jobject resultObj;
+    if (result == dmscanlib::SC_SUCCESS) {
+        resultObj = dmscanlib::jni::createDecodeResultObject(
+                env, result, dmScanLib.getDecodedWells());
+    } else {
+        resultObj = dmscanlib::jni::createDecodeResultObject(env, result);
+    }
+    dmscanlib::jni::setDecodeResultMetrics(env, resultObj, dmScanLib);
+    return resultObj;
+}
+
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    setScannerSimulator
+ * Signature: (Ljava/lang/String;ZJDJD)V
+ *
+ * Configures the scanner simulator used by the scan methods. The source is
+ * an image file or a directory of images; with a null or empty source and
+ * synthetic set, an empty flatbed is scanned. Otherwise scanning is
+ * unavailable. Each scan waits startSeconds and then bandSeconds for every
+ * bandRows rows.
+ */
+JNIEXPORT void JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_setScannerSimulator(
+        JNIEnv * env,
+        jobject obj,
+        jstring _source,
+        jboolean synthetic,
+        jlong sourceDpi,
+        jdouble startSeconds,
+        jlong bandRows,
+        jdouble bandSeconds) {
+    dmscanlib::imgscanner::SimulatorOptions options;
+    if (_source != NULL) {
+        const char * source = env->GetStringUTFChars(_source, 0);
+        options.source = source;
+        env->ReleaseStringUTFChars(_source, source);
+    }
+    options.synthetic = (synthetic == JNI_TRUE);
+    if (sourceDpi > 0) {
+        options.sourceDpi = static_cast<unsigned>(sourceDpi);
+    }
+    options.startSeconds = std::max(startSeconds, 0.0);
+    options.bandRows = static_cast<unsigned>(std::max(bandRows, static_cast<jlong>(0)));
+    options.bandSeconds = std::max(bandSeconds, 0.0);
+    dmscanlib::imgscanner::ImgScannerSimulator::setOptions(options);
 }
@@ -42,6 +42,9 @@ void getResultCodeMsg(int resultCode, std::string & message) {
 	case SC_INCORRECT_DPI_SCANNED:
 		message = "incorrect DPI on scanned image";
 		break;
+	case SC_DECODE_CANCELLED:
+		message = "decode cancelled";
+		break;
 	default:
 		message = "undefined error";
 		break;
@@ -182,7 +185,10 @@ JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_
     std::vector<std::unique_ptr<const dmscanlib::WellRectangle> > wellRects;
 
     std::unique_ptr<dmscanlib::DecodeOptions> decodeOptions = 
-		dmscanlib::DecodeOptions::getDecodeOptionsViaJni(env, _decodeOptions);
+		dmscanlib::jni::getDecodeOptions(env, _decodeOptions);
+	if (decodeOptions.get() == NULL) {
+		return NULL;
+	}
 
 	jsize numWells = env->GetArrayLength(_wellRects);
 	int result = dmscanlib::jni::getWellRectangles(env, numWells, _wellRects, wellRects);
@@ -207,10 +213,24 @@ JNIEXPORT jobject JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_
 		*decodeOptions, 
 		wellRects);
 
+	jobject resultObj;
 	if (result == dmscanlib::SC_SUCCESS) {
-		return dmscanlib::jni::createDecodeResultObject(env,result, dmScanLib.getDecodedWells());
+		resultObj = dmscanlib::jni::createDecodeResultObject(env,result, dmScanLib.getDecodedWells());
+	} else {
+		resultObj = dmscanlib::jni::createDecodeResultObject(env, result);
 	}
-	return dmscanlib::jni::createDecodeResultObject(env, result);
+	dmscanlib::jni::setDecodeResultMetrics(env, resultObj, dmScanLib);
+	return resultObj;
 }
 
-
+/*
+ * Class:     edu_ualberta_med_scannerconfig_dmscanlib_ScanLib
+ * Method:    setScannerSimulator
+ * Signature: (Ljava/lang/String;ZJDJD)V
+ *
+ * Does nothing, scans always use the TWAIN driver on Windows.
+ */
+JNIEXPORT void JNICALL Java_edu_ualberta_med_scannerconfig_dmscanlib_ScanLib_setScannerSimulator(
+        JNIEnv * env, jobject obj, jstring _source, jboolean synthetic, jlong sourceDpi,
+        jdouble startSeconds, jlong bandRows, jdouble bandSeconds) {
+}
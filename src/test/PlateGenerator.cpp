@@ -0,0 +1,259 @@
+/*
+ * PlateGenerator.cpp
+ *
+ * Renders images of plates of tubes with known barcodes.
+ */
+
+#include "PlateGenerator.h"
+
+#define GLOG_NO_ABBREVIATED_SEVERITIES
+#include <glog/logging.h>
+
+#include <dmtx.h>
+#include <math.h>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+namespace dmscanlib {
+
+namespace test {
+
+const unsigned char PlateGenerator::RACK_GREY = 40;
+const unsigned char PlateGenerator::HOLE_GREY = 15;
+const unsigned char PlateGenerator::TUBE_GREY = 210;
+
+namespace {
+
+const double MM_PER_INCH = 25.4;
+
+} /* namespace */
+
+/*
+ * A 96 well plate scanned at 600 DPI, with symbols small enough for the
+ * default maximum edge factor of the decoder.
+ */
+PlateOptions::PlateOptions() :
+        rows(8),
+        cols(12),
+        dpi(600),
+        pitchMm(9.0),
+        tubeFraction(0.8),
+        symbolMm(2.4),
+        digits(10),
+        maxRotation(45.0),
+        emptyFraction(0.05),
+        blurSigma(0.8),
+        noiseSigma(4.0),
+        contrast(150),
+        orientation(LANDSCAPE),
+        barcodePosition(TUBE_BOTTOMS)
+{
+}
+
+std::ostream & operator<<(std::ostream & os, const PlateOptions & m) {
+    os << "rows/" << m.rows
+            << " cols/" << m.cols
+            << " dpi/" << m.dpi
+            << " pitchMm/" << m.pitchMm
+            << " tubeFraction/" << m.tubeFraction
+            << " symbolMm/" << m.symbolMm
+            << " digits/" << m.digits
+            << " maxRotation/" << m.maxRotation
+            << " emptyFraction/" << m.emptyFraction
+            << " blurSigma/" << m.blurSigma
+            << " noiseSigma/" << m.noiseSigma
+            << " contrast/" << m.contrast
+            << " orientation/" << m.orientation
+            << " barcodePosition/" << m.barcodePosition;
+    return os;
+}
+
+PlateGenerator::PlateGenerator(const PlateOptions & _options) :
+        options(_options),
+        pixelsPerMm(_options.dpi / MM_PER_INCH)
+{
+    if ((options.rows == 0) || (options.cols == 0) || (options.dpi == 0)
+            || (options.digits == 0)) {
+        throw std::invalid_argument("plate has no wells or symbols are empty");
+    }
+
+    // the corners of a symbol at 45 degrees must stay on the tube
+    if (options.symbolMm * sqrt(2.0) > options.tubeFraction * options.pitchMm) {
+        throw std::invalid_argument("symbol does not fit on the tube bottom");
+    }
+    VLOG(3) << "PlateGenerator: " << options;
+}
+
+PlateGenerator::~PlateGenerator() {
+}
+
+/*
+ * Returns the symbol's modules, one pixel each, with 255 for a dark module.
+ * Row 0 is the top row of the symbol.
+ */
+bool PlateGenerator::encode(const std::string & message, cv::Mat & modules) {
+    DmtxEncode * enc = dmtxEncodeCreate();
+    if (enc == NULL) {
+        return false;
+    }
+
+    dmtxEncodeSetProp(enc, DmtxPropModuleSize, 1);
+    dmtxEncodeSetProp(enc, DmtxPropMarginSize, 0);
+
+    std::string data(message);
+    if (dmtxEncodeDataMatrix(enc, static_cast<int>(data.size()),
+            reinterpret_cast<unsigned char *>(&data[0])) == DmtxFail) {
+        dmtxEncodeDestroy(&enc);
+        return false;
+    }
+
+    const int width = dmtxImageGetProp(enc->image, DmtxPropWidth);
+    const int height = dmtxImageGetProp(enc->image, DmtxPropHeight);
+    modules.create(height, width, CV_8UC1);
+
+    // libdmtx counts image rows from the bottom
+    for (int y = 0; y < height; ++y) {
+        unsigned char * row = modules.ptr<unsigned char>(height - 1 - y);
+        for (int x = 0; x < width; ++x) {
+            int value;
+            dmtxImageGetPixelValue(enc->image, x, y, 0, &value);
+            row[x] = (value == 0) ? 255 : 0;
+        }
+    }
+
+    dmtxEncodeDestroy(&enc);
+    return true;
+}
+
+/*
+ * The modules are scaled up to whole pixels first so that their edges stay
+ * sharp, then rotated about the tube's centre. The ink darkens the tube by
+ * up to the contrast.
+ */
+void PlateGenerator::drawSymbol(cv::Mat & gray, const cv::Point2f & centre,
+        const std::string & message, double angle) const {
+    cv::Mat modules;
+    if (!encode(message, modules)) {
+        throw std::logic_error("could not encode message: " + message);
+    }
+
+    const double symbolPixels = options.symbolMm * pixelsPerMm;
+    const int upscale = std::max(1, static_cast<int>(symbolPixels / modules.cols));
+    cv::Mat symbol;
+    cv::resize(modules, symbol, cv::Size(), upscale, upscale, cv::INTER_NEAREST);
+
+    cv::Mat transform = cv::getRotationMatrix2D(
+            cv::Point2f(symbol.cols * 0.5f, symbol.rows * 0.5f),
+            angle,
+            symbolPixels / symbol.cols);
+    transform.at<double>(0, 2) += centre.x - symbol.cols * 0.5;
+    transform.at<double>(1, 2) += centre.y - symbol.rows * 0.5;
+
+    cv::Mat ink;
+    cv::warpAffine(symbol, ink, transform, gray.size(), cv::INTER_LINEAR,
+            cv::BORDER_CONSTANT, cv::Scalar(0));
+
+    cv::Mat shade;
+    ink.convertTo(shade, CV_8UC1, options.contrast / 255.0);
+    cv::subtract(gray, shade, gray);
+}
+
+void PlateGenerator::generate(unsigned seed, GeneratedPlate & plate) const {
+    const double pitch = options.pitchMm * pixelsPerMm;
+    const int margin = static_cast<int>(pitch / 4);
+    const int bboxWidth = static_cast<int>(options.cols * pitch);
+    const int bboxHeight = static_cast<int>(options.rows * pitch);
+
+    cv::Mat gray(bboxHeight + 2 * margin, bboxWidth + 2 * margin, CV_8UC1,
+            cv::Scalar(RACK_GREY));
+    plate.boundingBox = cv::Rect(margin, margin, bboxWidth, bboxHeight);
+    plate.messages.clear();
+
+    cv::RNG rng(seed);
+    std::set<std::string> used;
+    const int tubeRadius = static_cast<int>(options.tubeFraction * pitch / 2);
+    const int holeRadius = static_cast<int>(0.45 * pitch);
+
+    for (unsigned row = 0; row < options.rows; ++row) {
+        for (unsigned col = 0; col < options.cols; ++col) {
+            const cv::Point2f centre(
+                    static_cast<float>(margin + (col + 0.5) * pitch),
+                    static_cast<float>(margin + (row + 0.5) * pitch));
+            const cv::Point centrePixel(cvRound(centre.x), cvRound(centre.y));
+
+            std::string label;
+            DmScanLib::getLabelForPosition(row, col, options.rows, options.cols,
+                    options.orientation, options.barcodePosition, label);
+
+            cv::circle(gray, centrePixel, holeRadius, cv::Scalar(HOLE_GREY), -1, CV_AA);
+
+            if (rng.uniform(0.0, 1.0) < options.emptyFraction) {
+                plate.messages[label] = "";
+                continue;
+            }
+
+            std::string message;
+            do {
+                std::ostringstream digits;
+                for (unsigned i = 0; i < options.digits; ++i) {
+                    digits << rng.uniform(0, 10);
+                }
+                message = digits.str();
+            } while (!used.insert(message).second);
+
+            cv::circle(gray, centrePixel, tubeRadius, cv::Scalar(TUBE_GREY), -1, CV_AA);
+            drawSymbol(gray, centre, message,
+                    rng.uniform(-options.maxRotation, options.maxRotation));
+            plate.messages[label] = message;
+        }
+    }
+
+    if (options.blurSigma > 0) {
+        cv::GaussianBlur(gray, gray, cv::Size(), options.blurSigma);
+    }
+
+    if (options.noiseSigma > 0) {
+        cv::Mat noise(gray.size(), CV_16SC1);
+        rng.fill(noise, cv::RNG::NORMAL, cv::Scalar(0), cv::Scalar(options.noiseSigma));
+
+        cv::Mat noisy;
+        gray.convertTo(noisy, CV_16SC1);
+        noisy += noise;
+        noisy.convertTo(gray, CV_8UC1);
+    }
+
+    cv::cvtColor(gray, plate.image, CV_GRAY2BGR);
+    VLOG(3) << "generate: seed/" << seed << " size/" << plate.image.size();
+}
+
+void PlateGenerator::writeInfo(std::ostream & os, const std::string & imageFilename,
+        const GeneratedPlate & plate) const {
+    os << "imageFilename=\"" << imageFilename << "\"" << std::endl;
+
+    os << "boundingBox = {"
+            << " x = " << plate.boundingBox.x
+            << "; y = " << plate.boundingBox.y
+            << "; width = " << plate.boundingBox.width
+            << "; height = " << plate.boundingBox.height
+            << "; }"
+            << std::endl;
+
+    os << "palletSize = {"
+            << " rows = " << options.rows
+            << "; columns=" << options.cols
+            << "; }"
+            << std::endl;
+
+    os << "orientation=\"" << options.orientation << "\"" << std::endl;
+    os << "barcodePosition=\"" << options.barcodePosition << "\"" << std::endl;
+
+    std::map<std::string, std::string>::const_iterator ii = plate.messages.begin();
+    for (; ii != plate.messages.end(); ++ii) {
+        os << ii->first << "=\"" << ii->second << "\"" << std::endl;
+    }
+}
+
+} /* namespace test */
+
+} /* namespace dmscanlib */
@@ -0,0 +1,112 @@
+#ifndef PLATEGENERATOR_H_
+#define PLATEGENERATOR_H_
+
+/*
+ * PlateGenerator.h
+ *
+ * Renders images of plates of tubes with known barcodes, so that decoding
+ * can be tested and benchmarked without scanned images.
+ */
+
+#include "DmScanLib.h"
+
+#include <opencv/cv.h>
+#include <map>
+#include <ostream>
+#include <string>
+
+namespace dmscanlib {
+
+namespace test {
+
+struct PlateOptions {
+    PlateOptions();
+
+    unsigned rows;
+    unsigned cols;
+    unsigned dpi;
+
+    // distance between the centres of neighbouring wells
+    double pitchMm;
+
+    // diameter of a tube's bottom as a fraction of the pitch
+    double tubeFraction;
+
+    // length of a side of the barcode
+    double symbolMm;
+
+    // number of digits in each message, which sets the symbol's module count
+    unsigned digits;
+
+    // each symbol is rotated by a random angle of up to this many degrees
+    double maxRotation;
+
+    // chance of a well having no tube
+    double emptyFraction;
+
+    // standard deviation, in pixels, of the blur applied to the whole plate
+    double blurSigma;
+
+    // standard deviation, in grey levels, of the noise added to the plate
+    double noiseSigma;
+
+    // how much darker, in grey levels, a module is than the tube bottom
+    int contrast;
+
+    Orientation orientation;
+    BarcodePosition barcodePosition;
+};
+
+std::ostream & operator<<(std::ostream & os, const PlateOptions & m);
+
+struct GeneratedPlate {
+    cv::Mat image;
+
+    // the region holding the wells, divided evenly into rows and columns
+    cv::Rect boundingBox;
+
+    // the message in each well by label, empty for wells without a tube
+    std::map<std::string, std::string> messages;
+};
+
+/*
+ * The symbols are encoded with the vendored libdmtx. Each tube is drawn as a
+ * light disc in the dark rack, with the symbol's dark modules etched into it.
+ * Blur and noise are applied to the whole plate last.
+ */
+class PlateGenerator {
+public:
+    // throws std::invalid_argument when the symbol does not fit in a tube
+    PlateGenerator(const PlateOptions & options);
+
+    virtual ~PlateGenerator();
+
+    // the same seed always gives the same plate
+    void generate(unsigned seed, GeneratedPlate & plate) const;
+
+    /*
+     * Writes an image information file, in the format read by ImageInfo, for
+     * a plate saved as imageFilename.
+     */
+    void writeInfo(std::ostream & os, const std::string & imageFilename,
+            const GeneratedPlate & plate) const;
+
+private:
+    static const unsigned char RACK_GREY;
+    static const unsigned char HOLE_GREY;
+    static const unsigned char TUBE_GREY;
+
+    static bool encode(const std::string & message, cv::Mat & modules);
+
+    void drawSymbol(cv::Mat & gray, const cv::Point2f & centre,
+            const std::string & message, double angle) const;
+
+    const PlateOptions options;
+    const double pixelsPerMm;
+};
+
+} /* namespace test */
+
+} /* namespace dmscanlib */
+
+#endif /* PLATEGENERATOR_H_ */
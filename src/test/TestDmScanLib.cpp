@@ -8,17 +8,25 @@
 #define _CRT_SECURE_NO_DEPRECATE
 
 #include "DmScanLib.h"
+#include "DmScanSession.h"
+#include "DecodeJob.h"
 #include "Image.h"
 #include "decoder/Decoder.h"
 #include "decoder/DecodeOptions.h"
+#include "decoder/DecodeListener.h"
+#include "decoder/DecodeCache.h"
 #include "decoder/WellDecoder.h"
 #include "test/TestCommon.h"
 #include "test/ImageInfo.h"
+#include "test/PlateGenerator.h"
 #include "decoder/DmtxDecodeHelper.h"
+#include "decoder/ThreadMgr.h"
+#include "imgscanner/ImgScannerSimulator.h"
 
 #include <dmtx.h>
 
 #include <algorithm>
+#include <set>
 #include <opencv/cv.h>
 
 #include <stdexcept>
@@ -28,9 +36,19 @@
 #include <iostream>
 #include <fstream>
 
+#ifdef WIN32
+#   include <direct.h>
+#else
+#   include <stdlib.h>
+#   include <unistd.h>
+#endif
+
 #define GLOG_NO_ABBREVIATED_SEVERITIES
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <OpenThreads/Thread>
 
 using namespace dmscanlib;
 
@@ -78,6 +96,866 @@ TEST(TestDmScanLib, decodeImage) {
 	}
 }
 
+TEST(TestDmScanLib, decodeMetrics) {
+    FLAGS_v = 0;
+
+    std::string fname("testImages/8x12/96tubes.bmp");
+
+    DmScanLib::setMetricsEnabled(true);
+    DmScanLib dmScanLib(0);
+    int result = test::decodeImage(fname, dmScanLib, 8, 12);
+    DmScanLib::setMetricsEnabled(false);
+
+    EXPECT_EQ(SC_SUCCESS, result);
+
+    const DecodeMetrics & metrics = dmScanLib.getMetrics();
+    EXPECT_EQ(96u, dmScanLib.getWellMetrics().size());
+    EXPECT_TRUE(metrics.getCount(DecodeMetrics::PROBES) > 0);
+    EXPECT_TRUE(metrics.getCount(DecodeMetrics::REGIONS) >=
+            static_cast<long>(dmScanLib.getDecodedWellCount()));
+    EXPECT_TRUE(metrics.getCount(DecodeMetrics::DECODE_ATTEMPTS) -
+            metrics.getCount(DecodeMetrics::DECODE_FAILURES) >=
+            static_cast<long>(dmScanLib.getDecodedWellCount()));
+    EXPECT_TRUE(metrics.getTime(DecodeMetrics::TOTAL) > 0);
+
+    const util::DmLatencyHistogram & wellLatency = dmScanLib.getWellLatency();
+    EXPECT_EQ(96u, wellLatency.getCount());
+    EXPECT_TRUE(wellLatency.getPercentile(50) <= wellLatency.getPercentile(99));
+    EXPECT_TRUE(wellLatency.getPercentile(99) <= wellLatency.getMax());
+    EXPECT_EQ(1u, dmScanLib.getDecodeLatency().getCount());
+}
+
+TEST(TestDmScanLib, decodeLocateTubes) {
+    FLAGS_v = 0;
+
+    std::string fname("testImages/8x12/96tubes.bmp");
+
+    DmScanLib::setMetricsEnabled(true);
+    DmScanLib::setLocateTubes(true);
+    DmScanLib dmScanLib(0);
+    int result = test::decodeImage(fname, dmScanLib, 8, 12);
+    DmScanLib::setLocateTubes(false);
+    DmScanLib::setMetricsEnabled(false);
+
+    EXPECT_EQ(SC_SUCCESS, result);
+    EXPECT_TRUE(dmScanLib.getDecodedWellCount() > 0);
+
+    // only the tube bottoms are searched on the first pass
+    const DecodeMetrics & metrics = dmScanLib.getMetrics();
+    EXPECT_TRUE(metrics.getCount(DecodeMetrics::SEARCH_PIXELS) > 0);
+    EXPECT_TRUE(metrics.getCount(DecodeMetrics::SEARCH_PIXELS)
+            < metrics.getCount(DecodeMetrics::WELL_PIXELS));
+}
+
+TEST(TestDmScanLib, decodeCascade) {
+    FLAGS_v = 0;
+
+    std::string fname("testImages/8x12/96tubes.bmp");
+    Image image(fname);
+    ASSERT_TRUE(image.isValid());
+
+    std::vector<std::unique_ptr<const WellRectangle> > wellRects;
+    cv::Rect bbox(0, 0, image.size().width, image.size().height);
+    test::getWellRectsForBoundingBox(bbox, 8, 12, LANDSCAPE, TUBE_BOTTOMS, wellRects);
+    std::unique_ptr<DecodeOptions> decodeOptions = test::getDefaultDecodeOptions();
+
+    DmScanLib dmScanLib(0);
+    EXPECT_EQ(SC_SUCCESS, dmScanLib.decodeImageWells(fname.c_str(), *decodeOptions, wellRects));
+
+    // no symbol is this large, so every well moves on to the next stage
+    DecodeOptions hopeless(0.9, 0.95, 0.5, decodeOptions->squareDev,
+            decodeOptions->edgeThresh, decodeOptions->corrections, decodeOptions->shrink);
+    DecodeOptions coarse(decodeOptions->minEdgeFactor, decodeOptions->maxEdgeFactor, 0.2,
+            decodeOptions->squareDev, decodeOptions->edgeThresh, decodeOptions->corrections,
+            decodeOptions->shrink);
+    std::unique_ptr<DecodeOptions> cascade = test::getDefaultDecodeOptions();
+    cascade->addStage(hopeless);
+    cascade->addStage(coarse);
+    ASSERT_EQ(3u, cascade->getStageCount());
+    EXPECT_EQ(0.9, cascade->getStage(0).minEdgeFactor);
+    EXPECT_EQ(cascade.get(), &cascade->getStage(2));
+
+    DmScanLib::setMetricsEnabled(true);
+    DmScanLib cascadeScanLib(0);
+    int result = cascadeScanLib.decodeImageWells(fname.c_str(), *cascade, wellRects);
+    DmScanLib::setMetricsEnabled(false);
+
+    EXPECT_EQ(SC_SUCCESS, result);
+    EXPECT_TRUE(cascadeScanLib.getDecodedWellCount() >= dmScanLib.getDecodedWellCount());
+    EXPECT_TRUE(cascadeScanLib.getMetrics().getCount(DecodeMetrics::CASCADE_RETRIES) >= 96);
+}
+
+/*
+ * Counts the times each well is reported.
+ */
+class CountingListener: public DecodeListener {
+public:
+    virtual void wellDecoded(const WellDecoder & wellDecoder) {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+        ++counts[wellDecoder.getLabel()];
+    }
+
+    const std::map<std::string, unsigned> & getCounts() const {
+        return counts;
+    }
+
+private:
+    std::map<std::string, unsigned> counts;
+    OpenThreads::Mutex mutex;
+};
+
+long getSpeculativeAttempts(const std::map<std::string, const WellDecoder *> & wells,
+        long maxPerWell) {
+    long total = 0;
+    for (std::map<std::string, const WellDecoder *>::const_iterator ii = wells.begin();
+            ii != wells.end(); ++ii) {
+        const long attempts =
+                ii->second->getMetrics().getCount(DecodeMetrics::SPECULATIVE_ATTEMPTS);
+        EXPECT_TRUE(attempts <= maxPerWell) << "label: " << ii->first;
+        total += attempts;
+    }
+    return total;
+}
+
+/*
+ * Whichever attempt decodes a well first, the message is the same, so
+ * speculating only changes how long the decode takes.
+ */
+TEST(TestDmScanLib, decodeSpeculative) {
+    FLAGS_v = 0;
+
+    std::string fname("testImages/8x12/96tubes.bmp");
+    Image image(fname);
+    ASSERT_TRUE(image.isValid());
+
+    std::vector<std::unique_ptr<const WellRectangle> > wellRects;
+    cv::Rect bbox(0, 0, image.size().width, image.size().height);
+    test::getWellRectsForBoundingBox(bbox, 8, 12, LANDSCAPE, TUBE_BOTTOMS, wellRects);
+    std::unique_ptr<DecodeOptions> decodeOptions = test::getDefaultDecodeOptions();
+
+    decoder::ThreadMgr serialMgr(4);
+    serialMgr.setSpeculative(false);
+    Decoder serialDecoder(image, *decodeOptions, wellRects);
+    serialDecoder.setThreadMgr(&serialMgr);
+    serialDecoder.setCollectMetrics(true);
+    EXPECT_EQ(SC_SUCCESS, serialDecoder.decodeWellRects());
+
+    CountingListener listener;
+    decoder::ThreadMgr speculativeMgr(4);
+    Decoder speculativeDecoder(image, *decodeOptions, wellRects);
+    speculativeDecoder.setThreadMgr(&speculativeMgr);
+    speculativeDecoder.setCollectMetrics(true);
+    speculativeDecoder.setListener(&listener);
+    EXPECT_EQ(SC_SUCCESS, speculativeDecoder.decodeWellRects());
+
+    const std::map<std::string, const WellDecoder *> & serialWells =
+            serialDecoder.getDecodedWells();
+    const std::map<std::string, const WellDecoder *> & speculativeWells =
+            speculativeDecoder.getDecodedWells();
+    ASSERT_EQ(serialWells.size(), speculativeWells.size());
+
+    // only a well's later attempts can start while an earlier one is running
+    EXPECT_EQ(0, getSpeculativeAttempts(serialWells, 0));
+    getSpeculativeAttempts(speculativeWells,
+            static_cast<long>(speculativeDecoder.getAttemptCount()) - 1);
+
+    // a well decoded by two attempts at once is still reported once
+    const std::map<std::string, unsigned> & counts = listener.getCounts();
+    EXPECT_EQ(speculativeWells.size(), counts.size());
+    for (std::map<std::string, unsigned>::const_iterator ii = counts.begin();
+            ii != counts.end(); ++ii) {
+        EXPECT_EQ(1u, ii->second) << "label: " << ii->first;
+        EXPECT_TRUE(speculativeWells.find(ii->first) != speculativeWells.end())
+                << "label: " << ii->first;
+    }
+    for (std::map<std::string, const WellDecoder *>::const_iterator ii = serialWells.begin();
+            ii != serialWells.end(); ++ii) {
+        std::map<std::string, const WellDecoder *>::const_iterator jj =
+                speculativeWells.find(ii->first);
+        ASSERT_TRUE(jj != speculativeWells.end()) << "label: " << ii->first;
+        EXPECT_EQ(ii->second->getMessage(), jj->second->getMessage());
+    }
+}
+
+/*
+ * A new, empty directory for the files written by a test. Returns an empty
+ * string when it could not be created.
+ */
+std::string makeTempDir() {
+#ifdef WIN32
+    char name[] = "dmscanlib_testXXXXXX";
+    if ((_mktemp_s(name, sizeof(name)) != 0) || (_mkdir(name) != 0)) {
+        return std::string();
+    }
+    return name;
+#else
+    char name[] = "/tmp/dmscanlib_testXXXXXX";
+    return (mkdtemp(name) != NULL) ? std::string(name) : std::string();
+#endif
+}
+
+int removeDir(const std::string & dir) {
+#ifdef WIN32
+    return _rmdir(dir.c_str());
+#else
+    return rmdir(dir.c_str());
+#endif
+}
+
+TEST(TestDmScanLib, decodeAutoTune) {
+    FLAGS_v = 0;
+
+    std::string fname("testImages/8x12/96tubes.bmp");
+    const std::string dir = makeTempDir();
+    ASSERT_FALSE(dir.empty());
+    const std::string stateFilename = dir + "/tuner_state.txt";
+
+    DmScanLib conservativeScanLib(0);
+    int result = test::decodeImage(fname, conservativeScanLib, 8, 12);
+    EXPECT_EQ(SC_SUCCESS, result);
+    const unsigned expected = conservativeScanLib.getDecodedWellCount();
+
+    DmScanLib::setAutoTune(stateFilename);
+    unsigned tunedDecodes = 0;
+    for (unsigned i = 0; i < 4; ++i) {
+        // wells missed by the tuned options are decoded again, nothing is lost
+        DmScanLib dmScanLib(0);
+        result = test::decodeImage(fname, dmScanLib, 8, 12);
+        EXPECT_EQ(SC_SUCCESS, result);
+        EXPECT_TRUE(dmScanLib.getDecodedWellCount() >= expected);
+        if (dmScanLib.getTunedOptions() != NULL) {
+            ++tunedDecodes;
+        }
+    }
+    DmScanLib::setAutoTune("");
+
+    // the later plates are decoded with tuned options once enough symbols are seen
+    EXPECT_TRUE(tunedDecodes >= 2) << "tuned decodes: " << tunedDecodes;
+
+    std::ifstream stateFile(stateFilename.c_str());
+    EXPECT_TRUE(stateFile.is_open());
+    stateFile.close();
+
+    remove(stateFilename.c_str());
+    EXPECT_EQ(0, removeDir(dir));
+}
+
+TEST(TestDmScanLib, decodeSession) {
+    FLAGS_v = 0;
+
+    std::string fname("testImages/8x12/96tubes.bmp");
+
+    DmScanLib dmScanLib(0);
+    int result = test::decodeImage(fname, dmScanLib, 8, 12);
+    EXPECT_EQ(SC_SUCCESS, result);
+
+    // the session's worker threads are reused for every decode
+    DmScanSession session(0, 4);
+    for (unsigned i = 0; i < 2; ++i) {
+        DmScanSession::Access access(session);
+        result = test::decodeImage(fname, access.getScanLib(), 8, 12);
+        EXPECT_EQ(SC_SUCCESS, result);
+        EXPECT_EQ(dmScanLib.getDecodedWellCount(), access.getScanLib().getDecodedWellCount());
+    }
+    EXPECT_EQ(2u, session.getUseCount());
+}
+
+TEST(TestDmScanLib, decodeLayout) {
+    FLAGS_v = 0;
+
+    std::string fname("testImages/8x12/96tubes.bmp");
+    Image image(fname);
+    ASSERT_TRUE(image.isValid());
+
+    std::vector<std::unique_ptr<const WellRectangle> > wellRects;
+    cv::Rect bbox(0, 0, image.size().width, image.size().height);
+    test::getWellRectsForBoundingBox(bbox, 8, 12, LANDSCAPE, TUBE_BOTTOMS, wellRects);
+    std::unique_ptr<DecodeOptions> decodeOptions = test::getDefaultDecodeOptions();
+
+    DmScanLib dmScanLib(0);
+    int result = dmScanLib.decodeImageWells(fname.c_str(), *decodeOptions, wellRects);
+    EXPECT_EQ(SC_SUCCESS, result);
+
+    const int layoutId = DmScanLib::registerLayout(wellRects);
+    for (unsigned i = 0; i < 2; ++i) {
+        DmScanLib layoutScanLib(0);
+        result = layoutScanLib.decodeImageLayout(fname.c_str(), *decodeOptions, layoutId);
+        EXPECT_EQ(SC_SUCCESS, result);
+        EXPECT_EQ(dmScanLib.getDecodedWellCount(), layoutScanLib.getDecodedWellCount());
+    }
+
+    EXPECT_TRUE(DmScanLib::unregisterLayout(layoutId));
+    EXPECT_FALSE(DmScanLib::unregisterLayout(layoutId));
+    result = dmScanLib.decodeImageLayout(fname.c_str(), *decodeOptions, layoutId);
+    EXPECT_EQ(SC_INVALID_NOTHING_TO_DECODE, result);
+}
+
+TEST(TestDmScanLib, decodeCache) {
+    FLAGS_v = 0;
+
+    const std::string cacheDir = makeTempDir();
+    ASSERT_FALSE(cacheDir.empty());
+
+    std::string fname("testImages/8x12/96tubes.bmp");
+    Image image(fname);
+    ASSERT_TRUE(image.isValid());
+
+    std::vector<std::unique_ptr<const WellRectangle> > wellRects;
+    cv::Rect bbox(0, 0, image.size().width, image.size().height);
+    test::getWellRectsForBoundingBox(bbox, 8, 12, LANDSCAPE, TUBE_BOTTOMS, wellRects);
+    std::unique_ptr<DecodeOptions> decodeOptions = test::getDefaultDecodeOptions();
+
+    DmScanLib::setDecodeCache(4, cacheDir);
+
+    DmScanLib dmScanLib(0);
+    EXPECT_EQ(SC_SUCCESS, dmScanLib.decodeImageWells(fname.c_str(), *decodeOptions, wellRects));
+    EXPECT_FALSE(dmScanLib.getDecodedFromCache());
+
+    DmScanLib cachedScanLib(0);
+    EXPECT_EQ(SC_SUCCESS, cachedScanLib.decodeImageWells(fname.c_str(), *decodeOptions, wellRects));
+    EXPECT_TRUE(cachedScanLib.getDecodedFromCache());
+    EXPECT_EQ(dmScanLib.getDecodedWellCount(), cachedScanLib.getDecodedWellCount());
+
+    const std::map<std::string, const WellDecoder *> & decodedWells = dmScanLib.getDecodedWells();
+    const std::map<std::string, const WellDecoder *> & cachedWells = cachedScanLib.getDecodedWells();
+    std::map<std::string, const WellDecoder *>::const_iterator ii = decodedWells.begin();
+    for (; ii != decodedWells.end(); ++ii) {
+        ASSERT_TRUE(cachedWells.find(ii->first) != cachedWells.end());
+        EXPECT_EQ(ii->second->getLabel(), cachedWells.find(ii->first)->second->getLabel());
+    }
+
+    // other options or other wells are a different entry
+    DecodeOptions otherOptions(decodeOptions->minEdgeFactor, decodeOptions->maxEdgeFactor,
+            decodeOptions->scanGapFactor, decodeOptions->squareDev,
+            decodeOptions->edgeThresh + 1, decodeOptions->corrections, decodeOptions->shrink);
+    EXPECT_EQ(SC_SUCCESS, cachedScanLib.decodeImageWells(fname.c_str(), otherOptions, wellRects));
+    EXPECT_FALSE(cachedScanLib.getDecodedFromCache());
+
+    wellRects.pop_back();
+    EXPECT_EQ(SC_SUCCESS, cachedScanLib.decodeImageWells(fname.c_str(), *decodeOptions, wellRects));
+    EXPECT_FALSE(cachedScanLib.getDecodedFromCache());
+
+    // a new cache finds the entries written to disk by the last one
+    DmScanLib::setDecodeCache(4, cacheDir);
+    EXPECT_EQ(SC_SUCCESS, cachedScanLib.decodeImageWells(fname.c_str(), *decodeOptions, wellRects));
+    EXPECT_TRUE(cachedScanLib.getDecodedFromCache());
+    EXPECT_EQ(1u, DmScanLib::getDecodeCache()->getHits());
+
+    DmScanLib::setDecodeCache(0);
+    EXPECT_TRUE(DmScanLib::getDecodeCache() == NULL);
+
+    // a cache with no room removes every file it finds, leaving the directory empty
+    {
+        DecodeCache emptyCache(0, cacheDir);
+    }
+    EXPECT_EQ(0, removeDir(cacheDir));
+}
+
+TEST(TestDmScanLib, preprocessRows) {
+    FLAGS_v = 0;
+
+    std::string fname("testImages/8x12/96tubes.bmp");
+    Image image(fname);
+    ASSERT_TRUE(image.isValid());
+
+    Image expected;
+    Decoder::preprocess(image, expected);
+
+    // filtered band by band, as the scanner would deliver them
+    const cv::Mat original = image.getOriginalImage();
+    const int apron = Image::getFilterApron();
+    const int bandRows = 100;
+    cv::Mat filtered(original.size(), CV_8UC1);
+    int begin = 0;
+    for (int available = bandRows; begin < original.rows; available += bandRows) {
+        available = std::min(available, original.rows);
+        const int end = (available == original.rows) ? available : available - apron;
+        if (end > begin) {
+            Decoder::preprocessRows(original, begin, end, available, filtered);
+            begin = end;
+        }
+    }
+
+    cv::Mat diff;
+    cv::absdiff(expected.getOriginalImage(), filtered, diff);
+    EXPECT_EQ(0, cv::countNonZero(diff));
+}
+
+TEST(TestDmScanLib, decodeGeneratedPlate) {
+    FLAGS_v = 0;
+
+    test::PlateOptions options;
+    options.rows = 2;
+    options.cols = 3;
+    options.emptyFraction = 0;
+    test::PlateGenerator generator(options);
+
+    test::GeneratedPlate plate;
+    generator.generate(1, plate);
+    ASSERT_EQ(options.rows * options.cols, plate.messages.size());
+
+    test::GeneratedPlate again;
+    generator.generate(1, again);
+    EXPECT_TRUE(plate.messages == again.messages);
+
+    std::vector<std::unique_ptr<const WellRectangle> > wellRects;
+    test::getWellRectsForBoundingBox(plate.boundingBox, options.rows, options.cols,
+            options.orientation, options.barcodePosition, wellRects);
+    std::unique_ptr<DecodeOptions> decodeOptions = test::getDefaultDecodeOptions();
+
+    Image image(plate.image);
+    Decoder decoder(image, *decodeOptions, wellRects);
+    EXPECT_EQ(SC_SUCCESS, decoder.decodeWellRects());
+    EXPECT_TRUE(decoder.getDecodedWellCount() > 0);
+
+    const std::map<std::string, const WellDecoder *> & decodedWells = decoder.getDecodedWells();
+    for (std::map<std::string, const WellDecoder *>::const_iterator ii = decodedWells.begin();
+            ii != decodedWells.end(); ++ii) {
+        const std::string & label = ii->second->getLabel();
+        EXPECT_EQ(plate.messages[label], ii->second->getMessage()) << "label: " << label;
+    }
+
+    options.symbolMm = options.pitchMm;
+    EXPECT_THROW(test::PlateGenerator badGenerator(options), std::invalid_argument);
+}
+
+/*
+ * The wells given are 3% too small, so the symbols of the last columns lie
+ * across the edge of their wells. The grid fitted to the other wells finds
+ * them again.
+ */
+TEST(TestDmScanLib, decodeRefitGrid) {
+    FLAGS_v = 0;
+
+    test::PlateOptions options;
+    options.emptyFraction = 0;
+    test::PlateGenerator generator(options);
+
+    test::GeneratedPlate plate;
+    generator.generate(3, plate);
+
+    cv::Rect bbox = plate.boundingBox;
+    bbox.width = static_cast<int>(0.97 * bbox.width);
+    bbox.height = static_cast<int>(0.97 * bbox.height);
+    std::vector<std::unique_ptr<const WellRectangle> > wellRects;
+    test::getWellRectsForBoundingBox(bbox, options.rows, options.cols,
+            options.orientation, options.barcodePosition, wellRects);
+    std::unique_ptr<DecodeOptions> decodeOptions = test::getDefaultDecodeOptions();
+
+    Image image(plate.image);
+    Decoder decoder(image, *decodeOptions, wellRects);
+    EXPECT_EQ(SC_SUCCESS, decoder.decodeWellRects());
+
+    Decoder refitDecoder(image, *decodeOptions, wellRects);
+    refitDecoder.setRefitGrid(true);
+    refitDecoder.setCollectMetrics(true);
+    EXPECT_EQ(SC_SUCCESS, refitDecoder.decodeWellRects());
+
+    // the wells missed at the edge of the shrunk grid are searched again
+    long refitRetries = 0;
+    std::vector<std::unique_ptr<WellDecoder> > & wellDecoders = refitDecoder.getWellDecoders();
+    for (unsigned i = 0, n = wellDecoders.size(); i < n; ++i) {
+        refitRetries += wellDecoders[i]->getMetrics().getCount(DecodeMetrics::REFIT_RETRIES);
+    }
+    EXPECT_TRUE(refitRetries > 0);
+
+    const unsigned plain = decoder.getDecodedWellCount();
+    const unsigned refit = refitDecoder.getDecodedWellCount();
+    EXPECT_TRUE((refit > plain) || (refit == options.rows * options.cols))
+            << "plain: " << plain << " refit: " << refit;
+
+    const std::map<std::string, const WellDecoder *> & decodedWells =
+            refitDecoder.getDecodedWells();
+    for (std::map<std::string, const WellDecoder *>::const_iterator ii = decodedWells.begin();
+            ii != decodedWells.end(); ++ii) {
+        const std::string & label = ii->second->getLabel();
+        EXPECT_EQ(plate.messages[label], ii->second->getMessage()) << "label: " << label;
+    }
+}
+
+/*
+ * A row of six tubes with upright symbols, the fifth tube left without one.
+ * Returns the centre of each tube, and the square around a symbol.
+ */
+void generateRefitPlate(const test::PlateOptions & options, test::GeneratedPlate & plate,
+        std::vector<cv::Point> & centres, cv::Rect & symbolRect) {
+    test::PlateGenerator generator(options);
+    generator.generate(5, plate);
+
+    const float pitch = static_cast<float>(plate.boundingBox.width) / options.cols;
+    for (unsigned col = 0; col < options.cols; ++col) {
+        centres.push_back(cv::Point(
+                cvRound(plate.boundingBox.x + (col + 0.5f) * pitch),
+                cvRound(plate.boundingBox.y + 0.5f * pitch)));
+    }
+
+    const int half = static_cast<int>(pitch / 6);
+    symbolRect = cv::Rect(-half, -half, 2 * half, 2 * half);
+    cv::Mat & gray = plate.image;
+    const unsigned char tubeGrey = gray.at<unsigned char>(centres[4] + cv::Point(0, half + 10));
+    gray(symbolRect + centres[4]).setTo(cv::Scalar(tubeGrey));
+}
+
+test::PlateOptions getRefitPlateOptions() {
+    test::PlateOptions options;
+    options.rows = 1;
+    options.cols = 6;
+    options.emptyFraction = 0;
+    options.maxRotation = 0;
+    return options;
+}
+
+/*
+ * Adds a square well, labelled as the tube in col, centred at centre, and
+ * returns its label.
+ */
+std::string addRefitWell(const test::PlateOptions & options, unsigned col,
+        const cv::Point2f & centre, int side,
+        std::vector<std::unique_ptr<const WellRectangle> > & wellRects) {
+    std::string label;
+    DmScanLib::getLabelForPosition(0, col, options.rows, options.cols,
+            options.orientation, options.barcodePosition, label);
+    wellRects.push_back(std::unique_ptr<const WellRectangle>(new WellRectangle(
+            label.c_str(), static_cast<unsigned>(centre.x - side / 2),
+            static_cast<unsigned>(centre.y - side / 2), side, side)));
+    return label;
+}
+
+/*
+ * The wells given are 0.8 times as far apart as the tubes, so the fitted grid
+ * puts the square of the last well, whose tube holds a copy of the first
+ * well's symbol, outside the well. The copy found there is dropped, and the
+ * fallback from tuned options searches the well itself again rather than the
+ * square.
+ */
+TEST(TestDmScanLib, decodeRefitDuplicate) {
+    FLAGS_v = 0;
+
+    const test::PlateOptions options = getRefitPlateOptions();
+    test::GeneratedPlate plate;
+    std::vector<cv::Point> centres;
+    cv::Rect symbolRect;
+    generateRefitPlate(options, plate, centres, symbolRect);
+    plate.image(symbolRect + centres[0]).copyTo(plate.image(symbolRect + centres[5]));
+
+    const unsigned cols[] = { 0, 1, 2, 3, 5 };
+    const unsigned numWells = sizeof(cols) / sizeof(cols[0]);
+    const float middleX = (centres[1].x + centres[2].x) * 0.5f;
+    const int side = plate.boundingBox.width / options.cols - 2;
+    std::vector<std::unique_ptr<const WellRectangle> > wellRects;
+    std::vector<std::string> labels;
+    for (unsigned i = 0; i < numWells; ++i) {
+        const cv::Point2f centre(middleX + (centres[cols[i]].x - middleX) * 0.8f,
+                static_cast<float>(centres[cols[i]].y));
+        labels.push_back(addRefitWell(options, cols[i], centre, side, wellRects));
+    }
+    std::unique_ptr<DecodeOptions> decodeOptions = test::getDefaultDecodeOptions();
+
+    Image image(plate.image);
+    Decoder decoder(image, *decodeOptions, wellRects);
+    decoder.setRefitGrid(true);
+    decoder.setCollectMetrics(true);
+    ASSERT_EQ(SC_SUCCESS, decoder.decodeWellRects());
+    EXPECT_EQ(numWells - 1, decoder.getDecodedWellCount());
+
+    const WellDecoder & lastWell = *decoder.getWellDecoders()[numWells - 1];
+    EXPECT_EQ(1, lastWell.getMetrics().getCount(DecodeMetrics::REFIT_RETRIES));
+    EXPECT_TRUE(lastWell.getMessage().empty());
+    EXPECT_EQ(&lastWell.getWellRegion(), &lastWell.getSearchRegion());
+
+    // as done for the wells missed with tuned options
+    EXPECT_EQ(SC_SUCCESS, decoder.decodeFailedWells(*decodeOptions));
+    EXPECT_EQ(numWells - 1, decoder.getDecodedWellCount());
+    EXPECT_TRUE(lastWell.getMessage().empty());
+    for (unsigned i = 0; i + 1 < numWells; ++i) {
+        EXPECT_EQ(plate.messages[labels[i]], decoder.getWellDecoders()[i]->getMessage())
+                << "label: " << labels[i];
+    }
+
+    const std::string dir = makeTempDir();
+    ASSERT_FALSE(dir.empty());
+    const std::string fname = dir + "/plate.png";
+    const std::string stateFilename = dir + "/tuner_state.txt";
+    ASSERT_NE(0, image.write(fname));
+
+    DmScanLib::setAutoTune(stateFilename);
+    DmScanLib::setRefitGrid(true);
+    for (unsigned i = 0; i < 4; ++i) {
+        DmScanLib dmScanLib(0);
+        EXPECT_EQ(SC_SUCCESS, dmScanLib.decodeImageWells(fname.c_str(), *decodeOptions,
+                wellRects));
+        EXPECT_EQ(numWells - 1, dmScanLib.getDecodedWellCount());
+    }
+    DmScanLib::setRefitGrid(false);
+    DmScanLib::setAutoTune("");
+
+    remove(fname.c_str());
+    remove(stateFilename.c_str());
+    EXPECT_EQ(0, removeDir(dir));
+}
+
+/*
+ * Two wells given side by side, both missing the sixth tube, are fitted to
+ * squares that overlap around its symbol. Only the first keeps it, and the
+ * listener hears of it once.
+ */
+TEST(TestDmScanLib, decodeRefitSharedSymbol) {
+    FLAGS_v = 0;
+
+    const test::PlateOptions options = getRefitPlateOptions();
+    test::GeneratedPlate plate;
+    std::vector<cv::Point> centres;
+    cv::Rect symbolRect;
+    generateRefitPlate(options, plate, centres, symbolRect);
+
+    const float middleX = (centres[1].x + centres[2].x) * 0.5f;
+    const float y = static_cast<float>(centres[0].y);
+    const int side = plate.boundingBox.width / options.cols - 2;
+    std::vector<std::unique_ptr<const WellRectangle> > wellRects;
+    std::vector<std::string> labels;
+    for (unsigned col = 0; col < 4; ++col) {
+        const cv::Point2f centre(middleX + (centres[col].x - middleX) * 0.8f, y);
+        labels.push_back(addRefitWell(options, col, centre, side, wellRects));
+    }
+    const float lastX = middleX + (centres[5].x - middleX) * 0.8f;
+    const std::string firstLabel =
+            addRefitWell(options, 4, cv::Point2f(lastX - 12, y), side, wellRects);
+    const std::string secondLabel =
+            addRefitWell(options, 5, cv::Point2f(lastX + 12, y), side, wellRects);
+    std::unique_ptr<DecodeOptions> decodeOptions = test::getDefaultDecodeOptions();
+
+    CountingListener listener;
+    Image image(plate.image);
+    Decoder decoder(image, *decodeOptions, wellRects);
+    decoder.setRefitGrid(true);
+    decoder.setCollectMetrics(true);
+    decoder.setListener(&listener);
+    ASSERT_EQ(SC_SUCCESS, decoder.decodeWellRects());
+    EXPECT_EQ(5u, decoder.getDecodedWellCount());
+
+    const WellDecoder & firstWell = *decoder.getWellDecoders()[4];
+    const WellDecoder & secondWell = *decoder.getWellDecoders()[5];
+    EXPECT_EQ(1, firstWell.getMetrics().getCount(DecodeMetrics::REFIT_RETRIES));
+    EXPECT_EQ(1, secondWell.getMetrics().getCount(DecodeMetrics::REFIT_RETRIES));
+
+    std::string label;
+    DmScanLib::getLabelForPosition(0, 5, options.rows, options.cols,
+            options.orientation, options.barcodePosition, label);
+    EXPECT_EQ(plate.messages[label], firstWell.getMessage());
+    EXPECT_TRUE(secondWell.getMessage().empty());
+
+    std::map<std::string, unsigned> counts = listener.getCounts();
+    EXPECT_EQ(1u, counts[firstLabel]);
+    EXPECT_EQ(0u, counts[secondLabel]);
+    for (unsigned i = 0; i < labels.size(); ++i) {
+        EXPECT_EQ(plate.messages[labels[i]], decoder.getWellDecoders()[i]->getMessage())
+                << "label: " << labels[i];
+        EXPECT_EQ(1u, counts[labels[i]]) << "label: " << labels[i];
+    }
+}
+
+#if ! defined(WIN32)
+TEST(TestDmScanLib, scanAndDecodeSimulator) {
+    FLAGS_v = 0;
+
+    std::string fname("testImages/8x12/96tubes.bmp");
+    Image image(fname);
+    ASSERT_TRUE(image.isValid());
+
+    DmScanLib dmScanLib(0);
+    std::unique_ptr<DecodeOptions> decodeOptions = test::getDefaultDecodeOptions();
+    std::vector<std::unique_ptr<const WellRectangle> > wellRects;
+    cv::Rect bbox(0, 0, image.size().width, image.size().height);
+    test::getWellRectsForBoundingBox(bbox, 8, 12, LANDSCAPE, TUBE_BOTTOMS, wellRects);
+
+    // nothing to scan until the simulator is given a source
+    EXPECT_EQ(SC_TWAIN_UNAVAIL, dmScanLib.scanFlatbed(600, 0, 0, "scanned.png"));
+
+    imgscanner::SimulatorOptions options;
+    options.source = fname;
+    options.sourceDpi = 600;
+    options.startSeconds = 0.05;
+    options.bandRows = 100;
+    options.bandSeconds = 0.01;
+    imgscanner::ImgScannerSimulator::setOptions(options);
+
+    const unsigned numBands = (image.size().height + options.bandRows - 1) / options.bandRows;
+    const float inches = 1.0f / options.sourceDpi;
+
+    util::DmStopwatch stopwatch;
+    int result = dmScanLib.scanAndDecode(600, 0, 0, 0, 0,
+            image.size().width * inches, image.size().height * inches,
+            *decodeOptions, wellRects);
+    const double elapsed = stopwatch.getElapsedSeconds();
+    EXPECT_EQ(SC_SUCCESS, result);
+    EXPECT_LE(options.startSeconds + numBands * options.bandSeconds, elapsed);
+
+    DmScanLib fileScanLib(0);
+    EXPECT_EQ(SC_SUCCESS, fileScanLib.decodeImageWells(fname.c_str(), *decodeOptions, wellRects));
+    EXPECT_EQ(fileScanLib.getDecodedWellCount(), dmScanLib.getDecodedWellCount());
+
+    imgscanner::ImgScannerSimulator::setOptions(imgscanner::SimulatorOptions());
+}
+
+/*
+ * The plate is scanned at 300 DPI, and the wells missed at that resolution
+ * are scanned again at the 600 DPI the image was taken at.
+ */
+TEST(TestDmScanLib, scanAndDecodeRescanSimulator) {
+    FLAGS_v = 0;
+
+    std::string fname("testImages/8x12/96tubes.bmp");
+    Image image(fname);
+    ASSERT_TRUE(image.isValid());
+
+    imgscanner::SimulatorOptions options;
+    options.source = fname;
+    options.sourceDpi = 600;
+    imgscanner::ImgScannerSimulator::setOptions(options);
+
+    const unsigned dpi = 300;
+    const float inches = 1.0f / options.sourceDpi;
+    const cv::Size size = image.size();
+
+    // the wells are given in the pixels of the 300 DPI scan
+    std::unique_ptr<DecodeOptions> decodeOptions = test::getDefaultDecodeOptions();
+    std::vector<std::unique_ptr<const WellRectangle> > wellRects;
+    cv::Rect bbox(0, 0, size.width * dpi / options.sourceDpi, size.height * dpi / options.sourceDpi);
+    test::getWellRectsForBoundingBox(bbox, 8, 12, LANDSCAPE, TUBE_BOTTOMS, wellRects);
+
+    DmScanLib dmScanLib(0);
+    EXPECT_EQ(SC_SUCCESS, dmScanLib.scanAndDecode(dpi, 0, 0, 0, 0,
+            size.width * inches, size.height * inches, *decodeOptions, wellRects));
+
+    DmScanLib::setMetricsEnabled(true);
+    DmScanLib::setRescanDpi(options.sourceDpi);
+    DmScanLib rescanScanLib(0);
+    int result = rescanScanLib.scanAndDecode(dpi, 0, 0, 0, 0,
+            size.width * inches, size.height * inches, *decodeOptions, wellRects);
+    DmScanLib::setRescanDpi(0);
+    DmScanLib::setMetricsEnabled(false);
+
+    EXPECT_EQ(SC_SUCCESS, result);
+    EXPECT_TRUE(rescanScanLib.getDecodedWellCount() >= dmScanLib.getDecodedWellCount());
+    EXPECT_EQ(96 - dmScanLib.getDecodedWellCount(), static_cast<unsigned>(
+            rescanScanLib.getMetrics().getCount(DecodeMetrics::RESCANNED_WELLS)));
+
+    imgscanner::ImgScannerSimulator::setOptions(imgscanner::SimulatorOptions());
+}
+
+TEST(TestDmScanLib, scanAndDecodePlatesSimulator) {
+    FLAGS_v = 0;
+
+    std::string fname("testImages/8x12/96tubes.bmp");
+    Image image(fname);
+    ASSERT_TRUE(image.isValid());
+
+    std::unique_ptr<DecodeOptions> decodeOptions = test::getDefaultDecodeOptions();
+    std::vector<std::unique_ptr<const WellRectangle> > wellRects;
+    cv::Rect bbox(0, 0, image.size().width, image.size().height);
+    test::getWellRectsForBoundingBox(bbox, 8, 12, LANDSCAPE, TUBE_BOTTOMS, wellRects);
+    const int layoutId = DmScanLib::registerLayout(wellRects);
+
+    imgscanner::SimulatorOptions options;
+    options.source = fname;
+    options.sourceDpi = 600;
+    imgscanner::ImgScannerSimulator::setOptions(options);
+
+    // the same plate twice, and a third one off the flatbed
+    const float inches = 1.0f / options.sourceDpi;
+    const cv::Rect_<float> plateRegion(0, 0,
+            image.size().width * inches, image.size().height * inches);
+    std::vector<cv::Rect_<float> > regions(2, plateRegion);
+    regions.push_back(cv::Rect_<float>(100, 100, 1, 1));
+    std::vector<int> layoutIds(3, layoutId);
+
+    DmScanLib dmScanLib(0);
+    EXPECT_EQ(SC_INVALID_NOTHING_TO_DECODE, dmScanLib.scanAndDecodePlates(600, 0, 0,
+            regions, std::vector<int>(2, layoutId), *decodeOptions));
+    EXPECT_EQ(SC_SUCCESS, dmScanLib.scanAndDecodePlates(600, 0, 0,
+            regions, layoutIds, *decodeOptions));
+    ASSERT_EQ(3u, dmScanLib.getPlateCount());
+
+    DmScanLib fileScanLib(0);
+    EXPECT_EQ(SC_SUCCESS, fileScanLib.decodeImageWells(fname.c_str(), *decodeOptions, wellRects));
+    for (unsigned i = 0; i < 2; ++i) {
+        EXPECT_EQ(SC_SUCCESS, dmScanLib.getPlateResult(i));
+        EXPECT_EQ(fileScanLib.getDecodedWellCount(), dmScanLib.getDecodedWells(i).size());
+    }
+    EXPECT_EQ(SC_INVALID_NOTHING_TO_DECODE, dmScanLib.getPlateResult(2));
+
+    EXPECT_TRUE(DmScanLib::unregisterLayout(layoutId));
+    imgscanner::ImgScannerSimulator::setOptions(imgscanner::SimulatorOptions());
+}
+#endif
+
+/*
+ * Cancels the decode as soon as the first well is decoded.
+ */
+class CancelOnFirstWell: public DecodeListener {
+public:
+    CancelOnFirstWell() :
+            cancelled(false)
+    {
+    }
+
+    virtual void wellDecoded(const WellDecoder & wellDecoder) {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+        cancelled = true;
+    }
+
+    virtual bool isCancelled() const {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+        return cancelled;
+    }
+
+private:
+    bool cancelled;
+    mutable OpenThreads::Mutex mutex;
+};
+
+TEST(TestDmScanLib, decodeAsync) {
+    FLAGS_v = 0;
+
+    std::string fname("testImages/8x12/96tubes.bmp");
+    Image image(fname);
+    ASSERT_TRUE(image.isValid());
+
+    std::vector<std::unique_ptr<const WellRectangle> > wellRects;
+    cv::Rect bbox(0, 0, image.size().width, image.size().height);
+    test::getWellRectsForBoundingBox(bbox, 8, 12, LANDSCAPE, TUBE_BOTTOMS, wellRects);
+    std::unique_ptr<DecodeOptions> decodeOptions = test::getDefaultDecodeOptions();
+
+    // every decoded well is streamed exactly once
+    DmScanLib dmScanLib(0);
+    std::vector<DecodeJob::WellResult> results;
+    {
+        DecodeJob job(dmScanLib, fname, *decodeOptions, wellRects);
+        while (!job.isDone()) {
+            job.poll(results);
+            OpenThreads::Thread::microSleep(1000);
+        }
+        EXPECT_EQ(SC_SUCCESS, job.wait());
+        job.poll(results);
+    }
+    EXPECT_EQ(dmScanLib.getDecodedWellCount(), results.size());
+
+    std::set<std::string> labels;
+    for (unsigned i = 0, n = results.size(); i < n; ++i) {
+        labels.insert(results[i].first);
+    }
+    EXPECT_EQ(results.size(), labels.size());
+
+    // wells already being decoded finish, the others are skipped
+    CancelOnFirstWell cancelOnFirstWell;
+    DmScanLib cancelledScanLib(0);
+    DecodeJob cancelledJob(cancelledScanLib, fname, *decodeOptions, wellRects,
+            &cancelOnFirstWell);
+    EXPECT_EQ(SC_DECODE_CANCELLED, cancelledJob.wait());
+    EXPECT_TRUE(cancelledScanLib.getDecodedWellCount() > 0);
+    EXPECT_TRUE(cancelledScanLib.getDecodedWellCount() < results.size());
+}
+
 void writeAllDecodeResults(std::vector<std::string> & testResults, bool append = false) {
     std::ofstream ofile;
     if (append) {
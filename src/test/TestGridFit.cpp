@@ -0,0 +1,90 @@
+/*
+ * TestGridFit.cpp
+ *
+ * Fits of a plate's grid to symbols at known positions.
+ */
+
+#define _CRT_SECURE_NO_DEPRECATE
+
+#include "decoder/GridFit.h"
+
+#include <gtest/gtest.h>
+#include <math.h>
+
+namespace {
+
+using namespace dmscanlib::decoder;
+
+const double PITCH = 200;
+
+// a grid rotated by the angle, scaled and offset, as the symbols of a plate
+cv::Point2f transform(const cv::Point2f & nominal, double angle, double scale,
+        const cv::Point2f & offset) {
+    return cv::Point2f(
+            static_cast<float>(scale * (cos(angle) * nominal.x - sin(angle) * nominal.y)),
+            static_cast<float>(scale * (sin(angle) * nominal.x + cos(angle) * nominal.y)))
+            + offset;
+}
+
+TEST(TestGridFit, fit) {
+    const double angle = 0.02;
+    const double scale = 1.03;
+    const cv::Point2f offset(25, -12);
+
+    GridFit gridFit;
+    for (unsigned row = 0; row < 8; ++row) {
+        for (unsigned col = 0; col < 12; ++col) {
+            const cv::Point2f nominal((col + 0.5f) * PITCH, (row + 0.5f) * PITCH);
+            gridFit.addWell(nominal, transform(nominal, angle, scale, offset));
+        }
+    }
+    ASSERT_TRUE(gridFit.fit());
+
+    EXPECT_NEAR(angle, gridFit.getRotation(), 1e-4);
+    EXPECT_NEAR(scale, gridFit.getScale(), 1e-4);
+    EXPECT_NEAR(0, gridFit.getResidual(), 0.1);
+
+    // a well that was not added is placed by the same transform
+    const cv::Point2f outside(12.5f * PITCH, 3.5f * PITCH);
+    const cv::Point2f expected = transform(outside, angle, scale, offset);
+    const cv::Point2f mapped = gridFit.map(outside);
+    EXPECT_NEAR(expected.x, mapped.x, 0.5);
+    EXPECT_NEAR(expected.y, mapped.y, 0.5);
+}
+
+TEST(TestGridFit, outlier) {
+    GridFit gridFit;
+    for (unsigned row = 0; row < 4; ++row) {
+        for (unsigned col = 0; col < 6; ++col) {
+            const cv::Point2f nominal((col + 0.5f) * PITCH, (row + 0.5f) * PITCH);
+            gridFit.addWell(nominal, nominal + cv::Point2f(10, 10));
+        }
+    }
+
+    // a symbol etched well away from the middle of its tube
+    gridFit.addWell(cv::Point2f(0.5f * PITCH, 4.5f * PITCH),
+            cv::Point2f(0.5f * PITCH + 80, 4.5f * PITCH + 10));
+    ASSERT_TRUE(gridFit.fit());
+
+    EXPECT_NEAR(1, gridFit.getScale(), 1e-4);
+    EXPECT_NEAR(0, gridFit.getRotation(), 1e-4);
+    const cv::Point2f mapped = gridFit.map(cv::Point2f(PITCH, PITCH));
+    EXPECT_NEAR(PITCH + 10, mapped.x, 0.5);
+    EXPECT_NEAR(PITCH + 10, mapped.y, 0.5);
+}
+
+TEST(TestGridFit, tooFewWells) {
+    GridFit gridFit;
+    gridFit.addWell(cv::Point2f(100, 100), cv::Point2f(110, 100));
+    gridFit.addWell(cv::Point2f(300, 100), cv::Point2f(310, 100));
+    EXPECT_FALSE(gridFit.fit());
+
+    // every well at the same place does not give a grid
+    GridFit samePlace;
+    for (unsigned i = 0; i < GridFit::MIN_WELLS; ++i) {
+        samePlace.addWell(cv::Point2f(100, 100), cv::Point2f(110, 100));
+    }
+    EXPECT_FALSE(samePlace.fit());
+}
+
+} /* namespace */
@@ -10,6 +10,7 @@
 #include "decoder/WellRectangle.h"
 
 #include <gtest/gtest.h>
+#include <math.h>
 
 namespace {
 
@@ -19,4 +20,45 @@ TEST(TestWellRectangle, getRectangle) {
     WellRectangle wr("label", 5, 5, 20, 20);
 }
 
+TEST(TestWellRectangle, quad) {
+    // a rectangle's corners are not treated as a quad
+    const cv::Point2f square[4] = {
+            cv::Point2f(5, 5), cv::Point2f(25, 5), cv::Point2f(25, 25), cv::Point2f(5, 25)
+    };
+    WellRectangle squareWell("label", square);
+    EXPECT_FALSE(squareWell.isQuad());
+    EXPECT_EQ(cv::Rect(5, 5, 20, 20), squareWell.getRectangle());
+
+    // rotated by 45 degrees, it only fills half of its bounding box
+    const cv::Point2f diamond[4] = {
+            cv::Point2f(50, 0.5f), cv::Point2f(99.5f, 50), cv::Point2f(50, 99.5f),
+            cv::Point2f(0.5f, 50)
+    };
+    WellRectangle diamondWell("label", diamond);
+    EXPECT_TRUE(diamondWell.isQuad());
+    EXPECT_EQ(cv::Rect(0, 0, 100, 100), diamondWell.getRectangle());
+    EXPECT_NEAR(49.5 * sqrt(2.0), diamondWell.getMinSide(), 0.01);
+}
+
+TEST(TestWellRectangle, getRowSpan) {
+    float xmin, xmax;
+
+    WellRectangle rectWell("label", 5, 5, 20, 20);
+    EXPECT_TRUE(rectWell.getRowSpan(10, xmin, xmax));
+    EXPECT_EQ(0, xmin);
+    EXPECT_EQ(20, xmax);
+
+    const cv::Point2f diamond[4] = {
+            cv::Point2f(50, 0), cv::Point2f(100, 50), cv::Point2f(50, 100), cv::Point2f(0, 50)
+    };
+    WellRectangle diamondWell("label", diamond);
+    EXPECT_TRUE(diamondWell.getRowSpan(50, xmin, xmax));
+    EXPECT_NEAR(0, xmin, 0.01);
+    EXPECT_NEAR(100, xmax, 0.01);
+    EXPECT_TRUE(diamondWell.getRowSpan(25, xmin, xmax));
+    EXPECT_NEAR(25, xmin, 0.01);
+    EXPECT_NEAR(75, xmax, 0.01);
+    EXPECT_FALSE(diamondWell.getRowSpan(101, xmin, xmax));
+}
+
 } /* namespace */
@@ -0,0 +1,152 @@
+/*
+ * CorpusGen.cpp
+ *
+ * Writes a corpus of synthetic plate images, each with an image information
+ * file giving the message in every well, that can be used by the benchmark,
+ * the parameter sweep and the tests in place of scanned images.
+ *
+ * Plate i of a run is generated from seed + i, so a corpus can be recreated
+ * exactly from the command line that made it.
+ */
+
+#include "DmScanLib.h"
+#include "test/PlateGenerator.h"
+
+#define GLOG_NO_ABBREVIATED_SEVERITIES
+#include <glog/logging.h>
+#include <gflags/gflags.h>
+#include <opencv/cv.h>
+#include <opencv/highgui.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace dmscanlib {
+
+namespace test {
+
+std::string usage(
+        "Writes synthetic plate images with image information files for use "
+        "as a test corpus.\n\n"
+        "Sample usage:\n"
+        );
+
+DEFINE_string(out, "syntheticImages", "directory the images and image information "
+        "files are written to.");
+DEFINE_int32(plates, 10, "number of plates to generate.");
+DEFINE_int32(seed, 1, "seed of the first plate.");
+DEFINE_int32(rows, 8, "rows of wells in each plate.");
+DEFINE_int32(cols, 12, "columns of wells in each plate.");
+DEFINE_int32(dpi, 600, "resolution of the images.");
+DEFINE_double(pitch_mm, 9.0, "distance between the centres of neighbouring wells.");
+DEFINE_double(symbol_mm, 2.4, "length of a side of each barcode.");
+DEFINE_int32(digits, 10, "number of digits in each message.");
+DEFINE_double(rotation, 45.0, "largest rotation of a barcode, in degrees.");
+DEFINE_double(empty, 0.05, "chance of a well having no tube.");
+DEFINE_double(blur, 0.8, "standard deviation of the blur, in pixels.");
+DEFINE_double(noise, 4.0, "standard deviation of the noise, in grey levels.");
+DEFINE_int32(contrast, 150, "grey levels between a module and the tube bottom.");
+DEFINE_string(orientation, "landscape", "orientation of the plate, landscape or portrait.");
+DEFINE_string(position, "bottom", "barcode position, top or bottom.");
+
+bool makeDirectory(const std::string & dir) {
+    if ((mkdir(dir.c_str(), 0755) != 0) && (errno != EEXIST)) {
+        std::cerr << "could not create directory: " << dir << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool writePlate(const PlateGenerator & generator, unsigned seed, const std::string & dir) {
+    char basename[32];
+    snprintf(basename, sizeof(basename), "plate_%05u", seed);
+    const std::string imageFilename = dir + "/" + basename + ".png";
+    const std::string infoFilename = dir + "/" + basename + ".nfo";
+
+    GeneratedPlate plate;
+    generator.generate(seed, plate);
+
+    if (!cv::imwrite(imageFilename, plate.image)) {
+        std::cerr << "could not write image: " << imageFilename << std::endl;
+        return false;
+    }
+
+    std::ofstream ofile(infoFilename.c_str());
+    generator.writeInfo(ofile, imageFilename, plate);
+    if (!ofile.good()) {
+        std::cerr << "could not write image information: " << infoFilename << std::endl;
+        return false;
+    }
+
+    VLOG(1) << "writePlate: " << infoFilename;
+    return true;
+}
+
+} /* namespace */
+
+} /* namespace */
+
+using namespace dmscanlib;
+using namespace test;
+
+int main(int argc, char **argv) {
+    usage.append(argv[0]).append(" [--out=syntheticImages] [--plates=10] [--seed=1] "
+            "[--rows=8] [--cols=12] [--dpi=600] [--blur=0.8] [--noise=4]");
+
+    google::SetUsageMessage(usage);
+    google::ParseCommandLineFlags(&argc, &argv, true);
+
+    DmScanLib::configLogging(0, false);
+
+    if ((FLAGS_plates < 0) || (FLAGS_seed < 0) || (FLAGS_rows <= 0) || (FLAGS_cols <= 0)
+            || (FLAGS_dpi <= 0) || (FLAGS_digits <= 0) || (FLAGS_contrast < 0)) {
+        std::cerr << "invalid plate options" << std::endl;
+        return 1;
+    }
+
+    PlateOptions options;
+    options.rows = static_cast<unsigned>(FLAGS_rows);
+    options.cols = static_cast<unsigned>(FLAGS_cols);
+    options.dpi = static_cast<unsigned>(FLAGS_dpi);
+    options.pitchMm = FLAGS_pitch_mm;
+    options.symbolMm = FLAGS_symbol_mm;
+    options.digits = static_cast<unsigned>(FLAGS_digits);
+    options.maxRotation = FLAGS_rotation;
+    options.emptyFraction = FLAGS_empty;
+    options.blurSigma = FLAGS_blur;
+    options.noiseSigma = FLAGS_noise;
+    options.contrast = FLAGS_contrast;
+
+    options.orientation = DmScanLib::getOrientationFromString(FLAGS_orientation);
+    options.barcodePosition = DmScanLib::getBarcodePositionFromString(FLAGS_position);
+    if ((options.orientation == ORIENTATION_MAX)
+            || (options.barcodePosition == BARCODE_POSITION_MAX)) {
+        std::cerr << "invalid orientation or barcode position" << std::endl;
+        return 1;
+    }
+
+    if (!makeDirectory(FLAGS_out)) {
+        return 1;
+    }
+
+    try {
+        PlateGenerator generator(options);
+        for (int i = 0; i < FLAGS_plates; ++i) {
+            if (!writePlate(generator, static_cast<unsigned>(FLAGS_seed + i), FLAGS_out)) {
+                return 1;
+            }
+        }
+    } catch (const std::invalid_argument & ex) {
+        std::cerr << ex.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << FLAGS_plates << " plates written to " << FLAGS_out << std::endl;
+    return 0;
+}
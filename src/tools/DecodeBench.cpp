@@ -0,0 +1,602 @@
+/*
+ * DecodeBench.cpp
+ *
+ * Decodes the images in the test image corpus and reports the wall clock and
+ * CPU time spent in each stage of the decoding pipeline.
+ */
+
+#include "DmScanLib.h"
+#include "Image.h"
+#include "decoder/DecodeOptions.h"
+#include "decoder/Decoder.h"
+#include "decoder/DmtxDecodeHelper.h"
+#include "decoder/WellRectangle.h"
+#include "test/TestCommon.h"
+#include "test/ImageInfo.h"
+#include "utils/DmLatencyHistogram.h"
+
+#define GLOG_NO_ABBREVIATED_SEVERITIES
+#include <glog/logging.h>
+#include <gflags/gflags.h>
+#include <dmtx.h>
+#include <opencv/cv.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <time.h>
+
+namespace dmscanlib {
+
+namespace test {
+
+std::string usage(
+        "Decodes the images listed in the test image information files and "
+        "reports the time taken by each stage of the decoding pipeline.\n\n"
+        "Sample usage:\n"
+        );
+
+DEFINE_string(dir, "testImageInfo", "directory searched for image information files.");
+DEFINE_int32(warmup, 1, "number of times each image is decoded before timing starts.");
+DEFINE_int32(reps, 5, "number of timed decodes for each image.");
+DEFINE_string(json, "bench_baseline.json", "file the results are written to as JSON, "
+        "empty to disable.");
+DEFINE_string(decoded, "bench_decoded.png", "file the annotated image is written to.");
+
+/*
+ * The stages up to STAGE_ANNOTATE are timed on a single thread, one well at a
+ * time. STAGE_PIPELINE is their sum. STAGE_LIBRARY is a full call to
+ * DmScanLib::decodeImageWells(), which decodes the wells on the worker
+ * threads; its CPU time includes all threads. STAGE_LIBRARY_LOCATE is the
+ * same call with tube location enabled.
+ */
+enum Stage {
+    STAGE_LOAD,
+    STAGE_GRAYSCALE,
+    STAGE_FILTER,
+    STAGE_CROP,
+    STAGE_REGION_FIND,
+    STAGE_MODULE_READ,
+    STAGE_DECODE,
+    STAGE_ANNOTATE,
+    STAGE_PIPELINE,
+    STAGE_LIBRARY,
+    STAGE_LIBRARY_LOCATE,
+    STAGE_MAX
+};
+
+const char * STAGE_NAMES[STAGE_MAX] = {
+        "load",
+        "grayscale",
+        "filter",
+        "crop",
+        "regionFind",
+        "moduleRead",
+        "decode",
+        "annotate",
+        "pipeline",
+        "library",
+        "libraryLocate"
+};
+
+struct StageTime {
+    double wall;
+    double cpu;
+};
+
+double getClockSeconds(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+}
+
+/*
+ * Adds the time between construction and stop() to a stage.
+ */
+class StageTimer {
+public:
+    StageTimer(StageTime & _stageTime, clockid_t _cpuClock = CLOCK_THREAD_CPUTIME_ID) :
+            stageTime(_stageTime),
+            cpuClock(_cpuClock),
+            wallStart(util::getMonotonicNanos()),
+            cpuStart(getClockSeconds(cpuClock))
+    {
+    }
+
+    void stop() {
+        stageTime.wall += util::nanosToSeconds(util::getMonotonicNanos() - wallStart);
+        stageTime.cpu += getClockSeconds(cpuClock) - cpuStart;
+    }
+
+private:
+    StageTime & stageTime;
+    const clockid_t cpuClock;
+    const util::DmNanos wallStart;
+    const double cpuStart;
+};
+
+/*
+ * Timing samples for a group of images. There is one sample per stage for
+ * each timed decode of an image.
+ */
+class BenchGroup {
+public:
+    BenchGroup() :
+            images(0),
+            wells(0),
+            decoded(0),
+            libraryDecoded(0),
+            locateDecoded(0),
+            wellPixels(0),
+            searchPixels(0)
+    {
+    }
+
+    void addSample(const StageTime (&times)[STAGE_MAX]) {
+        for (unsigned i = 0; i < STAGE_MAX; ++i) {
+            wall[i].push_back(times[i].wall);
+            cpu[i].push_back(times[i].cpu);
+        }
+    }
+
+    double wellsPerSec(Stage stage) const {
+        double total = 0;
+        for (unsigned i = 0, n = wall[stage].size(); i < n; ++i) {
+            total += wall[stage][i];
+        }
+        return (total > 0) ? static_cast<double>(wells) / total : 0;
+    }
+
+    static double percentile(std::vector<double> samples, double p) {
+        if (samples.empty()) {
+            return 0;
+        }
+        std::sort(samples.begin(), samples.end());
+        unsigned rank = static_cast<unsigned>(p * (samples.size() - 1) + 0.5);
+        return samples[rank];
+    }
+
+    // median library time without tube location over the time with it
+    double locateSpeedup() const {
+        const double locateTime = percentile(wall[STAGE_LIBRARY_LOCATE], 0.5);
+        return (locateTime > 0) ? percentile(wall[STAGE_LIBRARY], 0.5) / locateTime : 0;
+    }
+
+    // fraction of the wells' pixels searched once the tubes are located
+    double searchFraction() const {
+        return (wellPixels > 0) ? static_cast<double>(searchPixels) / wellPixels : 0;
+    }
+
+    unsigned images;
+    unsigned wells;
+    unsigned decoded;
+    unsigned libraryDecoded;
+    unsigned locateDecoded;
+    long wellPixels;
+    long searchPixels;
+    std::vector<double> wall[STAGE_MAX];
+    std::vector<double> cpu[STAGE_MAX];
+};
+
+class DecodeBench {
+public:
+    DecodeBench(const DecodeOptions & _decodeOptions) :
+            decodeOptions(_decodeOptions)
+    {
+    }
+
+    virtual ~DecodeBench() {
+    }
+
+    bool run(const std::string & dirname);
+
+    void report(std::ostream & os) const;
+
+    void writeJson(std::ostream & os) const;
+
+private:
+    unsigned decodeImage(
+            const std::string & filename,
+            const std::vector<std::unique_ptr<const WellRectangle> > & wellRects,
+            StageTime (&times)[STAGE_MAX],
+            util::DmLatencyHistogram * latency);
+
+    bool decodeWell(
+            const Image & wellImage,
+            const WellRectangle & wellRect,
+            decoder::DmtxDecodeHelper & dmtxDecode,
+            StageTime (&times)[STAGE_MAX]);
+
+    unsigned decodeLibrary(
+            const std::string & filename,
+            std::vector<std::unique_ptr<const WellRectangle> > & wellRects,
+            StageTime & time);
+
+    void measureSearchArea(
+            const std::string & filename,
+            std::vector<std::unique_ptr<const WellRectangle> > & wellRects,
+            BenchGroup & all,
+            BenchGroup & group);
+
+    void reportStats(
+            std::ostream & os,
+            const std::vector<double> & samples) const;
+
+    void writeJsonStats(
+            std::ostream & os,
+            const std::vector<double> & samples) const;
+
+    const DecodeOptions & decodeOptions;
+    std::map<std::string, BenchGroup> groups;
+
+    // crop and decode time of every well in the timed pipeline decodes
+    util::DmLatencyHistogram wellLatency;
+};
+
+bool DecodeBench::run(const std::string & dirname) {
+    std::vector<std::string> filenames;
+    if (!test::getTestImageInfoFilenames(dirname, filenames)) {
+        std::cerr << "could not read directory: " << dirname << std::endl;
+        return false;
+    }
+    std::sort(filenames.begin(), filenames.end());
+
+    for (unsigned i = 0, n = filenames.size(); i < n; ++i) {
+        ImageInfo imageInfo(filenames[i]);
+        if (!imageInfo.isValid()) {
+            std::cerr << "skipping invalid image info file: " << filenames[i] << std::endl;
+            continue;
+        }
+
+        std::vector<std::unique_ptr<const WellRectangle> > wellRects;
+        test::getWellRectsForBoundingBox(
+                imageInfo.getBoundingBox(),
+                imageInfo.getPalletRows(),
+                imageInfo.getPalletCols(),
+                imageInfo.getOrientation(),
+                imageInfo.getBarcodePosition(),
+                wellRects);
+
+        std::ostringstream palletSize;
+        palletSize << imageInfo.getPalletRows() << "x" << imageInfo.getPalletCols();
+
+        BenchGroup & all = groups["all"];
+        BenchGroup & group = groups[palletSize.str()];
+        ++all.images;
+        ++group.images;
+
+        std::cout << "decoding: " << imageInfo.getImageFilename() << std::endl;
+
+        measureSearchArea(imageInfo.getImageFilename(), wellRects, all, group);
+
+        for (int rep = -FLAGS_warmup; rep < FLAGS_reps; ++rep) {
+            StageTime times[STAGE_MAX] = {};
+            unsigned decoded = decodeImage(imageInfo.getImageFilename(), wellRects, times,
+                    (rep < 0) ? NULL : &wellLatency);
+            unsigned libraryDecoded = decodeLibrary(imageInfo.getImageFilename(), wellRects,
+                    times[STAGE_LIBRARY]);
+
+            DmScanLib::setLocateTubes(true);
+            unsigned locateDecoded = decodeLibrary(imageInfo.getImageFilename(), wellRects,
+                    times[STAGE_LIBRARY_LOCATE]);
+            DmScanLib::setLocateTubes(false);
+
+            if (rep < 0) {
+                continue;
+            }
+
+            all.addSample(times);
+            group.addSample(times);
+            all.wells += wellRects.size();
+            group.wells += wellRects.size();
+            all.decoded += decoded;
+            group.decoded += decoded;
+            all.libraryDecoded += libraryDecoded;
+            group.libraryDecoded += libraryDecoded;
+            all.locateDecoded += locateDecoded;
+            group.locateDecoded += locateDecoded;
+        }
+    }
+    return true;
+}
+
+/*
+ * Runs the same steps as DmScanLib::decodeImageWells() but on the calling
+ * thread only, so that each stage can be timed on its own.
+ */
+unsigned DecodeBench::decodeImage(
+        const std::string & filename,
+        const std::vector<std::unique_ptr<const WellRectangle> > & wellRects,
+        StageTime (&times)[STAGE_MAX],
+        util::DmLatencyHistogram * latency) {
+    StageTimer pipelineTimer(times[STAGE_PIPELINE]);
+
+    StageTimer loadTimer(times[STAGE_LOAD]);
+    Image image(filename);
+    loadTimer.stop();
+    CHECK(image.isValid()) << "could not load image: " << filename;
+
+    StageTimer grayscaleTimer(times[STAGE_GRAYSCALE]);
+    Image grayscaleImage;
+    image.grayscale(grayscaleImage);
+    grayscaleTimer.stop();
+
+    StageTimer filterTimer(times[STAGE_FILTER]);
+    Image filteredImage;
+    grayscaleImage.applyFilters(filteredImage);
+    filterTimer.stop();
+
+    decoder::DmtxDecodeHelper dmtxDecode;
+    std::vector<bool> wellDecoded(wellRects.size());
+    unsigned decoded = 0;
+
+    for (unsigned i = 0, n = wellRects.size(); i < n; ++i) {
+        const cv::Rect & rect = wellRects[i]->getRectangle();
+        util::DmScopedTimer wellTimer(latency);
+
+        StageTimer cropTimer(times[STAGE_CROP]);
+        std::unique_ptr<const Image> wellImage =
+                filteredImage.crop(rect.x, rect.y, rect.width, rect.height);
+        cropTimer.stop();
+
+        wellDecoded[i] = decodeWell(*wellImage, *wellRects[i], dmtxDecode, times);
+        wellTimer.stop();
+        if (wellDecoded[i]) {
+            ++decoded;
+        }
+    }
+
+    StageTimer annotateTimer(times[STAGE_ANNOTATE]);
+    Image decodedImage(image);
+    for (unsigned i = 0, n = wellRects.size(); i < n; ++i) {
+        decodedImage.drawRectangle(wellRects[i]->getRectangle(),
+                wellDecoded[i] ? cv::Scalar(0, 255, 0) : cv::Scalar(0, 0, 255));
+    }
+    decodedImage.write(FLAGS_decoded);
+    annotateTimer.stop();
+
+    pipelineTimer.stop();
+    return decoded;
+}
+
+/*
+ * Uses the same decode properties, quad masking and retry at shrink + 1 as
+ * Decoder::decodeAttempt() without tube location.
+ */
+bool DecodeBench::decodeWell(
+        const Image & wellImage,
+        const WellRectangle & wellRect,
+        decoder::DmtxDecodeHelper & dmtxDecode,
+        StageTime (&times)[STAGE_MAX]) {
+    DmtxImage * dmtxImage = wellImage.dmtxImage();
+    CHECK_NOTNULL(dmtxImage);
+
+    // the edge lengths are relative to the well, not to its bounding box
+    unsigned mindim = static_cast<unsigned>(wellRect.getMinSide());
+
+    const int props[] = {
+            DmtxPropEdgeMin, static_cast<int>(decodeOptions.minEdgeFactor * mindim),
+            DmtxPropEdgeMax, static_cast<int>(decodeOptions.maxEdgeFactor * mindim),
+            DmtxPropScanGap, static_cast<int>(decodeOptions.scanGapFactor * mindim),
+            DmtxPropSymbolSize, DmtxSymbolSquareAuto,
+            DmtxPropSquareDevn, static_cast<int>(decodeOptions.squareDev),
+            DmtxPropEdgeThresh, static_cast<int>(decodeOptions.edgeThresh)
+    };
+
+    bool decoded = false;
+
+    for (int scale = decodeOptions.shrink;
+            !decoded && (scale <= decodeOptions.shrink + 1); ++scale) {
+        // building the scan grid is counted as part of the region search
+        StageTimer resetTimer(times[STAGE_REGION_FIND]);
+        dmtxDecode.reset(dmtxImage, scale);
+        dmtxDecode.setProperties(props, sizeof(props) / (2 * sizeof(props[0])));
+        if (wellRect.isQuad()) {
+            Decoder::maskOutsideWell(dmtxDecode, wellRect, NULL, scale);
+        }
+        resetTimer.stop();
+
+        DmtxDecode * dec = dmtxDecode.getDecode();
+
+        while (1) {
+            StageTimer findTimer(times[STAGE_REGION_FIND]);
+            DmtxRegion * reg = dmtxRegionFindNext(dec, NULL);
+            findTimer.stop();
+
+            if (reg == NULL) {
+                break;
+            }
+
+            StageTimer readTimer(times[STAGE_MODULE_READ]);
+            DmtxMessage * msg = dmtxDecodeReadModules(dec, reg);
+            readTimer.stop();
+
+            if (msg != NULL) {
+                StageTimer decodeTimer(times[STAGE_DECODE]);
+                msg = dmtxDecodePopulatedArray(reg->sizeIdx, msg,
+                        static_cast<int>(decodeOptions.corrections));
+                if (msg != NULL) {
+                    dmtxDecodeMarkRegion(dec, reg);
+                    dmtxMessageDestroy(&msg);
+                    decoded = true;
+                }
+                decodeTimer.stop();
+            }
+            dmtxRegionDestroy(&reg);
+        }
+    }
+    dmtxImageDestroy(&dmtxImage);
+    return decoded;
+}
+
+unsigned DecodeBench::decodeLibrary(
+        const std::string & filename,
+        std::vector<std::unique_ptr<const WellRectangle> > & wellRects,
+        StageTime & time) {
+    DmScanLib dmScanLib(0);
+
+    StageTimer libraryTimer(time, CLOCK_PROCESS_CPUTIME_ID);
+    int result = dmScanLib.decodeImageWells(filename.c_str(), decodeOptions, wellRects);
+    libraryTimer.stop();
+
+    if (result != SC_SUCCESS) {
+        return 0;
+    }
+    return dmScanLib.getDecodedWellCount();
+}
+
+/*
+ * Decodes the image once, untimed, with tube location and metrics enabled to
+ * count how many of the wells' pixels are left to search.
+ */
+void DecodeBench::measureSearchArea(
+        const std::string & filename,
+        std::vector<std::unique_ptr<const WellRectangle> > & wellRects,
+        BenchGroup & all,
+        BenchGroup & group) {
+    DmScanLib dmScanLib(0);
+
+    DmScanLib::setMetricsEnabled(true);
+    DmScanLib::setLocateTubes(true);
+    dmScanLib.decodeImageWells(filename.c_str(), decodeOptions, wellRects);
+    DmScanLib::setLocateTubes(false);
+    DmScanLib::setMetricsEnabled(false);
+
+    const DecodeMetrics & metrics = dmScanLib.getMetrics();
+    all.wellPixels += metrics.getCount(DecodeMetrics::WELL_PIXELS);
+    group.wellPixels += metrics.getCount(DecodeMetrics::WELL_PIXELS);
+    all.searchPixels += metrics.getCount(DecodeMetrics::SEARCH_PIXELS);
+    group.searchPixels += metrics.getCount(DecodeMetrics::SEARCH_PIXELS);
+}
+
+void DecodeBench::reportStats(
+        std::ostream & os,
+        const std::vector<double> & samples) const {
+    os << std::setw(10) << BenchGroup::percentile(samples, 0) * 1000
+            << std::setw(10) << BenchGroup::percentile(samples, 0.5) * 1000
+            << std::setw(10) << BenchGroup::percentile(samples, 0.95) * 1000;
+}
+
+void DecodeBench::report(std::ostream & os) const {
+    os << std::fixed << std::setprecision(2);
+
+    for (std::map<std::string, BenchGroup>::const_iterator ii = groups.begin();
+            ii != groups.end(); ++ii) {
+        const BenchGroup & group = ii->second;
+
+        os << "\n" << ii->first << ": images/" << group.images
+                << " wells/" << group.wells
+                << " decoded/" << group.decoded
+                << " library decoded/" << group.libraryDecoded
+                << " located decoded/" << group.locateDecoded << "\n"
+                << std::left << std::setw(12) << "stage" << std::right
+                << std::setw(30) << "wall ms (min/median/p95)"
+                << std::setw(30) << "cpu ms (min/median/p95)" << "\n";
+
+        for (unsigned i = 0; i < STAGE_MAX; ++i) {
+            os << std::left << std::setw(12) << STAGE_NAMES[i] << std::right;
+            reportStats(os, group.wall[i]);
+            reportStats(os, group.cpu[i]);
+            os << "\n";
+        }
+
+        os << "wells/s: pipeline/" << group.wellsPerSec(STAGE_PIPELINE)
+                << " library/" << group.wellsPerSec(STAGE_LIBRARY)
+                << " located/" << group.wellsPerSec(STAGE_LIBRARY_LOCATE) << "\n";
+        os << "tube location: searched area/" << group.searchFraction() * 100
+                << "% speedup/" << group.locateSpeedup() << "\n";
+    }
+
+    os << "\nwell latency: " << wellLatency << "\n";
+}
+
+void DecodeBench::writeJsonStats(
+        std::ostream & os,
+        const std::vector<double> & samples) const {
+    os << "{ \"min\": " << BenchGroup::percentile(samples, 0)
+            << ", \"median\": " << BenchGroup::percentile(samples, 0.5)
+            << ", \"p95\": " << BenchGroup::percentile(samples, 0.95) << " }";
+}
+
+/*
+ * Times are in seconds. The file can be kept as a baseline and compared with
+ * the output of a later build.
+ */
+void DecodeBench::writeJson(std::ostream & os) const {
+    os << std::setprecision(9);
+    os << "{\n  \"warmup\": " << FLAGS_warmup
+            << ",\n  \"reps\": " << FLAGS_reps
+            << ",\n  \"wellLatency\": { \"count\": " << wellLatency.getCount()
+            << ", \"p50\": " << util::nanosToSeconds(wellLatency.getPercentile(50))
+            << ", \"p99\": " << util::nanosToSeconds(wellLatency.getPercentile(99))
+            << ", \"p999\": " << util::nanosToSeconds(wellLatency.getPercentile(99.9))
+            << ", \"max\": " << util::nanosToSeconds(wellLatency.getMax()) << " }"
+            << ",\n  \"groups\": {";
+
+    for (std::map<std::string, BenchGroup>::const_iterator ii = groups.begin();
+            ii != groups.end(); ++ii) {
+        const BenchGroup & group = ii->second;
+
+        os << ((ii == groups.begin()) ? "" : ",")
+                << "\n    \"" << ii->first << "\": {"
+                << "\n      \"images\": " << group.images
+                << ",\n      \"wells\": " << group.wells
+                << ",\n      \"decoded\": " << group.decoded
+                << ",\n      \"libraryDecoded\": " << group.libraryDecoded
+                << ",\n      \"pipelineWellsPerSec\": " << group.wellsPerSec(STAGE_PIPELINE)
+                << ",\n      \"locateDecoded\": " << group.locateDecoded
+                << ",\n      \"libraryWellsPerSec\": " << group.wellsPerSec(STAGE_LIBRARY)
+                << ",\n      \"locateWellsPerSec\": " << group.wellsPerSec(STAGE_LIBRARY_LOCATE)
+                << ",\n      \"locateSearchFraction\": " << group.searchFraction()
+                << ",\n      \"locateSpeedup\": " << group.locateSpeedup()
+                << ",\n      \"stages\": {";
+
+        for (unsigned i = 0; i < STAGE_MAX; ++i) {
+            os << ((i == 0) ? "" : ",")
+                    << "\n        \"" << STAGE_NAMES[i] << "\": {\n          \"wall\": ";
+            writeJsonStats(os, group.wall[i]);
+            os << ",\n          \"cpu\": ";
+            writeJsonStats(os, group.cpu[i]);
+            os << "\n        }";
+        }
+        os << "\n      }\n    }";
+    }
+    os << "\n  }\n}\n";
+}
+
+} /* namespace */
+
+} /* namespace */
+
+using namespace dmscanlib;
+using namespace test;
+
+int main(int argc, char **argv) {
+    usage.append(argv[0]).append(" [--dir=testImageInfo] [--reps=5] [--json=FILE]");
+
+    google::SetUsageMessage(usage);
+    google::ParseCommandLineFlags(&argc, &argv, true);
+
+    DmScanLib::configLogging(0, false);
+
+    std::unique_ptr<DecodeOptions> decodeOptions = test::getDefaultDecodeOptions();
+    DecodeBench bench(*decodeOptions);
+
+    if (!bench.run(FLAGS_dir)) {
+        return 1;
+    }
+
+    bench.report(std::cout);
+
+    if (!FLAGS_json.empty()) {
+        std::ofstream ofile(FLAGS_json.c_str());
+        bench.writeJson(ofile);
+    }
+    return 0;
+}
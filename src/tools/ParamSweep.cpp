@@ -0,0 +1,533 @@
+/*
+ * ParamSweep.cpp
+ *
+ * Decodes the images in the test image corpus with every combination of the
+ * minimum edge, maximum edge and scan gap factors, and reports the
+ * combinations on the Pareto frontier of decode rate against decode time.
+ *
+ * Each image is loaded and preprocessed once. The preprocessed images stay in
+ * memory for the whole sweep and can also be cached on disk, where they are
+ * memory mapped by later runs. The combinations are decoded in parallel, one
+ * combination per thread at a time, with the wells of each plate decoded on
+ * that thread.
+ */
+
+#include "DmScanLib.h"
+#include "Image.h"
+#include "decoder/Decoder.h"
+#include "decoder/DecodeOptions.h"
+#include "decoder/WellRectangle.h"
+#include "decoder/PlateLayout.h"
+#include "test/TestCommon.h"
+#include "test/ImageInfo.h"
+
+#define GLOG_NO_ABBREVIATED_SEVERITIES
+#include <glog/logging.h>
+#include <gflags/gflags.h>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <OpenThreads/Thread>
+#include <opencv/cv.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace dmscanlib {
+
+namespace test {
+
+std::string usage(
+        "Decodes the images listed in the test image information files with "
+        "each combination of decode parameters and reports the best ones.\n\n"
+        "Sample usage:\n"
+        );
+
+DEFINE_string(dir, "testImageInfo", "directory searched for image information files.");
+DEFINE_string(cache, "", "directory where preprocessed images are cached, "
+        "empty to disable.");
+DEFINE_int32(threads, 0, "number of threads, 0 to use one per processor.");
+DEFINE_double(step, 0.05, "step between the values of each factor.");
+DEFINE_double(max_edge_min, 0.15, "smallest maximum edge factor.");
+DEFINE_double(factor_max, 1.0, "largest value of each factor.");
+DEFINE_string(csv, "sweep_results.csv", "file the result of each combination "
+        "is written to, empty to disable.");
+
+double getThreadCpuSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+}
+
+/*
+ * A preprocessed image saved as a header followed by its rows of pixels, so
+ * that it can be memory mapped and decoded without being copied. The file
+ * records the modification time of the source image and is not used once the
+ * source changes.
+ */
+class PreprocessedFile {
+public:
+    PreprocessedFile() :
+            data(NULL),
+            length(0)
+    {
+    }
+
+    virtual ~PreprocessedFile() {
+        if (data != NULL) {
+            munmap(data, length);
+        }
+    }
+
+    static bool write(const std::string & filename, const Image & image,
+            time_t sourceTime);
+
+    std::unique_ptr<Image> map(const std::string & filename, time_t sourceTime);
+
+private:
+    struct Header {
+        char magic[8];
+        unsigned width;
+        unsigned height;
+        long long sourceTime;
+    };
+
+    static const char MAGIC[8];
+
+    void * data;
+    size_t length;
+
+    PreprocessedFile(const PreprocessedFile &);
+    PreprocessedFile & operator=(const PreprocessedFile &);
+};
+
+const char PreprocessedFile::MAGIC[8] = { 'D', 'M', 'S', 'P', 'R', 'E', '0', '1' };
+
+bool PreprocessedFile::write(const std::string & filename, const Image & image,
+        time_t sourceTime) {
+    const cv::Mat mat = image.getOriginalImage();
+    CHECK_EQ(CV_8UC1, mat.type());
+
+    Header header;
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.width = mat.cols;
+    header.height = mat.rows;
+    header.sourceTime = sourceTime;
+
+    FILE * file = fopen(filename.c_str(), "wb");
+    if (file == NULL) {
+        return false;
+    }
+    bool ok = (fwrite(&header, sizeof(header), 1, file) == 1);
+    for (int row = 0; ok && (row < mat.rows); ++row) {
+        ok = (fwrite(mat.ptr(row), 1, mat.cols, file) == static_cast<size_t>(mat.cols));
+    }
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        remove(filename.c_str());
+    }
+    return ok;
+}
+
+std::unique_ptr<Image> PreprocessedFile::map(const std::string & filename,
+        time_t sourceTime) {
+    CHECK(data == NULL);
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return std::unique_ptr<Image>();
+    }
+
+    struct stat st;
+    Header header;
+    if ((fstat(fd, &st) != 0)
+            || (static_cast<size_t>(st.st_size) < sizeof(header))
+            || (read(fd, &header, sizeof(header)) != sizeof(header))
+            || (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+            || (header.sourceTime != sourceTime)
+            || (static_cast<size_t>(st.st_size) != sizeof(header)
+                    + static_cast<size_t>(header.width) * header.height)) {
+        close(fd);
+        return std::unique_ptr<Image>();
+    }
+
+    // a private writable mapping, pages are only copied if they are written to
+    length = st.st_size;
+    void * mapped = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return std::unique_ptr<Image>();
+    }
+    data = mapped;
+
+    cv::Mat mat(header.height, header.width, CV_8UC1,
+            static_cast<char *>(data) + sizeof(header));
+    return std::unique_ptr<Image>(new Image(mat));
+}
+
+/*
+ * An image from the corpus after preprocessing, with its well rectangles and
+ * the layout built from them, which every decode of the image shares.
+ */
+struct SweepImage {
+    std::string filename;
+    unsigned expected;
+    std::vector<std::unique_ptr<const WellRectangle> > wellRects;
+    std::shared_ptr<const PlateLayout> layout;
+    std::unique_ptr<Image> image;
+    PreprocessedFile mapping;
+};
+
+struct SweepResult {
+    double minEdge;
+    double maxEdge;
+    double scanGap;
+    unsigned decoded;
+    unsigned expected;
+    double cpuTime;
+    bool pareto;
+
+    double getRatio() const {
+        return (expected > 0) ? static_cast<double>(decoded) / expected : 0;
+    }
+};
+
+bool compareByTime(const SweepResult * a, const SweepResult * b) {
+    if (a->cpuTime != b->cpuTime) {
+        return a->cpuTime < b->cpuTime;
+    }
+    return a->getRatio() > b->getRatio();
+}
+
+class ParamSweep {
+public:
+    ParamSweep(const DecodeOptions & _defaultOptions) :
+            defaultOptions(_defaultOptions),
+            nextResult(0)
+    {
+    }
+
+    virtual ~ParamSweep() {
+    }
+
+    bool load(const std::string & dirname, const std::string & cacheDir);
+
+    void addCombinations(double step, double maxEdgeMin, double factorMax);
+
+    void run(unsigned numThreads);
+
+    void findParetoFrontier();
+
+    void report(std::ostream & os) const;
+
+    void writeCsv(std::ostream & os) const;
+
+private:
+    class Worker;
+
+    std::unique_ptr<Image> preprocess(const std::string & filename,
+            const std::string & cacheDir, PreprocessedFile & mapping);
+
+    bool getNextResult(SweepResult * & result);
+
+    void decode(SweepResult & result) const;
+
+    const DecodeOptions & defaultOptions;
+    std::vector<std::unique_ptr<SweepImage> > images;
+    std::vector<SweepResult> results;
+    unsigned nextResult;
+    OpenThreads::Mutex mutex;
+};
+
+/*
+ * Takes combinations from the sweep until there are none left.
+ */
+class ParamSweep::Worker : public OpenThreads::Thread {
+public:
+    Worker(ParamSweep & _sweep) :
+            sweep(_sweep)
+    {
+    }
+
+    void run() {
+        SweepResult * result;
+        while (sweep.getNextResult(result)) {
+            sweep.decode(*result);
+        }
+    }
+
+private:
+    ParamSweep & sweep;
+};
+
+bool ParamSweep::load(const std::string & dirname, const std::string & cacheDir) {
+    std::vector<std::string> filenames;
+    if (!test::getTestImageInfoFilenames(dirname, filenames)) {
+        std::cerr << "could not read directory: " << dirname << std::endl;
+        return false;
+    }
+    std::sort(filenames.begin(), filenames.end());
+
+    for (unsigned i = 0, n = filenames.size(); i < n; ++i) {
+        ImageInfo imageInfo(filenames[i]);
+        if (!imageInfo.isValid()) {
+            std::cerr << "skipping invalid image info file: " << filenames[i] << std::endl;
+            continue;
+        }
+
+        std::unique_ptr<SweepImage> sweepImage(new SweepImage());
+        sweepImage->filename = imageInfo.getImageFilename();
+        sweepImage->expected = imageInfo.getDecodedWellCount();
+        test::getWellRectsForBoundingBox(
+                imageInfo.getBoundingBox(),
+                imageInfo.getPalletRows(),
+                imageInfo.getPalletCols(),
+                imageInfo.getOrientation(),
+                imageInfo.getBarcodePosition(),
+                sweepImage->wellRects);
+        sweepImage->layout.reset(new PlateLayout(sweepImage->wellRects));
+
+        std::cout << "preprocessing: " << sweepImage->filename << std::endl;
+        sweepImage->image = preprocess(sweepImage->filename, cacheDir, sweepImage->mapping);
+        if (sweepImage->image.get() == NULL) {
+            std::cerr << "could not load image: " << sweepImage->filename << std::endl;
+            continue;
+        }
+        images.push_back(std::move(sweepImage));
+    }
+    return !images.empty();
+}
+
+std::unique_ptr<Image> ParamSweep::preprocess(const std::string & filename,
+        const std::string & cacheDir, PreprocessedFile & mapping) {
+    std::string cacheFilename;
+    time_t sourceTime = 0;
+
+    if (!cacheDir.empty()) {
+        struct stat st;
+        if (stat(filename.c_str(), &st) == 0) {
+            sourceTime = st.st_mtime;
+        }
+
+        std::string name(filename);
+        std::replace(name.begin(), name.end(), '/', '_');
+        cacheFilename = cacheDir + "/" + name + ".pre";
+
+        std::unique_ptr<Image> cached = mapping.map(cacheFilename, sourceTime);
+        if (cached.get() != NULL) {
+            return cached;
+        }
+    }
+
+    Image image(filename);
+    if (!image.isValid()) {
+        return std::unique_ptr<Image>();
+    }
+
+    std::unique_ptr<Image> result(new Image());
+    Decoder::preprocess(image, *result);
+
+    if (!cacheFilename.empty() && !PreprocessedFile::write(cacheFilename, *result, sourceTime)) {
+        std::cerr << "could not write cache file: " << cacheFilename << std::endl;
+    }
+    return result;
+}
+
+/*
+ * Factors are generated from integer multiples of the step so that rounding
+ * errors do not add or drop values at the end of a range. The minimum edge
+ * factor is never greater than the maximum edge factor.
+ */
+void ParamSweep::addCombinations(double step, double maxEdgeMin, double factorMax) {
+    const int last = static_cast<int>(factorMax / step + 0.5);
+    const int maxEdgeFirst = static_cast<int>(maxEdgeMin / step + 0.5);
+
+    for (int maxEdge = maxEdgeFirst; maxEdge <= last; ++maxEdge) {
+        for (int minEdge = 0; minEdge <= maxEdge; ++minEdge) {
+            for (int scanGap = 0; scanGap <= last; ++scanGap) {
+                SweepResult result = SweepResult();
+                result.minEdge = minEdge * step;
+                result.maxEdge = maxEdge * step;
+                result.scanGap = scanGap * step;
+                results.push_back(result);
+            }
+        }
+    }
+}
+
+bool ParamSweep::getNextResult(SweepResult * & result) {
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+    if (nextResult >= results.size()) {
+        return false;
+    }
+    result = &results[nextResult++];
+    if (nextResult % 100 == 0) {
+        std::cout << "combinations started: " << nextResult << "/" << results.size()
+                << std::endl;
+    }
+    return true;
+}
+
+/*
+ * Called by the worker threads. The time is the CPU time used by the calling
+ * thread, so that it does not depend on how many workers share the processors.
+ */
+void ParamSweep::decode(SweepResult & result) const {
+    DecodeOptions decodeOptions(
+            result.minEdge,
+            result.maxEdge,
+            result.scanGap,
+            defaultOptions.squareDev,
+            defaultOptions.edgeThresh,
+            defaultOptions.corrections,
+            defaultOptions.shrink);
+
+    for (unsigned i = 0, n = images.size(); i < n; ++i) {
+        SweepImage & sweepImage = *images[i];
+
+        double start = getThreadCpuSeconds();
+        Decoder decoder(*sweepImage.image, decodeOptions, sweepImage.layout, true);
+        decoder.setMultiThreaded(false);
+        int decodeResult = decoder.decodeWellRects();
+        result.cpuTime += getThreadCpuSeconds() - start;
+
+        result.expected += sweepImage.expected;
+        if (decodeResult == SC_SUCCESS) {
+            result.decoded += decoder.getDecodedWellCount();
+        }
+    }
+}
+
+void ParamSweep::run(unsigned numThreads) {
+    nextResult = 0;
+
+    std::vector<std::unique_ptr<Worker> > workers;
+    for (unsigned i = 0; i < numThreads; ++i) {
+        workers.push_back(std::unique_ptr<Worker>(new Worker(*this)));
+        workers[i]->start();
+    }
+    for (unsigned i = 0; i < numThreads; ++i) {
+        workers[i]->join();
+    }
+}
+
+/*
+ * A combination is on the frontier when no other combination decodes at
+ * least as many wells in less time.
+ */
+void ParamSweep::findParetoFrontier() {
+    std::vector<SweepResult *> sorted;
+    for (unsigned i = 0, n = results.size(); i < n; ++i) {
+        results[i].pareto = false;
+        sorted.push_back(&results[i]);
+    }
+    std::sort(sorted.begin(), sorted.end(), compareByTime);
+
+    double bestRatio = -1;
+    for (unsigned i = 0, n = sorted.size(); i < n; ++i) {
+        if (sorted[i]->getRatio() > bestRatio) {
+            sorted[i]->pareto = true;
+            bestRatio = sorted[i]->getRatio();
+        }
+    }
+}
+
+void ParamSweep::report(std::ostream & os) const {
+    std::vector<const SweepResult *> frontier;
+    for (unsigned i = 0, n = results.size(); i < n; ++i) {
+        if (results[i].pareto) {
+            frontier.push_back(&results[i]);
+        }
+    }
+    std::sort(frontier.begin(), frontier.end(), compareByTime);
+
+    os << "\nimages/" << images.size() << " combinations/" << results.size()
+            << " pareto frontier/" << frontier.size() << "\n"
+            << std::fixed
+            << std::setw(10) << "minEdge" << std::setw(10) << "maxEdge"
+            << std::setw(10) << "scanGap" << std::setw(10) << "decoded"
+            << std::setw(10) << "ratio" << std::setw(16) << "ms per image" << "\n";
+
+    for (unsigned i = 0, n = frontier.size(); i < n; ++i) {
+        const SweepResult & result = *frontier[i];
+        os << std::setprecision(2)
+                << std::setw(10) << result.minEdge
+                << std::setw(10) << result.maxEdge
+                << std::setw(10) << result.scanGap
+                << std::setw(10) << result.decoded
+                << std::setprecision(4) << std::setw(10) << result.getRatio()
+                << std::setprecision(2) << std::setw(16)
+                << result.cpuTime * 1000 / images.size() << "\n";
+    }
+}
+
+void ParamSweep::writeCsv(std::ostream & os) const {
+    os << "#minEdgeFactor,maxEdgeFactor,scanGapFactor,decoded,total,ratio,"
+            "cpu time per image (sec),pareto\n";
+    for (unsigned i = 0, n = results.size(); i < n; ++i) {
+        const SweepResult & result = results[i];
+        os << result.minEdge
+                << "," << result.maxEdge
+                << "," << result.scanGap
+                << "," << result.decoded
+                << "," << result.expected
+                << "," << result.getRatio()
+                << "," << result.cpuTime / images.size()
+                << "," << (result.pareto ? 1 : 0) << "\n";
+    }
+}
+
+} /* namespace */
+
+} /* namespace */
+
+using namespace dmscanlib;
+using namespace test;
+
+int main(int argc, char **argv) {
+    usage.append(argv[0]).append(" [--dir=testImageInfo] [--cache=DIR] [--threads=N] "
+            "[--step=0.05] [--csv=FILE]");
+
+    google::SetUsageMessage(usage);
+    google::ParseCommandLineFlags(&argc, &argv, true);
+
+    DmScanLib::configLogging(0, false);
+
+    if (FLAGS_step <= 0) {
+        std::cerr << "step must be greater than zero" << std::endl;
+        return 1;
+    }
+
+    unsigned numThreads = (FLAGS_threads > 0)
+            ? static_cast<unsigned>(FLAGS_threads)
+            : static_cast<unsigned>(std::max(1, OpenThreads::GetNumberOfProcessors()));
+
+    std::unique_ptr<DecodeOptions> decodeOptions = test::getDefaultDecodeOptions();
+    ParamSweep sweep(*decodeOptions);
+
+    if (!sweep.load(FLAGS_dir, FLAGS_cache)) {
+        return 1;
+    }
+
+    sweep.addCombinations(FLAGS_step, FLAGS_max_edge_min, FLAGS_factor_max);
+    sweep.run(numThreads);
+    sweep.findParetoFrontier();
+    sweep.report(std::cout);
+
+    if (!FLAGS_csv.empty()) {
+        std::ofstream ofile(FLAGS_csv.c_str());
+        sweep.writeCsv(ofile);
+    }
+    return 0;
+}
@@ -0,0 +1,228 @@
+/*
+ Dmscanlib is a software library and standalone application that scans
+ and decodes libdmtx compatible test-tubes. It is currently designed
+ to decode 12x8 pallets that use 2D data-matrix laser etched test-tubes.
+ Copyright (C) 2010 Canadian Biosample Repository
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/DmLatencyHistogram.h"
+
+#include <iomanip>
+#include <limits>
+
+#ifdef _VISUALC_
+#   define NOMINMAX
+#   include <windows.h>
+#endif
+
+namespace dmscanlib {
+
+namespace util {
+
+namespace {
+
+const long long NO_MIN = std::numeric_limits<long long>::max();
+
+inline void atomicAdd(volatile long long * target, long long value) {
+#ifdef _VISUALC_
+    InterlockedExchangeAdd64(target, value);
+#else
+    __sync_fetch_and_add(target, value);
+#endif
+}
+
+inline long long atomicCompareAndSwap(volatile long long * target,
+        long long expected, long long value) {
+#ifdef _VISUALC_
+    return InterlockedCompareExchange64(target, value, expected);
+#else
+    return __sync_val_compare_and_swap(target, expected, value);
+#endif
+}
+
+inline void atomicMin(volatile long long * target, long long value) {
+    long long current = *target;
+    while (value < current) {
+        long long previous = atomicCompareAndSwap(target, current, value);
+        if (previous == current) {
+            break;
+        }
+        current = previous;
+    }
+}
+
+inline void atomicMax(volatile long long * target, long long value) {
+    long long current = *target;
+    while (value > current) {
+        long long previous = atomicCompareAndSwap(target, current, value);
+        if (previous == current) {
+            break;
+        }
+        current = previous;
+    }
+}
+
+// position of the most significant set bit, value must not be zero
+inline unsigned mostSignificantBit(DmNanos value) {
+#ifdef __GNUC__
+    return 63 - __builtin_clzll(value);
+#else
+    unsigned msb = 0;
+    while (value >>= 1) {
+        ++msb;
+    }
+    return msb;
+#endif
+}
+
+// nanoseconds are stored as signed values, clamp anything absurdly large
+inline long long toStored(DmNanos nanos) {
+    const DmNanos limit = static_cast<DmNanos>(std::numeric_limits<long long>::max());
+    return static_cast<long long>(nanos > limit ? limit : nanos);
+}
+
+} /* namespace */
+
+DmLatencyHistogram::DmLatencyHistogram() {
+    clear();
+}
+
+void DmLatencyHistogram::clear() {
+    for (unsigned i = 0; i < BUCKET_COUNT; ++i) {
+        buckets[i] = 0;
+    }
+    count = 0;
+    sum = 0;
+    min = NO_MIN;
+    max = 0;
+}
+
+/*
+ * Values below SUB_BUCKET_COUNT get a bucket each. Larger values are shifted
+ * right until they fit in SUB_BUCKET_BITS + 1 bits; the shift selects the
+ * group of buckets and the remaining low bits the bucket within the group.
+ */
+unsigned DmLatencyHistogram::getBucketIndex(DmNanos value) {
+    if (value < SUB_BUCKET_COUNT) {
+        return static_cast<unsigned>(value);
+    }
+    unsigned shift = mostSignificantBit(value) - SUB_BUCKET_BITS;
+    unsigned subBucket = static_cast<unsigned>(value >> shift) - SUB_BUCKET_COUNT;
+    return (shift + 1) * SUB_BUCKET_COUNT + subBucket;
+}
+
+DmNanos DmLatencyHistogram::getBucketMidpoint(unsigned index) {
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    unsigned shift = index / SUB_BUCKET_COUNT - 1;
+    DmNanos low = static_cast<DmNanos>(SUB_BUCKET_COUNT + index % SUB_BUCKET_COUNT) << shift;
+    return low + ((static_cast<DmNanos>(1) << shift) >> 1);
+}
+
+void DmLatencyHistogram::record(DmNanos nanos) {
+    long long value = toStored(nanos);
+    atomicAdd(&buckets[getBucketIndex(static_cast<DmNanos>(value))], 1);
+    atomicAdd(&count, 1);
+    atomicAdd(&sum, value);
+    atomicMin(&min, value);
+    atomicMax(&max, value);
+}
+
+void DmLatencyHistogram::merge(const DmLatencyHistogram & that) {
+    if (that.count == 0) {
+        return;
+    }
+    for (unsigned i = 0; i < BUCKET_COUNT; ++i) {
+        if (that.buckets[i] != 0) {
+            atomicAdd(&buckets[i], that.buckets[i]);
+        }
+    }
+    atomicAdd(&count, that.count);
+    atomicAdd(&sum, that.sum);
+    atomicMin(&min, that.min);
+    atomicMax(&max, that.max);
+}
+
+DmNanos DmLatencyHistogram::getMin() const {
+    return (count == 0) ? 0 : static_cast<DmNanos>(min);
+}
+
+DmNanos DmLatencyHistogram::getMax() const {
+    return static_cast<DmNanos>(max);
+}
+
+double DmLatencyHistogram::getMean() const {
+    if (count == 0) {
+        return 0;
+    }
+    return static_cast<double>(sum) / static_cast<double>(count);
+}
+
+DmNanos DmLatencyHistogram::getPercentile(double percentile) const {
+    if (count == 0) {
+        return 0;
+    }
+    if (percentile <= 0) {
+        return getMin();
+    }
+    if (percentile >= 100) {
+        return getMax();
+    }
+
+    // rank of the requested sample, counting from 1
+    long long rank = static_cast<long long>(percentile / 100.0 * count + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+
+    long long seen = 0;
+    for (unsigned i = 0; i < BUCKET_COUNT; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            DmNanos value = getBucketMidpoint(i);
+            if (value < getMin()) {
+                return getMin();
+            }
+            if (value > getMax()) {
+                return getMax();
+            }
+            return value;
+        }
+    }
+    return getMax();
+}
+
+std::ostream & operator<<(std::ostream & os, const DmLatencyHistogram & m) {
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+
+    os << std::fixed << std::setprecision(1)
+       << "count=" << m.getCount()
+       << " mean=" << m.getMean() / 1000.0 << "us"
+       << " p50=" << m.getPercentile(50) / 1000.0 << "us"
+       << " p99=" << m.getPercentile(99) / 1000.0 << "us"
+       << " p999=" << m.getPercentile(99.9) / 1000.0 << "us"
+       << " max=" << m.getMax() / 1000.0 << "us";
+
+    os.flags(flags);
+    os.precision(precision);
+    return os;
+}
+
+} /* namespace */
+
+} /* namespace */
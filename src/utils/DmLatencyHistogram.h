@@ -0,0 +1,131 @@
+#ifndef __INC_LATENCY_HISTOGRAM_H_
+#define __INC_LATENCY_HISTOGRAM_H_
+
+/*
+ Dmscanlib is a software library and standalone application that scans
+ and decodes libdmtx compatible test-tubes. It is currently designed
+ to decode 12x8 pallets that use 2D data-matrix laser etched test-tubes.
+ Copyright (C) 2010 Canadian Biosample Repository
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/DmTime.h"
+
+#include <ostream>
+
+namespace dmscanlib {
+
+namespace util {
+
+/*
+ * Histogram of latencies in nanoseconds with logarithmic buckets. Each power
+ * of two is split into 2^SUB_BUCKET_BITS linear buckets, so a recorded value
+ * is reported to within 1/128 of its size. The minimum and maximum are exact.
+ *
+ * record() and merge() use atomic operations and can be called from several
+ * threads at once without a lock. The other methods expect the histogram not
+ * to be changing while they run.
+ */
+class DmLatencyHistogram {
+public:
+    DmLatencyHistogram();
+    virtual ~DmLatencyHistogram() {
+    }
+
+    void record(DmNanos nanos);
+
+    void merge(const DmLatencyHistogram & that);
+
+    void clear();
+
+    unsigned long long getCount() const {
+        return static_cast<unsigned long long>(count);
+    }
+
+    DmNanos getMin() const;
+
+    DmNanos getMax() const;
+
+    double getMean() const;
+
+    // percentile is in the range 0 to 100, e.g. 99.9
+    DmNanos getPercentile(double percentile) const;
+
+private:
+    static const unsigned SUB_BUCKET_BITS = 7;
+    static const unsigned SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static const unsigned BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    static unsigned getBucketIndex(DmNanos value);
+    static DmNanos getBucketMidpoint(unsigned index);
+
+    volatile long long buckets[BUCKET_COUNT];
+    volatile long long count;
+    volatile long long sum;
+    volatile long long min;
+    volatile long long max;
+
+    // not copyable, merge() into another histogram instead
+    DmLatencyHistogram(const DmLatencyHistogram &);
+    DmLatencyHistogram & operator=(const DmLatencyHistogram &);
+};
+
+/*
+ * Times the code from construction until stop() is called or it goes out of
+ * scope. The elapsed time is recorded in the histogram and added, in seconds,
+ * to total. Either one can be NULL; when both are the clock is never read.
+ */
+class DmScopedTimer {
+public:
+    DmScopedTimer(DmLatencyHistogram * _histogram, double * _total = NULL) :
+            histogram(_histogram),
+            total(_total),
+            start(((histogram != NULL) || (total != NULL)) ? getMonotonicNanos() : 0)
+    {
+    }
+
+    ~DmScopedTimer() {
+        stop();
+    }
+
+    void stop() {
+        if ((histogram == NULL) && (total == NULL)) {
+            return;
+        }
+        DmNanos elapsed = getMonotonicNanos() - start;
+        if (histogram != NULL) {
+            histogram->record(elapsed);
+        }
+        if (total != NULL) {
+            *total += nanosToSeconds(elapsed);
+        }
+        histogram = NULL;
+        total = NULL;
+    }
+
+private:
+    DmLatencyHistogram * histogram;
+    double * total;
+    const DmNanos start;
+};
+
+// reports count, mean, p50, p99, p999 and max in microseconds
+std::ostream & operator<<(std::ostream & os, const DmLatencyHistogram & m);
+
+} /* namespace */
+
+} /* namespace */
+
+#endif /* __INC_LATENCY_HISTOGRAM_H_ */
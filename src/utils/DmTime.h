@@ -36,6 +36,11 @@ typedef time_t slTime;
 typedef struct timeval slTime;
 #endif
 
+/*
+ * Wall clock time. Use DmStopwatch to measure elapsed time, since DmTime is
+ * affected by changes to the system clock and has only microsecond (second
+ * on Windows) resolution.
+ */
 class DmTime {
 public:
     DmTime();
@@ -49,6 +54,44 @@ private:
     slTime timeVal;
 };
 
+typedef unsigned long long DmNanos;
+
+/*
+ * Nanoseconds from a monotonic clock with an arbitrary starting point. Only
+ * differences between two readings are meaningful.
+ */
+DmNanos getMonotonicNanos();
+
+inline double nanosToSeconds(DmNanos nanos) {
+    return static_cast<double>(nanos) * 1e-9;
+}
+
+/*
+ * Measures elapsed time with the monotonic clock.
+ */
+class DmStopwatch {
+public:
+    DmStopwatch() :
+            start(getMonotonicNanos())
+    {
+    }
+
+    void restart() {
+        start = getMonotonicNanos();
+    }
+
+    DmNanos getElapsedNanos() const {
+        return getMonotonicNanos() - start;
+    }
+
+    double getElapsedSeconds() const {
+        return nanosToSeconds(getElapsedNanos());
+    }
+
+private:
+    DmNanos start;
+};
+
 } /* namespace */
 
 } /* namespace */
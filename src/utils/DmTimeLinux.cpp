@@ -26,6 +26,7 @@
 #include <iomanip>
 
 #include <sys/time.h>
+#include <time.h>
 
 namespace dmscanlib {
 
@@ -46,13 +47,22 @@ std::unique_ptr<DmTime> DmTime::difftime(const DmTime & that) {
     result->timeVal.tv_usec = timeVal.tv_usec - that.timeVal.tv_usec;
     if (result->timeVal.tv_usec < 0) {
         result->timeVal.tv_usec += 1000000;
+        --result->timeVal.tv_sec;
     }
 
     return result;
 }
 
 double DmTime::getTime() {
-    return static_cast<float>(timeVal.tv_sec) + static_cast<float>(timeVal.tv_usec) / 1000000;
+    return static_cast<double>(timeVal.tv_sec)
+            + static_cast<double>(timeVal.tv_usec) / 1000000;
+}
+
+DmNanos getMonotonicNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<DmNanos>(ts.tv_sec) * 1000000000ULL
+            + static_cast<DmNanos>(ts.tv_nsec);
 }
 
 } /* namespace */
@@ -24,6 +24,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdio.h>
 #include <iostream>
 #include <time.h>
+
+#define NOMINMAX
+#include <windows.h>
 //#include <sys/timeb.h>
 
 namespace dmscanlib {
@@ -45,7 +48,22 @@ std::unique_ptr<DmTime> DmTime::difftime(const DmTime & that) {
 }
 
 double DmTime::getTime() {
-	return static_cast<float>(timeVal);
+	return static_cast<double>(timeVal);
+}
+
+DmNanos getMonotonicNanos() {
+	static LARGE_INTEGER frequency = { 0 };
+	LARGE_INTEGER counter;
+
+	if (frequency.QuadPart == 0) {
+		QueryPerformanceFrequency(&frequency);
+	}
+	QueryPerformanceCounter(&counter);
+
+	// split the conversion so that it does not overflow
+	DmNanos freq = static_cast<DmNanos>(frequency.QuadPart);
+	DmNanos count = static_cast<DmNanos>(counter.QuadPart);
+	return (count / freq) * 1000000000ULL + ((count % freq) * 1000000000ULL) / freq;
 }
 
 } /* namespace */
@@ -166,6 +166,7 @@ typedef enum {
    DmtxPropSquareDevn,
    DmtxPropSymbolSize,
    DmtxPropEdgeThresh,
+   DmtxPropScanOrder,
    /* Image properties */
    DmtxPropWidth             = 300,
    DmtxPropHeight,
@@ -184,6 +185,11 @@ typedef enum {
    DmtxPropScale
 } DmtxProperty;
 
+typedef enum {
+   DmtxScanOrderGrid,             /* Recursive cross pattern over whole image */
+   DmtxScanOrderEdgeDensity       /* Same locations, highest contrast areas first */
+} DmtxScanOrder;
+
 typedef enum {
    /* Custom format */
    DmtxPackCustom            = 100,
@@ -390,11 +396,28 @@ typedef struct DmtxMessage_struct {
    size_t          outputSize;    /* Size of buffer used to hold decoded data */
    int             outputIdx;     /* Internal index used to store output progress */
    int             padCount;
+   int             correctedWords; /* Codewords repaired by error correction */
    unsigned char  *array;         /* Pointer to internal representation of Data Matrix modules */
    unsigned char  *code;          /* Pointer to internal storage of code words (data and error) */
    unsigned char  *output;        /* Pointer to internal storage of decoded output */
 } DmtxMessage;
 
+/**
+ * @struct DmtxDecodeStats
+ * @brief DmtxDecodeStats
+ */
+typedef struct DmtxDecodeStats_struct {
+   long            probes;            /* Scan locations visited */
+   long            candidates;        /* Locations with an edge strong enough to follow */
+   long            rejectOrientation; /* Candidates rejected finding the orientation */
+   long            rejectCalibEdge;   /* Candidates rejected aligning a calibration edge */
+   long            rejectSize;        /* Candidates rejected finding the symbol size */
+   long            regions;           /* Regions returned by dmtxRegionFindNext() */
+   long            decodeAttempts;    /* Regions passed to dmtxDecodeMatrixRegion() */
+   long            decodeFailures;    /* Attempts that did not produce a message */
+   long            correctedWords;    /* Codewords repaired by error correction */
+} DmtxDecodeStats;
+
 /**
  * @struct DmtxScanGrid
  * @brief DmtxScanGrid
@@ -432,6 +455,9 @@ typedef struct DmtxTime_struct {
    unsigned long   usec;
 } DmtxTime;
 
+/* Returns non-zero when the region search should stop */
+typedef int (*DmtxCancelCallback)(void *context);
+
 /**
  * @struct DmtxDecode
  * @brief DmtxDecode
@@ -455,6 +481,21 @@ typedef struct DmtxDecode_struct {
    /* Internals */
 /* int             cacheComplete; */
    unsigned char  *cache;
+   int             cacheSize;     /* Bytes allocated for cache, may exceed image size */
+   int             cacheStride;   /* Tiles per row, DMTX_CACHE_TILED only */
+   unsigned long long *visited;   /* Visited bitmap, DMTX_CACHE_TILED only */
+   int             visitedSize;   /* Words allocated for visited bitmap */
+   int             visitedStride; /* Words per row of visited bitmap */
+   int             scanOrder;     /* DmtxScanOrderGrid | DmtxScanOrderEdgeDensity */
+   DmtxPixelLoc   *scanLocs;      /* Grid locations sorted by edge density */
+   int             scanLocsSize;  /* Locations allocated */
+   int             scanLocCount;  /* Locations sorted, DmtxUndefined until needed, DmtxScanLocGridFallback if they can't be */
+   int             scanLocNext;   /* Next location to visit */
+   int            *scanCells;     /* Work area for edge density map */
+   int             scanCellsSize; /* Ints allocated for work area */
+   DmtxCancelCallback cancel;     /* Region search stops when it returns non-zero */
+   void           *cancelContext; /* Passed to cancel */
+   DmtxDecodeStats *stats;        /* Counters updated when not NULL */
    DmtxImage      *image;
    DmtxScanGrid    grid;
 } DmtxDecode;
@@ -534,12 +575,20 @@ extern DmtxPassFail dmtxEncodeDataMosaic(DmtxEncode *enc, int n, unsigned char *
 
 /* dmtxdecode.c */
 extern DmtxDecode *dmtxDecodeCreate(DmtxImage *img, int scale);
+extern DmtxPassFail dmtxDecodeReset(DmtxDecode *dec, DmtxImage *img, int scale);
 extern DmtxPassFail dmtxDecodeDestroy(DmtxDecode **dec);
 extern DmtxPassFail dmtxDecodeSetProp(DmtxDecode *dec, int prop, int value);
+extern DmtxPassFail dmtxDecodeSetProps(DmtxDecode *dec, const int *props, int count);
+extern DmtxPassFail dmtxDecodeSetCancel(DmtxDecode *dec, DmtxCancelCallback cancel, void *context);
+extern DmtxPassFail dmtxDecodeSetStats(DmtxDecode *dec, DmtxDecodeStats *stats);
+extern DmtxPassFail dmtxDecodeSetVisited(DmtxDecode *dec, int y, int xBeg, int xEnd);
 extern int dmtxDecodeGetProp(DmtxDecode *dec, int prop);
 extern /*@exposed@*/ unsigned char *dmtxDecodeGetCache(DmtxDecode *dec, int x, int y);
 extern DmtxPassFail dmtxDecodeGetPixelValue(DmtxDecode *dec, int x, int y, int channel, /*@out@*/ int *value);
 extern DmtxMessage *dmtxDecodeMatrixRegion(DmtxDecode *dec, DmtxRegion *reg, int fix);
+extern DmtxMessage *dmtxDecodeReadModules(DmtxDecode *dec, DmtxRegion *reg);
+extern DmtxMessage *dmtxDecodePopulatedArray(int sizeIdx, DmtxMessage *msg, int fix);
+extern void dmtxDecodeMarkRegion(DmtxDecode *dec, DmtxRegion *reg);
 extern DmtxMessage *dmtxDecodeMosaicRegion(DmtxDecode *dec, DmtxRegion *reg, int fix);
 extern unsigned char *dmtxDecodeCreateDiagnostic(DmtxDecode *dec, /*@out@*/ int *totalBytes, /*@out@*/ int *headerBytes, int style);
 
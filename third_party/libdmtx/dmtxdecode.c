@@ -21,21 +21,50 @@ extern DmtxDecode *
 dmtxDecodeCreate(DmtxImage *img, int scale)
 {
    DmtxDecode *dec;
-   int width, height;
 
    dec = (DmtxDecode *)calloc(1, sizeof(DmtxDecode));
    if(dec == NULL)
       return NULL;
 
+   if(dmtxDecodeReset(dec, img, scale) == DmtxFail) {
+      dmtxDecodeDestroy(&dec);
+      return NULL;
+   }
+
+   return dec;
+}
+
+/**
+ * \brief  Retarget existing decode struct at a new image with default values
+ * \param  dec
+ * \param  img
+ * \param  scale
+ * \return DmtxPass | DmtxFail
+ *
+ * The cache is only reallocated when the new image needs more room than the
+ * previous ones, and only the part covering the new image is cleared.
+ */
+extern DmtxPassFail
+dmtxDecodeReset(DmtxDecode *dec, DmtxImage *img, int scale)
+{
+   int width, height;
+
    width = dmtxImageGetProp(img, DmtxPropWidth) / scale;
    height = dmtxImageGetProp(img, DmtxPropHeight) / scale;
 
+   if(CacheReserve(dec, width, height) == DmtxFail)
+      return DmtxFail;
+
    dec->edgeMin = DmtxUndefined;
    dec->edgeMax = DmtxUndefined;
    dec->scanGap = 1;
    dec->squareDevn = cos(50 * (M_PI/180));
    dec->sizeIdxExpected = DmtxSymbolShapeAuto;
    dec->edgeThresh = 10;
+   dec->scanOrder = DmtxScanOrderGrid;
+   dec->cancel = NULL;
+   dec->cancelContext = NULL;
+   dec->stats = NULL;
 
    dec->xMin = 0;
    dec->xMax = width - 1;
@@ -43,16 +72,121 @@ dmtxDecodeCreate(DmtxImage *img, int scale)
    dec->yMax = height - 1;
    dec->scale = scale;
 
-   dec->cache = (unsigned char *)calloc(width * height, sizeof(unsigned char));
-   if(dec->cache == NULL) {
-      free(dec);
-      return NULL;
-   }
-
    dec->image = img;
    dec->grid = InitScanGrid(dec);
 
-   return dec;
+   return DmtxPass;
+}
+
+/**
+ * \brief  Make sure cache can hold an image of the given size and clear it
+ * \param  dec
+ * \param  width Scaled image width
+ * \param  height Scaled image height
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail
+CacheReserve(DmtxDecode *dec, int width, int height)
+{
+   int cacheSize;
+   unsigned char *cache;
+#ifdef DMTX_CACHE_TILED
+   int visitedSize;
+   unsigned long long *visited;
+
+   dec->cacheStride = (width + DmtxCacheTileMask) >> DmtxCacheTileBits;
+   cacheSize = dec->cacheStride * ((height + DmtxCacheTileMask) >> DmtxCacheTileBits) *
+         DmtxCacheTileSize * DmtxCacheTileSize;
+
+   dec->visitedStride = (width + DmtxVisitedWordBits - 1) / DmtxVisitedWordBits;
+   visitedSize = dec->visitedStride * height;
+
+   if(visitedSize > dec->visitedSize || dec->visited == NULL) {
+      visited = (unsigned long long *)malloc(visitedSize * sizeof(unsigned long long));
+      if(visited == NULL)
+         return DmtxFail;
+
+      if(dec->visited != NULL)
+         free(dec->visited);
+
+      dec->visited = visited;
+      dec->visitedSize = visitedSize;
+   }
+
+   memset(dec->visited, 0x00, visitedSize * sizeof(unsigned long long));
+#else
+   cacheSize = width * height;
+#endif
+
+   if(cacheSize > dec->cacheSize || dec->cache == NULL) {
+      cache = (unsigned char *)malloc(cacheSize * sizeof(unsigned char));
+      if(cache == NULL)
+         return DmtxFail;
+
+      if(dec->cache != NULL)
+         free(dec->cache);
+
+      dec->cache = cache;
+      dec->cacheSize = cacheSize;
+   }
+
+   memset(dec->cache, 0x00, cacheSize * sizeof(unsigned char));
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Test visited bit of a pixel, caller ensures location is in bounds
+ * \param  dec
+ * \param  x Scaled x coordinate
+ * \param  y Scaled y coordinate
+ * \return DmtxTrue | DmtxFalse
+ */
+static DmtxBoolean
+CacheVisited(DmtxDecode *dec, int x, int y)
+{
+#ifdef DMTX_CACHE_TILED
+   return ((dec->visited[y * dec->visitedStride + x / DmtxVisitedWordBits] >>
+         (x % DmtxVisitedWordBits)) & 0x01) ? DmtxTrue : DmtxFalse;
+#else
+   return (*dmtxDecodeGetCache(dec, x, y) & 0x80) ? DmtxTrue : DmtxFalse;
+#endif
+}
+
+/**
+ * \brief  Set visited bit of a pixel, caller ensures location is in bounds
+ * \param  dec
+ * \param  x Scaled x coordinate
+ * \param  y Scaled y coordinate
+ * \return void
+ */
+static void
+CacheSetVisited(DmtxDecode *dec, int x, int y)
+{
+#ifdef DMTX_CACHE_TILED
+   dec->visited[y * dec->visitedStride + x / DmtxVisitedWordBits] |=
+         (1ULL << (x % DmtxVisitedWordBits));
+#else
+   *dmtxDecodeGetCache(dec, x, y) |= 0x80;
+#endif
+}
+
+/**
+ * \brief  Clear visited bit of a pixel, caller ensures location is in bounds
+ * \param  dec
+ * \param  x Scaled x coordinate
+ * \param  y Scaled y coordinate
+ * \return void
+ */
+static void
+CacheClearVisited(DmtxDecode *dec, int x, int y)
+{
+#ifdef DMTX_CACHE_TILED
+   dec->visited[y * dec->visitedStride + x / DmtxVisitedWordBits] &=
+         ~(1ULL << (x % DmtxVisitedWordBits));
+#else
+   *dmtxDecodeGetCache(dec, x, y) &= 0x7f;
+#endif
 }
 
 /**
@@ -69,6 +203,15 @@ dmtxDecodeDestroy(DmtxDecode **dec)
    if((*dec)->cache != NULL)
       free((*dec)->cache);
 
+   if((*dec)->visited != NULL)
+      free((*dec)->visited);
+
+   if((*dec)->scanLocs != NULL)
+      free((*dec)->scanLocs);
+
+   if((*dec)->scanCells != NULL)
+      free((*dec)->scanCells);
+
    free(*dec);
 
    *dec = NULL;
@@ -85,6 +228,132 @@ dmtxDecodeDestroy(DmtxDecode **dec)
  */
 extern DmtxPassFail
 dmtxDecodeSetProp(DmtxDecode *dec, int prop, int value)
+{
+   SetDecodeProp(dec, prop, value);
+
+   if(ValidateDecodeProps(dec) == DmtxFail)
+      return DmtxFail;
+
+   /* Reinitialize scangrid in case any inputs changed */
+   dec->grid = InitScanGrid(dec);
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Set several decoding behavior properties at once
+ * \param  dec
+ * \param  props Property and value pairs: { prop, value, prop, value, ... }
+ * \param  count Number of property and value pairs
+ * \return DmtxPass | DmtxFail
+ *
+ * Same as calling dmtxDecodeSetProp() for each pair, but the scan grid is
+ * only rebuilt once after all the values have been assigned.
+ */
+extern DmtxPassFail
+dmtxDecodeSetProps(DmtxDecode *dec, const int *props, int count)
+{
+   int i;
+
+   for(i = 0; i < count; i++)
+      SetDecodeProp(dec, props[2*i], props[2*i + 1]);
+
+   if(ValidateDecodeProps(dec) == DmtxFail)
+      return DmtxFail;
+
+   dec->grid = InitScanGrid(dec);
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Set callback used to stop region search from another thread
+ * \param  dec
+ * \param  cancel Called with context before each scan location, NULL to disable
+ * \param  context
+ * \return DmtxPass | DmtxFail
+ *
+ * dmtxRegionFindNext() returns NULL as soon as cancel returns non-zero.
+ * This lets several decoders search parts of the same image in parallel and
+ * stop once one of them has found a symbol. The callback is called from the
+ * searching thread, so it must read any flag set by other threads safely.
+ */
+extern DmtxPassFail
+dmtxDecodeSetCancel(DmtxDecode *dec, DmtxCancelCallback cancel, void *context)
+{
+   if(dec == NULL)
+      return DmtxFail;
+
+   dec->cancel = cancel;
+   dec->cancelContext = context;
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Set counters updated while searching for and decoding regions
+ * \param  dec
+ * \param  stats Counters to add to, NULL to stop collecting
+ * \return DmtxPass | DmtxFail
+ *
+ * The counters are not cleared, so the same struct can accumulate over
+ * several images. dmtxDecodeReset() stops collection.
+ */
+extern DmtxPassFail
+dmtxDecodeSetStats(DmtxDecode *dec, DmtxDecodeStats *stats)
+{
+   if(dec == NULL)
+      return DmtxFail;
+
+   dec->stats = stats;
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Mark a span of a scanline as visited before searching for regions
+ * \param  dec
+ * \param  y Scaled y coordinate of the scanline
+ * \param  xBeg Scaled x coordinate of the first pixel marked
+ * \param  xEnd Scaled x coordinate one past the last pixel marked
+ * \return DmtxPass | DmtxFail
+ *
+ * The scan grid skips visited pixels and edge trails stop at them, so this
+ * keeps the search inside a region of interest that is not a rectangle. The
+ * span is clipped to the image. dmtxDecodeReset() clears the marks.
+ */
+extern DmtxPassFail
+dmtxDecodeSetVisited(DmtxDecode *dec, int y, int xBeg, int xEnd)
+{
+   int x, width, height;
+
+   if(dec == NULL)
+      return DmtxFail;
+
+   width = dmtxDecodeGetProp(dec, DmtxPropWidth);
+   height = dmtxDecodeGetProp(dec, DmtxPropHeight);
+
+   if(y < 0 || y >= height)
+      return DmtxPass;
+
+   xBeg = max(xBeg, 0);
+   xEnd = min(xEnd, width);
+
+   for(x = xBeg; x < xEnd; x++)
+      CacheSetVisited(dec, x, y);
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Assign property value without validating or rebuilding scan grid
+ * \param  dec
+ * \param  prop
+ * \param  value
+ * \return void
+ */
+static void
+SetDecodeProp(DmtxDecode *dec, int prop, int value)
 {
    switch(prop) {
       case DmtxPropEdgeMin:
@@ -105,6 +374,9 @@ dmtxDecodeSetProp(DmtxDecode *dec, int prop, int value)
       case DmtxPropEdgeThresh:
          dec->edgeThresh = value;
          break;
+      case DmtxPropScanOrder:
+         dec->scanOrder = value;
+         break;
       /* Min and Max values arrive unscaled */
       case DmtxPropXmin:
          dec->xMin = value / dec->scale;
@@ -121,7 +393,16 @@ dmtxDecodeSetProp(DmtxDecode *dec, int prop, int value)
       default:
          break;
    }
+}
 
+/**
+ * \brief  Check that decoding behavior properties are within range
+ * \param  dec
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail
+ValidateDecodeProps(DmtxDecode *dec)
+{
    if(dec->squareDevn <= 0.0 || dec->squareDevn >= 1.0)
       return DmtxFail;
 
@@ -131,8 +412,8 @@ dmtxDecodeSetProp(DmtxDecode *dec, int prop, int value)
    if(dec->edgeThresh < 1 || dec->edgeThresh > 100)
       return DmtxFail;
 
-   /* Reinitialize scangrid in case any inputs changed */
-   dec->grid = InitScanGrid(dec);
+   if(dec->scanOrder != DmtxScanOrderGrid && dec->scanOrder != DmtxScanOrderEdgeDensity)
+      return DmtxFail;
 
    return DmtxPass;
 }
@@ -159,6 +440,8 @@ dmtxDecodeGetProp(DmtxDecode *dec, int prop)
          return dec->sizeIdxExpected;
       case DmtxPropEdgeThresh:
          return dec->edgeThresh;
+      case DmtxPropScanOrder:
+         return dec->scanOrder;
       case DmtxPropXmin:
          return dec->xMin;
       case DmtxPropXmax:
@@ -203,7 +486,14 @@ dmtxDecodeGetCache(DmtxDecode *dec, int x, int y)
    if(x < 0 || x >= width || y < 0 || y >= height)
       return NULL;
 
+#ifdef DMTX_CACHE_TILED
+   return &(dec->cache[
+         (((y >> DmtxCacheTileBits) * dec->cacheStride + (x >> DmtxCacheTileBits))
+         << (2 * DmtxCacheTileBits)) +
+         ((y & DmtxCacheTileMask) << DmtxCacheTileBits) + (x & DmtxCacheTileMask)]);
+#else
    return &(dec->cache[y * width + x]);
+#endif
 }
 
 /**
@@ -255,9 +545,16 @@ CacheFillQuad(DmtxDecode *dec, DmtxPixelLoc p0, DmtxPixelLoc p1, DmtxPixelLoc p2
 {
    DmtxBresLine lines[4];
    DmtxPixelLoc pEmpty = { 0, 0 };
+#ifdef DMTX_CACHE_TILED
+   unsigned long long *visited;
+   unsigned long long maskBeg, maskEnd;
+   int begX, endX, wordBeg, wordEnd, word;
+#else
    unsigned char *cache;
+   int posX;
+#endif
    int *scanlineMin, *scanlineMax;
-   int minY, maxY, sizeY, posY, posX;
+   int minY, maxY, sizeY, posY;
    int i, idx;
 
    lines[0] = BresLineInit(p0, p1, pEmpty);
@@ -295,11 +592,37 @@ CacheFillQuad(DmtxDecode *dec, DmtxPixelLoc p0, DmtxPixelLoc p1, DmtxPixelLoc p2
 
    for(posY = minY; posY < maxY && posY < dec->yMax; posY++) {
       idx = posY - minY;
+#ifdef DMTX_CACHE_TILED
+      /* Mark span [begX,endX) of this scanline a word at a time */
+      if(posY < 0)
+         continue;
+      begX = max(scanlineMin[idx], 0);
+      endX = min(scanlineMax[idx], dec->xMax);
+      if(begX >= endX)
+         continue;
+
+      visited = dec->visited + posY * dec->visitedStride;
+      wordBeg = begX / DmtxVisitedWordBits;
+      wordEnd = (endX - 1) / DmtxVisitedWordBits;
+      maskBeg = ~0ULL << (begX % DmtxVisitedWordBits);
+      maskEnd = ~0ULL >> (DmtxVisitedWordBits - 1 - (endX - 1) % DmtxVisitedWordBits);
+
+      if(wordBeg == wordEnd) {
+         visited[wordBeg] |= (maskBeg & maskEnd);
+      }
+      else {
+         visited[wordBeg] |= maskBeg;
+         for(word = wordBeg + 1; word < wordEnd; word++)
+            visited[word] = ~0ULL;
+         visited[wordEnd] |= maskEnd;
+      }
+#else
       for(posX = scanlineMin[idx]; posX < scanlineMax[idx] && posX < dec->xMax; posX++) {
          cache = dmtxDecodeGetCache(dec, posX, posY);
          if(cache != NULL)
             *cache |= 0x80;
       }
+#endif
    }
 
    free(scanlineMin);
@@ -312,13 +635,44 @@ CacheFillQuad(DmtxDecode *dec, DmtxPixelLoc p0, DmtxPixelLoc p1, DmtxPixelLoc p2
  * \param  reg
  * \param  fix
  * \return Decoded message
+ *
+ * Same as calling dmtxDecodeReadModules(), dmtxDecodePopulatedArray() and
+ * dmtxDecodeMarkRegion() in turn. The separate steps are available so that
+ * callers can time them individually.
  */
 extern DmtxMessage *
 dmtxDecodeMatrixRegion(DmtxDecode *dec, DmtxRegion *reg, int fix)
 {
    DmtxMessage *msg;
-   DmtxVector2 topLeft, topRight, bottomLeft, bottomRight;
-   DmtxPixelLoc pxTopLeft, pxTopRight, pxBottomLeft, pxBottomRight;
+
+   DmtxStatsAdd(dec, decodeAttempts, 1);
+
+   msg = dmtxDecodeReadModules(dec, reg);
+   if(msg != NULL)
+      msg = dmtxDecodePopulatedArray(reg->sizeIdx, msg, fix);
+
+   if(msg == NULL) {
+      DmtxStatsAdd(dec, decodeFailures, 1);
+      return NULL;
+   }
+
+   DmtxStatsAdd(dec, correctedWords, msg->correctedWords);
+
+   dmtxDecodeMarkRegion(dec, reg);
+
+   return msg;
+}
+
+/**
+ * \brief  Sample the modules of a fitted Data Matrix region
+ * \param  dec
+ * \param  reg
+ * \return Message with populated module array, or NULL on failure
+ */
+extern DmtxMessage *
+dmtxDecodeReadModules(DmtxDecode *dec, DmtxRegion *reg)
+{
+   DmtxMessage *msg;
 
    msg = dmtxMessageCreate(reg->sizeIdx, DmtxFormatMatrix);
    if(msg == NULL)
@@ -329,18 +683,47 @@ dmtxDecodeMatrixRegion(DmtxDecode *dec, DmtxRegion *reg, int fix)
       return NULL;
    }
 
-   /* maybe place remaining logic into new dmtxDecodePopulatedArray()
-      function so other people can pass in their own arrays */
+   return msg;
+}
 
+/**
+ * \brief  Error correct and decode a populated module array
+ * \param  sizeIdx
+ * \param  msg Message returned by dmtxDecodeReadModules()
+ * \param  fix
+ * \return Decoded message, or NULL if error correction failed (msg is freed)
+ */
+extern DmtxMessage *
+dmtxDecodePopulatedArray(int sizeIdx, DmtxMessage *msg, int fix)
+{
    ModulePlacementEcc200(msg->array, msg->code,
-         reg->sizeIdx, DmtxModuleOnRed | DmtxModuleOnGreen | DmtxModuleOnBlue);
+         sizeIdx, DmtxModuleOnRed | DmtxModuleOnGreen | DmtxModuleOnBlue);
 
-   if(RsDecode(msg->code, reg->sizeIdx, fix) == DmtxFail)
+   if(RsDecode(msg->code, sizeIdx, fix, &msg->correctedWords) == DmtxFail)
    {
       dmtxMessageDestroy(&msg);
       return NULL;
    }
 
+   DecodeDataStream(msg, sizeIdx, NULL);
+
+   return msg;
+}
+
+/**
+ * \brief  Mark the area of a decoded region as visited
+ * \param  dec
+ * \param  reg
+ * \return void
+ *
+ * Keeps dmtxRegionFindNext() from finding the same symbol again.
+ */
+extern void
+dmtxDecodeMarkRegion(DmtxDecode *dec, DmtxRegion *reg)
+{
+   DmtxVector2 topLeft, topRight, bottomLeft, bottomRight;
+   DmtxPixelLoc pxTopLeft, pxTopRight, pxBottomLeft, pxBottomRight;
+
    topLeft.X = bottomLeft.X = topLeft.Y = topRight.Y = -0.1;
    topRight.X = bottomRight.X = bottomLeft.Y = bottomRight.Y = 1.1;
 
@@ -359,10 +742,6 @@ dmtxDecodeMatrixRegion(DmtxDecode *dec, DmtxRegion *reg, int fix)
    pxBottomRight.Y = (int)(0.5 + bottomRight.Y);
 
    CacheFillQuad(dec, pxTopLeft, pxTopRight, pxBottomRight, pxBottomLeft);
-
-   DecodeDataStream(msg, reg->sizeIdx, NULL);
-
-   return msg;
 }
 
 /**
@@ -494,7 +873,7 @@ dmtxDecodeCreateDiagnostic(DmtxDecode *dec, int *totalBytes, int *headerBytes, i
             rgb[2] = 0;
          }
          else {
-            shade = (*cache & 0x80) ? 0.0 : 0.7;
+            shade = (CacheVisited(dec, col, row) == DmtxTrue) ? 0.0 : 0.7;
             for(i = 0; i < 3; i++) {
                if(i < channelCount)
                   dmtxDecodeGetPixelValue(dec, col, row, i, &rgb[i]);
@@ -21,6 +21,10 @@
  *   o switch doxygen to simplified syntax, and using "\file" instead of "@file"
  */
 
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
 #define NN                      255
 #define MAX_ERROR_WORD_COUNT     68
 
@@ -30,7 +34,7 @@
 
 /* GF multiply (a * b) */
 #define GfMult(a,b) \
-   (((a) == 0 || (b) == 0) ? 0 : antilog301[(log301[(a)] + log301[(b)]) % NN])
+   (gfMulLo301[(a)][(b) & 0x0f] ^ gfMulHi301[(a)][(b) >> 4])
 
 /* GF multiply by antilog (a * alpha**b) */
 #define GfMultAntilog(a,b) \
@@ -74,6 +78,524 @@ static DmtxByte antilog301[] =
      148,   5,  10,  20,  40,  80, 160, 109, 218, 153,  31,  62, 124, 248, 221, 151,
        3,   6,  12,  24,  48,  96, 192, 173, 119, 238, 241, 207, 179,  75, 150,   0 };
 
+/* GF(256) products a * n for low nibble n, using primitive polynomial 301 */
+static DmtxByte gfMulLo301[256][16] =
+   { {  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0 },
+     {  0,   1,   2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,  15 },
+     {  0,   2,   4,   6,   8,  10,  12,  14,  16,  18,  20,  22,  24,  26,  28,  30 },
+     {  0,   3,   6,   5,  12,  15,  10,   9,  24,  27,  30,  29,  20,  23,  18,  17 },
+     {  0,   4,   8,  12,  16,  20,  24,  28,  32,  36,  40,  44,  48,  52,  56,  60 },
+     {  0,   5,  10,  15,  20,  17,  30,  27,  40,  45,  34,  39,  60,  57,  54,  51 },
+     {  0,   6,  12,  10,  24,  30,  20,  18,  48,  54,  60,  58,  40,  46,  36,  34 },
+     {  0,   7,  14,   9,  28,  27,  18,  21,  56,  63,  54,  49,  36,  35,  42,  45 },
+     {  0,   8,  16,  24,  32,  40,  48,  56,  64,  72,  80,  88,  96, 104, 112, 120 },
+     {  0,   9,  18,  27,  36,  45,  54,  63,  72,  65,  90,  83, 108, 101, 126, 119 },
+     {  0,  10,  20,  30,  40,  34,  60,  54,  80,  90,  68,  78, 120, 114, 108, 102 },
+     {  0,  11,  22,  29,  44,  39,  58,  49,  88,  83,  78,  69, 116, 127,  98, 105 },
+     {  0,  12,  24,  20,  48,  60,  40,  36,  96, 108, 120, 116,  80,  92,  72,  68 },
+     {  0,  13,  26,  23,  52,  57,  46,  35, 104, 101, 114, 127,  92,  81,  70,  75 },
+     {  0,  14,  28,  18,  56,  54,  36,  42, 112, 126, 108,  98,  72,  70,  84,  90 },
+     {  0,  15,  30,  17,  60,  51,  34,  45, 120, 119, 102, 105,  68,  75,  90,  85 },
+     {  0,  16,  32,  48,  64,  80,  96, 112, 128, 144, 160, 176, 192, 208, 224, 240 },
+     {  0,  17,  34,  51,  68,  85, 102, 119, 136, 153, 170, 187, 204, 221, 238, 255 },
+     {  0,  18,  36,  54,  72,  90, 108, 126, 144, 130, 180, 166, 216, 202, 252, 238 },
+     {  0,  19,  38,  53,  76,  95, 106, 121, 152, 139, 190, 173, 212, 199, 242, 225 },
+     {  0,  20,  40,  60,  80,  68, 120, 108, 160, 180, 136, 156, 240, 228, 216, 204 },
+     {  0,  21,  42,  63,  84,  65, 126, 107, 168, 189, 130, 151, 252, 233, 214, 195 },
+     {  0,  22,  44,  58,  88,  78, 116,  98, 176, 166, 156, 138, 232, 254, 196, 210 },
+     {  0,  23,  46,  57,  92,  75, 114, 101, 184, 175, 150, 129, 228, 243, 202, 221 },
+     {  0,  24,  48,  40,  96, 120,  80,  72, 192, 216, 240, 232, 160, 184, 144, 136 },
+     {  0,  25,  50,  43, 100, 125,  86,  79, 200, 209, 250, 227, 172, 181, 158, 135 },
+     {  0,  26,  52,  46, 104, 114,  92,  70, 208, 202, 228, 254, 184, 162, 140, 150 },
+     {  0,  27,  54,  45, 108, 119,  90,  65, 216, 195, 238, 245, 180, 175, 130, 153 },
+     {  0,  28,  56,  36, 112, 108,  72,  84, 224, 252, 216, 196, 144, 140, 168, 180 },
+     {  0,  29,  58,  39, 116, 105,  78,  83, 232, 245, 210, 207, 156, 129, 166, 187 },
+     {  0,  30,  60,  34, 120, 102,  68,  90, 240, 238, 204, 210, 136, 150, 180, 170 },
+     {  0,  31,  62,  33, 124,  99,  66,  93, 248, 231, 198, 217, 132, 155, 186, 165 },
+     {  0,  32,  64,  96, 128, 160, 192, 224,  45,  13, 109,  77, 173, 141, 237, 205 },
+     {  0,  33,  66,  99, 132, 165, 198, 231,  37,   4, 103,  70, 161, 128, 227, 194 },
+     {  0,  34,  68, 102, 136, 170, 204, 238,  61,  31, 121,  91, 181, 151, 241, 211 },
+     {  0,  35,  70, 101, 140, 175, 202, 233,  53,  22, 115,  80, 185, 154, 255, 220 },
+     {  0,  36,  72, 108, 144, 180, 216, 252,  13,  41,  69,  97, 157, 185, 213, 241 },
+     {  0,  37,  74, 111, 148, 177, 222, 251,   5,  32,  79, 106, 145, 180, 219, 254 },
+     {  0,  38,  76, 106, 152, 190, 212, 242,  29,  59,  81, 119, 133, 163, 201, 239 },
+     {  0,  39,  78, 105, 156, 187, 210, 245,  21,  50,  91, 124, 137, 174, 199, 224 },
+     {  0,  40,  80, 120, 160, 136, 240, 216, 109,  69,  61,  21, 205, 229, 157, 181 },
+     {  0,  41,  82, 123, 164, 141, 246, 223, 101,  76,  55,  30, 193, 232, 147, 186 },
+     {  0,  42,  84, 126, 168, 130, 252, 214, 125,  87,  41,   3, 213, 255, 129, 171 },
+     {  0,  43,  86, 125, 172, 135, 250, 209, 117,  94,  35,   8, 217, 242, 143, 164 },
+     {  0,  44,  88, 116, 176, 156, 232, 196,  77,  97,  21,  57, 253, 209, 165, 137 },
+     {  0,  45,  90, 119, 180, 153, 238, 195,  69, 104,  31,  50, 241, 220, 171, 134 },
+     {  0,  46,  92, 114, 184, 150, 228, 202,  93, 115,   1,  47, 229, 203, 185, 151 },
+     {  0,  47,  94, 113, 188, 147, 226, 205,  85, 122,  11,  36, 233, 198, 183, 152 },
+     {  0,  48,  96,  80, 192, 240, 160, 144, 173, 157, 205, 253, 109,  93,  13,  61 },
+     {  0,  49,  98,  83, 196, 245, 166, 151, 165, 148, 199, 246,  97,  80,   3,  50 },
+     {  0,  50, 100,  86, 200, 250, 172, 158, 189, 143, 217, 235, 117,  71,  17,  35 },
+     {  0,  51, 102,  85, 204, 255, 170, 153, 181, 134, 211, 224, 121,  74,  31,  44 },
+     {  0,  52, 104,  92, 208, 228, 184, 140, 141, 185, 229, 209,  93, 105,  53,   1 },
+     {  0,  53, 106,  95, 212, 225, 190, 139, 133, 176, 239, 218,  81, 100,  59,  14 },
+     {  0,  54, 108,  90, 216, 238, 180, 130, 157, 171, 241, 199,  69, 115,  41,  31 },
+     {  0,  55, 110,  89, 220, 235, 178, 133, 149, 162, 251, 204,  73, 126,  39,  16 },
+     {  0,  56, 112,  72, 224, 216, 144, 168, 237, 213, 157, 165,  13,  53, 125,  69 },
+     {  0,  57, 114,  75, 228, 221, 150, 175, 229, 220, 151, 174,   1,  56, 115,  74 },
+     {  0,  58, 116,  78, 232, 210, 156, 166, 253, 199, 137, 179,  21,  47,  97,  91 },
+     {  0,  59, 118,  77, 236, 215, 154, 161, 245, 206, 131, 184,  25,  34, 111,  84 },
+     {  0,  60, 120,  68, 240, 204, 136, 180, 205, 241, 181, 137,  61,   1,  69, 121 },
+     {  0,  61, 122,  71, 244, 201, 142, 179, 197, 248, 191, 130,  49,  12,  75, 118 },
+     {  0,  62, 124,  66, 248, 198, 132, 186, 221, 227, 161, 159,  37,  27,  89, 103 },
+     {  0,  63, 126,  65, 252, 195, 130, 189, 213, 234, 171, 148,  41,  22,  87, 104 },
+     {  0,  64, 128, 192,  45, 109, 173, 237,  90,  26, 218, 154, 119,  55, 247, 183 },
+     {  0,  65, 130, 195,  41, 104, 171, 234,  82,  19, 208, 145, 123,  58, 249, 184 },
+     {  0,  66, 132, 198,  37, 103, 161, 227,  74,   8, 206, 140, 111,  45, 235, 169 },
+     {  0,  67, 134, 197,  33,  98, 167, 228,  66,   1, 196, 135,  99,  32, 229, 166 },
+     {  0,  68, 136, 204,  61, 121, 181, 241, 122,  62, 242, 182,  71,   3, 207, 139 },
+     {  0,  69, 138, 207,  57, 124, 179, 246, 114,  55, 248, 189,  75,  14, 193, 132 },
+     {  0,  70, 140, 202,  53, 115, 185, 255, 106,  44, 230, 160,  95,  25, 211, 149 },
+     {  0,  71, 142, 201,  49, 118, 191, 248,  98,  37, 236, 171,  83,  20, 221, 154 },
+     {  0,  72, 144, 216,  13,  69, 157, 213,  26,  82, 138, 194,  23,  95, 135, 207 },
+     {  0,  73, 146, 219,   9,  64, 155, 210,  18,  91, 128, 201,  27,  82, 137, 192 },
+     {  0,  74, 148, 222,   5,  79, 145, 219,  10,  64, 158, 212,  15,  69, 155, 209 },
+     {  0,  75, 150, 221,   1,  74, 151, 220,   2,  73, 148, 223,   3,  72, 149, 222 },
+     {  0,  76, 152, 212,  29,  81, 133, 201,  58, 118, 162, 238,  39, 107, 191, 243 },
+     {  0,  77, 154, 215,  25,  84, 131, 206,  50, 127, 168, 229,  43, 102, 177, 252 },
+     {  0,  78, 156, 210,  21,  91, 137, 199,  42, 100, 182, 248,  63, 113, 163, 237 },
+     {  0,  79, 158, 209,  17,  94, 143, 192,  34, 109, 188, 243,  51, 124, 173, 226 },
+     {  0,  80, 160, 240, 109,  61, 205, 157, 218, 138, 122,  42, 183, 231,  23,  71 },
+     {  0,  81, 162, 243, 105,  56, 203, 154, 210, 131, 112,  33, 187, 234,  25,  72 },
+     {  0,  82, 164, 246, 101,  55, 193, 147, 202, 152, 110,  60, 175, 253,  11,  89 },
+     {  0,  83, 166, 245,  97,  50, 199, 148, 194, 145, 100,  55, 163, 240,   5,  86 },
+     {  0,  84, 168, 252, 125,  41, 213, 129, 250, 174,  82,   6, 135, 211,  47, 123 },
+     {  0,  85, 170, 255, 121,  44, 211, 134, 242, 167,  88,  13, 139, 222,  33, 116 },
+     {  0,  86, 172, 250, 117,  35, 217, 143, 234, 188,  70,  16, 159, 201,  51, 101 },
+     {  0,  87, 174, 249, 113,  38, 223, 136, 226, 181,  76,  27, 147, 196,  61, 106 },
+     {  0,  88, 176, 232,  77,  21, 253, 165, 154, 194,  42, 114, 215, 143, 103,  63 },
+     {  0,  89, 178, 235,  73,  16, 251, 162, 146, 203,  32, 121, 219, 130, 105,  48 },
+     {  0,  90, 180, 238,  69,  31, 241, 171, 138, 208,  62, 100, 207, 149, 123,  33 },
+     {  0,  91, 182, 237,  65,  26, 247, 172, 130, 217,  52, 111, 195, 152, 117,  46 },
+     {  0,  92, 184, 228,  93,   1, 229, 185, 186, 230,   2,  94, 231, 187,  95,   3 },
+     {  0,  93, 186, 231,  89,   4, 227, 190, 178, 239,   8,  85, 235, 182,  81,  12 },
+     {  0,  94, 188, 226,  85,  11, 233, 183, 170, 244,  22,  72, 255, 161,  67,  29 },
+     {  0,  95, 190, 225,  81,  14, 239, 176, 162, 253,  28,  67, 243, 172,  77,  18 },
+     {  0,  96, 192, 160, 173, 205, 109,  13, 119,  23, 183, 215, 218, 186,  26, 122 },
+     {  0,  97, 194, 163, 169, 200, 107,  10, 127,  30, 189, 220, 214, 183,  20, 117 },
+     {  0,  98, 196, 166, 165, 199,  97,   3, 103,   5, 163, 193, 194, 160,   6, 100 },
+     {  0,  99, 198, 165, 161, 194, 103,   4, 111,  12, 169, 202, 206, 173,   8, 107 },
+     {  0, 100, 200, 172, 189, 217, 117,  17,  87,  51, 159, 251, 234, 142,  34,  70 },
+     {  0, 101, 202, 175, 185, 220, 115,  22,  95,  58, 149, 240, 230, 131,  44,  73 },
+     {  0, 102, 204, 170, 181, 211, 121,  31,  71,  33, 139, 237, 242, 148,  62,  88 },
+     {  0, 103, 206, 169, 177, 214, 127,  24,  79,  40, 129, 230, 254, 153,  48,  87 },
+     {  0, 104, 208, 184, 141, 229,  93,  53,  55,  95, 231, 143, 186, 210, 106,   2 },
+     {  0, 105, 210, 187, 137, 224,  91,  50,  63,  86, 237, 132, 182, 223, 100,  13 },
+     {  0, 106, 212, 190, 133, 239,  81,  59,  39,  77, 243, 153, 162, 200, 118,  28 },
+     {  0, 107, 214, 189, 129, 234,  87,  60,  47,  68, 249, 146, 174, 197, 120,  19 },
+     {  0, 108, 216, 180, 157, 241,  69,  41,  23, 123, 207, 163, 138, 230,  82,  62 },
+     {  0, 109, 218, 183, 153, 244,  67,  46,  31, 114, 197, 168, 134, 235,  92,  49 },
+     {  0, 110, 220, 178, 149, 251,  73,  39,   7, 105, 219, 181, 146, 252,  78,  32 },
+     {  0, 111, 222, 177, 145, 254,  79,  32,  15,  96, 209, 190, 158, 241,  64,  47 },
+     {  0, 112, 224, 144, 237, 157,  13, 125, 247, 135,  23, 103,  26, 106, 250, 138 },
+     {  0, 113, 226, 147, 233, 152,  11, 122, 255, 142,  29, 108,  22, 103, 244, 133 },
+     {  0, 114, 228, 150, 229, 151,   1, 115, 231, 149,   3, 113,   2, 112, 230, 148 },
+     {  0, 115, 230, 149, 225, 146,   7, 116, 239, 156,   9, 122,  14, 125, 232, 155 },
+     {  0, 116, 232, 156, 253, 137,  21,  97, 215, 163,  63,  75,  42,  94, 194, 182 },
+     {  0, 117, 234, 159, 249, 140,  19, 102, 223, 170,  53,  64,  38,  83, 204, 185 },
+     {  0, 118, 236, 154, 245, 131,  25, 111, 199, 177,  43,  93,  50,  68, 222, 168 },
+     {  0, 119, 238, 153, 241, 134,  31, 104, 207, 184,  33,  86,  62,  73, 208, 167 },
+     {  0, 120, 240, 136, 205, 181,  61,  69, 183, 207,  71,  63, 122,   2, 138, 242 },
+     {  0, 121, 242, 139, 201, 176,  59,  66, 191, 198,  77,  52, 118,  15, 132, 253 },
+     {  0, 122, 244, 142, 197, 191,  49,  75, 167, 221,  83,  41,  98,  24, 150, 236 },
+     {  0, 123, 246, 141, 193, 186,  55,  76, 175, 212,  89,  34, 110,  21, 152, 227 },
+     {  0, 124, 248, 132, 221, 161,  37,  89, 151, 235, 111,  19,  74,  54, 178, 206 },
+     {  0, 125, 250, 135, 217, 164,  35,  94, 159, 226, 101,  24,  70,  59, 188, 193 },
+     {  0, 126, 252, 130, 213, 171,  41,  87, 135, 249, 123,   5,  82,  44, 174, 208 },
+     {  0, 127, 254, 129, 209, 174,  47,  80, 143, 240, 113,  14,  94,  33, 160, 223 },
+     {  0, 128,  45, 173,  90, 218, 119, 247, 180,  52, 153,  25, 238, 110, 195,  67 },
+     {  0, 129,  47, 174,  94, 223, 113, 240, 188,  61, 147,  18, 226,  99, 205,  76 },
+     {  0, 130,  41, 171,  82, 208, 123, 249, 164,  38, 141,  15, 246, 116, 223,  93 },
+     {  0, 131,  43, 168,  86, 213, 125, 254, 172,  47, 135,   4, 250, 121, 209,  82 },
+     {  0, 132,  37, 161,  74, 206, 111, 235, 148,  16, 177,  53, 222,  90, 251, 127 },
+     {  0, 133,  39, 162,  78, 203, 105, 236, 156,  25, 187,  62, 210,  87, 245, 112 },
+     {  0, 134,  33, 167,  66, 196,  99, 229, 132,   2, 165,  35, 198,  64, 231,  97 },
+     {  0, 135,  35, 164,  70, 193, 101, 226, 140,  11, 175,  40, 202,  77, 233, 110 },
+     {  0, 136,  61, 181, 122, 242,  71, 207, 244, 124, 201,  65, 142,   6, 179,  59 },
+     {  0, 137,  63, 182, 126, 247,  65, 200, 252, 117, 195,  74, 130,  11, 189,  52 },
+     {  0, 138,  57, 179, 114, 248,  75, 193, 228, 110, 221,  87, 150,  28, 175,  37 },
+     {  0, 139,  59, 176, 118, 253,  77, 198, 236, 103, 215,  92, 154,  17, 161,  42 },
+     {  0, 140,  53, 185, 106, 230,  95, 211, 212,  88, 225, 109, 190,  50, 139,   7 },
+     {  0, 141,  55, 186, 110, 227,  89, 212, 220,  81, 235, 102, 178,  63, 133,   8 },
+     {  0, 142,  49, 191,  98, 236,  83, 221, 196,  74, 245, 123, 166,  40, 151,  25 },
+     {  0, 143,  51, 188, 102, 233,  85, 218, 204,  67, 255, 112, 170,  37, 153,  22 },
+     {  0, 144,  13, 157,  26, 138,  23, 135,  52, 164,  57, 169,  46, 190,  35, 179 },
+     {  0, 145,  15, 158,  30, 143,  17, 128,  60, 173,  51, 162,  34, 179,  45, 188 },
+     {  0, 146,   9, 155,  18, 128,  27, 137,  36, 182,  45, 191,  54, 164,  63, 173 },
+     {  0, 147,  11, 152,  22, 133,  29, 142,  44, 191,  39, 180,  58, 169,  49, 162 },
+     {  0, 148,   5, 145,  10, 158,  15, 155,  20, 128,  17, 133,  30, 138,  27, 143 },
+     {  0, 149,   7, 146,  14, 155,   9, 156,  28, 137,  27, 142,  18, 135,  21, 128 },
+     {  0, 150,   1, 151,   2, 148,   3, 149,   4, 146,   5, 147,   6, 144,   7, 145 },
+     {  0, 151,   3, 148,   6, 145,   5, 146,  12, 155,  15, 152,  10, 157,   9, 158 },
+     {  0, 152,  29, 133,  58, 162,  39, 191, 116, 236, 105, 241,  78, 214,  83, 203 },
+     {  0, 153,  31, 134,  62, 167,  33, 184, 124, 229,  99, 250,  66, 219,  93, 196 },
+     {  0, 154,  25, 131,  50, 168,  43, 177, 100, 254, 125, 231,  86, 204,  79, 213 },
+     {  0, 155,  27, 128,  54, 173,  45, 182, 108, 247, 119, 236,  90, 193,  65, 218 },
+     {  0, 156,  21, 137,  42, 182,  63, 163,  84, 200,  65, 221, 126, 226, 107, 247 },
+     {  0, 157,  23, 138,  46, 179,  57, 164,  92, 193,  75, 214, 114, 239, 101, 248 },
+     {  0, 158,  17, 143,  34, 188,  51, 173,  68, 218,  85, 203, 102, 248, 119, 233 },
+     {  0, 159,  19, 140,  38, 185,  53, 170,  76, 211,  95, 192, 106, 245, 121, 230 },
+     {  0, 160, 109, 205, 218, 122, 183,  23, 153,  57, 244,  84,  67, 227,  46, 142 },
+     {  0, 161, 111, 206, 222, 127, 177,  16, 145,  48, 254,  95,  79, 238,  32, 129 },
+     {  0, 162, 105, 203, 210, 112, 187,  25, 137,  43, 224,  66,  91, 249,  50, 144 },
+     {  0, 163, 107, 200, 214, 117, 189,  30, 129,  34, 234,  73,  87, 244,  60, 159 },
+     {  0, 164, 101, 193, 202, 110, 175,  11, 185,  29, 220, 120, 115, 215,  22, 178 },
+     {  0, 165, 103, 194, 206, 107, 169,  12, 177,  20, 214, 115, 127, 218,  24, 189 },
+     {  0, 166,  97, 199, 194, 100, 163,   5, 169,  15, 200, 110, 107, 205,  10, 172 },
+     {  0, 167,  99, 196, 198,  97, 165,   2, 161,   6, 194, 101, 103, 192,   4, 163 },
+     {  0, 168, 125, 213, 250,  82, 135,  47, 217, 113, 164,  12,  35, 139,  94, 246 },
+     {  0, 169, 127, 214, 254,  87, 129,  40, 209, 120, 174,   7,  47, 134,  80, 249 },
+     {  0, 170, 121, 211, 242,  88, 139,  33, 201,  99, 176,  26,  59, 145,  66, 232 },
+     {  0, 171, 123, 208, 246,  93, 141,  38, 193, 106, 186,  17,  55, 156,  76, 231 },
+     {  0, 172, 117, 217, 234,  70, 159,  51, 249,  85, 140,  32,  19, 191, 102, 202 },
+     {  0, 173, 119, 218, 238,  67, 153,  52, 241,  92, 134,  43,  31, 178, 104, 197 },
+     {  0, 174, 113, 223, 226,  76, 147,  61, 233,  71, 152,  54,  11, 165, 122, 212 },
+     {  0, 175, 115, 220, 230,  73, 149,  58, 225,  78, 146,  61,   7, 168, 116, 219 },
+     {  0, 176,  77, 253, 154,  42, 215, 103,  25, 169,  84, 228, 131,  51, 206, 126 },
+     {  0, 177,  79, 254, 158,  47, 209,  96,  17, 160,  94, 239, 143,  62, 192, 113 },
+     {  0, 178,  73, 251, 146,  32, 219, 105,   9, 187,  64, 242, 155,  41, 210,  96 },
+     {  0, 179,  75, 248, 150,  37, 221, 110,   1, 178,  74, 249, 151,  36, 220, 111 },
+     {  0, 180,  69, 241, 138,  62, 207, 123,  57, 141, 124, 200, 179,   7, 246,  66 },
+     {  0, 181,  71, 242, 142,  59, 201, 124,  49, 132, 118, 195, 191,  10, 248,  77 },
+     {  0, 182,  65, 247, 130,  52, 195, 117,  41, 159, 104, 222, 171,  29, 234,  92 },
+     {  0, 183,  67, 244, 134,  49, 197, 114,  33, 150,  98, 213, 167,  16, 228,  83 },
+     {  0, 184,  93, 229, 186,   2, 231,  95,  89, 225,   4, 188, 227,  91, 190,   6 },
+     {  0, 185,  95, 230, 190,   7, 225,  88,  81, 232,  14, 183, 239,  86, 176,   9 },
+     {  0, 186,  89, 227, 178,   8, 235,  81,  73, 243,  16, 170, 251,  65, 162,  24 },
+     {  0, 187,  91, 224, 182,  13, 237,  86,  65, 250,  26, 161, 247,  76, 172,  23 },
+     {  0, 188,  85, 233, 170,  22, 255,  67, 121, 197,  44, 144, 211, 111, 134,  58 },
+     {  0, 189,  87, 234, 174,  19, 249,  68, 113, 204,  38, 155, 223,  98, 136,  53 },
+     {  0, 190,  81, 239, 162,  28, 243,  77, 105, 215,  56, 134, 203, 117, 154,  36 },
+     {  0, 191,  83, 236, 166,  25, 245,  74,  97, 222,  50, 141, 199, 120, 148,  43 },
+     {  0, 192, 173, 109, 119, 183, 218,  26, 238,  46,  67, 131, 153,  89,  52, 244 },
+     {  0, 193, 175, 110, 115, 178, 220,  29, 230,  39,  73, 136, 149,  84,  58, 251 },
+     {  0, 194, 169, 107, 127, 189, 214,  20, 254,  60,  87, 149, 129,  67,  40, 234 },
+     {  0, 195, 171, 104, 123, 184, 208,  19, 246,  53,  93, 158, 141,  78,  38, 229 },
+     {  0, 196, 165,  97, 103, 163, 194,   6, 206,  10, 107, 175, 169, 109,  12, 200 },
+     {  0, 197, 167,  98,  99, 166, 196,   1, 198,   3,  97, 164, 165,  96,   2, 199 },
+     {  0, 198, 161, 103, 111, 169, 206,   8, 222,  24, 127, 185, 177, 119,  16, 214 },
+     {  0, 199, 163, 100, 107, 172, 200,  15, 214,  17, 117, 178, 189, 122,  30, 217 },
+     {  0, 200, 189, 117,  87, 159, 234,  34, 174, 102,  19, 219, 249,  49,  68, 140 },
+     {  0, 201, 191, 118,  83, 154, 236,  37, 166, 111,  25, 208, 245,  60,  74, 131 },
+     {  0, 202, 185, 115,  95, 149, 230,  44, 190, 116,   7, 205, 225,  43,  88, 146 },
+     {  0, 203, 187, 112,  91, 144, 224,  43, 182, 125,  13, 198, 237,  38,  86, 157 },
+     {  0, 204, 181, 121,  71, 139, 242,  62, 142,  66,  59, 247, 201,   5, 124, 176 },
+     {  0, 205, 183, 122,  67, 142, 244,  57, 134,  75,  49, 252, 197,   8, 114, 191 },
+     {  0, 206, 177, 127,  79, 129, 254,  48, 158,  80,  47, 225, 209,  31,  96, 174 },
+     {  0, 207, 179, 124,  75, 132, 248,  55, 150,  89,  37, 234, 221,  18, 110, 161 },
+     {  0, 208, 141,  93,  55, 231, 186, 106, 110, 190, 227,  51,  89, 137, 212,   4 },
+     {  0, 209, 143,  94,  51, 226, 188, 109, 102, 183, 233,  56,  85, 132, 218,  11 },
+     {  0, 210, 137,  91,  63, 237, 182, 100, 126, 172, 247,  37,  65, 147, 200,  26 },
+     {  0, 211, 139,  88,  59, 232, 176,  99, 118, 165, 253,  46,  77, 158, 198,  21 },
+     {  0, 212, 133,  81,  39, 243, 162, 118,  78, 154, 203,  31, 105, 189, 236,  56 },
+     {  0, 213, 135,  82,  35, 246, 164, 113,  70, 147, 193,  20, 101, 176, 226,  55 },
+     {  0, 214, 129,  87,  47, 249, 174, 120,  94, 136, 223,   9, 113, 167, 240,  38 },
+     {  0, 215, 131,  84,  43, 252, 168, 127,  86, 129, 213,   2, 125, 170, 254,  41 },
+     {  0, 216, 157,  69,  23, 207, 138,  82,  46, 246, 179, 107,  57, 225, 164, 124 },
+     {  0, 217, 159,  70,  19, 202, 140,  85,  38, 255, 185,  96,  53, 236, 170, 115 },
+     {  0, 218, 153,  67,  31, 197, 134,  92,  62, 228, 167, 125,  33, 251, 184,  98 },
+     {  0, 219, 155,  64,  27, 192, 128,  91,  54, 237, 173, 118,  45, 246, 182, 109 },
+     {  0, 220, 149,  73,   7, 219, 146,  78,  14, 210, 155,  71,   9, 213, 156,  64 },
+     {  0, 221, 151,  74,   3, 222, 148,  73,   6, 219, 145,  76,   5, 216, 146,  79 },
+     {  0, 222, 145,  79,  15, 209, 158,  64,  30, 192, 143,  81,  17, 207, 128,  94 },
+     {  0, 223, 147,  76,  11, 212, 152,  71,  22, 201, 133,  90,  29, 194, 142,  81 },
+     {  0, 224, 237,  13, 247,  23,  26, 250, 195,  35,  46, 206,  52, 212, 217,  57 },
+     {  0, 225, 239,  14, 243,  18,  28, 253, 203,  42,  36, 197,  56, 217, 215,  54 },
+     {  0, 226, 233,  11, 255,  29,  22, 244, 211,  49,  58, 216,  44, 206, 197,  39 },
+     {  0, 227, 235,   8, 251,  24,  16, 243, 219,  56,  48, 211,  32, 195, 203,  40 },
+     {  0, 228, 229,   1, 231,   3,   2, 230, 227,   7,   6, 226,   4, 224, 225,   5 },
+     {  0, 229, 231,   2, 227,   6,   4, 225, 235,  14,  12, 233,   8, 237, 239,  10 },
+     {  0, 230, 225,   7, 239,   9,  14, 232, 243,  21,  18, 244,  28, 250, 253,  27 },
+     {  0, 231, 227,   4, 235,  12,   8, 239, 251,  28,  24, 255,  16, 247, 243,  20 },
+     {  0, 232, 253,  21, 215,  63,  42, 194, 131, 107, 126, 150,  84, 188, 169,  65 },
+     {  0, 233, 255,  22, 211,  58,  44, 197, 139,  98, 116, 157,  88, 177, 167,  78 },
+     {  0, 234, 249,  19, 223,  53,  38, 204, 147, 121, 106, 128,  76, 166, 181,  95 },
+     {  0, 235, 251,  16, 219,  48,  32, 203, 155, 112,  96, 139,  64, 171, 187,  80 },
+     {  0, 236, 245,  25, 199,  43,  50, 222, 163,  79,  86, 186, 100, 136, 145, 125 },
+     {  0, 237, 247,  26, 195,  46,  52, 217, 171,  70,  92, 177, 104, 133, 159, 114 },
+     {  0, 238, 241,  31, 207,  33,  62, 208, 179,  93,  66, 172, 124, 146, 141,  99 },
+     {  0, 239, 243,  28, 203,  36,  56, 215, 187,  84,  72, 167, 112, 159, 131, 108 },
+     {  0, 240, 205,  61, 183,  71, 122, 138,  67, 179, 142, 126, 244,   4,  57, 201 },
+     {  0, 241, 207,  62, 179,  66, 124, 141,  75, 186, 132, 117, 248,   9,  55, 198 },
+     {  0, 242, 201,  59, 191,  77, 118, 132,  83, 161, 154, 104, 236,  30,  37, 215 },
+     {  0, 243, 203,  56, 187,  72, 112, 131,  91, 168, 144,  99, 224,  19,  43, 216 },
+     {  0, 244, 197,  49, 167,  83,  98, 150,  99, 151, 166,  82, 196,  48,   1, 245 },
+     {  0, 245, 199,  50, 163,  86, 100, 145, 107, 158, 172,  89, 200,  61,  15, 250 },
+     {  0, 246, 193,  55, 175,  89, 110, 152, 115, 133, 178,  68, 220,  42,  29, 235 },
+     {  0, 247, 195,  52, 171,  92, 104, 159, 123, 140, 184,  79, 208,  39,  19, 228 },
+     {  0, 248, 221,  37, 151, 111,  74, 178,   3, 251, 222,  38, 148, 108,  73, 177 },
+     {  0, 249, 223,  38, 147, 106,  76, 181,  11, 242, 212,  45, 152,  97,  71, 190 },
+     {  0, 250, 217,  35, 159, 101,  70, 188,  19, 233, 202,  48, 140, 118,  85, 175 },
+     {  0, 251, 219,  32, 155,  96,  64, 187,  27, 224, 192,  59, 128, 123,  91, 160 },
+     {  0, 252, 213,  41, 135, 123,  82, 174,  35, 223, 246,  10, 164,  88, 113, 141 },
+     {  0, 253, 215,  42, 131, 126,  84, 169,  43, 214, 252,   1, 168,  85, 127, 130 },
+     {  0, 254, 209,  47, 143, 113,  94, 160,  51, 205, 226,  28, 188,  66, 109, 147 },
+     {  0, 255, 211,  44, 139, 116,  88, 167,  59, 196, 232,  23, 176,  79,  99, 156 } };
+
+/* GF(256) products a * (n << 4) for high nibble n, using primitive polynomial 301 */
+static DmtxByte gfMulHi301[256][16] =
+   { {  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0 },
+     {  0,  16,  32,  48,  64,  80,  96, 112, 128, 144, 160, 176, 192, 208, 224, 240 },
+     {  0,  32,  64,  96, 128, 160, 192, 224,  45,  13, 109,  77, 173, 141, 237, 205 },
+     {  0,  48,  96,  80, 192, 240, 160, 144, 173, 157, 205, 253, 109,  93,  13,  61 },
+     {  0,  64, 128, 192,  45, 109, 173, 237,  90,  26, 218, 154, 119,  55, 247, 183 },
+     {  0,  80, 160, 240, 109,  61, 205, 157, 218, 138, 122,  42, 183, 231,  23,  71 },
+     {  0,  96, 192, 160, 173, 205, 109,  13, 119,  23, 183, 215, 218, 186,  26, 122 },
+     {  0, 112, 224, 144, 237, 157,  13, 125, 247, 135,  23, 103,  26, 106, 250, 138 },
+     {  0, 128,  45, 173,  90, 218, 119, 247, 180,  52, 153,  25, 238, 110, 195,  67 },
+     {  0, 144,  13, 157,  26, 138,  23, 135,  52, 164,  57, 169,  46, 190,  35, 179 },
+     {  0, 160, 109, 205, 218, 122, 183,  23, 153,  57, 244,  84,  67, 227,  46, 142 },
+     {  0, 176,  77, 253, 154,  42, 215, 103,  25, 169,  84, 228, 131,  51, 206, 126 },
+     {  0, 192, 173, 109, 119, 183, 218,  26, 238,  46,  67, 131, 153,  89,  52, 244 },
+     {  0, 208, 141,  93,  55, 231, 186, 106, 110, 190, 227,  51,  89, 137, 212,   4 },
+     {  0, 224, 237,  13, 247,  23,  26, 250, 195,  35,  46, 206,  52, 212, 217,  57 },
+     {  0, 240, 205,  61, 183,  71, 122, 138,  67, 179, 142, 126, 244,   4,  57, 201 },
+     {  0,  45,  90, 119, 180, 153, 238, 195,  69, 104,  31,  50, 241, 220, 171, 134 },
+     {  0,  61, 122,  71, 244, 201, 142, 179, 197, 248, 191, 130,  49,  12,  75, 118 },
+     {  0,  13,  26,  23,  52,  57,  46,  35, 104, 101, 114, 127,  92,  81,  70,  75 },
+     {  0,  29,  58,  39, 116, 105,  78,  83, 232, 245, 210, 207, 156, 129, 166, 187 },
+     {  0, 109, 218, 183, 153, 244,  67,  46,  31, 114, 197, 168, 134, 235,  92,  49 },
+     {  0, 125, 250, 135, 217, 164,  35,  94, 159, 226, 101,  24,  70,  59, 188, 193 },
+     {  0,  77, 154, 215,  25,  84, 131, 206,  50, 127, 168, 229,  43, 102, 177, 252 },
+     {  0,  93, 186, 231,  89,   4, 227, 190, 178, 239,   8,  85, 235, 182,  81,  12 },
+     {  0, 173, 119, 218, 238,  67, 153,  52, 241,  92, 134,  43,  31, 178, 104, 197 },
+     {  0, 189,  87, 234, 174,  19, 249,  68, 113, 204,  38, 155, 223,  98, 136,  53 },
+     {  0, 141,  55, 186, 110, 227,  89, 212, 220,  81, 235, 102, 178,  63, 133,   8 },
+     {  0, 157,  23, 138,  46, 179,  57, 164,  92, 193,  75, 214, 114, 239, 101, 248 },
+     {  0, 237, 247,  26, 195,  46,  52, 217, 171,  70,  92, 177, 104, 133, 159, 114 },
+     {  0, 253, 215,  42, 131, 126,  84, 169,  43, 214, 252,   1, 168,  85, 127, 130 },
+     {  0, 205, 183, 122,  67, 142, 244,  57, 134,  75,  49, 252, 197,   8, 114, 191 },
+     {  0, 221, 151,  74,   3, 222, 148,  73,   6, 219, 145,  76,   5, 216, 146,  79 },
+     {  0,  90, 180, 238,  69,  31, 241, 171, 138, 208,  62, 100, 207, 149, 123,  33 },
+     {  0,  74, 148, 222,   5,  79, 145, 219,  10,  64, 158, 212,  15,  69, 155, 209 },
+     {  0, 122, 244, 142, 197, 191,  49,  75, 167, 221,  83,  41,  98,  24, 150, 236 },
+     {  0, 106, 212, 190, 133, 239,  81,  59,  39,  77, 243, 153, 162, 200, 118,  28 },
+     {  0,  26,  52,  46, 104, 114,  92,  70, 208, 202, 228, 254, 184, 162, 140, 150 },
+     {  0,  10,  20,  30,  40,  34,  60,  54,  80,  90,  68,  78, 120, 114, 108, 102 },
+     {  0,  58, 116,  78, 232, 210, 156, 166, 253, 199, 137, 179,  21,  47,  97,  91 },
+     {  0,  42,  84, 126, 168, 130, 252, 214, 125,  87,  41,   3, 213, 255, 129, 171 },
+     {  0, 218, 153,  67,  31, 197, 134,  92,  62, 228, 167, 125,  33, 251, 184,  98 },
+     {  0, 202, 185, 115,  95, 149, 230,  44, 190, 116,   7, 205, 225,  43,  88, 146 },
+     {  0, 250, 217,  35, 159, 101,  70, 188,  19, 233, 202,  48, 140, 118,  85, 175 },
+     {  0, 234, 249,  19, 223,  53,  38, 204, 147, 121, 106, 128,  76, 166, 181,  95 },
+     {  0, 154,  25, 131,  50, 168,  43, 177, 100, 254, 125, 231,  86, 204,  79, 213 },
+     {  0, 138,  57, 179, 114, 248,  75, 193, 228, 110, 221,  87, 150,  28, 175,  37 },
+     {  0, 186,  89, 227, 178,   8, 235,  81,  73, 243,  16, 170, 251,  65, 162,  24 },
+     {  0, 170, 121, 211, 242,  88, 139,  33, 201,  99, 176,  26,  59, 145,  66, 232 },
+     {  0, 119, 238, 153, 241, 134,  31, 104, 207, 184,  33,  86,  62,  73, 208, 167 },
+     {  0, 103, 206, 169, 177, 214, 127,  24,  79,  40, 129, 230, 254, 153,  48,  87 },
+     {  0,  87, 174, 249, 113,  38, 223, 136, 226, 181,  76,  27, 147, 196,  61, 106 },
+     {  0,  71, 142, 201,  49, 118, 191, 248,  98,  37, 236, 171,  83,  20, 221, 154 },
+     {  0,  55, 110,  89, 220, 235, 178, 133, 149, 162, 251, 204,  73, 126,  39,  16 },
+     {  0,  39,  78, 105, 156, 187, 210, 245,  21,  50,  91, 124, 137, 174, 199, 224 },
+     {  0,  23,  46,  57,  92,  75, 114, 101, 184, 175, 150, 129, 228, 243, 202, 221 },
+     {  0,   7,  14,   9,  28,  27,  18,  21,  56,  63,  54,  49,  36,  35,  42,  45 },
+     {  0, 247, 195,  52, 171,  92, 104, 159, 123, 140, 184,  79, 208,  39,  19, 228 },
+     {  0, 231, 227,   4, 235,  12,   8, 239, 251,  28,  24, 255,  16, 247, 243,  20 },
+     {  0, 215, 131,  84,  43, 252, 168, 127,  86, 129, 213,   2, 125, 170, 254,  41 },
+     {  0, 199, 163, 100, 107, 172, 200,  15, 214,  17, 117, 178, 189, 122,  30, 217 },
+     {  0, 183,  67, 244, 134,  49, 197, 114,  33, 150,  98, 213, 167,  16, 228,  83 },
+     {  0, 167,  99, 196, 198,  97, 165,   2, 161,   6, 194, 101, 103, 192,   4, 163 },
+     {  0, 151,   3, 148,   6, 145,   5, 146,  12, 155,  15, 152,  10, 157,   9, 158 },
+     {  0, 135,  35, 164,  70, 193, 101, 226, 140,  11, 175,  40, 202,  77, 233, 110 },
+     {  0, 180,  69, 241, 138,  62, 207, 123,  57, 141, 124, 200, 179,   7, 246,  66 },
+     {  0, 164, 101, 193, 202, 110, 175,  11, 185,  29, 220, 120, 115, 215,  22, 178 },
+     {  0, 148,   5, 145,  10, 158,  15, 155,  20, 128,  17, 133,  30, 138,  27, 143 },
+     {  0, 132,  37, 161,  74, 206, 111, 235, 148,  16, 177,  53, 222,  90, 251, 127 },
+     {  0, 244, 197,  49, 167,  83,  98, 150,  99, 151, 166,  82, 196,  48,   1, 245 },
+     {  0, 228, 229,   1, 231,   3,   2, 230, 227,   7,   6, 226,   4, 224, 225,   5 },
+     {  0, 212, 133,  81,  39, 243, 162, 118,  78, 154, 203,  31, 105, 189, 236,  56 },
+     {  0, 196, 165,  97, 103, 163, 194,   6, 206,  10, 107, 175, 169, 109,  12, 200 },
+     {  0,  52, 104,  92, 208, 228, 184, 140, 141, 185, 229, 209,  93, 105,  53,   1 },
+     {  0,  36,  72, 108, 144, 180, 216, 252,  13,  41,  69,  97, 157, 185, 213, 241 },
+     {  0,  20,  40,  60,  80,  68, 120, 108, 160, 180, 136, 156, 240, 228, 216, 204 },
+     {  0,   4,   8,  12,  16,  20,  24,  28,  32,  36,  40,  44,  48,  52,  56,  60 },
+     {  0, 116, 232, 156, 253, 137,  21,  97, 215, 163,  63,  75,  42,  94, 194, 182 },
+     {  0, 100, 200, 172, 189, 217, 117,  17,  87,  51, 159, 251, 234, 142,  34,  70 },
+     {  0,  84, 168, 252, 125,  41, 213, 129, 250, 174,  82,   6, 135, 211,  47, 123 },
+     {  0,  68, 136, 204,  61, 121, 181, 241, 122,  62, 242, 182,  71,   3, 207, 139 },
+     {  0, 153,  31, 134,  62, 167,  33, 184, 124, 229,  99, 250,  66, 219,  93, 196 },
+     {  0, 137,  63, 182, 126, 247,  65, 200, 252, 117, 195,  74, 130,  11, 189,  52 },
+     {  0, 185,  95, 230, 190,   7, 225,  88,  81, 232,  14, 183, 239,  86, 176,   9 },
+     {  0, 169, 127, 214, 254,  87, 129,  40, 209, 120, 174,   7,  47, 134,  80, 249 },
+     {  0, 217, 159,  70,  19, 202, 140,  85,  38, 255, 185,  96,  53, 236, 170, 115 },
+     {  0, 201, 191, 118,  83, 154, 236,  37, 166, 111,  25, 208, 245,  60,  74, 131 },
+     {  0, 249, 223,  38, 147, 106,  76, 181,  11, 242, 212,  45, 152,  97,  71, 190 },
+     {  0, 233, 255,  22, 211,  58,  44, 197, 139,  98, 116, 157,  88, 177, 167,  78 },
+     {  0,  25,  50,  43, 100, 125,  86,  79, 200, 209, 250, 227, 172, 181, 158, 135 },
+     {  0,   9,  18,  27,  36,  45,  54,  63,  72,  65,  90,  83, 108, 101, 126, 119 },
+     {  0,  57, 114,  75, 228, 221, 150, 175, 229, 220, 151, 174,   1,  56, 115,  74 },
+     {  0,  41,  82, 123, 164, 141, 246, 223, 101,  76,  55,  30, 193, 232, 147, 186 },
+     {  0,  89, 178, 235,  73,  16, 251, 162, 146, 203,  32, 121, 219, 130, 105,  48 },
+     {  0,  73, 146, 219,   9,  64, 155, 210,  18,  91, 128, 201,  27,  82, 137, 192 },
+     {  0, 121, 242, 139, 201, 176,  59,  66, 191, 198,  77,  52, 118,  15, 132, 253 },
+     {  0, 105, 210, 187, 137, 224,  91,  50,  63,  86, 237, 132, 182, 223, 100,  13 },
+     {  0, 238, 241,  31, 207,  33,  62, 208, 179,  93,  66, 172, 124, 146, 141,  99 },
+     {  0, 254, 209,  47, 143, 113,  94, 160,  51, 205, 226,  28, 188,  66, 109, 147 },
+     {  0, 206, 177, 127,  79, 129, 254,  48, 158,  80,  47, 225, 209,  31,  96, 174 },
+     {  0, 222, 145,  79,  15, 209, 158,  64,  30, 192, 143,  81,  17, 207, 128,  94 },
+     {  0, 174, 113, 223, 226,  76, 147,  61, 233,  71, 152,  54,  11, 165, 122, 212 },
+     {  0, 190,  81, 239, 162,  28, 243,  77, 105, 215,  56, 134, 203, 117, 154,  36 },
+     {  0, 142,  49, 191,  98, 236,  83, 221, 196,  74, 245, 123, 166,  40, 151,  25 },
+     {  0, 158,  17, 143,  34, 188,  51, 173,  68, 218,  85, 203, 102, 248, 119, 233 },
+     {  0, 110, 220, 178, 149, 251,  73,  39,   7, 105, 219, 181, 146, 252,  78,  32 },
+     {  0, 126, 252, 130, 213, 171,  41,  87, 135, 249, 123,   5,  82,  44, 174, 208 },
+     {  0,  78, 156, 210,  21,  91, 137, 199,  42, 100, 182, 248,  63, 113, 163, 237 },
+     {  0,  94, 188, 226,  85,  11, 233, 183, 170, 244,  22,  72, 255, 161,  67,  29 },
+     {  0,  46,  92, 114, 184, 150, 228, 202,  93, 115,   1,  47, 229, 203, 185, 151 },
+     {  0,  62, 124,  66, 248, 198, 132, 186, 221, 227, 161, 159,  37,  27,  89, 103 },
+     {  0,  14,  28,  18,  56,  54,  36,  42, 112, 126, 108,  98,  72,  70,  84,  90 },
+     {  0,  30,  60,  34, 120, 102,  68,  90, 240, 238, 204, 210, 136, 150, 180, 170 },
+     {  0, 195, 171, 104, 123, 184, 208,  19, 246,  53,  93, 158, 141,  78,  38, 229 },
+     {  0, 211, 139,  88,  59, 232, 176,  99, 118, 165, 253,  46,  77, 158, 198,  21 },
+     {  0, 227, 235,   8, 251,  24,  16, 243, 219,  56,  48, 211,  32, 195, 203,  40 },
+     {  0, 243, 203,  56, 187,  72, 112, 131,  91, 168, 144,  99, 224,  19,  43, 216 },
+     {  0, 131,  43, 168,  86, 213, 125, 254, 172,  47, 135,   4, 250, 121, 209,  82 },
+     {  0, 147,  11, 152,  22, 133,  29, 142,  44, 191,  39, 180,  58, 169,  49, 162 },
+     {  0, 163, 107, 200, 214, 117, 189,  30, 129,  34, 234,  73,  87, 244,  60, 159 },
+     {  0, 179,  75, 248, 150,  37, 221, 110,   1, 178,  74, 249, 151,  36, 220, 111 },
+     {  0,  67, 134, 197,  33,  98, 167, 228,  66,   1, 196, 135,  99,  32, 229, 166 },
+     {  0,  83, 166, 245,  97,  50, 199, 148, 194, 145, 100,  55, 163, 240,   5,  86 },
+     {  0,  99, 198, 165, 161, 194, 103,   4, 111,  12, 169, 202, 206, 173,   8, 107 },
+     {  0, 115, 230, 149, 225, 146,   7, 116, 239, 156,   9, 122,  14, 125, 232, 155 },
+     {  0,   3,   6,   5,  12,  15,  10,   9,  24,  27,  30,  29,  20,  23,  18,  17 },
+     {  0,  19,  38,  53,  76,  95, 106, 121, 152, 139, 190, 173, 212, 199, 242, 225 },
+     {  0,  35,  70, 101, 140, 175, 202, 233,  53,  22, 115,  80, 185, 154, 255, 220 },
+     {  0,  51, 102,  85, 204, 255, 170, 153, 181, 134, 211, 224, 121,  74,  31,  44 },
+     {  0,  69, 138, 207,  57, 124, 179, 246, 114,  55, 248, 189,  75,  14, 193, 132 },
+     {  0,  85, 170, 255, 121,  44, 211, 134, 242, 167,  88,  13, 139, 222,  33, 116 },
+     {  0, 101, 202, 175, 185, 220, 115,  22,  95,  58, 149, 240, 230, 131,  44,  73 },
+     {  0, 117, 234, 159, 249, 140,  19, 102, 223, 170,  53,  64,  38,  83, 204, 185 },
+     {  0,   5,  10,  15,  20,  17,  30,  27,  40,  45,  34,  39,  60,  57,  54,  51 },
+     {  0,  21,  42,  63,  84,  65, 126, 107, 168, 189, 130, 151, 252, 233, 214, 195 },
+     {  0,  37,  74, 111, 148, 177, 222, 251,   5,  32,  79, 106, 145, 180, 219, 254 },
+     {  0,  53, 106,  95, 212, 225, 190, 139, 133, 176, 239, 218,  81, 100,  59,  14 },
+     {  0, 197, 167,  98,  99, 166, 196,   1, 198,   3,  97, 164, 165,  96,   2, 199 },
+     {  0, 213, 135,  82,  35, 246, 164, 113,  70, 147, 193,  20, 101, 176, 226,  55 },
+     {  0, 229, 231,   2, 227,   6,   4, 225, 235,  14,  12, 233,   8, 237, 239,  10 },
+     {  0, 245, 199,  50, 163,  86, 100, 145, 107, 158, 172,  89, 200,  61,  15, 250 },
+     {  0, 133,  39, 162,  78, 203, 105, 236, 156,  25, 187,  62, 210,  87, 245, 112 },
+     {  0, 149,   7, 146,  14, 155,   9, 156,  28, 137,  27, 142,  18, 135,  21, 128 },
+     {  0, 165, 103, 194, 206, 107, 169,  12, 177,  20, 214, 115, 127, 218,  24, 189 },
+     {  0, 181,  71, 242, 142,  59, 201, 124,  49, 132, 118, 195, 191,  10, 248,  77 },
+     {  0, 104, 208, 184, 141, 229,  93,  53,  55,  95, 231, 143, 186, 210, 106,   2 },
+     {  0, 120, 240, 136, 205, 181,  61,  69, 183, 207,  71,  63, 122,   2, 138, 242 },
+     {  0,  72, 144, 216,  13,  69, 157, 213,  26,  82, 138, 194,  23,  95, 135, 207 },
+     {  0,  88, 176, 232,  77,  21, 253, 165, 154, 194,  42, 114, 215, 143, 103,  63 },
+     {  0,  40,  80, 120, 160, 136, 240, 216, 109,  69,  61,  21, 205, 229, 157, 181 },
+     {  0,  56, 112,  72, 224, 216, 144, 168, 237, 213, 157, 165,  13,  53, 125,  69 },
+     {  0,   8,  16,  24,  32,  40,  48,  56,  64,  72,  80,  88,  96, 104, 112, 120 },
+     {  0,  24,  48,  40,  96, 120,  80,  72, 192, 216, 240, 232, 160, 184, 144, 136 },
+     {  0, 232, 253,  21, 215,  63,  42, 194, 131, 107, 126, 150,  84, 188, 169,  65 },
+     {  0, 248, 221,  37, 151, 111,  74, 178,   3, 251, 222,  38, 148, 108,  73, 177 },
+     {  0, 200, 189, 117,  87, 159, 234,  34, 174, 102,  19, 219, 249,  49,  68, 140 },
+     {  0, 216, 157,  69,  23, 207, 138,  82,  46, 246, 179, 107,  57, 225, 164, 124 },
+     {  0, 168, 125, 213, 250,  82, 135,  47, 217, 113, 164,  12,  35, 139,  94, 246 },
+     {  0, 184,  93, 229, 186,   2, 231,  95,  89, 225,   4, 188, 227,  91, 190,   6 },
+     {  0, 136,  61, 181, 122, 242,  71, 207, 244, 124, 201,  65, 142,   6, 179,  59 },
+     {  0, 152,  29, 133,  58, 162,  39, 191, 116, 236, 105, 241,  78, 214,  83, 203 },
+     {  0,  31,  62,  33, 124,  99,  66,  93, 248, 231, 198, 217, 132, 155, 186, 165 },
+     {  0,  15,  30,  17,  60,  51,  34,  45, 120, 119, 102, 105,  68,  75,  90,  85 },
+     {  0,  63, 126,  65, 252, 195, 130, 189, 213, 234, 171, 148,  41,  22,  87, 104 },
+     {  0,  47,  94, 113, 188, 147, 226, 205,  85, 122,  11,  36, 233, 198, 183, 152 },
+     {  0,  95, 190, 225,  81,  14, 239, 176, 162, 253,  28,  67, 243, 172,  77,  18 },
+     {  0,  79, 158, 209,  17,  94, 143, 192,  34, 109, 188, 243,  51, 124, 173, 226 },
+     {  0, 127, 254, 129, 209, 174,  47,  80, 143, 240, 113,  14,  94,  33, 160, 223 },
+     {  0, 111, 222, 177, 145, 254,  79,  32,  15,  96, 209, 190, 158, 241,  64,  47 },
+     {  0, 159,  19, 140,  38, 185,  53, 170,  76, 211,  95, 192, 106, 245, 121, 230 },
+     {  0, 143,  51, 188, 102, 233,  85, 218, 204,  67, 255, 112, 170,  37, 153,  22 },
+     {  0, 191,  83, 236, 166,  25, 245,  74,  97, 222,  50, 141, 199, 120, 148,  43 },
+     {  0, 175, 115, 220, 230,  73, 149,  58, 225,  78, 146,  61,   7, 168, 116, 219 },
+     {  0, 223, 147,  76,  11, 212, 152,  71,  22, 201, 133,  90,  29, 194, 142,  81 },
+     {  0, 207, 179, 124,  75, 132, 248,  55, 150,  89,  37, 234, 221,  18, 110, 161 },
+     {  0, 255, 211,  44, 139, 116,  88, 167,  59, 196, 232,  23, 176,  79,  99, 156 },
+     {  0, 239, 243,  28, 203,  36,  56, 215, 187,  84,  72, 167, 112, 159, 131, 108 },
+     {  0,  50, 100,  86, 200, 250, 172, 158, 189, 143, 217, 235, 117,  71,  17,  35 },
+     {  0,  34,  68, 102, 136, 170, 204, 238,  61,  31, 121,  91, 181, 151, 241, 211 },
+     {  0,  18,  36,  54,  72,  90, 108, 126, 144, 130, 180, 166, 216, 202, 252, 238 },
+     {  0,   2,   4,   6,   8,  10,  12,  14,  16,  18,  20,  22,  24,  26,  28,  30 },
+     {  0, 114, 228, 150, 229, 151,   1, 115, 231, 149,   3, 113,   2, 112, 230, 148 },
+     {  0,  98, 196, 166, 165, 199,  97,   3, 103,   5, 163, 193, 194, 160,   6, 100 },
+     {  0,  82, 164, 246, 101,  55, 193, 147, 202, 152, 110,  60, 175, 253,  11,  89 },
+     {  0,  66, 132, 198,  37, 103, 161, 227,  74,   8, 206, 140, 111,  45, 235, 169 },
+     {  0, 178,  73, 251, 146,  32, 219, 105,   9, 187,  64, 242, 155,  41, 210,  96 },
+     {  0, 162, 105, 203, 210, 112, 187,  25, 137,  43, 224,  66,  91, 249,  50, 144 },
+     {  0, 146,   9, 155,  18, 128,  27, 137,  36, 182,  45, 191,  54, 164,  63, 173 },
+     {  0, 130,  41, 171,  82, 208, 123, 249, 164,  38, 141,  15, 246, 116, 223,  93 },
+     {  0, 242, 201,  59, 191,  77, 118, 132,  83, 161, 154, 104, 236,  30,  37, 215 },
+     {  0, 226, 233,  11, 255,  29,  22, 244, 211,  49,  58, 216,  44, 206, 197,  39 },
+     {  0, 210, 137,  91,  63, 237, 182, 100, 126, 172, 247,  37,  65, 147, 200,  26 },
+     {  0, 194, 169, 107, 127, 189, 214,  20, 254,  60,  87, 149, 129,  67,  40, 234 },
+     {  0, 241, 207,  62, 179,  66, 124, 141,  75, 186, 132, 117, 248,   9,  55, 198 },
+     {  0, 225, 239,  14, 243,  18,  28, 253, 203,  42,  36, 197,  56, 217, 215,  54 },
+     {  0, 209, 143,  94,  51, 226, 188, 109, 102, 183, 233,  56,  85, 132, 218,  11 },
+     {  0, 193, 175, 110, 115, 178, 220,  29, 230,  39,  73, 136, 149,  84,  58, 251 },
+     {  0, 177,  79, 254, 158,  47, 209,  96,  17, 160,  94, 239, 143,  62, 192, 113 },
+     {  0, 161, 111, 206, 222, 127, 177,  16, 145,  48, 254,  95,  79, 238,  32, 129 },
+     {  0, 145,  15, 158,  30, 143,  17, 128,  60, 173,  51, 162,  34, 179,  45, 188 },
+     {  0, 129,  47, 174,  94, 223, 113, 240, 188,  61, 147,  18, 226,  99, 205,  76 },
+     {  0, 113, 226, 147, 233, 152,  11, 122, 255, 142,  29, 108,  22, 103, 244, 133 },
+     {  0,  97, 194, 163, 169, 200, 107,  10, 127,  30, 189, 220, 214, 183,  20, 117 },
+     {  0,  81, 162, 243, 105,  56, 203, 154, 210, 131, 112,  33, 187, 234,  25,  72 },
+     {  0,  65, 130, 195,  41, 104, 171, 234,  82,  19, 208, 145, 123,  58, 249, 184 },
+     {  0,  49,  98,  83, 196, 245, 166, 151, 165, 148, 199, 246,  97,  80,   3,  50 },
+     {  0,  33,  66,  99, 132, 165, 198, 231,  37,   4, 103,  70, 161, 128, 227, 194 },
+     {  0,  17,  34,  51,  68,  85, 102, 119, 136, 153, 170, 187, 204, 221, 238, 255 },
+     {  0,   1,   2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,  15 },
+     {  0, 220, 149,  73,   7, 219, 146,  78,  14, 210, 155,  71,   9, 213, 156,  64 },
+     {  0, 204, 181, 121,  71, 139, 242,  62, 142,  66,  59, 247, 201,   5, 124, 176 },
+     {  0, 252, 213,  41, 135, 123,  82, 174,  35, 223, 246,  10, 164,  88, 113, 141 },
+     {  0, 236, 245,  25, 199,  43,  50, 222, 163,  79,  86, 186, 100, 136, 145, 125 },
+     {  0, 156,  21, 137,  42, 182,  63, 163,  84, 200,  65, 221, 126, 226, 107, 247 },
+     {  0, 140,  53, 185, 106, 230,  95, 211, 212,  88, 225, 109, 190,  50, 139,   7 },
+     {  0, 188,  85, 233, 170,  22, 255,  67, 121, 197,  44, 144, 211, 111, 134,  58 },
+     {  0, 172, 117, 217, 234,  70, 159,  51, 249,  85, 140,  32,  19, 191, 102, 202 },
+     {  0,  92, 184, 228,  93,   1, 229, 185, 186, 230,   2,  94, 231, 187,  95,   3 },
+     {  0,  76, 152, 212,  29,  81, 133, 201,  58, 118, 162, 238,  39, 107, 191, 243 },
+     {  0, 124, 248, 132, 221, 161,  37,  89, 151, 235, 111,  19,  74,  54, 178, 206 },
+     {  0, 108, 216, 180, 157, 241,  69,  41,  23, 123, 207, 163, 138, 230,  82,  62 },
+     {  0,  28,  56,  36, 112, 108,  72,  84, 224, 252, 216, 196, 144, 140, 168, 180 },
+     {  0,  12,  24,  20,  48,  60,  40,  36,  96, 108, 120, 116,  80,  92,  72,  68 },
+     {  0,  60, 120,  68, 240, 204, 136, 180, 205, 241, 181, 137,  61,   1,  69, 121 },
+     {  0,  44,  88, 116, 176, 156, 232, 196,  77,  97,  21,  57, 253, 209, 165, 137 },
+     {  0, 171, 123, 208, 246,  93, 141,  38, 193, 106, 186,  17,  55, 156,  76, 231 },
+     {  0, 187,  91, 224, 182,  13, 237,  86,  65, 250,  26, 161, 247,  76, 172,  23 },
+     {  0, 139,  59, 176, 118, 253,  77, 198, 236, 103, 215,  92, 154,  17, 161,  42 },
+     {  0, 155,  27, 128,  54, 173,  45, 182, 108, 247, 119, 236,  90, 193,  65, 218 },
+     {  0, 235, 251,  16, 219,  48,  32, 203, 155, 112,  96, 139,  64, 171, 187,  80 },
+     {  0, 251, 219,  32, 155,  96,  64, 187,  27, 224, 192,  59, 128, 123,  91, 160 },
+     {  0, 203, 187, 112,  91, 144, 224,  43, 182, 125,  13, 198, 237,  38,  86, 157 },
+     {  0, 219, 155,  64,  27, 192, 128,  91,  54, 237, 173, 118,  45, 246, 182, 109 },
+     {  0,  43,  86, 125, 172, 135, 250, 209, 117,  94,  35,   8, 217, 242, 143, 164 },
+     {  0,  59, 118,  77, 236, 215, 154, 161, 245, 206, 131, 184,  25,  34, 111,  84 },
+     {  0,  11,  22,  29,  44,  39,  58,  49,  88,  83,  78,  69, 116, 127,  98, 105 },
+     {  0,  27,  54,  45, 108, 119,  90,  65, 216, 195, 238, 245, 180, 175, 130, 153 },
+     {  0, 107, 214, 189, 129, 234,  87,  60,  47,  68, 249, 146, 174, 197, 120,  19 },
+     {  0, 123, 246, 141, 193, 186,  55,  76, 175, 212,  89,  34, 110,  21, 152, 227 },
+     {  0,  75, 150, 221,   1,  74, 151, 220,   2,  73, 148, 223,   3,  72, 149, 222 },
+     {  0,  91, 182, 237,  65,  26, 247, 172, 130, 217,  52, 111, 195, 152, 117,  46 },
+     {  0, 134,  33, 167,  66, 196,  99, 229, 132,   2, 165,  35, 198,  64, 231,  97 },
+     {  0, 150,   1, 151,   2, 148,   3, 149,   4, 146,   5, 147,   6, 144,   7, 145 },
+     {  0, 166,  97, 199, 194, 100, 163,   5, 169,  15, 200, 110, 107, 205,  10, 172 },
+     {  0, 182,  65, 247, 130,  52, 195, 117,  41, 159, 104, 222, 171,  29, 234,  92 },
+     {  0, 198, 161, 103, 111, 169, 206,   8, 222,  24, 127, 185, 177, 119,  16, 214 },
+     {  0, 214, 129,  87,  47, 249, 174, 120,  94, 136, 223,   9, 113, 167, 240,  38 },
+     {  0, 230, 225,   7, 239,   9,  14, 232, 243,  21,  18, 244,  28, 250, 253,  27 },
+     {  0, 246, 193,  55, 175,  89, 110, 152, 115, 133, 178,  68, 220,  42,  29, 235 },
+     {  0,   6,  12,  10,  24,  30,  20,  18,  48,  54,  60,  58,  40,  46,  36,  34 },
+     {  0,  22,  44,  58,  88,  78, 116,  98, 176, 166, 156, 138, 232, 254, 196, 210 },
+     {  0,  38,  76, 106, 152, 190, 212, 242,  29,  59,  81, 119, 133, 163, 201, 239 },
+     {  0,  54, 108,  90, 216, 238, 180, 130, 157, 171, 241, 199,  69, 115,  41,  31 },
+     {  0,  70, 140, 202,  53, 115, 185, 255, 106,  44, 230, 160,  95,  25, 211, 149 },
+     {  0,  86, 172, 250, 117,  35, 217, 143, 234, 188,  70,  16, 159, 201,  51, 101 },
+     {  0, 102, 204, 170, 181, 211, 121,  31,  71,  33, 139, 237, 242, 148,  62,  88 },
+     {  0, 118, 236, 154, 245, 131,  25, 111, 199, 177,  43,  93,  50,  68, 222, 168 } };
+
 /**
  * Encode xyz.
  * More detailed description.
@@ -136,24 +658,31 @@ RsEncode(DmtxMessage *message, int sizeIdx)
 
 /**
  * Decode xyz.
- * More detailed description.
+ * Codewords are de-interleaved straight from the symbol into one row per
+ * codeword position, with one column per interleaved block, so syndromes
+ * for all blocks can be computed together. Symbols without errors are left
+ * untouched, otherwise only the damaged blocks are repaired.
  * \param code
  * \param sizeIdx
  * \param fix
+ * \param correctedWords Set to the number of codewords repaired
  * \return Function success (DmtxPass|DmtxFail)
  */
 #undef CHKPASS
 #define CHKPASS { if(passFail == DmtxFail) return DmtxFail; }
 static DmtxPassFail
-RsDecode(unsigned char *code, int sizeIdx, int fix)
+RsDecode(unsigned char *code, int sizeIdx, int fix, int *correctedWords)
 {
    int i;
    int blockStride, blockIdx;
    int blockDataWords, blockErrorWords, blockTotalWords, blockMaxCorrectable;
-   int symbolDataWords, symbolErrorWords, symbolTotalWords;
+   int blockPadWords, rowDataWords, rowCount;
+   int symbolDataWords;
    DmtxBoolean error, repairable;
    DmtxPassFail passFail;
    unsigned char *word;
+   DmtxByte rows[NN][DmtxMaxInterleavedBlocks];
+   DmtxByte synRows[MAX_ERROR_WORD_COUNT+1][DmtxMaxInterleavedBlocks];
    DmtxByte elpStorage[MAX_ERROR_WORD_COUNT];
    DmtxByte synStorage[MAX_ERROR_WORD_COUNT+1];
    DmtxByte recStorage[NN];
@@ -163,76 +692,105 @@ RsDecode(unsigned char *code, int sizeIdx, int fix)
    DmtxByteList rec = dmtxByteListBuild(recStorage, sizeof(recStorage));
    DmtxByteList loc = dmtxByteListBuild(locStorage, sizeof(locStorage));
 
+   *correctedWords = 0;
+
    blockStride = dmtxGetSymbolAttribute(DmtxSymAttribInterleavedBlocks, sizeIdx);
    blockErrorWords = dmtxGetSymbolAttribute(DmtxSymAttribBlockErrorWords, sizeIdx);
    blockMaxCorrectable = dmtxGetSymbolAttribute(DmtxSymAttribBlockMaxCorrectable, sizeIdx);
    symbolDataWords = dmtxGetSymbolAttribute(DmtxSymAttribSymbolDataWords, sizeIdx);
-   symbolErrorWords = dmtxGetSymbolAttribute(DmtxSymAttribSymbolErrorWords, sizeIdx);
-   symbolTotalWords = symbolDataWords + symbolErrorWords;
 
-   /* For each interleaved block */
+   if(blockStride < 1 || blockStride > DmtxMaxInterleavedBlocks ||
+         blockErrorWords < 1 || blockErrorWords > MAX_ERROR_WORD_COUNT)
+      return DmtxFail;
+
+   /* Block 0 always has the most data words */
+   rowDataWords = dmtxGetBlockDataSize(sizeIdx, 0);
+   rowCount = rowDataWords + blockErrorWords;
+   if(rowCount > NN)
+      return DmtxFail;
+
+   /* De-interleave into rows, shorter blocks (144x144) get a leading zero */
+   memset(rows, 0x00, rowCount * sizeof(rows[0]));
    for(blockIdx = 0; blockIdx < blockStride; blockIdx++)
    {
-      /* Data word count depends on blockIdx due to special case at 144x144 */
       blockDataWords = dmtxGetBlockDataSize(sizeIdx, blockIdx);
-      blockTotalWords = blockErrorWords + blockDataWords;
+      blockPadWords = rowDataWords - blockDataWords;
 
-      /* Populate received list (rec) with data and error codewords */
-      dmtxByteListInit(&rec, 0, 0, &passFail); CHKPASS;
-
-      /* Start with final error word and work backward */
-      word = code + symbolTotalWords + blockIdx - blockStride;
-      for(i = 0; i < blockErrorWords; i++)
+      word = code + blockIdx;
+      for(i = blockPadWords; i < rowDataWords; i++)
       {
-         dmtxByteListPush(&rec, *word, &passFail); CHKPASS;
-         word -= blockStride;
+         rows[i][blockIdx] = *word;
+         word += blockStride;
       }
 
-      /* Start with final data word and work backward */
-      word = code + blockIdx + (blockStride * (blockDataWords - 1));
-      for(i = 0; i < blockDataWords; i++)
+      word = code + symbolDataWords + blockIdx;
+      for(i = rowDataWords; i < rowCount; i++)
       {
-         dmtxByteListPush(&rec, *word, &passFail); CHKPASS;
-         word -= blockStride;
+         rows[i][blockIdx] = *word;
+         word += blockStride;
       }
+   }
+
+   /* Compute syndromes for all blocks, error-free symbols are done */
+   error = RsComputeSyndromes(synRows, rows, rowCount, blockStride, blockErrorWords);
+   if(!error)
+      return DmtxPass;
 
-      /* Compute syndromes (syn) */
-      error = RsComputeSyndromes(&syn, &rec, blockErrorWords);
+   /* For each interleaved block */
+   for(blockIdx = 0; blockIdx < blockStride; blockIdx++)
+   {
+      dmtxByteListInit(&syn, blockErrorWords + 1, 0, &passFail); CHKPASS;
 
-      /* Error(s) detected: Attempt repair */
-      if(error)
+      for(error = DmtxFalse, i = 1; i <= blockErrorWords; i++)
       {
-         /* Find error locator polynomial (elp) */
-         repairable = RsFindErrorLocatorPoly(&elp, &syn, blockErrorWords, blockMaxCorrectable);
-         if(!repairable)
-            return DmtxFail;
-
-         /* Find error positions (loc) */
-         repairable = RsFindErrorLocations(&loc, &elp);
-         if(!repairable)
-            return DmtxFail;
-
-         /* Find error values and repair */
-         RsRepairErrors(&rec, &loc, &elp, &syn);
+         syn.b[i] = synRows[i][blockIdx];
+         if(syn.b[i] != 0)
+            error = DmtxTrue;
       }
 
+      if(!error)
+         continue;
+
+      /* Data word count depends on blockIdx due to special case at 144x144 */
+      blockDataWords = dmtxGetBlockDataSize(sizeIdx, blockIdx);
+      blockTotalWords = blockErrorWords + blockDataWords;
+
+      /* Populate received list (rec) with final codeword first */
+      dmtxByteListInit(&rec, blockTotalWords, 0, &passFail); CHKPASS;
+      for(i = 0; i < blockTotalWords; i++)
+         rec.b[i] = rows[rowCount - 1 - i][blockIdx];
+
+      /* Find error locator polynomial (elp) */
+      repairable = RsFindErrorLocatorPoly(&elp, &syn, blockErrorWords, blockMaxCorrectable);
+      if(!repairable)
+         return DmtxFail;
+
+      /* Find error positions (loc) */
+      repairable = RsFindErrorLocations(&loc, &elp);
+      if(!repairable)
+         return DmtxFail;
+
+      /* Find error values and repair */
+      RsRepairErrors(&rec, &loc, &elp, &syn);
+      *correctedWords += loc.length;
+
       /*
-       * Overwrite output with correct/corrected values
+       * Overwrite output with corrected values
        */
 
       /* Start with first data word and work forward */
       word = code + blockIdx;
-      for(i = 0; i < blockDataWords; i++)
+      for(i = blockTotalWords - 1; i >= blockErrorWords; i--)
       {
-         *word = dmtxByteListPop(&rec, &passFail); CHKPASS;
+         *word = rec.b[i];
          word += blockStride;
       }
 
       /* Start with first error word and work forward */
       word = code + symbolDataWords + blockIdx;
-      for(i = 0; i < blockErrorWords; i++)
+      for(i = blockErrorWords - 1; i >= 0; i--)
       {
-         *word = dmtxByteListPop(&rec, &passFail); CHKPASS;
+         *word = rec.b[i];
          word += blockStride;
       }
    }
@@ -273,41 +831,86 @@ RsGenPoly(DmtxByteList *gen, int errorWordCount)
 }
 
 /**
- * Populate generator polynomial.
- * Assume we have received bits grouped into mm-bit symbols in rec[i],
- * i=0..(nn-1),  and rec[i] is index form (ie as powers of alpha). We first
- * compute the 2*tt syndromes by substituting alpha**i into rec(X) and
- * evaluating, storing the syndromes in syn[i], i=1..2tt (leave syn[0] zero).
- * \param syn
- * \param rec
+ * Compute syndromes for all interleaved blocks at once.
+ * Each received block rec(X) is evaluated at alpha**i, i=1..2tt, using
+ * Horner's rule over the codeword rows (first codeword is the highest power).
+ * Each row holds one codeword per block, so a row is processed with a
+ * vector multiply by the constant alpha**i when SSSE3 is available.
+ * \param syn Syndrome i of block b is returned in syn[i][b], syn[0] is zero
+ * \param rows De-interleaved codewords, rows[k][b] is codeword k of block b
+ * \param rowCount
+ * \param blockCount Number of interleaved blocks, unused columns of rows are zero
  * \param blockErrorWords
- * \return Are error(s) present? (DmtxPass|DmtxFail)
+ * \return Are error(s) present? (DmtxTrue|DmtxFalse)
  */
-/* XXX this CHKPASS isn't doing what we want ... really need a error reporting strategy */
-#undef CHKPASS
-#define CHKPASS { if(passFail == DmtxFail) return DmtxTrue; }
 static DmtxBoolean
-RsComputeSyndromes(DmtxByteList *syn, const DmtxByteList *rec, int blockErrorWords)
+RsComputeSyndromes(DmtxByte syn[][DmtxMaxInterleavedBlocks], DmtxByte rows[][DmtxMaxInterleavedBlocks],
+      int rowCount, int blockCount, int blockErrorWords)
 {
-   int i, j;
-   DmtxPassFail passFail;
+   int i, k;
+   DmtxByte alpha;
+#ifdef __SSSE3__
+   __m128i acc, any, lo, hi, mask;
+
+   mask = _mm_set1_epi8(0x0f);
+   any = _mm_setzero_si128();
+   _mm_storeu_si128((__m128i *)syn[0], any);
+
+   for(i = 1; i <= blockErrorWords; i++)
+   {
+      alpha = antilog301[i % NN];
+      lo = _mm_loadu_si128((const __m128i *)gfMulLo301[alpha]);
+      hi = _mm_loadu_si128((const __m128i *)gfMulHi301[alpha]);
+
+      acc = _mm_setzero_si128();
+      for(k = 0; k < rowCount; k++)
+      {
+         acc = _mm_xor_si128(
+               _mm_shuffle_epi8(lo, _mm_and_si128(acc, mask)),
+               _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(acc, 4), mask)));
+         acc = _mm_xor_si128(acc, _mm_loadu_si128((const __m128i *)rows[k]));
+      }
+
+      _mm_storeu_si128((__m128i *)syn[i], acc);
+      any = _mm_or_si128(any, acc);
+   }
+
+   /* Non-zero syndrome indicates presence of error(s) */
+   return (_mm_movemask_epi8(_mm_cmpeq_epi8(any, _mm_setzero_si128())) != 0xffff) ?
+         DmtxTrue : DmtxFalse;
+#else
+   int b;
+   DmtxByte *mulLo, *mulHi;
+   DmtxByte acc[DmtxMaxInterleavedBlocks];
    DmtxBoolean error = DmtxFalse;
 
-   /* Initialize all coefficients to 0 */
-   dmtxByteListInit(syn, blockErrorWords + 1, 0, &passFail); CHKPASS;
+   memset(syn[0], 0x00, blockCount * sizeof(DmtxByte));
 
-   for(i = 1; i < syn->length; i++)
+   for(i = 1; i <= blockErrorWords; i++)
    {
-      /* Calculate syndrome at i */
-      for(j = 0; j < rec->length; j++) /* alternatively: j < blockTotalWords */
-         syn->b[i] = GfAdd(syn->b[i], GfMultAntilog(rec->b[j], i*j));
+      alpha = antilog301[i % NN];
+      mulLo = gfMulLo301[alpha];
+      mulHi = gfMulHi301[alpha];
 
-      /* Non-zero syndrome indicates presence of error(s) */
-      if(syn->b[i] != 0)
-         error = DmtxTrue;
+      memset(acc, 0x00, blockCount * sizeof(DmtxByte));
+      for(k = 0; k < rowCount; k++)
+      {
+         for(b = 0; b < blockCount; b++)
+            acc[b] = mulLo[acc[b] & 0x0f] ^ mulHi[acc[b] >> 4] ^ rows[k][b];
+      }
+
+      for(b = 0; b < blockCount; b++)
+      {
+         syn[i][b] = acc[b];
+
+         /* Non-zero syndrome indicates presence of error(s) */
+         if(acc[b] != 0)
+            error = DmtxTrue;
+      }
    }
 
    return error;
+#endif
 }
 
 /**
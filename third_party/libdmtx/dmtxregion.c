@@ -65,18 +65,26 @@ dmtxRegionFindNext(DmtxDecode *dec, DmtxTime *timeout)
 
    /* Continue until we find a region or run out of chances */
    for(;;) {
-      locStatus = PopGridLocation(&(dec->grid), &loc);
+      locStatus = PopScanLocation(dec, &loc);
       if(locStatus == DmtxRangeEnd)
          break;
 
+      DmtxStatsAdd(dec, probes, 1);
+
       /* Scan location for presence of valid barcode region */
       reg = dmtxRegionScanPixel(dec, loc.X, loc.Y);
-      if(reg != NULL)
+      if(reg != NULL) {
+         DmtxStatsAdd(dec, regions, 1);
          return reg;
+      }
 
       /* Ran out of time? */
       if(timeout != NULL && dmtxTimeExceeded(*timeout))
          break;
+
+      /* Cancelled by another thread? */
+      if(dec->cancel != NULL && (*dec->cancel)(dec->cancelContext) != 0)
+         break;
    }
 
    return NULL;
@@ -103,7 +111,7 @@ dmtxRegionScanPixel(DmtxDecode *dec, int x, int y)
    if(cache == NULL)
       return NULL;
 
-   if((int)(*cache & 0x80) != 0x00)
+   if(CacheVisited(dec, loc.X, loc.Y) == DmtxTrue)
       return NULL;
 
    /* Test for presence of any reasonable edge at this location */
@@ -111,31 +119,38 @@ dmtxRegionScanPixel(DmtxDecode *dec, int x, int y)
    if(flowBegin.mag < (int)(dec->edgeThresh * 7.65 + 0.5))
       return NULL;
 
+   DmtxStatsAdd(dec, candidates, 1);
+
    memset(&reg, 0x00, sizeof(DmtxRegion));
 
    /* Determine barcode orientation */
-   if(MatrixRegionOrientation(dec, &reg, flowBegin) == DmtxFail)
-      return NULL;
-   if(dmtxRegionUpdateXfrms(dec, &reg) == DmtxFail)
+   if(MatrixRegionOrientation(dec, &reg, flowBegin) == DmtxFail ||
+         dmtxRegionUpdateXfrms(dec, &reg) == DmtxFail) {
+      DmtxStatsAdd(dec, rejectOrientation, 1);
       return NULL;
+   }
 
    /* Define top edge */
-   if(MatrixRegionAlignCalibEdge(dec, &reg, DmtxEdgeTop) == DmtxFail)
-      return NULL;
-   if(dmtxRegionUpdateXfrms(dec, &reg) == DmtxFail)
+   if(MatrixRegionAlignCalibEdge(dec, &reg, DmtxEdgeTop) == DmtxFail ||
+         dmtxRegionUpdateXfrms(dec, &reg) == DmtxFail) {
+      DmtxStatsAdd(dec, rejectCalibEdge, 1);
       return NULL;
+   }
 
    /* Define right edge */
-   if(MatrixRegionAlignCalibEdge(dec, &reg, DmtxEdgeRight) == DmtxFail)
-      return NULL;
-   if(dmtxRegionUpdateXfrms(dec, &reg) == DmtxFail)
+   if(MatrixRegionAlignCalibEdge(dec, &reg, DmtxEdgeRight) == DmtxFail ||
+         dmtxRegionUpdateXfrms(dec, &reg) == DmtxFail) {
+      DmtxStatsAdd(dec, rejectCalibEdge, 1);
       return NULL;
+   }
 
    CALLBACK_MATRIX(&reg);
 
    /* Calculate the best fitting symbol size */
-   if(MatrixRegionFindSize(dec, &reg) == DmtxFail)
+   if(MatrixRegionFindSize(dec, &reg) == DmtxFail) {
+      DmtxStatsAdd(dec, rejectSize, 1);
       return NULL;
+   }
 
    /* Found a valid matrix region */
    return dmtxRegionCreate(&reg);
@@ -916,7 +931,7 @@ FindStrongestNeighbor(DmtxDecode *dec, DmtxPointFlow center, int sign)
       if(cache == NULL)
          continue;
 
-      if((int)(*cache & 0x80) != 0x00) {
+      if(CacheVisited(dec, loc.X, loc.Y) == DmtxTrue) {
          if(++occupied > 2)
             return dmtxBlankEdge;
          else
@@ -1062,6 +1077,9 @@ FollowStep2(DmtxDecode *dec, DmtxFollow followBeg, int sign)
  * 0x40 a = assigned bit
  * 0x38 u = 3 bits points upstream 0-7
  * 0x07 d = 3 bits points downstream 0-7
+ *
+ * The visited bit is only accessed through CacheVisited() and friends since it
+ * is kept in a separate bitmap when built with DMTX_CACHE_TILED.
  */
 static DmtxPassFail
 TrailBlazeContinuous(DmtxDecode *dec, DmtxRegion *reg, DmtxPointFlow flowBegin, int maxDiagonal)
@@ -1077,7 +1095,8 @@ TrailBlazeContinuous(DmtxDecode *dec, DmtxRegion *reg, DmtxPointFlow flowBegin,
    cacheBeg = dmtxDecodeGetCache(dec, flowBegin.loc.X, flowBegin.loc.Y);
    if(cacheBeg == NULL)
       return DmtxFail;
-   *cacheBeg = (0x80 | 0x40); /* Mark location as visited and assigned */
+   *cacheBeg = 0x40; /* Mark location as assigned and visited */
+   CacheSetVisited(dec, flowBegin.loc.X, flowBegin.loc.Y);
 
    reg->flowBegin = flowBegin;
 
@@ -1102,7 +1121,7 @@ TrailBlazeContinuous(DmtxDecode *dec, DmtxRegion *reg, DmtxPointFlow flowBegin,
          cacheNext = dmtxDecodeGetCache(dec, flowNext.loc.X, flowNext.loc.Y);
          if(cacheNext == NULL)
             break;
-         assert(!(*cacheNext & 0x80));
+         assert(CacheVisited(dec, flowNext.loc.X, flowNext.loc.Y) == DmtxFalse);
 
          /* Mark departure from current location. If flowing downstream
           * (sign < 0) then departure vector here is the arrival vector
@@ -1113,7 +1132,8 @@ TrailBlazeContinuous(DmtxDecode *dec, DmtxRegion *reg, DmtxPointFlow flowBegin,
          /* If testing downstream (sign < 0) then next upstream is opposite of next arrival */
          /* If testing upstream (sign > 0) then next downstream is opposite of next arrival */
          *cacheNext = (sign < 0) ? (((flowNext.arrive + 4)%8) << 3) : ((flowNext.arrive + 4)%8);
-         *cacheNext |= (0x80 | 0x40); /* Mark location as visited and assigned */
+         *cacheNext |= 0x40; /* Mark location as assigned and visited */
+         CacheSetVisited(dec, flowNext.loc.X, flowNext.loc.Y);
          if(sign > 0)
             posAssigns++;
          else
@@ -1191,6 +1211,7 @@ TrailBlazeGapped(DmtxDecode *dec, DmtxRegion *reg, DmtxBresLine line, int stream
       return DmtxFail;
    else
       *beforeCache = 0x00; /* probably should just overwrite one direction */
+   CacheClearVisited(dec, loc0.X, loc0.Y);
 
    do {
       if(onEdge == DmtxTrue) {
@@ -1235,6 +1256,7 @@ TrailBlazeGapped(DmtxDecode *dec, DmtxRegion *reg, DmtxBresLine line, int stream
          *beforeCache |= (0x40 | (stepDir << 3));
          *afterCache = ((stepDir + 4)%8);
       }
+      CacheClearVisited(dec, afterStep.X, afterStep.Y);
 
       /* Guaranteed to have taken one step since top of loop */
       xDiff = line.loc.X - loc0.X;
@@ -1266,7 +1288,13 @@ TrailClear(DmtxDecode *dec, DmtxRegion *reg, int clearMask)
    clears = 0;
    follow = FollowSeek(dec, reg, 0);
    while(abs(follow.step) <= reg->stepsTotal) {
-      assert((int)(*follow.ptr & clearMask) != 0x00);
+      if(clearMask & 0x80) {
+         assert(CacheVisited(dec, follow.loc.X, follow.loc.Y) == DmtxTrue);
+         CacheClearVisited(dec, follow.loc.X, follow.loc.Y);
+      }
+      else {
+         assert((int)(*follow.ptr & clearMask) != 0x00);
+      }
       *follow.ptr &= (clearMask ^ 0xff);
       follow = FollowStep(dec, reg, follow, +1);
       clears++;
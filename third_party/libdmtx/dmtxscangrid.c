@@ -56,9 +56,244 @@ InitScanGrid(DmtxDecode *dec)
 
    SetDerivedFields(&grid);
 
+   /* Edge density order is rebuilt from the new grid on first use */
+   dec->scanLocCount = DmtxUndefined;
+
    return grid;
 }
 
+/**
+ * \brief  Return the next location to scan using the decoder's scan order.
+ *         Grid order visits locations in the fixed cross pattern. Edge density
+ *         order visits the same locations grouped by the grid cell they fall
+ *         in, highest contrast cells first, and skips cells that are too flat
+ *         to contain an edge.
+ * \param  dec
+ * \param  locPtr
+ * \return DmtxRangeGood | DmtxRangeEnd
+ */
+static int
+PopScanLocation(DmtxDecode *dec, DmtxPixelLoc *locPtr)
+{
+   if(dec->scanOrder == DmtxScanOrderEdgeDensity && dec->scanLocCount == DmtxUndefined) {
+      /* Fall back to grid order for this grid only if work area can't be allocated */
+      if(SortScanLocations(dec) == DmtxFail)
+         dec->scanLocCount = DmtxScanLocGridFallback;
+   }
+
+   if(dec->scanOrder != DmtxScanOrderEdgeDensity || dec->scanLocCount == DmtxScanLocGridFallback)
+      return PopGridLocation(&(dec->grid), locPtr);
+
+   if(dec->scanLocNext >= dec->scanLocCount) {
+      locPtr->X = locPtr->Y = -1;
+      return DmtxRangeEnd;
+   }
+
+   *locPtr = dec->scanLocs[dec->scanLocNext++];
+
+   return DmtxRangeGood;
+}
+
+/**
+ * \brief  Build list of grid locations in edge density order. The image is
+ *         divided into cells the size of the finest cross spacing. Each cell
+ *         gets the contrast (max - min) and the density of strong pixel to
+ *         pixel steps over its pixels plus a one pixel border. Locations are
+ *         visited from the densest cell down, so the many small edges of a
+ *         symbol are tried before long single edges such as tube walls, and
+ *         each cell keeps the coarse to fine grid order.
+ *         A location can only start a region if its 3x3 edge magnitude, at
+ *         most 4 * contrast, reaches the edge threshold, so cells below that
+ *         are dropped without changing what can be found.
+ * \param  dec
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail
+SortScanLocations(DmtxDecode *dec)
+{
+   int cell, cellSize, cellCols, cellRows, cellCount;
+   int xBeg, yBeg, xEnd, yEnd;
+   int level, levelCount, extent;
+   int key, keyCount, minMag, minStep, contrast, total, start;
+   int *density, *bucket, *cells;
+   DmtxPixelLoc loc, *locs;
+   DmtxScanGrid grid;
+
+   grid = dec->grid;
+   cellSize = grid.minExtent + 1;
+   cellCols = (grid.xMax - grid.xMin) / cellSize + 1;
+   cellRows = (grid.yMax - grid.yMin) / cellSize + 1;
+   cellCount = cellCols * cellRows;
+
+   for(levelCount = 0, extent = grid.maxExtent; extent > 0 && extent >= grid.minExtent; extent /= 2)
+      levelCount++;
+   keyCount = levelCount * 256;
+
+   if(cellCount + keyCount > dec->scanCellsSize || dec->scanCells == NULL) {
+      cells = (int *)malloc((cellCount + keyCount) * sizeof(int));
+      if(cells == NULL)
+         return DmtxFail;
+
+      if(dec->scanCells != NULL)
+         free(dec->scanCells);
+
+      dec->scanCells = cells;
+      dec->scanCellsSize = cellCount + keyCount;
+   }
+
+   density = dec->scanCells;
+   bucket = dec->scanCells + cellCount;
+   minMag = (int)(dec->edgeThresh * 7.65 + 0.5);
+   minStep = (minMag + 3) / 4;
+
+   /* Rate each cell, the border covers the 3x3 neighborhood of edge pixels */
+   for(cell = 0; cell < cellCount; cell++) {
+      xBeg = grid.xMin + (cell % cellCols) * cellSize;
+      yBeg = grid.yMin + (cell / cellCols) * cellSize;
+      xEnd = min(xBeg + cellSize - 1, grid.xMax);
+      yEnd = min(yBeg + cellSize - 1, grid.yMax);
+
+      density[cell] = GetCellDensity(dec, xBeg - 1, yBeg - 1, xEnd + 1, yEnd + 1,
+            minStep, &contrast);
+      if(4 * contrast < minMag)
+         density[cell] = DmtxUndefined;
+   }
+
+   /* Count grid locations by level and density, skipping flat cells */
+   memset(bucket, 0x00, keyCount * sizeof(int));
+   while(PopGridLocation(&grid, &loc) != DmtxRangeEnd) {
+      cell = ((loc.Y - grid.yMin) / cellSize) * cellCols + (loc.X - grid.xMin) / cellSize;
+      if(density[cell] == DmtxUndefined)
+         continue;
+
+      for(level = 0, extent = grid.maxExtent; extent > grid.extent; extent /= 2)
+         level++;
+      bucket[level * 256 + 255 - density[cell]]++;
+   }
+
+   for(start = 0, key = 0; key < keyCount; key++) {
+      total = bucket[key];
+      bucket[key] = start;
+      start += total;
+   }
+
+   if(start > dec->scanLocsSize || dec->scanLocs == NULL) {
+      locs = (DmtxPixelLoc *)malloc(max(start, 1) * sizeof(DmtxPixelLoc));
+      if(locs == NULL)
+         return DmtxFail;
+
+      if(dec->scanLocs != NULL)
+         free(dec->scanLocs);
+
+      dec->scanLocs = locs;
+      dec->scanLocsSize = max(start, 1);
+   }
+
+   /* Place locations, keeping grid order among equal keys */
+   grid = dec->grid;
+   while(PopGridLocation(&grid, &loc) != DmtxRangeEnd) {
+      cell = ((loc.Y - grid.yMin) / cellSize) * cellCols + (loc.X - grid.xMin) / cellSize;
+      if(density[cell] == DmtxUndefined)
+         continue;
+
+      for(level = 0, extent = grid.maxExtent; extent > grid.extent; extent /= 2)
+         level++;
+      dec->scanLocs[bucket[level * 256 + 255 - density[cell]]++] = loc;
+   }
+
+   dec->scanLocCount = start;
+   dec->scanLocNext = 0;
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Rate a box of scaled pixel locations by edge density, the fraction
+ *         of horizontal and vertical pixel steps of at least minStep
+ * \param  dec
+ * \param  xBeg
+ * \param  yBeg
+ * \param  xEnd Inclusive
+ * \param  yEnd Inclusive
+ * \param  minStep
+ * \param  contrast Returns max - min of the channel with the highest contrast
+ * \return Edge density 0-255
+ */
+static int
+GetCellDensity(DmtxDecode *dec, int xBeg, int yBeg, int xEnd, int yEnd, int minStep, int *contrast)
+{
+   int x, y, channel;
+   int value = 0, left = 0, up = 0;
+   int lo, hi, steps, stepTotal;
+   int scale, rowOffset, rowStep;
+   unsigned char *ptr;
+   DmtxImage *img;
+
+   img = dec->image;
+   scale = dec->scale;
+
+   xBeg = max(xBeg, 0);
+   yBeg = max(yBeg, 0);
+   xEnd = min(xEnd, img->width / scale - 1);
+   yEnd = min(yEnd, img->height / scale - 1);
+
+   *contrast = 0;
+   if(xBeg > xEnd || yBeg > yEnd)
+      return 0;
+
+   stepTotal = 2 * (xEnd - xBeg + 1) * (yEnd - yBeg + 1);
+   steps = 0;
+
+   /* Fast path for 8 bit grayscale images */
+   if(img->channelCount == 1 && img->bytesPerPixel == 1 && img->bitsPerChannel[0] == 8) {
+      rowStep = (img->imageFlip & DmtxFlipY) ? img->rowSizeBytes * scale :
+            -img->rowSizeBytes * scale;
+      lo = 255;
+      hi = 0;
+      for(y = yBeg; y <= yEnd; y++) {
+         rowOffset = (img->imageFlip & DmtxFlipY) ? y * scale :
+               img->height - y * scale - 1;
+         ptr = img->pxl + rowOffset * img->rowSizeBytes + xBeg * scale;
+         for(x = xBeg; x <= xEnd; x++, ptr += scale) {
+            lo = min(lo, *ptr);
+            hi = max(hi, *ptr);
+            if(x > xBeg && abs(*ptr - *(ptr - scale)) >= minStep)
+               steps++;
+            if(y > yBeg && abs(*ptr - *(ptr - rowStep)) >= minStep)
+               steps++;
+         }
+      }
+      *contrast = hi - lo;
+      return (steps * 255) / stepTotal;
+   }
+
+   for(channel = 0; channel < img->channelCount; channel++) {
+      lo = 255;
+      hi = 0;
+      for(y = yBeg; y <= yEnd; y++) {
+         for(x = xBeg; x <= xEnd; x++) {
+            if(dmtxDecodeGetPixelValue(dec, x, y, channel, &value) == DmtxFail)
+               continue;
+            lo = min(lo, value);
+            hi = max(hi, value);
+
+            /* Steps are only counted on the first channel */
+            if(channel > 0)
+               continue;
+            if(x > xBeg && dmtxDecodeGetPixelValue(dec, x - 1, y, channel, &left) == DmtxPass &&
+                  abs(value - left) >= minStep)
+               steps++;
+            if(y > yBeg && dmtxDecodeGetPixelValue(dec, x, y - 1, channel, &up) == DmtxPass &&
+                  abs(value - up) >= minStep)
+               steps++;
+         }
+      }
+      *contrast = max(*contrast, hi - lo);
+   }
+
+   return (steps * 255) / stepTotal;
+}
+
 /**
  * \brief  Return the next good location (which may be the current location),
  *         and advance grid progress one position beyond that. If no good
@@ -49,6 +49,26 @@
 #define DmtxChannelUnsupportedChar  0x01 << 0
 #define DmtxChannelCannotUnlatch    0x01 << 1
 
+/*
+ * When built with DMTX_CACHE_TILED the per-pixel trail cache is stored in
+ * 8x8 pixel tiles, and the visited bit lives in a separate row-major bitmap
+ * with one bit per pixel.
+ */
+#define DmtxCacheTileBits              3
+#define DmtxCacheTileSize              (1 << DmtxCacheTileBits)
+#define DmtxCacheTileMask              (DmtxCacheTileSize - 1)
+#define DmtxVisitedWordBits           64
+
+/* scanLocCount when edge density order could not be built for this grid */
+#define DmtxScanLocGridFallback       -2
+
+/* Interleaved blocks processed together by Reed-Solomon syndrome calculation */
+#define DmtxMaxInterleavedBlocks      16
+
+/* Add to a decode statistics counter, if statistics are being collected */
+#define DmtxStatsAdd(dec,field,n) \
+   do { if((dec)->stats != NULL) (dec)->stats->field += (n); } while(0)
+
 #undef min
 #define min(X,Y) (((X) < (Y)) ? (X) : (Y))
 
@@ -149,6 +169,12 @@ static DmtxPassFail BresLineStep(DmtxBresLine *line, int travel, int outward);
 /*static void WriteDiagnosticImage(DmtxDecode *dec, DmtxRegion *reg, char *imagePath);*/
 
 /* dmtxdecode.c */
+static DmtxPassFail CacheReserve(DmtxDecode *dec, int width, int height);
+static DmtxBoolean CacheVisited(DmtxDecode *dec, int x, int y);
+static void CacheSetVisited(DmtxDecode *dec, int x, int y);
+static void CacheClearVisited(DmtxDecode *dec, int x, int y);
+static void SetDecodeProp(DmtxDecode *dec, int prop, int value);
+static DmtxPassFail ValidateDecodeProps(DmtxDecode *dec);
 static void TallyModuleJumps(DmtxDecode *dec, DmtxRegion *reg, int tally[][24], int xOrigin, int yOrigin, int mapWidth, int mapHeight, DmtxDirection dir);
 static DmtxPassFail PopulateArrayFromMatrix(DmtxDecode *dec, DmtxRegion *reg, DmtxMessage *msg);
 
@@ -181,9 +207,9 @@ static void PlaceModule(unsigned char *modules, int mappingRows, int mappingCols
 
 /* dmtxreedsol.c */
 static DmtxPassFail RsEncode(DmtxMessage *message, int sizeIdx);
-static DmtxPassFail RsDecode(unsigned char *code, int sizeIdx, int fix);
+static DmtxPassFail RsDecode(unsigned char *code, int sizeIdx, int fix, int *correctedWords);
 static DmtxPassFail RsGenPoly(DmtxByteList *gen, int errorWordCount);
-static DmtxBoolean RsComputeSyndromes(DmtxByteList *syn, const DmtxByteList *rec, int blockErrorWords);
+static DmtxBoolean RsComputeSyndromes(DmtxByte syn[][DmtxMaxInterleavedBlocks], DmtxByte rows[][DmtxMaxInterleavedBlocks], int rowCount, int blockCount, int blockErrorWords);
 static DmtxBoolean RsFindErrorLocatorPoly(DmtxByteList *elp, const DmtxByteList *syn, int errorWordCount, int maxCorrectable);
 static DmtxBoolean RsFindErrorLocations(DmtxByteList *loc, const DmtxByteList *elp);
 static DmtxPassFail RsRepairErrors(DmtxByteList *rec, const DmtxByteList *loc, const DmtxByteList *elp, const DmtxByteList *syn);
@@ -191,6 +217,9 @@ static DmtxPassFail RsRepairErrors(DmtxByteList *rec, const DmtxByteList *loc, c
 /* dmtxscangrid.c */
 static DmtxScanGrid InitScanGrid(DmtxDecode *dec);
 static int PopGridLocation(DmtxScanGrid *grid, /*@out@*/ DmtxPixelLoc *locPtr);
+static int PopScanLocation(DmtxDecode *dec, /*@out@*/ DmtxPixelLoc *locPtr);
+static DmtxPassFail SortScanLocations(DmtxDecode *dec);
+static int GetCellDensity(DmtxDecode *dec, int xBeg, int yBeg, int xEnd, int yEnd, int minStep, /*@out@*/ int *contrast);
 static int GetGridCoordinates(DmtxScanGrid *grid, /*@out@*/ DmtxPixelLoc *locPtr);
 static void SetDerivedFields(DmtxScanGrid *grid);
 